@@ -1,18 +1,55 @@
 import asyncio
+import struct
 from bleak import BleakScanner
 
+# Status record in the manufacturer data of an EasyDSP advertisement.
+# See BLE_STATUS_LEN in ble.h for the layout. Bleak strips the company id.
+STATUS_COMPANY_ID      = 0xFFFF
+STATUS_FORMAT          = 2
+STATUS_FLAG_DSP_FAILED = 0x01
+
+# q, s, bandwidth, boost, freq and gain are an int32 in hundredths, for
+# reads and writes. See ble.txt.
+def encode_float(value):
+    return struct.pack("<i", int(round(value * 100)))
+
+def decode_float(data):
+    return struct.unpack("<i", bytes(data))[0] / 100
+
 # Fucntions
 async def scan():
-    devices = await BleakScanner.discover()
+    devices = await BleakScanner.discover(return_adv=True)
 
     return devices
 
+def parse_status(adv):
+    data = adv.manufacturer_data.get(STATUS_COMPANY_ID)
+    if data is None or len(data) < 10 or data[0] != STATUS_FORMAT:
+        return None
+
+    fmt, preset, version, flags, major, minor, patch = \
+        struct.unpack_from("<BBIBBBB", data)
+
+    return {
+        "preset":     preset,
+        "version":    version,
+        "dsp_failed": bool(flags & STATUS_FLAG_DSP_FAILED),
+        "firmware":   "%d.%d.%d" % (major, minor, patch),
+    }
+
 # Main program
 async def main():
     devices = await scan()
 
-    for device in devices:
-        print(device)
+    for device, adv in devices.values():
+        status = parse_status(adv)
+        if status is None:
+            print(device)
+        else:
+            print("%s rssi %d preset %d settings v%d %s firmware %s" % (
+                  device, adv.rssi, status["preset"], status["version"],
+                  "DSP FAILED" if status["dsp_failed"] else "DSP ok",
+                  status["firmware"]))
 
 # Run main program
-asyncio.run(main())
\ No newline at end of file
+asyncio.run(main())
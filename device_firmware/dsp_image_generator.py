@@ -0,0 +1,219 @@
+#####################################################################
+#                  EASYDSP DSP IMAGE GENERATOR SCRIPT                #
+#                                                                   #
+# Builds the contents of the dsp_images flash partition from one or #
+# more program headers in the format of                             #
+# main/sigma_dsp_program_data.h. Every header becomes one image,    #
+# the images are stored side by side in slots of SLOT_SIZE.         #
+#                                                                   #
+# The image layout is described in main/dsp_image.h. RAM sections  #
+# are stored sparse: a clear section for the region without data,   #
+# then the runs of non-zero registers as data sections.             #
+#                                                                   #
+# The firmware writes settings to the module addresses it was built #
+# with, so every program needs its module header in the format of   #
+# main/sigma_dsp_module_data.h. The image keeps a hash of the       #
+# module addresses and the firmware only switches between images    #
+# with the same layout.                                             #
+#                                                                   #
+# Usage:                                                            #
+#  python dsp_image_generator.py -o dsp_images.bin                  #
+#         program.h [...] -m module.h [...]                         #
+#####################################################################
+
+import argparse
+import hashlib
+import re
+import struct
+import sys
+import zlib
+
+SLOT_SIZE      = 0x8000
+PARTITION_SIZE = 0x20000
+MAGIC          = 0x50534445  # "EDSP"
+FORMAT         = 3
+SECTION_MAX    = 64
+
+SECTION_DATA   = 0
+SECTION_CLEAR  = 1
+
+# The firmware writes the image hash to the last parameter word after a
+# download, SIGMA_DSP_IMAGE_MARKER_ADDR in sigma_dsp.h. The program must
+# not use it.
+MARKER_ADDR    = 0x03FF
+
+# Zero gaps up to this many bytes are cheaper to write than to start a
+# new I2C transaction for the next run.
+MERGE_GAP      = 8
+
+# magic, size, crc, format, section amount, version, hash, layout
+HEADER_FORMAT  = "<IIIHHIII"
+# address, regsize, type, offset, len
+SECTION_FORMAT = "<HBBII"
+CRC_START      = 12
+
+# Sections in the order SigmaStudio downloads them: stop the core, load
+# program and parameters, configure the hardware, start the core.
+DOWNLOAD_ORDER = [
+    ("CORE_REGISTER_R0", "dsp_core_register_R0_data"),
+    ("PROGRAM",          "dsp_program_data"),
+    ("PARAMETER",        "dsp_parameter_data"),
+    ("HARDWARE_CONF",    "dsp_hardware_conf_data"),
+    ("CORE_REGISTER_R4", "dsp_core_register_R4_data"),
+]
+
+
+def parse_header(path):
+    with open(path) as file:
+        content = file.read()
+
+    defines = {name: int(value, 0) for name, value in
+               re.findall(r"#define\s+(\w+)\s+(0x[0-9A-Fa-f]+|\d+)", content)}
+
+    arrays = {}
+    for name, body in re.findall(r"(\w+)\s*\[\w*\]\s*=\s*\{([^}]*)\}", content):
+        arrays[name] = bytes(int(value, 0) for value in
+                             re.findall(r"0x[0-9A-Fa-f]+|\d+", body))
+
+    sections = []
+    for prefix, array in DOWNLOAD_ORDER:
+        data = arrays[array]
+        if len(data) != defines[prefix + "_SIZE"]:
+            sys.exit("%s: %s has %d bytes, expected %d" %
+                     (path, array, len(data), defines[prefix + "_SIZE"]))
+        sections.append((defines[prefix + "_ADDR"],
+                         defines[prefix + "_REGSIZE"],
+                         data))
+
+    address = defines["PARAMETER_ADDR"]
+    regsize = defines["PARAMETER_REGSIZE"]
+    marker  = (MARKER_ADDR - address) * regsize
+    data    = arrays["dsp_parameter_data"]
+    if 0 <= marker < len(data) and any(data[marker:marker + regsize]):
+        sys.exit("%s: parameter word 0x%04X is not 0, the firmware keeps "
+                 "the image hash there" % (path, MARKER_ADDR))
+    return sections
+
+
+def parse_layout(path):
+    """Hash of the module addresses, 0 is never used."""
+    with open(path) as file:
+        content = file.read()
+
+    addresses = sorted(re.findall(r"#define\s+(MOD_\w+_ADDR)\s+(0x[0-9A-Fa-f]+|\d+)",
+                                  content))
+    if not addresses:
+        sys.exit("%s: no module addresses" % path)
+    for name, value in addresses:
+        if int(value, 0) == MARKER_ADDR:
+            sys.exit("%s: %s is 0x%04X, the firmware keeps the image hash "
+                     "there" % (path, name, MARKER_ADDR))
+    text = "".join("%s=%d\n" % (name, int(value, 0)) for name, value in addresses)
+    return int(hashlib.sha256(text.encode()).hexdigest()[:8], 16) or 1
+
+
+def data_runs(regsize, data):
+    """Byte ranges of the non-zero registers, on register boundaries.
+    Short zero gaps stay part of the surrounding run."""
+    runs = []
+    for start in range(0, len(data), regsize):
+        if not any(data[start:start + regsize]):
+            continue
+        if runs and start - runs[-1][1] <= MERGE_GAP:
+            runs[-1][1] = start + regsize
+        else:
+            runs.append([start, start + regsize])
+    return runs
+
+
+def split_sections(sections):
+    """Program and parameter RAM become one clear section for the whole
+    region followed by its data runs. Registers are written completely,
+    every byte of them configures something."""
+    result = []
+    for address, regsize, data in sections:
+        runs = data_runs(regsize, data) if regsize > 1 else []
+        if regsize == 1 or runs == [[0, len(data)]]:
+            result.append((address, regsize, SECTION_DATA, data))
+            continue
+        result.append((address, regsize, SECTION_CLEAR, data))
+        for start, end in runs:
+            result.append((address + start // regsize,
+                           regsize,
+                           SECTION_DATA,
+                           data[start:end]))
+    return result
+
+
+def build_image(sections, version, layout):
+    sections = split_sections(sections)
+    if len(sections) > SECTION_MAX:
+        sys.exit("Image has %d sections, the firmware takes %d" %
+                 (len(sections), SECTION_MAX))
+
+    header_size = struct.calcsize(HEADER_FORMAT) + \
+                  len(sections) * struct.calcsize(SECTION_FORMAT)
+    table       = b""
+    payload     = b""
+    for address, regsize, kind, data in sections:
+        table   += struct.pack(SECTION_FORMAT,
+                               address,
+                               regsize,
+                               kind,
+                               header_size + len(payload) if kind == SECTION_DATA else 0,
+                               len(data))
+        if kind == SECTION_DATA:
+            payload += data
+
+    # 28 bits, the firmware keeps it in one DSP parameter word. 0 means
+    # "always download". The table is hashed too, it holds the addresses.
+    image_hash = int(hashlib.sha256(table + payload).hexdigest()[:7], 16) or 1
+
+    size  = header_size + len(payload)
+    fixed = struct.pack(HEADER_FORMAT,
+                        MAGIC, size, 0, FORMAT, len(sections), version, image_hash,
+                        layout)
+    image = fixed + table + payload
+
+    # Same CRC as esp_crc32_le(0, ...) on the device.
+    crc = zlib.crc32(image[CRC_START:]) & 0xFFFFFFFF
+    return image[:8] + struct.pack("<I", crc) + image[CRC_START:]
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Build the DSP image partition.")
+    parser.add_argument("-o", "--output", required=True)
+    parser.add_argument("-v", "--version", type=int, default=1,
+                        help="version of the first image, the next ones count up")
+    parser.add_argument("-m", "--modules", nargs="+", required=True,
+                        help="module header of every program, in the same order")
+    parser.add_argument("headers", nargs="+")
+    args = parser.parse_args()
+
+    if len(args.headers) > PARTITION_SIZE // SLOT_SIZE:
+        sys.exit("Too many images for the partition")
+    if len(args.modules) != len(args.headers):
+        sys.exit("%d module headers for %d programs" %
+                 (len(args.modules), len(args.headers)))
+
+    partition = b""
+    for index, (header, modules) in enumerate(zip(args.headers, args.modules)):
+        # Erased flash between the images.
+        partition += b"\xFF" * (index * SLOT_SIZE - len(partition))
+        image = build_image(parse_header(header),
+                            args.version + index,
+                            parse_layout(modules))
+        if len(image) > SLOT_SIZE:
+            sys.exit("%s: image is %d bytes, a slot is %d" %
+                     (header, len(image), SLOT_SIZE))
+        partition += image
+        print("Image %d: %s, %d bytes, %d sections, layout %08X" %
+              (index, header, len(image), struct.unpack_from("<H", image, 14)[0],
+               struct.unpack_from("<I", image, 28)[0]))
+
+    with open(args.output, "wb") as file:
+        file.write(partition)
+
+
+if __name__ == "__main__":
+    main()
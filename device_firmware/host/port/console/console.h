@@ -0,0 +1,13 @@
+/*
+ * console.h
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Host stand-in for the NimBLE console, nothing the firmware uses.
+ *
+ */
+#ifndef CONSOLE_H_
+#define CONSOLE_H_
+
+#endif /* CONSOLE_H_ */
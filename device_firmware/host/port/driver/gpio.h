@@ -0,0 +1,49 @@
+/*
+ * gpio.h
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Host port of the GPIO driver. Levels are kept per pin, simulated
+ * devices watch the pins they are wired to, see host_gpio_watch().
+ *
+ */
+#ifndef GPIO_H_
+#define GPIO_H_
+
+/******************************* INCLUDES ********************************/
+
+#include <stdint.h>
+#include "esp_err.h"
+
+/******************************* DEFINES *********************************/
+
+#define GPIO_NUM_NC      -1
+#define GPIO_NUM_4       4
+#define GPIO_NUM_MAX     49
+
+/******************************* TYPEDEFS ********************************/
+
+typedef int gpio_num_t;
+
+typedef enum
+{
+    GPIO_MODE_DISABLE,
+    GPIO_MODE_INPUT,
+    GPIO_MODE_OUTPUT,
+    GPIO_MODE_INPUT_OUTPUT,
+} gpio_mode_t;
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+esp_err_t gpio_reset_pin(gpio_num_t gpio_num);
+
+esp_err_t gpio_set_direction(gpio_num_t gpio_num, gpio_mode_t mode);
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level);
+
+int gpio_get_level(gpio_num_t gpio_num);
+
+/******************************* THE END *********************************/
+
+#endif /* GPIO_H_ */
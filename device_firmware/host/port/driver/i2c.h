@@ -0,0 +1,130 @@
+/*
+ * i2c.h
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Host port of the legacy I2C driver with command links, the one the
+ * firmware uses before ESP-IDF 5.3. A command link goes out as one
+ * transaction on the simulated bus, see sim/sim_i2c.h.
+ *
+ */
+#ifndef I2C_H_
+#define I2C_H_
+
+/******************************* INCLUDES ********************************/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "driver/gpio.h"
+#include "freertos/FreeRTOS.h"
+
+/******************************* DEFINES *********************************/
+
+// Start, address, header, start, address, data and stop per transaction.
+#define I2C_LINK_OPS_PER_TRANSACTION 7
+#define I2C_LINK_RECOMMENDED_SIZE(TRANSACTIONS)                      \
+    (sizeof(i2c_cmd_link_t) +                                        \
+     (TRANSACTIONS) * I2C_LINK_OPS_PER_TRANSACTION * sizeof(i2c_cmd_t))
+
+/******************************* TYPEDEFS ********************************/
+
+typedef int i2c_port_t;
+
+typedef enum
+{
+    I2C_MODE_SLAVE,
+    I2C_MODE_MASTER,
+} i2c_mode_t;
+
+typedef enum
+{
+    I2C_MASTER_ACK,
+    I2C_MASTER_NACK,
+    I2C_MASTER_LAST_NACK,
+} i2c_ack_type_t;
+
+typedef struct
+{
+    i2c_mode_t mode;
+    gpio_num_t sda_io_num;
+    gpio_num_t scl_io_num;
+    bool       sda_pullup_en;
+    bool       scl_pullup_en;
+    struct
+    {
+        uint32_t clk_speed;
+    } master;
+    uint32_t   clk_flags;
+} i2c_config_t;
+
+typedef enum
+{
+    I2C_CMD_START,
+    I2C_CMD_WRITE,
+    I2C_CMD_READ,
+    I2C_CMD_STOP,
+} i2c_cmd_op_t;
+
+// Written data is not copied, it has to stay until i2c_master_cmd_begin().
+typedef struct
+{
+    i2c_cmd_op_t  op;
+    uint8_t       byte;
+    const uint8_t *write;
+    uint8_t       *read;
+    size_t        len;
+} i2c_cmd_t;
+
+typedef struct
+{
+    size_t    amount;
+    size_t    size;
+    i2c_cmd_t cmds[];
+} i2c_cmd_link_t;
+
+typedef void* i2c_cmd_handle_t;
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+esp_err_t i2c_param_config(i2c_port_t i2c_num, const i2c_config_t *i2c_conf);
+
+esp_err_t i2c_driver_install(i2c_port_t i2c_num,
+                             i2c_mode_t mode,
+                             size_t     slv_rx_buf_len,
+                             size_t     slv_tx_buf_len,
+                             int        intr_alloc_flags);
+
+esp_err_t i2c_driver_delete(i2c_port_t i2c_num);
+
+i2c_cmd_handle_t i2c_cmd_link_create_static(uint8_t *buffer, uint32_t size);
+
+void i2c_cmd_link_delete_static(i2c_cmd_handle_t cmd_handle);
+
+esp_err_t i2c_master_start(i2c_cmd_handle_t cmd_handle);
+
+esp_err_t i2c_master_write_byte(i2c_cmd_handle_t cmd_handle,
+                                uint8_t          data,
+                                bool             ack_en);
+
+esp_err_t i2c_master_write(i2c_cmd_handle_t cmd_handle,
+                           const uint8_t    *data,
+                           size_t           data_len,
+                           bool             ack_en);
+
+esp_err_t i2c_master_read(i2c_cmd_handle_t cmd_handle,
+                          uint8_t          *data,
+                          size_t           data_len,
+                          i2c_ack_type_t   ack);
+
+esp_err_t i2c_master_stop(i2c_cmd_handle_t cmd_handle);
+
+esp_err_t i2c_master_cmd_begin(i2c_port_t       i2c_num,
+                               i2c_cmd_handle_t cmd_handle,
+                               TickType_t       ticks_to_wait);
+
+/******************************* THE END *********************************/
+
+#endif /* I2C_H_ */
@@ -0,0 +1,110 @@
+/*
+ * i2c_master.h
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Host port of the ESP-IDF 5.3 i2c_master driver. The buses are 
+ * simulated, transfers go to the device models attached with 
+ * sim_i2c_attach(), see sim/sim_i2c.h.
+ *
+ */
+#ifndef I2C_MASTER_H_
+#define I2C_MASTER_H_
+
+/******************************* INCLUDES ********************************/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "driver/gpio.h"
+
+/******************************* DEFINES *********************************/
+
+#define I2C_CLK_SRC_DEFAULT 0
+
+/******************************* TYPEDEFS ********************************/
+
+typedef int i2c_port_num_t;
+
+typedef enum
+{
+    I2C_ADDR_BIT_LEN_7,
+    I2C_ADDR_BIT_LEN_10,
+} i2c_addr_bit_len_t;
+
+typedef struct i2c_master_bus_t* i2c_master_bus_handle_t;
+typedef struct i2c_master_dev_t* i2c_master_dev_handle_t;
+
+typedef struct
+{
+    i2c_port_num_t i2c_port;
+    gpio_num_t     sda_io_num;
+    gpio_num_t     scl_io_num;
+    int            clk_source;
+    uint8_t        glitch_ignore_cnt;
+    int            intr_priority;
+    size_t         trans_queue_depth;
+    struct
+    {
+        uint32_t enable_internal_pullup : 1;
+    } flags;
+} i2c_master_bus_config_t;
+
+typedef struct
+{
+    i2c_addr_bit_len_t dev_addr_length;
+    uint16_t           device_address;
+    uint32_t           scl_speed_hz;
+    uint32_t           scl_wait_us;
+} i2c_device_config_t;
+
+typedef struct
+{
+    uint8_t *write_buffer;
+    size_t  buffer_size;
+} i2c_master_transmit_multi_buffer_info_t;
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+esp_err_t i2c_new_master_bus(const i2c_master_bus_config_t *bus_config, 
+                             i2c_master_bus_handle_t       *ret_bus_handle);
+
+esp_err_t i2c_del_master_bus(i2c_master_bus_handle_t bus_handle);
+
+esp_err_t i2c_master_bus_add_device(i2c_master_bus_handle_t   bus_handle,
+                                    const i2c_device_config_t *dev_config,
+                                    i2c_master_dev_handle_t   *ret_handle);
+
+esp_err_t i2c_master_bus_rm_device(i2c_master_dev_handle_t handle);
+
+esp_err_t i2c_master_transmit(i2c_master_dev_handle_t i2c_dev,
+                              const uint8_t           *write_buffer,
+                              size_t                  write_size,
+                              int                     xfer_timeout_ms);
+
+esp_err_t i2c_master_multi_buffer_transmit(i2c_master_dev_handle_t                 i2c_dev,
+                                           i2c_master_transmit_multi_buffer_info_t *buffer_info_array,
+                                           size_t                                  array_size,
+                                           int                                     xfer_timeout_ms);
+
+esp_err_t i2c_master_transmit_receive(i2c_master_dev_handle_t i2c_dev,
+                                      const uint8_t           *write_buffer,
+                                      size_t                  write_size,
+                                      uint8_t                 *read_buffer,
+                                      size_t                  read_size,
+                                      int                     xfer_timeout_ms);
+
+esp_err_t i2c_master_receive(i2c_master_dev_handle_t i2c_dev,
+                             uint8_t                 *read_buffer,
+                             size_t                  read_size,
+                             int                     xfer_timeout_ms);
+
+esp_err_t i2c_master_probe(i2c_master_bus_handle_t bus_handle,
+                           uint16_t                address,
+                           int                     xfer_timeout_ms);
+
+/******************************* THE END *********************************/
+
+#endif /* I2C_MASTER_H_ */
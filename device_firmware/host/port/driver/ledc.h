@@ -0,0 +1,145 @@
+/*
+ * ledc.h
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Host port of the LED PWM driver. The duty is only kept, a fade jumps to
+ * its target right away and never reports its end: a fader waiting for 
+ * the end callback blocks instead of spinning.
+ *
+ */
+#ifndef LEDC_H_
+#define LEDC_H_
+
+/******************************* INCLUDES ********************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "driver/gpio.h"
+
+/******************************* TYPEDEFS ********************************/
+
+typedef enum
+{
+    LEDC_LOW_SPEED_MODE,
+    LEDC_SPEED_MODE_MAX,
+} ledc_mode_t;
+
+typedef enum
+{
+    LEDC_TIMER_0,
+    LEDC_TIMER_1,
+    LEDC_TIMER_2,
+    LEDC_TIMER_3,
+} ledc_timer_t;
+
+typedef enum
+{
+    LEDC_CHANNEL_0,
+    LEDC_CHANNEL_1,
+    LEDC_CHANNEL_2,
+    LEDC_CHANNEL_3,
+    LEDC_CHANNEL_4,
+    LEDC_CHANNEL_5,
+    LEDC_CHANNEL_6,
+    LEDC_CHANNEL_7,
+    LEDC_CHANNEL_MAX,
+} ledc_channel_t;
+
+typedef enum
+{
+    LEDC_TIMER_8_BIT  = 8,
+    LEDC_TIMER_10_BIT = 10,
+    LEDC_TIMER_12_BIT = 12,
+} ledc_timer_bit_t;
+
+typedef enum
+{
+    LEDC_AUTO_CLK,
+} ledc_clk_cfg_t;
+
+typedef enum
+{
+    LEDC_INTR_DISABLE,
+    LEDC_INTR_FADE_END,
+} ledc_intr_type_t;
+
+typedef enum
+{
+    LEDC_FADE_NO_WAIT,
+    LEDC_FADE_WAIT_DONE,
+} ledc_fade_mode_t;
+
+typedef enum
+{
+    LEDC_FADE_END_EVT,
+} ledc_cb_event_t;
+
+typedef struct
+{
+    ledc_mode_t      speed_mode;
+    ledc_timer_bit_t duty_resolution;
+    ledc_timer_t     timer_num;
+    uint32_t         freq_hz;
+    ledc_clk_cfg_t   clk_cfg;
+} ledc_timer_config_t;
+
+typedef struct
+{
+    int              gpio_num;
+    ledc_mode_t      speed_mode;
+    ledc_channel_t   channel;
+    ledc_intr_type_t intr_type;
+    ledc_timer_t     timer_sel;
+    uint32_t         duty;
+    int              hpoint;
+} ledc_channel_config_t;
+
+typedef struct
+{
+    ledc_cb_event_t event;
+    uint32_t        speed_mode;
+    uint32_t        channel;
+    uint32_t        duty;
+} ledc_cb_param_t;
+
+typedef bool (*ledc_cb_t)(const ledc_cb_param_t *param, void *user_arg);
+
+typedef struct
+{
+    ledc_cb_t fade_cb;
+} ledc_cbs_t;
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+esp_err_t ledc_timer_config(const ledc_timer_config_t *timer_conf);
+
+esp_err_t ledc_channel_config(const ledc_channel_config_t *ledc_conf);
+
+esp_err_t ledc_fade_func_install(int intr_alloc_flags);
+
+esp_err_t ledc_cb_register(ledc_mode_t    speed_mode, 
+                           ledc_channel_t channel, 
+                           ledc_cbs_t     *cbs, 
+                           void           *user_arg);
+
+esp_err_t ledc_set_duty(ledc_mode_t speed_mode, ledc_channel_t channel, uint32_t duty);
+
+esp_err_t ledc_update_duty(ledc_mode_t speed_mode, ledc_channel_t channel);
+
+uint32_t ledc_get_duty(ledc_mode_t speed_mode, ledc_channel_t channel);
+
+esp_err_t ledc_set_fade_with_time(ledc_mode_t    speed_mode, 
+                                  ledc_channel_t channel, 
+                                  uint32_t       target_duty, 
+                                  int            max_fade_time_ms);
+
+esp_err_t ledc_fade_start(ledc_mode_t      speed_mode, 
+                          ledc_channel_t   channel, 
+                          ledc_fade_mode_t fade_mode);
+
+/******************************* THE END *********************************/
+
+#endif /* LEDC_H_ */
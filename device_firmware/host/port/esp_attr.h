@@ -0,0 +1,17 @@
+/*
+ * esp_attr.h
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Host port of the section attributes, everything is in the same memory.
+ *
+ */
+#ifndef ESP_ATTR_H_
+#define ESP_ATTR_H_
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define RTC_NOINIT_ATTR
+
+#endif /* ESP_ATTR_H_ */
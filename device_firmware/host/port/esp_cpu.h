@@ -0,0 +1,30 @@
+/*
+ * esp_cpu.h
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Host port of the esp_cpu cycle counter. Counts the time stamp counter
+ * on x86 and nanoseconds of the monotonic clock elsewhere. Like on the
+ * target it is 32 bits and wraps, only differences of short intervals
+ * are meaningful.
+ *
+ */
+#ifndef ESP_CPU_H_
+#define ESP_CPU_H_
+
+/******************************* INCLUDES ********************************/
+
+#include <stdint.h>
+
+/******************************* TYPEDEFS ********************************/
+
+typedef uint32_t esp_cpu_cycle_count_t;
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+esp_cpu_cycle_count_t esp_cpu_get_cycle_count(void);
+
+/******************************* THE END *********************************/
+
+#endif /* ESP_CPU_H_ */
@@ -0,0 +1,24 @@
+/*
+ * esp_crc.h
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Host port of the ROM crc functions. esp_crc32_le() gives the same
+ * result as zlib crc32(), which dsp_image_generator.py uses.
+ *
+ */
+#ifndef ESP_CRC_H_
+#define ESP_CRC_H_
+
+/******************************* INCLUDES ********************************/
+
+#include <stdint.h>
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+uint32_t esp_crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len);
+
+/******************************* THE END *********************************/
+
+#endif /* ESP_CRC_H_ */
@@ -0,0 +1,59 @@
+/*
+ * esp_err.h
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Host port of the ESP-IDF error codes the firmware uses. The values
+ * match ESP-IDF so logged codes mean the same on both.
+ *
+ */
+#ifndef ESP_ERR_H_
+#define ESP_ERR_H_
+
+/******************************* INCLUDES ********************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+/******************************* DEFINES *********************************/
+
+#define ESP_OK                  0
+#define ESP_FAIL                -1
+#define ESP_ERR_NO_MEM          0x101
+#define ESP_ERR_INVALID_ARG     0x102
+#define ESP_ERR_INVALID_STATE   0x103
+#define ESP_ERR_INVALID_SIZE    0x104
+#define ESP_ERR_NOT_FOUND       0x105
+#define ESP_ERR_NOT_SUPPORTED   0x106
+#define ESP_ERR_TIMEOUT         0x107
+#define ESP_ERR_NVS_BASE        0x1100
+#define ESP_ERR_NVS_NOT_FOUND   (ESP_ERR_NVS_BASE + 0x02)
+#define ESP_ERR_NVS_NO_FREE_PAGES     (ESP_ERR_NVS_BASE + 0x0d)
+#define ESP_ERR_NVS_NEW_VERSION_FOUND (ESP_ERR_NVS_BASE + 0x10)
+
+#define ESP_ERROR_CHECK(x)                                              \
+    do                                                                  \
+    {                                                                   \
+        esp_err_t err_rc_ = (x);                                        \
+        if(err_rc_ != ESP_OK)                                           \
+        {                                                               \
+            fprintf(stderr, "ESP_ERROR_CHECK failed: 0x%x at %s:%d\n",  \
+                    err_rc_, __FILE__, __LINE__);                       \
+            abort();                                                    \
+        }                                                               \
+    } while(0)
+
+/******************************* TYPEDEFS ********************************/
+
+typedef int esp_err_t;
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+const char* esp_err_to_name(esp_err_t code);
+
+/******************************* THE END *********************************/
+
+#endif /* ESP_ERR_H_ */
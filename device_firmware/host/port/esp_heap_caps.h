@@ -0,0 +1,34 @@
+/*
+ * esp_heap_caps.h
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Host port of the heap statistics. The host heap has no meaningful 
+ * limits, every figure is large enough to never look low.
+ *
+ */
+#ifndef ESP_HEAP_CAPS_H_
+#define ESP_HEAP_CAPS_H_
+
+/******************************* INCLUDES ********************************/
+
+#include <stdint.h>
+#include <stddef.h>
+
+/******************************* DEFINES *********************************/
+
+#define MALLOC_CAP_8BIT     (1 << 2)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+size_t heap_caps_get_free_size(uint32_t caps);
+
+size_t heap_caps_get_minimum_free_size(uint32_t caps);
+
+size_t heap_caps_get_largest_free_block(uint32_t caps);
+
+/******************************* THE END *********************************/
+
+#endif /* ESP_HEAP_CAPS_H_ */
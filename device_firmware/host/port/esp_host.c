@@ -0,0 +1,742 @@
+/*
+ * esp_host.c
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Host port of the ESP-IDF functions the firmware uses: logging, time,
+ * cycle counter, crc, partitions, NVS, GPIO and LED PWM. See the headers
+ * in this directory.
+ *
+ */
+/******************************* INCLUDES ********************************/
+
+#include <stdarg.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_cpu.h"
+#include "esp_rom_sys.h"
+#include "esp_crc.h"
+#include "esp_system.h"
+#include "esp_partition.h"
+#include "nvs_flash.h"
+#include "esp_heap_caps.h"
+#include "driver/gpio.h"
+#include "driver/ledc.h"
+#include "host_port.h"
+
+/******************************* DEFINES *********************************/
+
+#define HOST_NVS_ENTRIES   32
+#define HOST_NVS_NAME_LEN  16
+#define HOST_NVS_BLOB_MAX  1984
+#define HOST_NVS_HANDLES   8
+
+/******************************* TYPEDEFS ********************************/
+
+typedef struct
+{
+    bool    used;
+    char    name_space[HOST_NVS_NAME_LEN];
+    char    key[HOST_NVS_NAME_LEN];
+    uint8_t value[HOST_NVS_BLOB_MAX];
+    size_t  len;
+} host_nvs_entry_t;
+
+typedef struct
+{
+    bool                 used;
+    host_gpio_callback_t callback;
+    void                 *ctx;
+    gpio_num_t           pin;
+} host_gpio_watch_t;
+
+/******************************* GLOBAL VARIABLES ************************/
+
+static esp_log_level_t logLevel = ESP_LOG_WARN;
+
+static esp_partition_t partitions[HOST_PARTITION_AMOUNT];
+static uint8_t         partitionAmount = 0;
+
+static pthread_mutex_t  nvsLock = PTHREAD_MUTEX_INITIALIZER;
+static host_nvs_entry_t nvsEntries[HOST_NVS_ENTRIES];
+static char             nvsHandles[HOST_NVS_HANDLES][HOST_NVS_NAME_LEN];
+
+static pthread_mutex_t   gpioLock = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t          gpioLevels[GPIO_NUM_MAX];
+static host_gpio_watch_t gpioWatches[HOST_GPIO_WATCH_AMOUNT];
+
+static uint32_t          ledcDuty[LEDC_SPEED_MODE_MAX][LEDC_CHANNEL_MAX];
+
+/******************************* LOCAL FUNCTIONS *************************/
+
+// Only called with nvsLock taken.
+static host_nvs_entry_t* host_nvs_find(nvs_handle_t handle, 
+                                       const char   *key,
+                                       bool         create)
+{
+    host_nvs_entry_t *free = NULL;
+
+    if(handle == 0 || handle > HOST_NVS_HANDLES || key == NULL)
+    {
+        return NULL;
+    }
+
+    const char *name_space = nvsHandles[handle - 1];
+
+    for(int i = 0; i < HOST_NVS_ENTRIES; i++)
+    {
+        if(!nvsEntries[i].used)
+        {
+            if(free == NULL)
+            {
+                free = &nvsEntries[i];
+            }
+            continue;
+        }
+        if(strcmp(nvsEntries[i].name_space, name_space) == 0 &&
+           strcmp(nvsEntries[i].key, key) == 0)
+        {
+            return &nvsEntries[i];
+        }
+    }
+    if(create && free != NULL)
+    {
+        free->used = true;
+        snprintf(free->name_space, HOST_NVS_NAME_LEN, "%s", name_space);
+        snprintf(free->key, HOST_NVS_NAME_LEN, "%s", key);
+        free->len = 0;
+        return free;
+    }
+    return NULL;
+}
+
+static esp_err_t host_nvs_set(nvs_handle_t handle, 
+                              const char   *key, 
+                              const void   *value, 
+                              size_t       len)
+{
+    esp_err_t ret = ESP_ERR_NO_MEM;
+
+    if(len > HOST_NVS_BLOB_MAX)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    pthread_mutex_lock(&nvsLock);
+    host_nvs_entry_t *entry = host_nvs_find(handle, key, true);
+    if(entry != NULL)
+    {
+        memcpy(entry->value, value, len);
+        entry->len = len;
+        ret        = ESP_OK;
+    }
+    pthread_mutex_unlock(&nvsLock);
+    return ret;
+}
+
+// Fixed size values have to match in size, like typed NVS entries.
+static esp_err_t host_nvs_get(nvs_handle_t handle, 
+                              const char   *key, 
+                              void         *value, 
+                              size_t       len)
+{
+    esp_err_t ret = ESP_ERR_NVS_NOT_FOUND;
+
+    pthread_mutex_lock(&nvsLock);
+    host_nvs_entry_t *entry = host_nvs_find(handle, key, false);
+    if(entry != NULL && entry->len == len)
+    {
+        memcpy(value, entry->value, len);
+        ret = ESP_OK;
+    }
+    pthread_mutex_unlock(&nvsLock);
+    return ret;
+}
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+const char* esp_err_to_name(esp_err_t code)
+{
+    switch(code)
+    {
+        case ESP_OK:                return "ESP_OK";
+        case ESP_FAIL:              return "ESP_FAIL";
+        case ESP_ERR_NO_MEM:        return "ESP_ERR_NO_MEM";
+        case ESP_ERR_INVALID_ARG:   return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+        case ESP_ERR_INVALID_SIZE:  return "ESP_ERR_INVALID_SIZE";
+        case ESP_ERR_NOT_FOUND:     return "ESP_ERR_NOT_FOUND";
+        case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+        case ESP_ERR_TIMEOUT:       return "ESP_ERR_TIMEOUT";
+        case ESP_ERR_NVS_NOT_FOUND: return "ESP_ERR_NVS_NOT_FOUND";
+        case ESP_ERR_NVS_NO_FREE_PAGES: return "ESP_ERR_NVS_NO_FREE_PAGES";
+        case ESP_ERR_NVS_NEW_VERSION_FOUND: 
+            return "ESP_ERR_NVS_NEW_VERSION_FOUND";
+        default:                    return "UNKNOWN ERROR";
+    }
+}
+
+void esp_log_level_set(const char *tag, esp_log_level_t level)
+{
+    (void)tag;
+    logLevel = level;
+}
+
+void esp_log_write(esp_log_level_t level, 
+                   const char      *tag, 
+                   const char      *format, 
+                   ...)
+{
+    static const char letters[] = "NEWIDV";
+    va_list args;
+
+    if(level > logLevel)
+    {
+        return;
+    }
+
+    va_start(args, format);
+    flockfile(stderr);
+    fprintf(stderr, "%c (%lld) %s: ", 
+            letters[level], 
+            (long long)(host_time_us() / 1000), 
+            tag);
+    vfprintf(stderr, format, args);
+    fputc('\n', stderr);
+    funlockfile(stderr);
+    va_end(args);
+}
+
+int64_t host_time_us(void)
+{
+    static int64_t  start = -1;
+    struct timespec now;
+    int64_t         us;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    us = (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+    // The first call of the process is time 0, like a boot.
+    if(__atomic_load_n(&start, __ATOMIC_RELAXED) < 0)
+    {
+        int64_t unset = -1;
+        __atomic_compare_exchange_n(&start, &unset, us, false, 
+                                    __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    }
+    return us - start;
+}
+
+void host_sleep_us(int64_t us)
+{
+    struct timespec delay = {
+        .tv_sec  = us / 1000000,
+        .tv_nsec = (us % 1000000) * 1000,
+    };
+
+    while(nanosleep(&delay, &delay) != 0 && errno == EINTR)
+    {
+    }
+}
+
+int64_t esp_timer_get_time(void)
+{
+    return host_time_us();
+}
+
+void esp_rom_delay_us(uint32_t us)
+{
+    host_sleep_us(us);
+}
+
+esp_cpu_cycle_count_t esp_cpu_get_cycle_count(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return (esp_cpu_cycle_count_t)__builtin_ia32_rdtsc();
+#else
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (esp_cpu_cycle_count_t)(now.tv_sec * 1000000000ULL + now.tv_nsec);
+#endif
+}
+
+uint32_t esp_crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len)
+{
+    crc = ~crc;
+    for(uint32_t i = 0; i < len; i++)
+    {
+        crc ^= buf[i];
+        for(int bit = 0; bit < 8; bit++)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
+
+esp_reset_reason_t esp_reset_reason(void)
+{
+    return ESP_RST_POWERON;
+}
+
+uint32_t esp_get_free_heap_size(void)
+{
+    // Meaningless on the host, large enough to never look low.
+    return UINT32_MAX;
+}
+
+size_t heap_caps_get_free_size(uint32_t caps)
+{
+    (void)caps;
+    return UINT32_MAX;
+}
+
+size_t heap_caps_get_minimum_free_size(uint32_t caps)
+{
+    (void)caps;
+    return UINT32_MAX;
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps)
+{
+    (void)caps;
+    return UINT32_MAX;
+}
+
+bool host_partition_add(const char              *label,
+                        esp_partition_type_t    type,
+                        esp_partition_subtype_t subtype,
+                        uint32_t                size)
+{
+    if(partitionAmount >= HOST_PARTITION_AMOUNT)
+    {
+        return false;
+    }
+
+    esp_partition_t *partition = &partitions[partitionAmount];
+    uint32_t        address    = 0;
+
+    partition->host_data = malloc(size);
+    if(partition->host_data == NULL)
+    {
+        return false;
+    }
+    memset(partition->host_data, 0xFF, size);
+
+    if(partitionAmount > 0)
+    {
+        address = partitions[partitionAmount - 1].address + 
+                  partitions[partitionAmount - 1].size;
+    }
+    partition->type    = type;
+    partition->subtype = subtype;
+    partition->address = address;
+    partition->size    = size;
+    snprintf(partition->label, sizeof(partition->label), "%s", label);
+    partitionAmount++;
+    return true;
+}
+
+bool host_partition_load(const char *label, const char *path)
+{
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_ANY,
+                                                                0,
+                                                                label);
+    FILE                  *file      = fopen(path, "rb");
+    bool                  loaded     = false;
+
+    if(partition != NULL && file != NULL)
+    {
+        size_t len = fread(partition->host_data, 1, partition->size, file);
+
+        // The image has to fit.
+        loaded = (len > 0 && fgetc(file) == EOF);
+    }
+    if(file != NULL)
+    {
+        fclose(file);
+    }
+    return loaded;
+}
+
+bool host_partition_save(const char *label, const char *path, uint32_t len)
+{
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_ANY,
+                                                                0,
+                                                                label);
+    FILE                  *file;
+    bool                  saved;
+
+    if(partition == NULL || len > partition->size)
+    {
+        return false;
+    }
+    file = fopen(path, "wb");
+    if(file == NULL)
+    {
+        return false;
+    }
+    saved = fwrite(partition->host_data, 1, len, file) == len;
+    return fclose(file) == 0 && saved;
+}
+
+const esp_partition_t* esp_partition_find_first(esp_partition_type_t    type,
+                                                esp_partition_subtype_t subtype,
+                                                const char              *label)
+{
+    for(int i = 0; i < partitionAmount && i < HOST_PARTITION_AMOUNT; i++)
+    {
+        if(type != ESP_PARTITION_TYPE_ANY && 
+           (partitions[i].type != type || partitions[i].subtype != subtype))
+        {
+            continue;
+        }
+        if(label == NULL || strcmp(partitions[i].label, label) == 0)
+        {
+            return &partitions[i];
+        }
+    }
+    return NULL;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *partition,
+                             size_t                offset,
+                             void                  *dst,
+                             size_t                size)
+{
+    if(partition == NULL || offset + size > partition->size)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memcpy(dst, partition->host_data + offset, size);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *partition,
+                              size_t                offset,
+                              const void            *src,
+                              size_t                size)
+{
+    const uint8_t *data = src;
+
+    if(partition == NULL || offset + size > partition->size)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for(size_t i = 0; i < size; i++)
+    {
+        partition->host_data[offset + i] &= data[i];
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition,
+                                    size_t                offset,
+                                    size_t                size)
+{
+    if(partition == NULL || offset + size > partition->size ||
+       offset % SPI_FLASH_SEC_SIZE != 0 || size % SPI_FLASH_SEC_SIZE != 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(partition->host_data + offset, 0xFF, size);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_mmap(const esp_partition_t       *partition,
+                             size_t                      offset,
+                             size_t                      size,
+                             esp_partition_mmap_memory_t memory,
+                             const void                  **out_ptr,
+                             esp_partition_mmap_handle_t *out_handle)
+{
+    (void)memory;
+
+    if(partition == NULL || offset + size > partition->size)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *out_ptr    = partition->host_data + offset;
+    *out_handle = 0;
+    return ESP_OK;
+}
+
+void esp_partition_munmap(esp_partition_mmap_handle_t handle)
+{
+    (void)handle;
+}
+
+esp_err_t nvs_flash_init(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase(void)
+{
+    pthread_mutex_lock(&nvsLock);
+    memset(nvsEntries, 0, sizeof(nvsEntries));
+    pthread_mutex_unlock(&nvsLock);
+    return ESP_OK;
+}
+
+esp_err_t nvs_open(const char      *name_space, 
+                   nvs_open_mode_t open_mode, 
+                   nvs_handle_t    *out_handle)
+{
+    esp_err_t ret = ESP_ERR_NO_MEM;
+
+    (void)open_mode;
+
+    pthread_mutex_lock(&nvsLock);
+    for(int i = 0; i < HOST_NVS_HANDLES; i++)
+    {
+        if(nvsHandles[i][0] == '\0')
+        {
+            snprintf(nvsHandles[i], HOST_NVS_NAME_LEN, "%s", name_space);
+            *out_handle = i + 1;
+            ret         = ESP_OK;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&nvsLock);
+    return ret;
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+    if(handle > 0 && handle <= HOST_NVS_HANDLES)
+    {
+        pthread_mutex_lock(&nvsLock);
+        nvsHandles[handle - 1][0] = '\0';
+        pthread_mutex_unlock(&nvsLock);
+    }
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    (void)handle;
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, 
+                       const char   *key, 
+                       const void   *value, 
+                       size_t       length)
+{
+    return host_nvs_set(handle, key, value, length);
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, 
+                       const char   *key, 
+                       void         *out_value, 
+                       size_t       *length)
+{
+    esp_err_t ret = ESP_ERR_NVS_NOT_FOUND;
+
+    pthread_mutex_lock(&nvsLock);
+    host_nvs_entry_t *entry = host_nvs_find(handle, key, false);
+    if(entry != NULL)
+    {
+        // Like NVS, a NULL buffer asks for the length only.
+        if(out_value != NULL && *length < entry->len)
+        {
+            ret = ESP_ERR_INVALID_SIZE;
+        }
+        else
+        {
+            if(out_value != NULL)
+            {
+                memcpy(out_value, entry->value, entry->len);
+            }
+            ret = ESP_OK;
+        }
+        *length = entry->len;
+    }
+    pthread_mutex_unlock(&nvsLock);
+    return ret;
+}
+
+esp_err_t nvs_set_u8(nvs_handle_t handle, const char *key, uint8_t value)
+{
+    return host_nvs_set(handle, key, &value, sizeof(value));
+}
+
+esp_err_t nvs_get_u8(nvs_handle_t handle, const char *key, uint8_t *out_value)
+{
+    return host_nvs_get(handle, key, out_value, sizeof(*out_value));
+}
+
+esp_err_t nvs_set_u32(nvs_handle_t handle, const char *key, uint32_t value)
+{
+    return host_nvs_set(handle, key, &value, sizeof(value));
+}
+
+esp_err_t nvs_get_u32(nvs_handle_t handle, const char *key, uint32_t *out_value)
+{
+    return host_nvs_get(handle, key, out_value, sizeof(*out_value));
+}
+
+bool host_gpio_watch(gpio_num_t pin, host_gpio_callback_t callback, void *ctx)
+{
+    bool added = false;
+
+    pthread_mutex_lock(&gpioLock);
+    for(int i = 0; i < HOST_GPIO_WATCH_AMOUNT; i++)
+    {
+        if(!gpioWatches[i].used)
+        {
+            gpioWatches[i].used     = true;
+            gpioWatches[i].pin      = pin;
+            gpioWatches[i].callback = callback;
+            gpioWatches[i].ctx      = ctx;
+            added = true;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&gpioLock);
+    return added;
+}
+
+esp_err_t gpio_reset_pin(gpio_num_t gpio_num)
+{
+    return gpio_set_direction(gpio_num, GPIO_MODE_INPUT);
+}
+
+esp_err_t gpio_set_direction(gpio_num_t gpio_num, gpio_mode_t mode)
+{
+    (void)mode;
+
+    if(gpio_num < 0 || gpio_num >= GPIO_NUM_MAX)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level)
+{
+    host_gpio_watch_t watches[HOST_GPIO_WATCH_AMOUNT];
+
+    if(gpio_num < 0 || gpio_num >= GPIO_NUM_MAX)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    level = level ? 1 : 0;
+
+    pthread_mutex_lock(&gpioLock);
+    bool changed = gpioLevels[gpio_num] != level;
+    gpioLevels[gpio_num] = level;
+    memcpy(watches, gpioWatches, sizeof(watches));
+    pthread_mutex_unlock(&gpioLock);
+
+    // Callbacks run without the lock, they may touch other pins.
+    for(int i = 0; changed && i < HOST_GPIO_WATCH_AMOUNT; i++)
+    {
+        if(watches[i].used && watches[i].pin == gpio_num)
+        {
+            watches[i].callback(watches[i].ctx, gpio_num, level);
+        }
+    }
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpio_num)
+{
+    int level = 0;
+
+    if(gpio_num >= 0 && gpio_num < GPIO_NUM_MAX)
+    {
+        pthread_mutex_lock(&gpioLock);
+        level = gpioLevels[gpio_num];
+        pthread_mutex_unlock(&gpioLock);
+    }
+    return level;
+}
+
+esp_err_t ledc_timer_config(const ledc_timer_config_t *timer_conf)
+{
+    return timer_conf != NULL ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t ledc_channel_config(const ledc_channel_config_t *ledc_conf)
+{
+    if(ledc_conf == NULL || ledc_conf->speed_mode >= LEDC_SPEED_MODE_MAX ||
+       ledc_conf->channel >= LEDC_CHANNEL_MAX)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    ledcDuty[ledc_conf->speed_mode][ledc_conf->channel] = ledc_conf->duty;
+    return ESP_OK;
+}
+
+esp_err_t ledc_fade_func_install(int intr_alloc_flags)
+{
+    (void)intr_alloc_flags;
+    return ESP_OK;
+}
+
+esp_err_t ledc_cb_register(ledc_mode_t    speed_mode, 
+                           ledc_channel_t channel, 
+                           ledc_cbs_t     *cbs, 
+                           void           *user_arg)
+{
+    (void)user_arg;
+
+    if(speed_mode >= LEDC_SPEED_MODE_MAX || channel >= LEDC_CHANNEL_MAX ||
+       cbs == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return ESP_OK;
+}
+
+esp_err_t ledc_set_duty(ledc_mode_t speed_mode, ledc_channel_t channel, uint32_t duty)
+{
+    if(speed_mode >= LEDC_SPEED_MODE_MAX || channel >= LEDC_CHANNEL_MAX)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    ledcDuty[speed_mode][channel] = duty;
+    return ESP_OK;
+}
+
+esp_err_t ledc_update_duty(ledc_mode_t speed_mode, ledc_channel_t channel)
+{
+    if(speed_mode >= LEDC_SPEED_MODE_MAX || channel >= LEDC_CHANNEL_MAX)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return ESP_OK;
+}
+
+uint32_t ledc_get_duty(ledc_mode_t speed_mode, ledc_channel_t channel)
+{
+    if(speed_mode >= LEDC_SPEED_MODE_MAX || channel >= LEDC_CHANNEL_MAX)
+    {
+        return 0;
+    }
+    return ledcDuty[speed_mode][channel];
+}
+
+esp_err_t ledc_set_fade_with_time(ledc_mode_t    speed_mode, 
+                                  ledc_channel_t channel, 
+                                  uint32_t       target_duty, 
+                                  int            max_fade_time_ms)
+{
+    (void)max_fade_time_ms;
+    return ledc_set_duty(speed_mode, channel, target_duty);
+}
+
+esp_err_t ledc_fade_start(ledc_mode_t      speed_mode, 
+                          ledc_channel_t   channel, 
+                          ledc_fade_mode_t fade_mode)
+{
+    (void)fade_mode;
+    return ledc_update_duty(speed_mode, channel);
+}
+
+/******************************* THE END *********************************/
@@ -0,0 +1,35 @@
+/*
+ * esp_idf_version.h
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * The host reports ESP-IDF 5.1 like the tree is pinned to, so the 
+ * firmware uses the legacy I2C driver. Building with 
+ * HOST_IDF_VERSION_MINOR=3 gives the i2c_master driver. The simulated 
+ * buses implement both.
+ *
+ */
+#ifndef ESP_IDF_VERSION_H_
+#define ESP_IDF_VERSION_H_
+
+/******************************* DEFINES *********************************/
+
+#ifndef HOST_IDF_VERSION_MINOR
+#define HOST_IDF_VERSION_MINOR 1
+#endif
+
+#define ESP_IDF_VERSION_MAJOR 5
+#define ESP_IDF_VERSION_MINOR HOST_IDF_VERSION_MINOR
+#define ESP_IDF_VERSION_PATCH 0
+
+#define ESP_IDF_VERSION_VAL(major, minor, patch) \
+    (((major) << 16) | ((minor) << 8) | (patch))
+
+#define ESP_IDF_VERSION ESP_IDF_VERSION_VAL(ESP_IDF_VERSION_MAJOR, \
+                                            ESP_IDF_VERSION_MINOR, \
+                                            ESP_IDF_VERSION_PATCH)
+
+/******************************* THE END *********************************/
+
+#endif /* ESP_IDF_VERSION_H_ */
@@ -0,0 +1,57 @@
+/*
+ * esp_log.h
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Host port of ESP-IDF logging. Lines go to stderr so the output of the
+ * host tools stays clean. Only warnings and errors are shown unless the
+ * level is raised with esp_log_level_set().
+ *
+ */
+#ifndef ESP_LOG_H_
+#define ESP_LOG_H_
+
+/******************************* INCLUDES ********************************/
+
+#include <stdio.h>
+#include <stdint.h>
+
+/******************************* DEFINES *********************************/
+
+#define ESP_LOGE(tag, format, ...) \
+    esp_log_write(ESP_LOG_ERROR,   tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) \
+    esp_log_write(ESP_LOG_WARN,    tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) \
+    esp_log_write(ESP_LOG_INFO,    tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) \
+    esp_log_write(ESP_LOG_DEBUG,   tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) \
+    esp_log_write(ESP_LOG_VERBOSE, tag, format, ##__VA_ARGS__)
+
+/******************************* TYPEDEFS ********************************/
+
+typedef enum
+{
+    ESP_LOG_NONE,
+    ESP_LOG_ERROR,
+    ESP_LOG_WARN,
+    ESP_LOG_INFO,
+    ESP_LOG_DEBUG,
+    ESP_LOG_VERBOSE
+} esp_log_level_t;
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+// The tag is ignored, the level holds for every tag.
+void esp_log_level_set(const char *tag, esp_log_level_t level);
+
+void esp_log_write(esp_log_level_t level, 
+                   const char      *tag, 
+                   const char      *format, 
+                   ...) __attribute__((format(printf, 3, 4)));
+
+/******************************* THE END *********************************/
+
+#endif /* ESP_LOG_H_ */
@@ -0,0 +1,23 @@
+/*
+ * esp_nimble_hci.h
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Host stand-in for the NimBLE HCI, there is no controller on the host.
+ *
+ */
+#ifndef ESP_NIMBLE_HCI_H_
+#define ESP_NIMBLE_HCI_H_
+
+/******************************* INCLUDES ********************************/
+
+#include "esp_err.h"
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+esp_err_t esp_nimble_hci_init(void);
+
+/******************************* THE END *********************************/
+
+#endif /* ESP_NIMBLE_HCI_H_ */
@@ -0,0 +1,91 @@
+/*
+ * esp_partition.h
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Host port of the partition API. Partitions live in RAM, they are added
+ * and filled from files with host_partition_add() and 
+ * host_partition_load() and written back with host_partition_save(), see
+ * host_port.h. Mapping just returns a pointer into the RAM.
+ *
+ */
+#ifndef ESP_PARTITION_H_
+#define ESP_PARTITION_H_
+
+/******************************* INCLUDES ********************************/
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+/******************************* DEFINES *********************************/
+
+#define ESP_PARTITION_LABEL_LEN 16
+#define SPI_FLASH_SEC_SIZE      4096
+
+/******************************* TYPEDEFS ********************************/
+
+typedef enum
+{
+    ESP_PARTITION_TYPE_APP  = 0x00,
+    ESP_PARTITION_TYPE_DATA = 0x01,
+    ESP_PARTITION_TYPE_ANY  = 0xFF,
+} esp_partition_type_t;
+
+typedef int esp_partition_subtype_t;
+
+typedef enum
+{
+    ESP_PARTITION_MMAP_DATA,
+    ESP_PARTITION_MMAP_INST,
+} esp_partition_mmap_memory_t;
+
+typedef uint32_t esp_partition_mmap_handle_t;
+
+typedef struct
+{
+    esp_partition_type_t    type;
+    esp_partition_subtype_t subtype;
+    uint32_t                address;
+    uint32_t                size;
+    char                    label[ESP_PARTITION_LABEL_LEN + 1];
+
+    uint8_t                 *host_data;   /* Host only, the contents */
+} esp_partition_t;
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+// NULL label matches any label.
+const esp_partition_t* esp_partition_find_first(esp_partition_type_t    type,
+                                                esp_partition_subtype_t subtype,
+                                                const char              *label);
+
+esp_err_t esp_partition_read(const esp_partition_t *partition,
+                             size_t                offset,
+                             void                  *dst,
+                             size_t                size);
+
+// Like NOR flash, a write can only clear bits. The erase has to cover
+// whole sectors.
+esp_err_t esp_partition_write(const esp_partition_t *partition,
+                              size_t                offset,
+                              const void            *src,
+                              size_t                size);
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition,
+                                    size_t                offset,
+                                    size_t                size);
+
+esp_err_t esp_partition_mmap(const esp_partition_t       *partition,
+                             size_t                      offset,
+                             size_t                      size,
+                             esp_partition_mmap_memory_t memory,
+                             const void                  **out_ptr,
+                             esp_partition_mmap_handle_t *out_handle);
+
+void esp_partition_munmap(esp_partition_mmap_handle_t handle);
+
+/******************************* THE END *********************************/
+
+#endif /* ESP_PARTITION_H_ */
@@ -0,0 +1,24 @@
+/*
+ * esp_rom_sys.h
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Host port of the ROM delay. The ROM spins on the CPU, here the thread
+ * sleeps so the simulated devices get the host CPU meanwhile.
+ *
+ */
+#ifndef ESP_ROM_SYS_H_
+#define ESP_ROM_SYS_H_
+
+/******************************* INCLUDES ********************************/
+
+#include <stdint.h>
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+void esp_rom_delay_us(uint32_t us);
+
+/******************************* THE END *********************************/
+
+#endif /* ESP_ROM_SYS_H_ */
@@ -0,0 +1,44 @@
+/*
+ * esp_system.h
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Host port of the system functions the firmware uses. A host run is
+ * always a power on.
+ *
+ */
+#ifndef ESP_SYSTEM_H_
+#define ESP_SYSTEM_H_
+
+/******************************* INCLUDES ********************************/
+
+#include <stdint.h>
+#include "esp_err.h"
+
+/******************************* TYPEDEFS ********************************/
+
+typedef enum
+{
+    ESP_RST_UNKNOWN,
+    ESP_RST_POWERON,
+    ESP_RST_EXT,
+    ESP_RST_SW,
+    ESP_RST_PANIC,
+    ESP_RST_INT_WDT,
+    ESP_RST_TASK_WDT,
+    ESP_RST_WDT,
+    ESP_RST_DEEPSLEEP,
+    ESP_RST_BROWNOUT,
+    ESP_RST_SDIO,
+} esp_reset_reason_t;
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+esp_reset_reason_t esp_reset_reason(void);
+
+uint32_t esp_get_free_heap_size(void);
+
+/******************************* THE END *********************************/
+
+#endif /* ESP_SYSTEM_H_ */
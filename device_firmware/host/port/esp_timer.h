@@ -0,0 +1,24 @@
+/*
+ * esp_timer.h
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Host port of esp_timer, microseconds of the monotonic clock since the
+ * start of the process.
+ *
+ */
+#ifndef ESP_TIMER_H_
+#define ESP_TIMER_H_
+
+/******************************* INCLUDES ********************************/
+
+#include <stdint.h>
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+int64_t esp_timer_get_time(void);
+
+/******************************* THE END *********************************/
+
+#endif /* ESP_TIMER_H_ */
@@ -0,0 +1,68 @@
+/*
+ * FreeRTOS.h
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Host port of the FreeRTOS API the firmware uses, on top of pthreads. 
+ * Tasks are threads, queues and semaphores are mutex/condition pairs and
+ * critical sections are a recursive mutex per portMUX. Priorities and 
+ * core affinity are kept but not enforced, the host scheduler decides.
+ *
+ * The tick rate matches CONFIG_FREERTOS_HZ of the firmware so tick based
+ * timeouts behave the same.
+ *
+ */
+#ifndef FREERTOS_H_
+#define FREERTOS_H_
+
+/******************************* INCLUDES ********************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <pthread.h>
+
+/******************************* DEFINES *********************************/
+
+#define configTICK_RATE_HZ       100
+#define configMAX_TASK_NAME_LEN  16
+#define configHOST_TASK_AMOUNT   32      /* Tasks listed for telemetry */
+#define configSTACK_DEPTH_TYPE   uint32_t
+
+#define portTICK_PERIOD_MS       (1000 / configTICK_RATE_HZ)
+#define portMAX_DELAY            ((TickType_t)0xFFFFFFFF)
+#define portNUM_PROCESSORS       2
+
+#define pdMS_TO_TICKS(ms) \
+    ((TickType_t)(((uint64_t)(ms) * configTICK_RATE_HZ) / 1000))
+
+#define pdTRUE                   1
+#define pdFALSE                  0
+#define pdPASS                   1
+#define pdFAIL                   0
+
+#define tskNO_AFFINITY           0x7FFFFFFF
+
+// Critical sections of the firmware only protect short updates, a mutex
+// per portMUX gives the same exclusion between threads.
+#define portMUX_INITIALIZER_UNLOCKED PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP
+#define taskENTER_CRITICAL(mux)      pthread_mutex_lock(mux)
+#define taskEXIT_CRITICAL(mux)       pthread_mutex_unlock(mux)
+#define taskENTER_CRITICAL_ISR(mux)  pthread_mutex_lock(mux)
+#define taskEXIT_CRITICAL_ISR(mux)   pthread_mutex_unlock(mux)
+#define portENTER_CRITICAL(mux)      pthread_mutex_lock(mux)
+#define portEXIT_CRITICAL(mux)       pthread_mutex_unlock(mux)
+#define portYIELD_FROM_ISR(woken)    ((void)(woken))
+
+/******************************* TYPEDEFS ********************************/
+
+typedef int32_t         BaseType_t;
+typedef uint32_t        UBaseType_t;
+typedef uint32_t        TickType_t;
+typedef uint8_t         StackType_t;
+typedef pthread_mutex_t portMUX_TYPE;
+
+/******************************* THE END *********************************/
+
+#endif /* FREERTOS_H_ */
@@ -0,0 +1,55 @@
+/*
+ * queue.h
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Host port of FreeRTOS queues and queue sets. Semaphores are queues
+ * with items of size 0, like in FreeRTOS itself.
+ *
+ */
+#ifndef QUEUE_H_
+#define QUEUE_H_
+
+/******************************* INCLUDES ********************************/
+
+#include "FreeRTOS.h"
+
+/******************************* TYPEDEFS ********************************/
+
+typedef struct host_queue* QueueHandle_t;
+typedef struct host_queue* QueueSetHandle_t;
+typedef struct host_queue* QueueSetMemberHandle_t;
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size);
+
+void vQueueDelete(QueueHandle_t queue);
+
+BaseType_t xQueueSend(QueueHandle_t queue, 
+                      const void    *item, 
+                      TickType_t    timeout);
+
+BaseType_t xQueueSendFromISR(QueueHandle_t queue, 
+                             const void    *item, 
+                             BaseType_t    *woken);
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t timeout);
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue);
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue);
+
+QueueSetHandle_t xQueueCreateSet(UBaseType_t length);
+
+BaseType_t xQueueAddToSet(QueueSetMemberHandle_t member, QueueSetHandle_t set);
+
+QueueSetMemberHandle_t xQueueSelectFromSet(QueueSetHandle_t set, 
+                                           TickType_t       timeout);
+
+#define xQueueSendToBack xQueueSend
+
+/******************************* THE END *********************************/
+
+#endif /* QUEUE_H_ */
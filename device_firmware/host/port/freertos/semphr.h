@@ -0,0 +1,45 @@
+/*
+ * semphr.h
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Host port of FreeRTOS semaphores and mutexes.
+ *
+ */
+#ifndef SEMPHR_H_
+#define SEMPHR_H_
+
+/******************************* INCLUDES ********************************/
+
+#include "queue.h"
+
+/******************************* TYPEDEFS ********************************/
+
+typedef QueueHandle_t SemaphoreHandle_t;
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void);
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max, UBaseType_t initial);
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex(void);
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t timeout);
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore);
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t semaphore, BaseType_t *woken);
+
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t mutex, TickType_t timeout);
+
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t mutex);
+
+#define vSemaphoreDelete(semaphore) vQueueDelete(semaphore)
+
+/******************************* THE END *********************************/
+
+#endif /* SEMPHR_H_ */
@@ -0,0 +1,95 @@
+/*
+ * task.h
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Host port of the FreeRTOS task API, see FreeRTOS.h.
+ *
+ */
+#ifndef TASK_H_
+#define TASK_H_
+
+/******************************* INCLUDES ********************************/
+
+#include <sched.h>
+#include "FreeRTOS.h"
+
+/******************************* DEFINES *********************************/
+
+#define taskYIELD() sched_yield()
+
+#define xTaskCreate(code, name, stack, param, prio, handle) \
+    xTaskCreatePinnedToCore(code, name, stack, param, prio, handle, \
+                            tskNO_AFFINITY)
+
+/******************************* TYPEDEFS ********************************/
+
+typedef struct host_task* TaskHandle_t;
+typedef void (*TaskFunction_t)(void *pvParameters);
+
+typedef enum
+{
+    eRunning,
+    eReady,
+    eBlocked,
+    eSuspended,
+    eDeleted,
+    eInvalid
+} eTaskState;
+
+// The run time counter is the CPU time of the thread in us. The stack is
+// the one of the thread, its use isn't tracked: the whole requested depth
+// is reported as never used.
+typedef struct
+{
+    TaskHandle_t           xHandle;
+    const char             *pcTaskName;
+    UBaseType_t            xTaskNumber;
+    eTaskState             eCurrentState;
+    UBaseType_t            uxCurrentPriority;
+    UBaseType_t            uxBasePriority;
+    uint32_t               ulRunTimeCounter;
+    StackType_t            *pxStackBase;
+    configSTACK_DEPTH_TYPE usStackHighWaterMark;
+    BaseType_t             xCoreID;
+} TaskStatus_t;
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t code,
+                                   const char     *name,
+                                   uint32_t       stack_depth,
+                                   void           *parameters,
+                                   UBaseType_t    priority,
+                                   TaskHandle_t   *handle,
+                                   BaseType_t     core);
+
+// NULL deletes the calling task. Another task ends at its next wait on a
+// queue or semaphore, or its next delay.
+void vTaskDelete(TaskHandle_t task);
+
+void vTaskDelay(TickType_t ticks);
+
+void vTaskDelayUntil(TickType_t *previous, TickType_t increment);
+
+TickType_t xTaskGetTickCount(void);
+
+// Threads not created through xTaskCreate get a handle on first use.
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task);
+
+const char* pcTaskGetName(TaskHandle_t task);
+
+UBaseType_t uxTaskGetNumberOfTasks(void);
+
+// Tasks created through xTaskCreate only. The total run time is the time
+// since the first task was created, in us.
+UBaseType_t uxTaskGetSystemState(TaskStatus_t *statuses,
+                                 UBaseType_t  amount,
+                                 uint32_t     *total_run_time);
+
+/******************************* THE END *********************************/
+
+#endif /* TASK_H_ */
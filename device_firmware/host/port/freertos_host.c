@@ -0,0 +1,598 @@
+/*
+ * freertos_host.c
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Host port of the FreeRTOS API the firmware uses, see FreeRTOS.h.
+ *
+ */
+/******************************* INCLUDES ********************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "host_port.h"
+
+/******************************* TYPEDEFS ********************************/
+
+struct host_task
+{
+    pthread_t      thread;
+    char           name[configMAX_TASK_NAME_LEN];
+    UBaseType_t    priority;
+    uint32_t       stack_depth;
+    UBaseType_t    number;
+    BaseType_t     core;
+    TaskFunction_t code;
+    void           *parameters;
+};
+
+struct host_queue
+{
+    pthread_mutex_t lock;
+    pthread_cond_t  changed;
+
+    uint8_t     *items;
+    UBaseType_t length;
+    UBaseType_t item_size;
+    UBaseType_t count;
+    UBaseType_t head;
+
+    // Set the queue is a member of, it gets the handle for every item.
+    struct host_queue *set;
+
+    // Recursive mutexes only.
+    bool         recursive;
+    TaskHandle_t owner;
+    UBaseType_t  depth;
+};
+
+/******************************* GLOBAL VARIABLES ************************/
+
+static __thread TaskHandle_t current = NULL;
+
+// Tasks created through xTaskCreate, for uxTaskGetSystemState().
+static TaskHandle_t    tasks[configHOST_TASK_AMOUNT];
+static UBaseType_t     taskNumber = 0;
+static int64_t         taskEpoch  = 0;
+static pthread_mutex_t tasksLock  = PTHREAD_MUTEX_INITIALIZER;
+
+/******************************* LOCAL FUNCTIONS *************************/
+
+static void host_task_unlist(TaskHandle_t task);
+
+static void* host_task_entry(void *arg)
+{
+    TaskHandle_t task = (TaskHandle_t)arg;
+
+    current = task;
+    task->code(task->parameters);
+    // A FreeRTOS task may not return, on the host it just ends.
+    host_task_unlist(task);
+    return NULL;
+}
+
+// Call with tasksLock held.
+static void host_task_list(TaskHandle_t task)
+{
+    if(taskEpoch == 0)
+    {
+        taskEpoch = host_time_us();
+    }
+    task->number = ++taskNumber;
+    for(int i = 0; i < configHOST_TASK_AMOUNT; i++)
+    {
+        if(tasks[i] == NULL)
+        {
+            tasks[i] = task;
+            break;
+        }
+    }
+}
+
+static void host_task_unlist(TaskHandle_t task)
+{
+    pthread_mutex_lock(&tasksLock);
+    for(int i = 0; i < configHOST_TASK_AMOUNT; i++)
+    {
+        if(tasks[i] == task)
+        {
+            tasks[i] = NULL;
+        }
+    }
+    pthread_mutex_unlock(&tasksLock);
+}
+
+static void host_deadline(TickType_t timeout, struct timespec *deadline)
+{
+    uint64_t ms = (uint64_t)timeout * portTICK_PERIOD_MS;
+
+    clock_gettime(CLOCK_MONOTONIC, deadline);
+    deadline->tv_sec  += ms / 1000;
+    deadline->tv_nsec += (ms % 1000) * 1000000;
+    if(deadline->tv_nsec >= 1000000000)
+    {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000;
+    }
+}
+
+static void host_queue_unlock(void *queue)
+{
+    pthread_mutex_unlock(&((struct host_queue*)queue)->lock);
+}
+
+// Waits for a change of the queue, false when the timeout passed. Called
+// with the lock taken. A task deleted while it waits leaves the queue 
+// unlocked.
+static bool host_queue_wait(struct host_queue     *queue, 
+                            TickType_t            timeout,
+                            const struct timespec *deadline)
+{
+    bool changed = true;
+
+    if(timeout == 0)
+    {
+        return false;
+    }
+    pthread_cleanup_push(host_queue_unlock, queue);
+    if(timeout == portMAX_DELAY)
+    {
+        pthread_cond_wait(&queue->changed, &queue->lock);
+    }
+    else
+    {
+        changed = pthread_cond_timedwait(&queue->changed, 
+                                         &queue->lock, 
+                                         deadline) != ETIMEDOUT;
+    }
+    pthread_cleanup_pop(0);
+    return changed;
+}
+
+static struct host_queue* host_queue_create(UBaseType_t length, 
+                                            UBaseType_t item_size,
+                                            UBaseType_t count)
+{
+    struct host_queue  *queue = calloc(1, sizeof(struct host_queue));
+    pthread_condattr_t attr;
+
+    if(queue == NULL)
+    {
+        return NULL;
+    }
+    if(item_size > 0)
+    {
+        queue->items = malloc(length * item_size);
+        if(queue->items == NULL)
+        {
+            free(queue);
+            return NULL;
+        }
+    }
+    queue->length    = length;
+    queue->item_size = item_size;
+    queue->count     = count;
+
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&queue->changed, &attr);
+    pthread_condattr_destroy(&attr);
+    return queue;
+}
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t code,
+                                   const char     *name,
+                                   uint32_t       stack_depth,
+                                   void           *parameters,
+                                   UBaseType_t    priority,
+                                   TaskHandle_t   *handle,
+                                   BaseType_t     core)
+{
+    TaskHandle_t task = calloc(1, sizeof(struct host_task));
+
+    if(task == NULL)
+    {
+        return pdFAIL;
+    }
+    snprintf(task->name, sizeof(task->name), "%s", name);
+    task->priority    = priority;
+    task->stack_depth = stack_depth;
+    task->core        = core;
+    task->code        = code;
+    task->parameters  = parameters;
+
+    // Listed before it runs, it may delete itself right away. The lock
+    // keeps it from being sampled before its thread exists.
+    pthread_mutex_lock(&tasksLock);
+    host_task_list(task);
+    if(pthread_create(&task->thread, NULL, host_task_entry, task) != 0)
+    {
+        pthread_mutex_unlock(&tasksLock);
+        host_task_unlist(task);
+        free(task);
+        return pdFAIL;
+    }
+    pthread_mutex_unlock(&tasksLock);
+    pthread_detach(task->thread);
+
+    if(handle != NULL)
+    {
+        *handle = task;
+    }
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    if(task == NULL || task == current)
+    {
+        host_task_unlist(current);
+        pthread_exit(NULL);
+    }
+    // Another task ends at its next wait or delay, the waits of the port
+    // are the only cancellation points it reaches while holding a lock.
+    host_task_unlist(task);
+    pthread_cancel(task->thread);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    if(ticks == 0)
+    {
+        sched_yield();
+        return;
+    }
+    host_sleep_us((int64_t)ticks * portTICK_PERIOD_MS * 1000);
+}
+
+void vTaskDelayUntil(TickType_t *previous, TickType_t increment)
+{
+    TickType_t wake = *previous + increment;
+    TickType_t now  = xTaskGetTickCount();
+
+    if((int32_t)(wake - now) > 0)
+    {
+        vTaskDelay(wake - now);
+    }
+    *previous = wake;
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(host_time_us() / 1000 / portTICK_PERIOD_MS);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    if(current == NULL)
+    {
+        current = calloc(1, sizeof(struct host_task));
+        if(current != NULL)
+        {
+            current->thread = pthread_self();
+            snprintf(current->name, sizeof(current->name), "host");
+        }
+    }
+    return current;
+}
+
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task)
+{
+    if(task == NULL)
+    {
+        task = xTaskGetCurrentTaskHandle();
+    }
+    return task != NULL ? task->priority : 0;
+}
+
+const char* pcTaskGetName(TaskHandle_t task)
+{
+    if(task == NULL)
+    {
+        task = xTaskGetCurrentTaskHandle();
+    }
+    return task != NULL ? task->name : "";
+}
+
+UBaseType_t uxTaskGetNumberOfTasks(void)
+{
+    UBaseType_t amount = 0;
+
+    pthread_mutex_lock(&tasksLock);
+    for(int i = 0; i < configHOST_TASK_AMOUNT; i++)
+    {
+        amount += (tasks[i] != NULL);
+    }
+    pthread_mutex_unlock(&tasksLock);
+    return amount;
+}
+
+UBaseType_t uxTaskGetSystemState(TaskStatus_t *statuses,
+                                 UBaseType_t  amount,
+                                 uint32_t     *total_run_time)
+{
+    UBaseType_t listed = 0;
+
+    if(uxTaskGetNumberOfTasks() > amount)
+    {
+        return 0;
+    }
+
+    pthread_mutex_lock(&tasksLock);
+    for(int i = 0; i < configHOST_TASK_AMOUNT && listed < amount; i++)
+    {
+        TaskHandle_t    task = tasks[i];
+        TaskStatus_t    *status;
+        clockid_t       clock;
+        struct timespec cpu = {0};
+
+        if(task == NULL)
+        {
+            continue;
+        }
+        // The thread may not run yet or may just have ended.
+        if(pthread_getcpuclockid(task->thread, &clock) == 0)
+        {
+            clock_gettime(clock, &cpu);
+        }
+
+        status = &statuses[listed++];
+        memset(status, 0, sizeof(TaskStatus_t));
+        status->xHandle              = task;
+        status->pcTaskName           = task->name;
+        status->xTaskNumber          = task->number;
+        status->eCurrentState        = task == current ? eRunning : eBlocked;
+        status->uxCurrentPriority    = task->priority;
+        status->uxBasePriority       = task->priority;
+        status->ulRunTimeCounter     = (uint32_t)(cpu.tv_sec * 1000000 + 
+                                                  cpu.tv_nsec / 1000);
+        status->usStackHighWaterMark = task->stack_depth;
+        status->xCoreID              = task->core;
+    }
+    if(total_run_time != NULL)
+    {
+        *total_run_time = (uint32_t)(host_time_us() - taskEpoch);
+    }
+    pthread_mutex_unlock(&tasksLock);
+    return listed;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size)
+{
+    return host_queue_create(length, item_size, 0);
+}
+
+void vQueueDelete(QueueHandle_t queue)
+{
+    if(queue != NULL)
+    {
+        pthread_mutex_destroy(&queue->lock);
+        pthread_cond_destroy(&queue->changed);
+        free(queue->items);
+        free(queue);
+    }
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, 
+                      const void    *item, 
+                      TickType_t    timeout)
+{
+    struct timespec   deadline;
+    struct host_queue *set;
+
+    host_deadline(timeout, &deadline);
+
+    pthread_mutex_lock(&queue->lock);
+    while(queue->count >= queue->length)
+    {
+        if(!host_queue_wait(queue, timeout, &deadline))
+        {
+            pthread_mutex_unlock(&queue->lock);
+            return pdFAIL;
+        }
+    }
+    if(queue->item_size > 0)
+    {
+        UBaseType_t tail = (queue->head + queue->count) % queue->length;
+        memcpy(queue->items + tail * queue->item_size, item, queue->item_size);
+    }
+    queue->count++;
+    set = queue->set;
+    pthread_cond_broadcast(&queue->changed);
+    pthread_mutex_unlock(&queue->lock);
+
+    // Like FreeRTOS, the set has room for every item of its members.
+    if(set != NULL)
+    {
+        xQueueSend(set, &queue, 0);
+    }
+    return pdPASS;
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t queue, 
+                             const void    *item, 
+                             BaseType_t    *woken)
+{
+    if(woken != NULL)
+    {
+        *woken = pdFALSE;
+    }
+    return xQueueSend(queue, item, 0);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t timeout)
+{
+    struct timespec deadline;
+
+    host_deadline(timeout, &deadline);
+
+    pthread_mutex_lock(&queue->lock);
+    while(queue->count == 0)
+    {
+        if(!host_queue_wait(queue, timeout, &deadline))
+        {
+            pthread_mutex_unlock(&queue->lock);
+            return pdFAIL;
+        }
+    }
+    if(queue->item_size > 0)
+    {
+        if(item != NULL)
+        {
+            memcpy(item, 
+                   queue->items + queue->head * queue->item_size, 
+                   queue->item_size);
+        }
+        queue->head = (queue->head + 1) % queue->length;
+    }
+    queue->count--;
+    pthread_cond_broadcast(&queue->changed);
+    pthread_mutex_unlock(&queue->lock);
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue)
+{
+    UBaseType_t count;
+
+    pthread_mutex_lock(&queue->lock);
+    count = queue->count;
+    pthread_mutex_unlock(&queue->lock);
+    return count;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue)
+{
+    return queue->length - uxQueueMessagesWaiting(queue);
+}
+
+QueueSetHandle_t xQueueCreateSet(UBaseType_t length)
+{
+    return host_queue_create(length, sizeof(QueueHandle_t), 0);
+}
+
+BaseType_t xQueueAddToSet(QueueSetMemberHandle_t member, QueueSetHandle_t set)
+{
+    BaseType_t ret = pdFAIL;
+
+    pthread_mutex_lock(&member->lock);
+    // FreeRTOS only adds empty queues that are in no set yet.
+    if(member->set == NULL && member->count == 0)
+    {
+        member->set = set;
+        ret         = pdPASS;
+    }
+    pthread_mutex_unlock(&member->lock);
+    return ret;
+}
+
+QueueSetMemberHandle_t xQueueSelectFromSet(QueueSetHandle_t set, 
+                                           TickType_t       timeout)
+{
+    QueueSetMemberHandle_t member = NULL;
+
+    if(xQueueReceive(set, &member, timeout) != pdPASS)
+    {
+        return NULL;
+    }
+    return member;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+    return host_queue_create(1, 0, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max, UBaseType_t initial)
+{
+    return host_queue_create(max, 0, initial);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return host_queue_create(1, 0, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex(void)
+{
+    SemaphoreHandle_t mutex = host_queue_create(1, 0, 1);
+
+    if(mutex != NULL)
+    {
+        mutex->recursive = true;
+    }
+    return mutex;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t timeout)
+{
+    return xQueueReceive(semaphore, NULL, timeout);
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore)
+{
+    return xQueueSend(semaphore, NULL, 0);
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t semaphore, BaseType_t *woken)
+{
+    return xQueueSendFromISR(semaphore, NULL, woken);
+}
+
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t mutex, TickType_t timeout)
+{
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+
+    pthread_mutex_lock(&mutex->lock);
+    if(mutex->owner == self)
+    {
+        mutex->depth++;
+        pthread_mutex_unlock(&mutex->lock);
+        return pdPASS;
+    }
+    pthread_mutex_unlock(&mutex->lock);
+
+    if(xQueueReceive(mutex, NULL, timeout) != pdPASS)
+    {
+        return pdFAIL;
+    }
+
+    pthread_mutex_lock(&mutex->lock);
+    mutex->owner = self;
+    mutex->depth = 1;
+    pthread_mutex_unlock(&mutex->lock);
+    return pdPASS;
+}
+
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t mutex)
+{
+    bool release = false;
+
+    pthread_mutex_lock(&mutex->lock);
+    if(mutex->owner != xTaskGetCurrentTaskHandle())
+    {
+        pthread_mutex_unlock(&mutex->lock);
+        return pdFAIL;
+    }
+    if(--mutex->depth == 0)
+    {
+        mutex->owner = NULL;
+        release      = true;
+    }
+    pthread_mutex_unlock(&mutex->lock);
+
+    return release ? xQueueSend(mutex, NULL, 0) : pdPASS;
+}
+
+/******************************* THE END *********************************/
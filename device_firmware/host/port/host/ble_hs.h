@@ -0,0 +1,301 @@
+/*
+ * ble_hs.h
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Host stand-in for the NimBLE host API the firmware uses: GATT service
+ * registration, GAP advertising and connections, mbufs and the host 
+ * configuration. There is no radio behind it, the GATT simulator in 
+ * sim/gatt_sim.h plays the clients and runs the callbacks on the host 
+ * task like NimBLE does.
+ *
+ * Only the parts the firmware touches exist. Constants have the NimBLE
+ * values.
+ *
+ */
+#ifndef BLE_HS_H_
+#define BLE_HS_H_
+
+/******************************* INCLUDES ********************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "host/ble_uuid.h"
+
+/******************************* DEFINES *********************************/
+
+#define BLE_HS_CONN_HANDLE_NONE        0xFFFF
+#define BLE_HS_FOREVER                 INT32_MAX
+
+#define BLE_HS_EALREADY                2
+#define BLE_HS_EINVAL                  3
+#define BLE_HS_ENOMEM                  6
+#define BLE_HS_ENOTCONN                7
+#define BLE_HS_EBUSY                   15
+#define BLE_HS_ERR_HCI_BASE            0x200
+#define BLE_HS_HCI_ERR(x)              ((x) ? BLE_HS_ERR_HCI_BASE + (x) : 0)
+
+#define BLE_ERR_CONN_SPVN_TMO          0x08
+#define BLE_ERR_CONN_LIMIT             0x09
+#define BLE_ERR_REM_USER_CONN_TERM     0x13
+
+#define BLE_ATT_ERR_INVALID_HANDLE     0x01
+#define BLE_ATT_ERR_READ_NOT_PERMITTED 0x02
+#define BLE_ATT_ERR_WRITE_NOT_PERMITTED 0x03
+#define BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN 0x0D
+#define BLE_ATT_ERR_UNLIKELY           0x0E
+#define BLE_ATT_ERR_VALUE_NOT_ALLOWED  0x13
+#define BLE_ATT_ATTR_MAX_LEN           512
+
+#define BLE_GATT_SVC_TYPE_END          0
+#define BLE_GATT_SVC_TYPE_PRIMARY      1
+#define BLE_GATT_SVC_TYPE_SECONDARY    2
+
+#define BLE_GATT_CHR_F_READ            0x0002
+#define BLE_GATT_CHR_F_WRITE_NO_RSP    0x0004
+#define BLE_GATT_CHR_F_WRITE           0x0008
+#define BLE_GATT_CHR_F_NOTIFY          0x0010
+
+#define BLE_GATT_ACCESS_OP_READ_CHR    0
+#define BLE_GATT_ACCESS_OP_WRITE_CHR   1
+
+#define BLE_GAP_EVENT_CONNECT          0
+#define BLE_GAP_EVENT_DISCONNECT       1
+#define BLE_GAP_EVENT_ADV_COMPLETE     9
+#define BLE_GAP_EVENT_ENC_CHANGE       10
+#define BLE_GAP_EVENT_REPEAT_PAIRING   17
+
+#define BLE_GAP_REPEAT_PAIRING_RETRY   1
+#define BLE_GAP_REPEAT_PAIRING_IGNORE  2
+
+#define BLE_GAP_CONN_MODE_NON          0
+#define BLE_GAP_CONN_MODE_DIR          1
+#define BLE_GAP_CONN_MODE_UND          2
+#define BLE_GAP_DISC_MODE_NON          0
+#define BLE_GAP_DISC_MODE_LTD          1
+#define BLE_GAP_DISC_MODE_GEN          2
+
+#define BLE_HS_ADV_F_DISC_LTD          0x01
+#define BLE_HS_ADV_F_DISC_GEN          0x02
+#define BLE_HS_ADV_F_BREDR_UNSUP       0x04
+
+#define BLE_HS_IO_DISPLAY_ONLY         0x00
+#define BLE_HS_IO_NO_INPUT_OUTPUT      0x03
+#define BLE_SM_PAIR_KEY_DIST_ENC       0x01
+#define BLE_SM_PAIR_KEY_DIST_ID        0x02
+
+#define BLE_ADDR_PUBLIC                0x00
+#define BLE_ADDR_RANDOM                0x01
+
+/******************************* TYPEDEFS ********************************/
+
+typedef struct
+{
+    uint8_t type;
+    uint8_t val[6];
+} ble_addr_t;
+
+// A single flat buffer, NimBLE chains them. om_len is the amount of data.
+struct os_mbuf
+{
+    uint8_t  *om_data;
+    uint16_t om_len;
+    uint16_t om_size;
+};
+
+struct ble_gatt_chr_def;
+
+struct ble_gatt_access_ctxt
+{
+    uint8_t                       op;
+    struct os_mbuf                *om;
+    const struct ble_gatt_chr_def *chr;
+};
+
+typedef int ble_gatt_access_fn(uint16_t                    conn_handle, 
+                               uint16_t                    attr_handle,
+                               struct ble_gatt_access_ctxt *ctxt, 
+                               void                        *arg);
+
+typedef uint16_t ble_gatt_chr_flags;
+
+struct ble_gatt_chr_def
+{
+    const ble_uuid_t   *uuid;
+    ble_gatt_access_fn *access_cb;
+    void               *arg;
+    void               *descriptors;
+    ble_gatt_chr_flags flags;
+    uint8_t            min_key_size;
+    uint16_t           *val_handle;
+};
+
+struct ble_gatt_svc_def
+{
+    uint8_t                        type;
+    const ble_uuid_t               *uuid;
+    const struct ble_gatt_svc_def  **includes;
+    const struct ble_gatt_chr_def  *characteristics;
+};
+
+struct ble_gap_sec_state
+{
+    unsigned encrypted:1;
+    unsigned authenticated:1;
+    unsigned bonded:1;
+    unsigned key_size:5;
+};
+
+struct ble_gap_conn_desc
+{
+    struct ble_gap_sec_state sec_state;
+    ble_addr_t               our_id_addr;
+    ble_addr_t               peer_id_addr;
+    ble_addr_t               our_ota_addr;
+    ble_addr_t               peer_ota_addr;
+    uint16_t                 conn_handle;
+    uint16_t                 conn_itvl;
+    uint16_t                 conn_latency;
+    uint16_t                 supervision_timeout;
+    uint8_t                  role;
+    uint8_t                  master_clock_accuracy;
+};
+
+struct ble_gap_event
+{
+    uint8_t type;
+
+    union
+    {
+        struct
+        {
+            int      status;
+            uint16_t conn_handle;
+        } connect;
+
+        struct
+        {
+            int                      reason;
+            struct ble_gap_conn_desc conn;
+        } disconnect;
+
+        struct
+        {
+            int reason;
+        } adv_complete;
+
+        struct
+        {
+            int      status;
+            uint16_t conn_handle;
+        } enc_change;
+
+        struct
+        {
+            uint16_t conn_handle;
+            uint8_t  cur_key_size;
+            uint8_t  cur_authenticated:1;
+            uint8_t  cur_sc:1;
+            uint8_t  new_key_size;
+            uint8_t  new_authenticated:1;
+            uint8_t  new_sc:1;
+            uint8_t  new_bonding:1;
+        } repeat_pairing;
+    };
+};
+
+typedef int ble_gap_event_fn(struct ble_gap_event *event, void *arg);
+
+struct ble_gap_adv_params
+{
+    uint8_t  conn_mode;
+    uint8_t  disc_mode;
+    uint16_t itvl_min;
+    uint16_t itvl_max;
+    uint8_t  channel_map;
+    uint8_t  filter_policy;
+    uint8_t  high_duty_cycle:1;
+};
+
+struct ble_hs_adv_fields
+{
+    uint8_t       flags;
+    const uint8_t *name;
+    uint8_t       name_len;
+    unsigned      name_is_complete:1;
+    int8_t        tx_pwr_lvl;
+    unsigned      tx_pwr_lvl_is_present:1;
+    const uint8_t *mfg_data;
+    uint8_t       mfg_data_len;
+};
+
+struct ble_store_status_event;
+
+typedef void ble_hs_sync_fn(void);
+typedef void ble_hs_reset_fn(int reason);
+typedef int  ble_store_status_fn(struct ble_store_status_event *event, void *arg);
+
+struct ble_hs_cfg
+{
+    ble_hs_reset_fn     *reset_cb;
+    ble_hs_sync_fn      *sync_cb;
+    ble_store_status_fn *store_status_cb;
+    void                *store_status_arg;
+
+    uint8_t  sm_io_cap;
+    unsigned sm_oob_data_flag:1;
+    unsigned sm_bonding:1;
+    unsigned sm_mitm:1;
+    unsigned sm_sc:1;
+    unsigned sm_keypress:1;
+    uint8_t  sm_our_key_dist;
+    uint8_t  sm_their_key_dist;
+};
+
+/******************************* GLOBAL VARIABLES ************************/
+
+extern struct ble_hs_cfg ble_hs_cfg;
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+static inline int ble_addr_cmp(const ble_addr_t *a, const ble_addr_t *b)
+{
+    int type_diff = a->type - b->type;
+
+    return type_diff != 0 ? type_diff : memcmp(a->val, b->val, sizeof(a->val));
+}
+
+int os_mbuf_append(struct os_mbuf *om, const void *data, uint16_t len);
+
+int ble_gatts_count_cfg(const struct ble_gatt_svc_def *defs);
+
+int ble_gatts_add_svcs(const struct ble_gatt_svc_def *svcs);
+
+int ble_gap_adv_set_fields(const struct ble_hs_adv_fields *adv_fields);
+
+int ble_gap_adv_start(uint8_t                         own_addr_type, 
+                      const ble_addr_t                *direct_addr,
+                      int32_t                         duration_ms, 
+                      const struct ble_gap_adv_params *adv_params,
+                      ble_gap_event_fn                *cb, 
+                      void                            *cb_arg);
+
+int ble_gap_adv_stop(void);
+
+int ble_gap_adv_active(void);
+
+int ble_gap_terminate(uint16_t conn_handle, uint8_t hci_reason);
+
+int ble_gap_security_initiate(uint16_t conn_handle);
+
+int ble_gap_conn_find(uint16_t conn_handle, struct ble_gap_conn_desc *out_desc);
+
+int ble_store_util_status_rr(struct ble_store_status_event *event, void *arg);
+
+int ble_store_util_delete_peer(const ble_addr_t *peer_id_addr);
+
+/******************************* THE END *********************************/
+
+#endif /* BLE_HS_H_ */
@@ -0,0 +1,50 @@
+/*
+ * ble_uuid.h
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Host stand-in for the NimBLE UUID types, 16 bit UUIDs only.
+ *
+ */
+#ifndef BLE_UUID_H_
+#define BLE_UUID_H_
+
+/******************************* INCLUDES ********************************/
+
+#include <stdint.h>
+
+/******************************* DEFINES *********************************/
+
+#define BLE_UUID_TYPE_16 16
+
+#define BLE_UUID16_INIT(uuid16) \
+    {                           \
+        .u.type = BLE_UUID_TYPE_16, \
+        .value  = (uuid16),     \
+    }
+
+#define BLE_UUID16_DECLARE(uuid16) \
+    ((const ble_uuid_t *) (&(ble_uuid16_t) BLE_UUID16_INIT(uuid16)))
+
+/******************************* TYPEDEFS ********************************/
+
+typedef struct
+{
+    uint8_t type;
+} ble_uuid_t;
+
+typedef struct
+{
+    ble_uuid_t u;
+    uint16_t   value;
+} ble_uuid16_t;
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+// The 16 bit value, 0 for other UUID types.
+uint16_t ble_uuid_u16(const ble_uuid_t *uuid);
+
+/******************************* THE END *********************************/
+
+#endif /* BLE_UUID_H_ */
@@ -0,0 +1,23 @@
+/*
+ * util.h
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Host stand-in for the NimBLE host utilities, see host/ble_hs.h.
+ *
+ */
+#ifndef BLE_HS_UTIL_H_
+#define BLE_HS_UTIL_H_
+
+/******************************* INCLUDES ********************************/
+
+#include <stdint.h>
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+int ble_hs_id_infer_auto(int privacy, uint8_t *out_addr_type);
+
+/******************************* THE END *********************************/
+
+#endif /* BLE_HS_UTIL_H_ */
@@ -0,0 +1,55 @@
+/*
+ * host_port.h
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Host only additions to the ported ESP-IDF API. They set up what the
+ * board provides on the real device: the partitions in flash and the
+ * wiring of GPIOs to the simulated devices.
+ *
+ */
+#ifndef HOST_PORT_H_
+#define HOST_PORT_H_
+
+/******************************* INCLUDES ********************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_partition.h"
+#include "driver/gpio.h"
+
+/******************************* DEFINES *********************************/
+
+#define HOST_PARTITION_AMOUNT  8
+#define HOST_GPIO_WATCH_AMOUNT 8
+
+/******************************* TYPEDEFS ********************************/
+
+// Called after every level change of a watched pin, from the task that
+// set the level.
+typedef void (*host_gpio_callback_t)(void *ctx, gpio_num_t pin, uint32_t level);
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+int64_t host_time_us(void);
+
+void host_sleep_us(int64_t us);
+
+// Adds an erased (0xFF) partition.
+bool host_partition_add(const char              *label,
+                        esp_partition_type_t    type,
+                        esp_partition_subtype_t subtype,
+                        uint32_t                size);
+
+// Copies a file to the start of a partition.
+bool host_partition_load(const char *label, const char *path);
+
+// Copies the first len bytes of a partition to a file.
+bool host_partition_save(const char *label, const char *path, uint32_t len);
+
+bool host_gpio_watch(gpio_num_t pin, host_gpio_callback_t callback, void *ctx);
+
+/******************************* THE END *********************************/
+
+#endif /* HOST_PORT_H_ */
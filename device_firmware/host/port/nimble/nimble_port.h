@@ -0,0 +1,26 @@
+/*
+ * nimble_port.h
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Host stand-in for the NimBLE port, see host/ble_hs.h. nimble_port_run()
+ * syncs the host and then serves the GATT simulator until the end.
+ *
+ */
+#ifndef NIMBLE_PORT_H_
+#define NIMBLE_PORT_H_
+
+/******************************* INCLUDES ********************************/
+
+#include "esp_err.h"
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+esp_err_t nimble_port_init(void);
+
+void nimble_port_run(void);
+
+/******************************* THE END *********************************/
+
+#endif /* NIMBLE_PORT_H_ */
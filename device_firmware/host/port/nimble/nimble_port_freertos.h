@@ -0,0 +1,25 @@
+/*
+ * nimble_port_freertos.h
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Host stand-in for the NimBLE FreeRTOS glue, see host/ble_hs.h.
+ *
+ */
+#ifndef NIMBLE_PORT_FREERTOS_H_
+#define NIMBLE_PORT_FREERTOS_H_
+
+/******************************* INCLUDES ********************************/
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+// Starts the host task running host_task_fn.
+void nimble_port_freertos_init(TaskFunction_t host_task_fn);
+
+/******************************* THE END *********************************/
+
+#endif /* NIMBLE_PORT_FREERTOS_H_ */
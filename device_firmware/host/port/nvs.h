@@ -0,0 +1,60 @@
+/*
+ * nvs.h
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Host port of the NVS API the firmware uses. Entries are kept in RAM
+ * for the lifetime of the process, a host run starts with empty NVS.
+ *
+ */
+#ifndef NVS_H_
+#define NVS_H_
+
+/******************************* INCLUDES ********************************/
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+/******************************* TYPEDEFS ********************************/
+
+typedef uint32_t nvs_handle_t;
+
+typedef enum
+{
+    NVS_READONLY,
+    NVS_READWRITE
+} nvs_open_mode_t;
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+esp_err_t nvs_open(const char      *name_space, 
+                   nvs_open_mode_t open_mode, 
+                   nvs_handle_t    *out_handle);
+
+void nvs_close(nvs_handle_t handle);
+
+esp_err_t nvs_commit(nvs_handle_t handle);
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, 
+                       const char   *key, 
+                       const void   *value, 
+                       size_t       length);
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, 
+                       const char   *key, 
+                       void         *out_value, 
+                       size_t       *length);
+
+esp_err_t nvs_set_u8(nvs_handle_t handle, const char *key, uint8_t value);
+
+esp_err_t nvs_get_u8(nvs_handle_t handle, const char *key, uint8_t *out_value);
+
+esp_err_t nvs_set_u32(nvs_handle_t handle, const char *key, uint32_t value);
+
+esp_err_t nvs_get_u32(nvs_handle_t handle, const char *key, uint32_t *out_value);
+
+/******************************* THE END *********************************/
+
+#endif /* NVS_H_ */
@@ -0,0 +1,25 @@
+/*
+ * nvs_flash.h
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Host port of NVS initialization, see nvs.h.
+ *
+ */
+#ifndef NVS_FLASH_H_
+#define NVS_FLASH_H_
+
+/******************************* INCLUDES ********************************/
+
+#include "nvs.h"
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+esp_err_t nvs_flash_init(void);
+
+esp_err_t nvs_flash_erase(void);
+
+/******************************* THE END *********************************/
+
+#endif /* NVS_FLASH_H_ */
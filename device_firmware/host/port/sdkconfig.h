@@ -0,0 +1,17 @@
+/*
+ * sdkconfig.h
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * The options of device_firmware/sdkconfig the host build depends on.
+ *
+ */
+#ifndef SDKCONFIG_H_
+#define SDKCONFIG_H_
+
+#define CONFIG_FREERTOS_HZ                  100
+#define CONFIG_BT_NIMBLE_MAX_CONNECTIONS    3
+#define CONFIG_FREERTOS_USE_TRACE_FACILITY  1
+
+#endif /* SDKCONFIG_H_ */
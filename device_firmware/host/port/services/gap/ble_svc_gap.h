@@ -0,0 +1,23 @@
+/*
+ * ble_svc_gap.h
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Host stand-in for the NimBLE GAP service, see host/ble_hs.h.
+ *
+ */
+#ifndef BLE_SVC_GAP_H_
+#define BLE_SVC_GAP_H_
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+void ble_svc_gap_init(void);
+
+const char* ble_svc_gap_device_name(void);
+
+int ble_svc_gap_device_name_set(const char *name);
+
+/******************************* THE END *********************************/
+
+#endif /* BLE_SVC_GAP_H_ */
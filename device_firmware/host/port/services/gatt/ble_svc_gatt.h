@@ -0,0 +1,26 @@
+/*
+ * ble_svc_gatt.h
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Host stand-in for the NimBLE GATT service, see host/ble_hs.h.
+ *
+ */
+#ifndef BLE_SVC_GATT_H_
+#define BLE_SVC_GATT_H_
+
+/******************************* INCLUDES ********************************/
+
+#include <stdint.h>
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+void ble_svc_gatt_init(void);
+
+// Indicates the handle range changed to every bonded client.
+void ble_svc_gatt_changed(uint16_t start_handle, uint16_t end_handle);
+
+/******************************* THE END *********************************/
+
+#endif /* BLE_SVC_GATT_H_ */
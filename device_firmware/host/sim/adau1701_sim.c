@@ -0,0 +1,415 @@
+/*
+ * adau1701_sim.c
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Model of the ADAU1701 I2C slave, see adau1701_sim.h.
+ *
+ */
+/******************************* INCLUDES ********************************/
+
+#include "adau1701_sim.h"
+#include "host_port.h"
+
+/******************************* LOCAL FUNCTIONS *************************/
+
+static bool adau1701_sim_start(void *ctx, bool read);
+static bool adau1701_sim_write(void *ctx, const uint8_t *data, size_t len);
+static void adau1701_sim_read(void *ctx, uint8_t *data, size_t len);
+static void adau1701_sim_stop(void *ctx);
+
+/******************************* GLOBAL VARIABLES ************************/
+
+// Sizes of the control registers from 0x0800 on, in bytes.
+static const uint8_t registerSizes[ADAU1701_SIM_REGISTER_AMOUNT] = {
+    4, 4, 4, 4, 4, 4, 4, 4,     /* 0x0800 interface registers          */
+    2, 2, 2, 2, 2, 2, 2, 2,     /* 0x0808 GPIO, aux ADC                */
+    5, 5, 5, 5, 5,              /* 0x0810 safeload data                */
+    2, 2, 2, 2, 2,              /* 0x0815 safeload address             */
+    2, 2,                       /* 0x081A data capture                 */
+    2,                          /* 0x081C core control                 */
+    1,                          /* 0x081D reserved                     */
+    2,                          /* 0x081E serial output control        */
+    1,                          /* 0x081F serial input control         */
+    3, 3,                       /* 0x0820 multipurpose pin config      */
+    2, 2, 2, 2, 2, 2,           /* 0x0822 aux ADC, clock, DAC setup    */
+};
+
+static const sim_i2c_ops_t adau1701SimOps = {
+    .start = adau1701_sim_start,
+    .write = adau1701_sim_write,
+    .read  = adau1701_sim_read,
+    .stop  = adau1701_sim_stop,
+};
+
+/******************************* LOCAL FUNCTIONS *************************/
+
+// Word size of the memory an address is in, 1 past the registers so bad
+// addresses are still consumed byte by byte.
+uint8_t adau1701_sim_word_size(uint16_t address)
+{
+    if(address < ADAU1701_SIM_PROGRAM_ADDR)
+    {
+        return ADAU1701_SIM_PARAMETER_REGSIZE;
+    }
+    if(address < ADAU1701_SIM_REGISTER_ADDR)
+    {
+        return ADAU1701_SIM_PROGRAM_REGSIZE;
+    }
+    if(address < ADAU1701_SIM_REGISTER_END)
+    {
+        return registerSizes[address - ADAU1701_SIM_REGISTER_ADDR];
+    }
+    return 1;
+}
+
+// Where the word of an address is kept, NULL past the registers.
+uint8_t* adau1701_sim_location(adau1701_sim_t *sim, uint16_t address)
+{
+    if(address < ADAU1701_SIM_PROGRAM_ADDR)
+    {
+        return &sim->parameter[address * ADAU1701_SIM_PARAMETER_REGSIZE];
+    }
+    if(address < ADAU1701_SIM_REGISTER_ADDR)
+    {
+        return &sim->program[(address - ADAU1701_SIM_PROGRAM_ADDR) * 
+                             ADAU1701_SIM_PROGRAM_REGSIZE];
+    }
+    if(address < ADAU1701_SIM_REGISTER_END)
+    {
+        uint16_t offset = 0;
+
+        for(uint16_t i = ADAU1701_SIM_REGISTER_ADDR; i < address; i++)
+        {
+            offset += registerSizes[i - ADAU1701_SIM_REGISTER_ADDR];
+        }
+        return &sim->registers[offset];
+    }
+    return NULL;
+}
+
+// Moves the written safeload slots to parameter RAM.
+static void adau1701_sim_safeload(adau1701_sim_t *sim)
+{
+    for(int slot = 0; slot < ADAU1701_SIM_SAFELOAD_SLOTS; slot++)
+    {
+        if(!(sim->safeload_pending & (1 << slot)))
+        {
+            continue;
+        }
+
+        const uint8_t *data    = adau1701_sim_location(sim, 
+                                                       ADAU1701_SIM_SAFELOAD_DATA + slot);
+        const uint8_t *address = adau1701_sim_location(sim, 
+                                                       ADAU1701_SIM_SAFELOAD_ADDRESS + slot);
+        uint16_t      target   = ((address[0] << 8) | address[1]) % 
+                                 ADAU1701_SIM_WORDS;
+        uint8_t       *word    = adau1701_sim_location(sim, target);
+
+        // The data register is 5 bytes, parameters use the lower 4.
+        memcpy(word, &data[1], ADAU1701_SIM_PARAMETER_REGSIZE);
+        word[0] &= ADAU1701_SIM_PARAMETER_MASK;
+        sim->stats.safeload_words++;
+    }
+    if(sim->safeload_pending != 0)
+    {
+        sim->stats.safeloads++;
+    }
+    sim->safeload_pending = 0;
+}
+
+// Stores one complete word written over the bus.
+void adau1701_sim_store(adau1701_sim_t *sim, uint16_t address, const uint8_t *word)
+{
+    uint8_t *location = adau1701_sim_location(sim, address);
+    uint8_t size      = adau1701_sim_word_size(address);
+
+    if(location == NULL)
+    {
+        sim->stats.protocol_errors++;
+        return;
+    }
+
+    memcpy(location, word, size);
+    sim->stats.words_written++;
+
+    if(address < ADAU1701_SIM_PROGRAM_ADDR)
+    {
+        location[0] &= ADAU1701_SIM_PARAMETER_MASK;
+    }
+    else if(address < ADAU1701_SIM_REGISTER_ADDR)
+    {
+        const uint8_t *control = adau1701_sim_location(sim, 
+                                                       ADAU1701_SIM_CORE_CONTROL);
+        if(control[1] & ADAU1701_SIM_CORE_CR)
+        {
+            // Audible on the chip, a download has to stop the core.
+            sim->stats.running_program_writes++;
+        }
+    }
+    else if(address >= ADAU1701_SIM_SAFELOAD_DATA && 
+            address <  ADAU1701_SIM_SAFELOAD_ADDRESS + ADAU1701_SIM_SAFELOAD_SLOTS)
+    {
+        sim->safeload_pending |= 1 << ((address - ADAU1701_SIM_SAFELOAD_DATA) % 
+                                       ADAU1701_SIM_SAFELOAD_SLOTS);
+    }
+    else if(address == ADAU1701_SIM_CORE_CONTROL && 
+            (location[1] & ADAU1701_SIM_CORE_IST))
+    {
+        // IST clears itself once the transfer is done.
+        adau1701_sim_safeload(sim);
+        location[1] &= ~ADAU1701_SIM_CORE_IST;
+    }
+}
+
+void adau1701_sim_clear(adau1701_sim_t *sim)
+{
+    memset(sim->parameter, 0, sizeof(sim->parameter));
+    memset(sim->program,   0, sizeof(sim->program));
+    memset(sim->registers, 0, sizeof(sim->registers));
+    sim->safeload_pending = 0;
+}
+
+static void adau1701_sim_reset_pin(void *ctx, gpio_num_t pin, uint32_t level)
+{
+    adau1701_sim_t *sim = (adau1701_sim_t*)ctx;
+
+    (void)pin;
+
+    pthread_mutex_lock(&sim->lock);
+    if(level == 0 && !sim->in_reset)
+    {
+        sim->in_reset = true;
+        sim->stats.resets++;
+    }
+    else if(level != 0 && sim->in_reset)
+    {
+        // The chip initializes its RAMs when it comes out of reset.
+        adau1701_sim_clear(sim);
+        sim->in_reset = false;
+    }
+    pthread_mutex_unlock(&sim->lock);
+}
+
+static bool adau1701_sim_start(void *ctx, bool read)
+{
+    adau1701_sim_t *sim = (adau1701_sim_t*)ctx;
+    bool           ack;
+
+    pthread_mutex_lock(&sim->lock);
+    ack = !sim->in_reset;
+    if(ack && read)
+    {
+        // Repeated start after the subaddress, or a read from where the
+        // last transaction ended.
+        if(sim->subaddress_len == 1 || sim->word_len != 0)
+        {
+            sim->stats.protocol_errors++;
+        }
+        sim->reading  = true;
+        sim->word_len = 0;
+    }
+    else if(ack)
+    {
+        sim->reading        = false;
+        sim->subaddress_len = 0;
+        sim->word_len       = 0;
+    }
+    pthread_mutex_unlock(&sim->lock);
+    return ack;
+}
+
+static bool adau1701_sim_write(void *ctx, const uint8_t *data, size_t len)
+{
+    adau1701_sim_t *sim = (adau1701_sim_t*)ctx;
+
+    pthread_mutex_lock(&sim->lock);
+    for(size_t i = 0; i < len; i++)
+    {
+        if(sim->subaddress_len < 2)
+        {
+            sim->pointer = (sim->pointer << 8) | data[i];
+            sim->subaddress_len++;
+            continue;
+        }
+
+        sim->word[sim->word_len++] = data[i];
+        if(sim->word_len == adau1701_sim_word_size(sim->pointer))
+        {
+            adau1701_sim_store(sim, sim->pointer, sim->word);
+            sim->pointer++;
+            sim->word_len = 0;
+        }
+    }
+    pthread_mutex_unlock(&sim->lock);
+    return true;
+}
+
+static void adau1701_sim_read(void *ctx, uint8_t *data, size_t len)
+{
+    adau1701_sim_t *sim = (adau1701_sim_t*)ctx;
+
+    pthread_mutex_lock(&sim->lock);
+    for(size_t i = 0; i < len; i++)
+    {
+        const uint8_t *location = adau1701_sim_location(sim, sim->pointer);
+        uint8_t       size      = adau1701_sim_word_size(sim->pointer);
+
+        if(location == NULL)
+        {
+            sim->stats.protocol_errors++;
+            data[i] = 0;
+        }
+        else
+        {
+            data[i] = location[sim->word_len];
+        }
+
+        if(++sim->word_len == size)
+        {
+            sim->pointer++;
+            sim->word_len = 0;
+            sim->stats.words_read++;
+        }
+    }
+    pthread_mutex_unlock(&sim->lock);
+}
+
+static void adau1701_sim_stop(void *ctx)
+{
+    adau1701_sim_t *sim = (adau1701_sim_t*)ctx;
+
+    pthread_mutex_lock(&sim->lock);
+    if(sim->reading)
+    {
+        sim->stats.reads++;
+    }
+    else
+    {
+        sim->stats.writes++;
+        // The word that was cut off is lost on the chip.
+        if(sim->subaddress_len == 1 || sim->word_len != 0)
+        {
+            sim->stats.protocol_errors++;
+        }
+    }
+    sim->word_len = 0;
+    pthread_mutex_unlock(&sim->lock);
+}
+
+// Walks whole words from address on, false when len doesn't end on a
+// word or the range is past the registers.
+static bool adau1701_sim_access(adau1701_sim_t *sim, 
+                                uint16_t       address, 
+                                uint16_t       len, 
+                                uint8_t        *data,
+                                bool           store)
+{
+    uint16_t done = 0;
+
+    while(done < len)
+    {
+        uint8_t *location = adau1701_sim_location(sim, address);
+        uint8_t size      = adau1701_sim_word_size(address);
+
+        if(location == NULL || done + size > len)
+        {
+            return false;
+        }
+        if(store)
+        {
+            memcpy(location, data + done, size);
+            if(address < ADAU1701_SIM_PROGRAM_ADDR)
+            {
+                location[0] &= ADAU1701_SIM_PARAMETER_MASK;
+            }
+        }
+        else
+        {
+            memcpy(data + done, location, size);
+        }
+        done += size;
+        address++;
+    }
+    return true;
+}
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+bool adau1701_sim_attach(adau1701_sim_t *sim,
+                         uint8_t        port,
+                         uint8_t        address,
+                         gpio_num_t     reset_pin)
+{
+    memset(sim, 0, sizeof(adau1701_sim_t));
+    pthread_mutex_init(&sim->lock, NULL);
+    sim->address   = address;
+    sim->reset_pin = reset_pin;
+
+    if(!sim_i2c_attach(port, address, &adau1701SimOps, sim))
+    {
+        return false;
+    }
+    if(reset_pin != GPIO_NUM_NC && 
+       !host_gpio_watch(reset_pin, adau1701_sim_reset_pin, sim))
+    {
+        sim_i2c_detach(port, address);
+        return false;
+    }
+    return true;
+}
+
+bool adau1701_sim_peek(adau1701_sim_t *sim, 
+                       uint16_t       address, 
+                       uint16_t       len, 
+                       uint8_t        *data)
+{
+    bool ret;
+
+    pthread_mutex_lock(&sim->lock);
+    ret = adau1701_sim_access(sim, address, len, data, false);
+    pthread_mutex_unlock(&sim->lock);
+    return ret;
+}
+
+bool adau1701_sim_poke(adau1701_sim_t *sim, 
+                       uint16_t       address, 
+                       uint16_t       len, 
+                       const uint8_t  *data)
+{
+    bool ret;
+
+    pthread_mutex_lock(&sim->lock);
+    ret = adau1701_sim_access(sim, address, len, (uint8_t*)data, true);
+    pthread_mutex_unlock(&sim->lock);
+    return ret;
+}
+
+bool adau1701_sim_running(adau1701_sim_t *sim)
+{
+    bool running;
+
+    pthread_mutex_lock(&sim->lock);
+    running = !sim->in_reset &&
+              (adau1701_sim_location(sim, ADAU1701_SIM_CORE_CONTROL)[1] & 
+               ADAU1701_SIM_CORE_CR);
+    pthread_mutex_unlock(&sim->lock);
+    return running;
+}
+
+void adau1701_sim_get_stats(adau1701_sim_t *sim, adau1701_sim_stats_t *stats)
+{
+    pthread_mutex_lock(&sim->lock);
+    *stats = sim->stats;
+    pthread_mutex_unlock(&sim->lock);
+}
+
+void adau1701_sim_clear_stats(adau1701_sim_t *sim)
+{
+    pthread_mutex_lock(&sim->lock);
+    memset(&sim->stats, 0, sizeof(sim->stats));
+    pthread_mutex_unlock(&sim->lock);
+}
+
+/******************************* THE END *********************************/
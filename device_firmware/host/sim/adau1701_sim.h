@@ -0,0 +1,143 @@
+/*
+ * adau1701_sim.h
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Model of the ADAU1701 I2C slave for the host build. It keeps parameter
+ * RAM, program RAM and the control registers the way the chip does:
+ *
+ *  - A write starts with a 2 byte subaddress, the data that follows is 
+ *    stored in words of the memory it goes to (4 bytes parameter RAM, 
+ *    5 bytes program RAM, the size of the register for the control 
+ *    registers) and the address increments per word.
+ *  - Parameters are 28 bit, the upper nibble of the first byte is lost.
+ *  - A read returns words from the last subaddress on.
+ *  - The safeload registers are transferred to parameter RAM when the IST
+ *    bit of the core control register is set. Only the slots written since
+ *    the last transfer are transferred.
+ *  - The core runs while the CR bit of the core control register is set.
+ *  - Pulling the reset pin low NACKs the address, releasing it clears the
+ *    RAMs and registers.
+ *
+ * Protocol errors (words cut off by a stop, addresses past the registers,
+ * a subaddress that is too short) and program writes while the core runs
+ * are counted, the firmware should never cause them.
+ *
+ */
+#ifndef ADAU1701_SIM_H_
+#define ADAU1701_SIM_H_
+
+/******************************* INCLUDES ********************************/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "driver/gpio.h"
+#include "sim_i2c.h"
+
+/******************************* DEFINES *********************************/
+
+#define ADAU1701_SIM_PARAMETER_ADDR     0x0000
+#define ADAU1701_SIM_PARAMETER_REGSIZE  4
+#define ADAU1701_SIM_PROGRAM_ADDR       0x0400
+#define ADAU1701_SIM_PROGRAM_REGSIZE    5
+#define ADAU1701_SIM_REGISTER_ADDR      0x0800
+#define ADAU1701_SIM_REGISTER_END       0x0828
+#define ADAU1701_SIM_WORDS              0x0400  /* Per RAM              */
+#define ADAU1701_SIM_REGISTER_AMOUNT    (ADAU1701_SIM_REGISTER_END - \
+                                         ADAU1701_SIM_REGISTER_ADDR)
+#define ADAU1701_SIM_REGISTER_BYTES     111
+
+#define ADAU1701_SIM_PARAMETER_MASK     0x0F
+
+#define ADAU1701_SIM_SAFELOAD_DATA      0x0810
+#define ADAU1701_SIM_SAFELOAD_ADDRESS   0x0815
+#define ADAU1701_SIM_SAFELOAD_SLOTS     5
+#define ADAU1701_SIM_CORE_CONTROL       0x081C
+
+// Core control register bits, low byte.
+#define ADAU1701_SIM_CORE_IST           0x20   /* Start safeload         */
+#define ADAU1701_SIM_CORE_ADM           0x10   /* ADC mute off           */
+#define ADAU1701_SIM_CORE_DAM           0x08   /* DAC mute off           */
+#define ADAU1701_SIM_CORE_CR            0x04   /* Core runs              */
+
+/******************************* TYPEDEFS ********************************/
+
+typedef struct
+{
+    uint32_t writes;            /* Write transactions                  */
+    uint32_t reads;             /* Read transactions                   */
+    uint32_t words_written;
+    uint32_t words_read;
+    uint32_t safeloads;         /* IST transfers                       */
+    uint32_t safeload_words;
+    uint32_t resets;
+    uint32_t protocol_errors;
+    uint32_t running_program_writes;
+} adau1701_sim_stats_t;
+
+typedef struct
+{
+    pthread_mutex_t lock;
+
+    uint8_t    address;
+    gpio_num_t reset_pin;
+    bool       in_reset;
+
+    uint8_t    parameter[ADAU1701_SIM_WORDS * ADAU1701_SIM_PARAMETER_REGSIZE];
+    uint8_t    program[ADAU1701_SIM_WORDS * ADAU1701_SIM_PROGRAM_REGSIZE];
+    uint8_t    registers[ADAU1701_SIM_REGISTER_BYTES];
+    uint8_t    safeload_pending;  /* Bit per written slot             */
+
+    // Transaction in progress.
+    bool       reading;
+    uint8_t    subaddress_len;
+    uint16_t   pointer;
+    uint8_t    word[ADAU1701_SIM_PROGRAM_REGSIZE];
+    uint8_t    word_len;
+
+    adau1701_sim_stats_t stats;
+} adau1701_sim_t;
+
+/******************************* LOCAL FUNCTIONS *************************/
+
+uint8_t adau1701_sim_word_size(uint16_t address);
+
+uint8_t* adau1701_sim_location(adau1701_sim_t *sim, uint16_t address);
+
+void adau1701_sim_store(adau1701_sim_t *sim, uint16_t address, const uint8_t *word);
+
+void adau1701_sim_clear(adau1701_sim_t *sim);
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+// Resets the model and connects it to an address on a simulated bus and
+// to its reset pin, GPIO_NUM_NC for none.
+bool adau1701_sim_attach(adau1701_sim_t *sim,
+                         uint8_t        port,
+                         uint8_t        address,
+                         gpio_num_t     reset_pin);
+
+// Memory access without the bus, for checks and fault injection. len is
+// in bytes and has to be a whole number of words.
+bool adau1701_sim_peek(adau1701_sim_t *sim, 
+                       uint16_t       address, 
+                       uint16_t       len, 
+                       uint8_t        *data);
+
+bool adau1701_sim_poke(adau1701_sim_t *sim, 
+                       uint16_t       address, 
+                       uint16_t       len, 
+                       const uint8_t  *data);
+
+bool adau1701_sim_running(adau1701_sim_t *sim);
+
+void adau1701_sim_get_stats(adau1701_sim_t *sim, adau1701_sim_stats_t *stats);
+
+void adau1701_sim_clear_stats(adau1701_sim_t *sim);
+
+/******************************* THE END *********************************/
+
+#endif /* ADAU1701_SIM_H_ */
@@ -0,0 +1,415 @@
+/*
+ * biquad_sim.c
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Bit exact model of the ADAU1701 biquad cascade, see biquad_sim.h.
+ *
+ */
+/******************************* INCLUDES ********************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "biquad_sim.h"
+
+/******************************* DEFINES *********************************/
+
+#define BIQUAD_SIM_ACC_MAX  (((int64_t)1 << (BIQUAD_SIM_ACC_BITS - 1)) - 1)
+#define BIQUAD_SIM_ACC_MIN  (-((int64_t)1 << (BIQUAD_SIM_ACC_BITS - 1)))
+
+/******************************* LOCAL FUNCTIONS *************************/
+
+// A parameter word, the upper nibble is lost like in parameter RAM.
+int32_t biquad_sim_word(const uint8_t *data)
+{
+    uint32_t word = ((uint32_t)data[0] << 24) |
+                    ((uint32_t)data[1] << 16) |
+                    ((uint32_t)data[2] <<  8) |
+                     (uint32_t)data[3];
+
+    // Sign extends bit 27.
+    return (int32_t)(word << (32 - BIQUAD_SIM_WORD_BITS)) >>
+           (32 - BIQUAD_SIM_WORD_BITS);
+}
+
+// Accumulator to data memory: wraps at 56 bits, truncates to 5.23 and
+// saturates.
+int32_t biquad_sim_store(biquad_sim_t *sim, int64_t acc)
+{
+    if(acc > BIQUAD_SIM_ACC_MAX || acc < BIQUAD_SIM_ACC_MIN)
+    {
+        sim->overflows++;
+        acc = (int64_t)((uint64_t)acc << (64 - BIQUAD_SIM_ACC_BITS)) >>
+              (64 - BIQUAD_SIM_ACC_BITS);
+    }
+    acc >>= BIQUAD_SIM_FRACTION_BITS;
+
+    if(acc > BIQUAD_SIM_MAX)
+    {
+        sim->saturations++;
+        return BIQUAD_SIM_MAX;
+    }
+    if(acc < BIQUAD_SIM_MIN)
+    {
+        sim->saturations++;
+        return BIQUAD_SIM_MIN;
+    }
+    return (int32_t)acc;
+}
+
+void biquad_sim_reference_init(biquad_sim_reference_t *ref,
+                               const biquad_sim_t     *sim)
+{
+    memset(ref, 0, sizeof(biquad_sim_reference_t));
+    ref->amount = sim->amount;
+    for(int i = 0; i < sim->amount; i++)
+    {
+        for(int j = 0; j < 3; j++)
+        {
+            ref->b[i][j] = (double)sim->stages[i].b[j] / BIQUAD_SIM_ONE;
+        }
+        for(int j = 0; j < 2; j++)
+        {
+            ref->a[i][j] = (double)sim->stages[i].a[j] / BIQUAD_SIM_ONE;
+        }
+    }
+}
+
+// One sample through the double precision cascade. Stores the output of
+// every stage in outputs when it isn't NULL.
+double biquad_sim_reference_step(biquad_sim_reference_t *ref,
+                                 double                 x,
+                                 double                 *outputs)
+{
+    for(int i = 0; i < ref->amount; i++)
+    {
+        double y = ref->b[i][0] * x +
+                   ref->b[i][1] * ref->x[i][0] +
+                   ref->b[i][2] * ref->x[i][1] +
+                   ref->a[i][0] * ref->y[i][0] +
+                   ref->a[i][1] * ref->y[i][1];
+
+        ref->x[i][1] = ref->x[i][0];
+        ref->x[i][0] = x;
+        ref->y[i][1] = ref->y[i][0];
+        ref->y[i][0] = y;
+        if(outputs != NULL)
+        {
+            outputs[i] = y;
+        }
+        x = y;
+    }
+    return x;
+}
+
+// Magnitude of the DTFT of a signal at the given frequencies. A phasor
+// per frequency is rotated every sample instead of calling sin and cos,
+// all frequencies at once so the inner loop vectorizes.
+void biquad_sim_spectrum(const double *signal,
+                         uint32_t     len,
+                         const double *freq,
+                         double       *magnitude)
+{
+    double stepRe[BIQUAD_SIM_POINTS];
+    double stepIm[BIQUAD_SIM_POINTS];
+    double phaseRe[BIQUAD_SIM_POINTS];
+    double phaseIm[BIQUAD_SIM_POINTS];
+    double re[BIQUAD_SIM_POINTS] = {0};
+    double im[BIQUAD_SIM_POINTS] = {0};
+
+    for(int i = 0; i < BIQUAD_SIM_POINTS; i++)
+    {
+        double w = 2 * M_PI * freq[i] / BIQUAD_SIM_SAMPLE_FREQ;
+
+        stepRe[i]  = cos(w);
+        stepIm[i]  = -sin(w);
+        phaseRe[i] = 1;
+        phaseIm[i] = 0;
+    }
+    for(uint32_t n = 0; n < len; n++)
+    {
+        for(int i = 0; i < BIQUAD_SIM_POINTS; i++)
+        {
+            double next = phaseRe[i] * stepRe[i] - phaseIm[i] * stepIm[i];
+
+            re[i]     += signal[n] * phaseRe[i];
+            im[i]     += signal[n] * phaseIm[i];
+            phaseIm[i] = phaseRe[i] * stepIm[i] + phaseIm[i] * stepRe[i];
+            phaseRe[i] = next;
+        }
+    }
+    for(int i = 0; i < BIQUAD_SIM_POINTS; i++)
+    {
+        magnitude[i] = sqrt(re[i] * re[i] + im[i] * im[i]);
+    }
+}
+
+bool biquad_sim_state_equal(const biquad_sim_t *a, const biquad_sim_t *b)
+{
+    for(int i = 0; i < a->amount; i++)
+    {
+        if(memcmp(a->stages[i].x, b->stages[i].x, sizeof(a->stages[i].x)) != 0 ||
+           memcmp(a->stages[i].y, b->stages[i].y, sizeof(a->stages[i].y)) != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+bool biquad_sim_init(biquad_sim_t *sim, const uint8_t *data, uint8_t amount)
+{
+    if(amount == 0 || amount > BIQUAD_SIM_STAGE_MAX)
+    {
+        return false;
+    }
+    memset(sim, 0, sizeof(biquad_sim_t));
+    sim->amount = amount;
+    for(int i = 0; i < amount; i++)
+    {
+        const uint8_t *stage = &data[i * BIQUAD_SIM_STAGE_BYTES];
+
+        for(int j = 0; j < 3; j++)
+        {
+            sim->stages[i].b[j] = biquad_sim_word(&stage[j * BIQUAD_SIM_WORD_SIZE]);
+        }
+        for(int j = 0; j < 2; j++)
+        {
+            sim->stages[i].a[j] = biquad_sim_word(&stage[(3 + j) * BIQUAD_SIM_WORD_SIZE]);
+        }
+    }
+    return true;
+}
+
+void biquad_sim_reset(biquad_sim_t *sim)
+{
+    for(int i = 0; i < sim->amount; i++)
+    {
+        memset(sim->stages[i].x, 0, sizeof(sim->stages[i].x));
+        memset(sim->stages[i].y, 0, sizeof(sim->stages[i].y));
+    }
+}
+
+int32_t biquad_sim_step(biquad_sim_t *sim, int32_t x)
+{
+    for(int i = 0; i < sim->amount; i++)
+    {
+        biquad_sim_stage_t *stage = &sim->stages[i];
+        int64_t            acc;
+        int32_t            y;
+
+        acc = (int64_t)stage->b[0] * x +
+              (int64_t)stage->b[1] * stage->x[0] +
+              (int64_t)stage->b[2] * stage->x[1] +
+              (int64_t)stage->a[0] * stage->y[0] +
+              (int64_t)stage->a[1] * stage->y[1];
+        y   = biquad_sim_store(sim, acc);
+
+        stage->x[1] = stage->x[0];
+        stage->x[0] = x;
+        stage->y[1] = stage->y[0];
+        stage->y[0] = y;
+        x = y;
+    }
+    return x;
+}
+
+void biquad_sim_process(biquad_sim_t  *sim,
+                        const int32_t *in,
+                        int32_t       *out,
+                        uint32_t      len)
+{
+    for(uint32_t i = 0; i < len; i++)
+    {
+        out[i] = biquad_sim_step(sim, in[i]);
+    }
+}
+
+/* Function: biquad_sim_analyze
+ *
+ * Runs an impulse, a sine and silence through the cascade and through the
+ * double precision cascade with the same coefficients, see biquad_sim.h
+ * for what is measured. The sine and the silence run back to back, the
+ * silence starts from the state the sine left.
+ *
+ */
+bool biquad_sim_analyze(const uint8_t       *data,
+                        uint8_t             amount,
+                        uint32_t            length,
+                        biquad_sim_report_t *report)
+{
+    biquad_sim_t           sim;
+    biquad_sim_t           start;
+    biquad_sim_reference_t ref;
+    double                 outputs[BIQUAD_SIM_STAGE_MAX];
+    double                 sums[BIQUAD_SIM_STAGE_MAX] = {0};
+    double                 fixedMagnitude[BIQUAD_SIM_POINTS];
+    double                 refMagnitude[BIQUAD_SIM_POINTS];
+    double                 errorMagnitude[BIQUAD_SIM_POINTS];
+    double                 *fixedSignal;
+    double                 *refSignal;
+    int32_t                impulse = (int32_t)lround(BIQUAD_SIM_IMPULSE * BIQUAD_SIM_ONE);
+
+    if(length == 0)
+    {
+        length = BIQUAD_SIM_LENGTH;
+    }
+    if(!biquad_sim_init(&sim, data, amount))
+    {
+        return false;
+    }
+    fixedSignal = malloc(length * sizeof(double));
+    refSignal   = malloc(length * sizeof(double));
+    if(fixedSignal == NULL || refSignal == NULL)
+    {
+        free(fixedSignal);
+        free(refSignal);
+        return false;
+    }
+    memset(report, 0, sizeof(biquad_sim_report_t));
+    biquad_sim_reference_init(&ref, &sim);
+
+    // Impulse response, for the response and the headroom. Truncation
+    // leaves an offset in the tail of the response that doesn't change
+    // sign with the impulse, the difference of a positive and a negative
+    // impulse cancels it.
+    for(uint32_t n = 0; n < length; n++)
+    {
+        int32_t x = n == 0 ? impulse : 0;
+
+        fixedSignal[n] = (double)biquad_sim_step(&sim, x) / BIQUAD_SIM_ONE;
+        refSignal[n]   = biquad_sim_reference_step(&ref,
+                                                   (double)x / BIQUAD_SIM_ONE,
+                                                   outputs);
+        for(int i = 0; i < amount; i++)
+        {
+            sums[i] += fabs(outputs[i]);
+        }
+    }
+    biquad_sim_reset(&sim);
+    for(uint32_t n = 0; n < length; n++)
+    {
+        int32_t x = n == 0 ? -impulse : 0;
+
+        fixedSignal[n] -= (double)biquad_sim_step(&sim, x) / BIQUAD_SIM_ONE;
+        fixedSignal[n] /= 2;
+    }
+
+    for(int i = 0; i < BIQUAD_SIM_POINTS; i++)
+    {
+        report->freq[i] = BIQUAD_SIM_FREQ_MIN *
+                          pow((double)BIQUAD_SIM_FREQ_MAX / BIQUAD_SIM_FREQ_MIN,
+                              (double)i / (BIQUAD_SIM_POINTS - 1));
+    }
+    biquad_sim_spectrum(fixedSignal, length, report->freq, fixedMagnitude);
+    biquad_sim_spectrum(refSignal, length, report->freq, refMagnitude);
+
+    report->peak_db = -INFINITY;
+    for(int i = 0; i < BIQUAD_SIM_POINTS; i++)
+    {
+        report->response_db[i]  = 20 * log10(fixedMagnitude[i] / BIQUAD_SIM_IMPULSE);
+        report->reference_db[i] = 20 * log10(refMagnitude[i] / BIQUAD_SIM_IMPULSE);
+        report->peak_db         = fmax(report->peak_db, report->reference_db[i]);
+    }
+
+    double worst = 0;
+
+    for(int i = 0; i < amount; i++)
+    {
+        worst = fmax(worst, sums[i] / BIQUAD_SIM_IMPULSE);
+    }
+    report->headroom_db = 20 * log10(((double)BIQUAD_SIM_MAX + 1) / BIQUAD_SIM_ONE / worst);
+
+    // Sine, the difference to double precision is the offset and noise.
+    double amplitude = pow(10, BIQUAD_SIM_NOISE_DBFS / 20.0);
+    double sum       = 0;
+    double square    = 0;
+
+    biquad_sim_reset(&sim);
+    biquad_sim_reference_init(&ref, &sim);
+    for(uint32_t n = 0; n < length; n++)
+    {
+        double  sine = amplitude * sin(2 * M_PI * BIQUAD_SIM_NOISE_FREQ * n /
+                                       BIQUAD_SIM_SAMPLE_FREQ);
+        int32_t x    = (int32_t)lround(sine * BIQUAD_SIM_ONE);
+        double  error;
+
+        error   = (double)biquad_sim_step(&sim, x) / BIQUAD_SIM_ONE -
+                  biquad_sim_reference_step(&ref, (double)x / BIQUAD_SIM_ONE, NULL);
+        sum    += error;
+        square += error * error;
+
+        refSignal[n] = error;
+    }
+    sum    /= length;
+    square /= length;
+    report->offset_db = 20 * log10(fabs(sum) + 1e-15);
+    report->noise_db  = 10 * log10(fmax(square - sum * sum, 0) + 1e-30);
+
+    // The noise isn't white, the poles shape it. Its spectrum without the
+    // offset, relative to the impulse, is the floor of every point of the
+    // response. The deviation is only measured where the response is
+    // BIQUAD_SIM_SNR_DB above it, there the noise alone moves it less
+    // than 0.1 dB.
+    for(uint32_t n = 0; n < length; n++)
+    {
+        refSignal[n] -= sum;
+    }
+    biquad_sim_spectrum(refSignal, length, report->freq, errorMagnitude);
+    for(int i = 0; i < BIQUAD_SIM_POINTS; i++)
+    {
+        report->floor_db[i] = 20 * log10(errorMagnitude[i] / BIQUAD_SIM_IMPULSE + 1e-15);
+        if(report->reference_db[i] >= report->floor_db[i] + BIQUAD_SIM_SNR_DB)
+        {
+            report->deviation_db = fmax(report->deviation_db,
+                                        fabs(report->response_db[i] -
+                                             report->reference_db[i]));
+        }
+    }
+
+    // Silence, then a window where the double precision cascade is down
+    // to less than half an LSB.
+    for(uint32_t n = 0; n < length; n++)
+    {
+        biquad_sim_step(&sim, 0);
+        biquad_sim_reference_step(&ref, 0, NULL);
+    }
+
+    uint32_t fixedPeak = 0;
+    double   refPeak   = 0;
+
+    start = sim;
+    for(uint32_t n = 1; n <= BIQUAD_SIM_CYCLE_WINDOW; n++)
+    {
+        int32_t y = biquad_sim_step(&sim, 0);
+
+        fixedPeak = fmax(fixedPeak, abs(y));
+        refPeak   = fmax(refPeak, fabs(biquad_sim_reference_step(&ref, 0, NULL)));
+        if(report->limit_cycle_period == 0 && biquad_sim_state_equal(&sim, &start))
+        {
+            report->limit_cycle_period = n;
+        }
+    }
+    report->limit_cycle = fixedPeak > 0 && refPeak * BIQUAD_SIM_ONE < 0.5;
+    if(report->limit_cycle)
+    {
+        report->limit_cycle_lsb = fixedPeak;
+    }
+    else
+    {
+        report->limit_cycle_period = 0;
+    }
+
+    report->overflows   = sim.overflows;
+    report->saturations = sim.saturations;
+
+    free(fixedSignal);
+    free(refSignal);
+    return true;
+}
+
+/******************************* THE END *********************************/
@@ -0,0 +1,180 @@
+/*
+ * biquad_sim.h
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Bit exact model of the biquad cascade of an ADAU1701 channel, for
+ * checking coefficients without the hardware. It takes the parameter
+ * words the firmware writes, 5 per stage (b0, b1, b2, -a1, -a2), and
+ * runs the cascade the way the core does:
+ *
+ *  - Coefficients and samples are 28 bit 5.23 fixed point, the upper
+ *    nibble of a written word is lost.
+ *  - Every stage is direct form I. The 5 products (28 x 28 bit) are
+ *    summed in a 56 bit accumulator, a sum past 56 bits wraps and is
+ *    counted as an overflow.
+ *  - Storing the accumulator truncates it to 5.23 (arithmetic shift) and
+ *    saturates at the 5.23 range, which is counted.
+ *
+ * biquad_sim_analyze() measures a cascade against the same cascade in
+ * double precision:
+ *
+ *  response    Magnitude of the first length samples of the impulse
+ *              response at BIQUAD_SIM_POINTS log spaced frequencies, and
+ *              the largest deviation from double precision where the
+ *              response is BIQUAD_SIM_SNR_DB above the noise floor, the
+ *              spectrum of the noise below at the same points. The offset
+ *              is cancelled out.
+ *  offset      Mean of the difference to double precision for a sine
+ *              of BIQUAD_SIM_NOISE_DBFS, in dB relative to 1.0. Truncation
+ *              always rounds down, the recursion amplifies that into a DC
+ *              offset, most for low frequency poles.
+ *  noise       Rms of the rest of the difference.
+ *  limit cycle After the sine the input is silent. Output that doesn't
+ *              decay where the double precision cascade did is a limit
+ *              cycle, its amplitude in LSBs and its period are reported.
+ *  headroom    Margin of the 5.23 range over the worst case peak of any
+ *              stage for a full scale (1.0) input, from the sum of the
+ *              absolute impulse response.
+ *
+ * A channel of 5 stages analyzes in 2 to 7 ms at the default length,
+ * most of it in the three spectra. The full biquad_bench sweep of about
+ * 12000 cascades takes 20 to 80 s.
+ *
+ */
+#ifndef BIQUAD_SIM_H_
+#define BIQUAD_SIM_H_
+
+/******************************* INCLUDES ********************************/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/******************************* DEFINES *********************************/
+
+#define BIQUAD_SIM_STAGE_MAX      8
+#define BIQUAD_SIM_COEFFICIENTS   5
+#define BIQUAD_SIM_WORD_SIZE      4
+#define BIQUAD_SIM_STAGE_BYTES    (BIQUAD_SIM_COEFFICIENTS * BIQUAD_SIM_WORD_SIZE)
+
+// 5.23 fixed point in a 28 bit word.
+#define BIQUAD_SIM_FRACTION_BITS  23
+#define BIQUAD_SIM_WORD_BITS      28
+#define BIQUAD_SIM_ACC_BITS       56
+#define BIQUAD_SIM_ONE            ((int32_t)1 << BIQUAD_SIM_FRACTION_BITS)
+#define BIQUAD_SIM_MAX            (((int32_t)1 << (BIQUAD_SIM_WORD_BITS - 1)) - 1)
+#define BIQUAD_SIM_MIN            (-((int32_t)1 << (BIQUAD_SIM_WORD_BITS - 1)))
+
+#define BIQUAD_SIM_SAMPLE_FREQ    48000
+#define BIQUAD_SIM_POINTS         32
+#define BIQUAD_SIM_FREQ_MIN       20
+#define BIQUAD_SIM_FREQ_MAX       20000
+
+#define BIQUAD_SIM_LENGTH         4096     /* Default samples per run   */
+#define BIQUAD_SIM_IMPULSE        0.5      /* Amplitude of the impulse  */
+#define BIQUAD_SIM_NOISE_FREQ     997
+#define BIQUAD_SIM_NOISE_DBFS     -20
+#define BIQUAD_SIM_CYCLE_WINDOW   1024     /* Last silent samples       */
+// Response points closer to the noise floor are left out of the
+// deviation, 40 dB keeps the error of the noise below 0.1 dB.
+#define BIQUAD_SIM_SNR_DB         40
+
+/******************************* TYPEDEFS ********************************/
+
+typedef struct
+{
+    int32_t  b[3];          /* b0, b1, b2                              */
+    int32_t  a[2];          /* -a1, -a2, as written to the DSP         */
+    int32_t  x[2];
+    int32_t  y[2];
+} biquad_sim_stage_t;
+
+typedef struct
+{
+    uint8_t            amount;
+    biquad_sim_stage_t stages[BIQUAD_SIM_STAGE_MAX];
+
+    uint32_t           overflows;    /* Accumulator past 56 bits        */
+    uint32_t           saturations;  /* Stores clipped to 5.23          */
+} biquad_sim_t;
+
+// Same cascade in double precision with the same (quantized)
+// coefficients, the reference of the analysis.
+typedef struct
+{
+    uint8_t amount;
+    double  b[BIQUAD_SIM_STAGE_MAX][3];
+    double  a[BIQUAD_SIM_STAGE_MAX][2];
+    double  x[BIQUAD_SIM_STAGE_MAX][2];
+    double  y[BIQUAD_SIM_STAGE_MAX][2];
+} biquad_sim_reference_t;
+
+typedef struct
+{
+    double   freq[BIQUAD_SIM_POINTS];
+    double   response_db[BIQUAD_SIM_POINTS];
+    double   reference_db[BIQUAD_SIM_POINTS];  /* Double precision     */
+    double   peak_db;         /* Of the reference                     */
+    double   floor_db[BIQUAD_SIM_POINTS];      /* Noise, per point    */
+    double   deviation_db;    /* Largest, above the noise floor       */
+
+    double   offset_db;
+    double   noise_db;
+    bool     limit_cycle;
+    uint32_t limit_cycle_lsb;
+    uint32_t limit_cycle_period;   /* 0 when it didn't repeat in the
+                                      window                            */
+    double   headroom_db;
+
+    uint32_t overflows;
+    uint32_t saturations;
+} biquad_sim_report_t;
+
+/******************************* LOCAL FUNCTIONS *************************/
+
+int32_t biquad_sim_word(const uint8_t *data);
+
+int32_t biquad_sim_store(biquad_sim_t *sim, int64_t acc);
+
+void biquad_sim_reference_init(biquad_sim_reference_t *ref,
+                               const biquad_sim_t     *sim);
+
+double biquad_sim_reference_step(biquad_sim_reference_t *ref,
+                                 double                 x,
+                                 double                 *outputs);
+
+void biquad_sim_spectrum(const double *signal,
+                         uint32_t     len,
+                         const double *freq,
+                         double       *magnitude);
+
+bool biquad_sim_state_equal(const biquad_sim_t *a, const biquad_sim_t *b);
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+// Loads the parameter words of amount stages, BIQUAD_SIM_STAGE_BYTES
+// each, most significant byte first. Clears the state and the counters.
+bool biquad_sim_init(biquad_sim_t *sim, const uint8_t *data, uint8_t amount);
+
+void biquad_sim_reset(biquad_sim_t *sim);
+
+// One sample through the cascade, 5.23 in and out.
+int32_t biquad_sim_step(biquad_sim_t *sim, int32_t x);
+
+void biquad_sim_process(biquad_sim_t  *sim,
+                        const int32_t *in,
+                        int32_t       *out,
+                        uint32_t      len);
+
+// Runs the analysis described above, length samples per run (0 for
+// BIQUAD_SIM_LENGTH). Longer runs resolve narrow low bands better.
+bool biquad_sim_analyze(const uint8_t       *data,
+                        uint8_t             amount,
+                        uint32_t            length,
+                        biquad_sim_report_t *report);
+
+/******************************* THE END *********************************/
+
+#endif /* BIQUAD_SIM_H_ */
@@ -0,0 +1,330 @@
+/*
+ * eeprom24_sim.c
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Model of a 24LCxx I2C EEPROM, see eeprom24_sim.h.
+ *
+ */
+/******************************* INCLUDES ********************************/
+
+#include "eeprom24_sim.h"
+#include <stdlib.h>
+#include <string.h>
+#include "host_port.h"
+
+/******************************* LOCAL FUNCTIONS *************************/
+
+static bool eeprom24_sim_start(void *ctx, bool read);
+static bool eeprom24_sim_write(void *ctx, const uint8_t *data, size_t len);
+static void eeprom24_sim_read(void *ctx, uint8_t *data, size_t len);
+static void eeprom24_sim_stop(void *ctx);
+
+/******************************* GLOBAL VARIABLES ************************/
+
+static const sim_i2c_ops_t eeprom24SimOps = {
+    .start = eeprom24_sim_start,
+    .write = eeprom24_sim_write,
+    .read  = eeprom24_sim_read,
+    .stop  = eeprom24_sim_stop,
+};
+
+/******************************* LOCAL FUNCTIONS *************************/
+
+// xorshift32, only used to tear pages.
+uint32_t eeprom24_sim_random(eeprom24_sim_t *sim)
+{
+    uint32_t x = sim->random;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    sim->random = x;
+    return x;
+}
+
+// Programs the latched bytes. A cycle hit by the power loss leaves every
+// byte old, new or garbage.
+void eeprom24_sim_write_cycle(eeprom24_sim_t *sim)
+{
+    bool loss = (sim->loss_countdown == 0);
+
+    for(int i = 0; i < sim->page_size; i++)
+    {
+        uint32_t address = sim->page_base + i;
+        uint8_t  value   = sim->latch[i];
+
+        if(!sim->latched[i])
+        {
+            continue;
+        }
+        if(loss)
+        {
+            uint32_t r = eeprom24_sim_random(sim);
+
+            if(r % 3 == 0)
+            {
+                continue;
+            }
+            if(r % 3 == 1)
+            {
+                value = r >> 8;
+            }
+        }
+        sim->memory[address] = value;
+        sim->wear[address]++;
+        sim->stats.bytes_programmed++;
+    }
+    sim->stats.write_cycles++;
+
+    if(loss)
+    {
+        sim->powered        = false;
+        sim->loss_countdown = EEPROM24_SIM_NO_LOSS;
+        sim->stats.power_losses++;
+        return;
+    }
+    if(sim->loss_countdown != EEPROM24_SIM_NO_LOSS)
+    {
+        sim->loss_countdown--;
+    }
+    sim->busy_until = host_time_us() + sim->write_cycle_us;
+}
+
+static bool eeprom24_sim_start(void *ctx, bool read)
+{
+    eeprom24_sim_t *sim = (eeprom24_sim_t*)ctx;
+    bool           ack  = true;
+
+    pthread_mutex_lock(&sim->lock);
+    if(sim->powered && host_time_us() < sim->busy_until)
+    {
+        // The chip ignores its address during the write cycle.
+        sim->stats.busy_nacks++;
+        ack = false;
+    }
+    else if(read)
+    {
+        // A repeated start drops what was latched, nothing is written.
+        sim->reading      = true;
+        sim->latch_amount = 0;
+    }
+    else
+    {
+        sim->reading      = false;
+        sim->address_len  = 0;
+        sim->latch_amount = 0;
+    }
+    pthread_mutex_unlock(&sim->lock);
+    return ack;
+}
+
+static bool eeprom24_sim_write(void *ctx, const uint8_t *data, size_t len)
+{
+    eeprom24_sim_t *sim = (eeprom24_sim_t*)ctx;
+
+    pthread_mutex_lock(&sim->lock);
+    for(size_t i = 0; i < len && sim->powered; i++)
+    {
+        if(sim->address_len < 2)
+        {
+            sim->pointer = ((sim->pointer << 8) | data[i]) % sim->size;
+            if(++sim->address_len == 2)
+            {
+                sim->page_base   = sim->pointer - sim->pointer % sim->page_size;
+                sim->page_offset = sim->pointer % sim->page_size;
+                memset(sim->latched, 0, sizeof(sim->latched));
+            }
+            continue;
+        }
+
+        // Past the end of the page the latch wraps to its start.
+        sim->latch[sim->page_offset]   = data[i];
+        sim->latched[sim->page_offset] = true;
+        sim->page_offset = (sim->page_offset + 1) % sim->page_size;
+        sim->latch_amount++;
+    }
+    pthread_mutex_unlock(&sim->lock);
+    return true;
+}
+
+static void eeprom24_sim_read(void *ctx, uint8_t *data, size_t len)
+{
+    eeprom24_sim_t *sim = (eeprom24_sim_t*)ctx;
+
+    pthread_mutex_lock(&sim->lock);
+    for(size_t i = 0; i < len; i++)
+    {
+        if(!sim->powered)
+        {
+            data[i] = 0xFF;
+            continue;
+        }
+        data[i]      = sim->memory[sim->pointer];
+        sim->pointer = (sim->pointer + 1) % sim->size;
+        sim->stats.bytes_read++;
+    }
+    pthread_mutex_unlock(&sim->lock);
+}
+
+static void eeprom24_sim_stop(void *ctx)
+{
+    eeprom24_sim_t *sim = (eeprom24_sim_t*)ctx;
+
+    pthread_mutex_lock(&sim->lock);
+    if(sim->powered)
+    {
+        if(sim->reading)
+        {
+            sim->stats.reads++;
+        }
+        else if(sim->address_len == 1)
+        {
+            sim->stats.protocol_errors++;
+        }
+        else if(sim->latch_amount > 0)
+        {
+            eeprom24_sim_write_cycle(sim);
+            // The pointer stays behind the last latched byte.
+            sim->pointer = sim->page_base + sim->page_offset;
+        }
+    }
+    sim->latch_amount = 0;
+    pthread_mutex_unlock(&sim->lock);
+}
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+bool eeprom24_sim_attach(eeprom24_sim_t *sim,
+                         uint8_t        port,
+                         uint8_t        address,
+                         uint32_t       size,
+                         uint16_t       page_size,
+                         uint32_t       write_cycle_us)
+{
+    if(page_size == 0 || page_size > EEPROM24_SIM_PAGE_MAX || 
+       size == 0 || size % page_size != 0)
+    {
+        return false;
+    }
+
+    memset(sim, 0, sizeof(eeprom24_sim_t));
+    pthread_mutex_init(&sim->lock, NULL);
+    sim->size           = size;
+    sim->page_size      = page_size;
+    sim->write_cycle_us = write_cycle_us;
+    sim->powered        = true;
+    sim->loss_countdown = EEPROM24_SIM_NO_LOSS;
+    sim->random         = 1;
+    sim->memory         = malloc(size);
+    sim->wear           = calloc(size, sizeof(uint32_t));
+
+    if(sim->memory == NULL || sim->wear == NULL)
+    {
+        free(sim->memory);
+        free(sim->wear);
+        return false;
+    }
+    memset(sim->memory, 0xFF, size);
+    return sim_i2c_attach(port, address, &eeprom24SimOps, sim);
+}
+
+void eeprom24_sim_power_loss(eeprom24_sim_t *sim, uint32_t cycles, uint32_t seed)
+{
+    pthread_mutex_lock(&sim->lock);
+    sim->loss_countdown = cycles;
+    sim->random         = seed != 0 ? seed : 1;
+    pthread_mutex_unlock(&sim->lock);
+}
+
+void eeprom24_sim_power_on(eeprom24_sim_t *sim)
+{
+    pthread_mutex_lock(&sim->lock);
+    sim->powered    = true;
+    sim->busy_until = 0;
+    pthread_mutex_unlock(&sim->lock);
+}
+
+bool eeprom24_sim_powered(eeprom24_sim_t *sim)
+{
+    bool powered;
+
+    pthread_mutex_lock(&sim->lock);
+    powered = sim->powered;
+    pthread_mutex_unlock(&sim->lock);
+    return powered;
+}
+
+void eeprom24_sim_peek(eeprom24_sim_t *sim, uint32_t address, uint32_t len, uint8_t *data)
+{
+    pthread_mutex_lock(&sim->lock);
+    for(uint32_t i = 0; i < len; i++)
+    {
+        data[i] = sim->memory[(address + i) % sim->size];
+    }
+    pthread_mutex_unlock(&sim->lock);
+}
+
+void eeprom24_sim_poke(eeprom24_sim_t *sim, uint32_t address, uint32_t len, const uint8_t *data)
+{
+    pthread_mutex_lock(&sim->lock);
+    for(uint32_t i = 0; i < len; i++)
+    {
+        sim->memory[(address + i) % sim->size] = data[i];
+    }
+    pthread_mutex_unlock(&sim->lock);
+}
+
+uint32_t eeprom24_sim_wear(eeprom24_sim_t *sim, uint32_t address)
+{
+    uint32_t wear;
+
+    pthread_mutex_lock(&sim->lock);
+    wear = sim->wear[address % sim->size];
+    pthread_mutex_unlock(&sim->lock);
+    return wear;
+}
+
+uint32_t eeprom24_sim_max_wear(eeprom24_sim_t *sim, uint32_t *address)
+{
+    uint32_t max = 0;
+
+    pthread_mutex_lock(&sim->lock);
+    for(uint32_t i = 0; i < sim->size; i++)
+    {
+        if(sim->wear[i] > max)
+        {
+            max = sim->wear[i];
+            if(address != NULL)
+            {
+                *address = i;
+            }
+        }
+    }
+    pthread_mutex_unlock(&sim->lock);
+    return max;
+}
+
+void eeprom24_sim_clear_wear(eeprom24_sim_t *sim)
+{
+    pthread_mutex_lock(&sim->lock);
+    memset(sim->wear, 0, sim->size * sizeof(uint32_t));
+    pthread_mutex_unlock(&sim->lock);
+}
+
+void eeprom24_sim_get_stats(eeprom24_sim_t *sim, eeprom24_sim_stats_t *stats)
+{
+    pthread_mutex_lock(&sim->lock);
+    *stats = sim->stats;
+    pthread_mutex_unlock(&sim->lock);
+}
+
+void eeprom24_sim_clear_stats(eeprom24_sim_t *sim)
+{
+    pthread_mutex_lock(&sim->lock);
+    memset(&sim->stats, 0, sizeof(sim->stats));
+    pthread_mutex_unlock(&sim->lock);
+}
+
+/******************************* THE END *********************************/
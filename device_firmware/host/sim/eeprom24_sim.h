@@ -0,0 +1,128 @@
+/*
+ * eeprom24_sim.h
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Model of a 24LCxx I2C EEPROM with two address bytes (24LC32 up to 
+ * 24LC512) for the host build:
+ *
+ *  - Written bytes are latched in a page buffer. Past the end of the page
+ *    the address wraps to the start of the same page, like on the chip.
+ *  - The stop starts the write cycle. During the cycle the address is 
+ *    NACKed, so the firmware has to poll.
+ *  - Sequential reads run from the address pointer to the end of the 
+ *    memory and wrap to 0.
+ *  - Every byte has a wear counter, incremented by each write cycle that
+ *    programs it.
+ *
+ * Power loss is injected per write cycle. The cycle it hits programs only
+ * some bytes of the page, the others keep the old value or get garbage. 
+ * After that the EEPROM stores nothing anymore but still acknowledges, so
+ * the firmware runs to the end of what it was doing fast, as if the 
+ * store never finished. Power it on again before the simulated reboot.
+ *
+ */
+#ifndef EEPROM24_SIM_H_
+#define EEPROM24_SIM_H_
+
+/******************************* INCLUDES ********************************/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "sim_i2c.h"
+
+/******************************* DEFINES *********************************/
+
+#define EEPROM24_SIM_PAGE_MAX       128   /* 24LC512                   */
+#define EEPROM24_SIM_WRITE_CYCLE_US 5000  /* Datasheet maximum         */
+#define EEPROM24_SIM_NO_LOSS        UINT32_MAX
+
+/******************************* TYPEDEFS ********************************/
+
+typedef struct
+{
+    uint32_t write_cycles;      /* Page or byte writes               */
+    uint32_t bytes_programmed;
+    uint32_t busy_nacks;        /* Addressed during a write cycle    */
+    uint32_t reads;
+    uint32_t bytes_read;
+    uint32_t power_losses;
+    uint32_t protocol_errors;   /* Stop inside the address bytes     */
+} eeprom24_sim_stats_t;
+
+typedef struct
+{
+    pthread_mutex_t lock;
+
+    uint32_t size;
+    uint16_t page_size;
+    uint32_t write_cycle_us;
+
+    uint8_t  *memory;
+    uint32_t *wear;
+
+    // Transaction in progress.
+    bool     reading;
+    uint8_t  address_len;
+    uint32_t pointer;
+    uint32_t page_base;
+    uint16_t page_offset;
+    uint8_t  latch[EEPROM24_SIM_PAGE_MAX];
+    bool     latched[EEPROM24_SIM_PAGE_MAX];
+    uint16_t latch_amount;
+
+    int64_t  busy_until;
+    bool     powered;
+    uint32_t loss_countdown;    /* Write cycles until the loss       */
+    uint32_t random;
+
+    eeprom24_sim_stats_t stats;
+} eeprom24_sim_t;
+
+/******************************* LOCAL FUNCTIONS *************************/
+
+uint32_t eeprom24_sim_random(eeprom24_sim_t *sim);
+
+void eeprom24_sim_write_cycle(eeprom24_sim_t *sim);
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+// Creates an erased (0xFF) EEPROM and connects it to an address on a 
+// simulated bus.
+bool eeprom24_sim_attach(eeprom24_sim_t *sim,
+                         uint8_t        port,
+                         uint8_t        address,
+                         uint32_t       size,
+                         uint16_t       page_size,
+                         uint32_t       write_cycle_us);
+
+// Arms a power loss during the write cycle after skipping cycles more,
+// EEPROM24_SIM_NO_LOSS disarms. The seed makes the torn page repeatable.
+void eeprom24_sim_power_loss(eeprom24_sim_t *sim, uint32_t cycles, uint32_t seed);
+
+void eeprom24_sim_power_on(eeprom24_sim_t *sim);
+
+bool eeprom24_sim_powered(eeprom24_sim_t *sim);
+
+// Memory access without the bus and without wear.
+void eeprom24_sim_peek(eeprom24_sim_t *sim, uint32_t address, uint32_t len, uint8_t *data);
+
+void eeprom24_sim_poke(eeprom24_sim_t *sim, uint32_t address, uint32_t len, const uint8_t *data);
+
+uint32_t eeprom24_sim_wear(eeprom24_sim_t *sim, uint32_t address);
+
+// Highest wear of all bytes and the first byte that has it.
+uint32_t eeprom24_sim_max_wear(eeprom24_sim_t *sim, uint32_t *address);
+
+void eeprom24_sim_clear_wear(eeprom24_sim_t *sim);
+
+void eeprom24_sim_get_stats(eeprom24_sim_t *sim, eeprom24_sim_stats_t *stats);
+
+void eeprom24_sim_clear_stats(eeprom24_sim_t *sim);
+
+/******************************* THE END *********************************/
+
+#endif /* EEPROM24_SIM_H_ */
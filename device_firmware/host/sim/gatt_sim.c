@@ -0,0 +1,709 @@
+/*
+ * gatt_sim.c
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Stand-in for the NimBLE host and the BLE clients, see gatt_sim.h.
+ *
+ */
+/******************************* INCLUDES ********************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "gatt_sim.h"
+#include "esp_nimble_hci.h"
+#include "nimble/nimble_port.h"
+#include "nimble/nimble_port_freertos.h"
+#include "host/util/util.h"
+#include "services/gap/ble_svc_gap.h"
+#include "services/gatt/ble_svc_gatt.h"
+
+/******************************* GLOBAL VARIABLES ************************/
+
+struct ble_hs_cfg ble_hs_cfg;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+static const struct ble_gatt_svc_def *svcTables[GATT_SIM_SVC_TABLES];
+static uint8_t                       svcTableAmount = 0;
+
+static gatt_sim_conn_t conns[GATT_SIM_CONN_AMOUNT];
+static QueueHandle_t   requests = NULL;
+
+static bool             synced      = false;
+static bool             advertising = false;
+static ble_gap_event_fn *advCb      = NULL;
+static void             *advCbArg   = NULL;
+static uint8_t          advMfgData[GATT_SIM_ADV_DATA_MAX];
+static uint8_t          advMfgLen   = 0;
+static char             deviceName[GATT_SIM_NAME_LEN] = "nimble";
+
+static gatt_sim_stats_t stats;
+
+// Every client thread waits on its own semaphore.
+static __thread SemaphoreHandle_t done = NULL;
+
+/******************************* LOCAL FUNCTIONS *************************/
+
+// Characteristic with a 16 bit UUID. Handles are numbered like NimBLE 
+// does: the service, then per characteristic its declaration and value.
+const struct ble_gatt_chr_def* gatt_sim_find(uint16_t uuid, uint16_t *handle)
+{
+    uint16_t next = 1;
+
+    for(int t = 0; t < svcTableAmount; t++)
+    {
+        for(const struct ble_gatt_svc_def *svc = svcTables[t]; 
+            svc->type != BLE_GATT_SVC_TYPE_END; 
+            svc++)
+        {
+            next++;
+            for(const struct ble_gatt_chr_def *chr = svc->characteristics;
+                chr != NULL && chr->uuid != NULL;
+                chr++)
+            {
+                if(ble_uuid_u16(chr->uuid) == uuid)
+                {
+                    *handle = next + 1;
+                    return chr;
+                }
+                next += 2;
+            }
+        }
+    }
+    return NULL;
+}
+
+// Call with lock held.
+gatt_sim_conn_t* gatt_sim_conn(uint16_t conn_handle)
+{
+    for(int i = 0; i < GATT_SIM_CONN_AMOUNT; i++)
+    {
+        if(conns[i].in_use && conns[i].handle == conn_handle)
+        {
+            return &conns[i];
+        }
+    }
+    return NULL;
+}
+
+// Queues an event for the host task, nobody waits for it.
+bool gatt_sim_post(gatt_sim_request_t *request)
+{
+    gatt_sim_request_t *copy = malloc(sizeof(gatt_sim_request_t));
+
+    if(copy == NULL)
+    {
+        return false;
+    }
+    *copy      = *request;
+    copy->done = NULL;
+    if(xQueueSend(requests, &copy, 0) != pdPASS)
+    {
+        free(copy);
+        return false;
+    }
+    return true;
+}
+
+// Queues a request for the host task and waits for its result.
+int gatt_sim_call(gatt_sim_request_t *request)
+{
+    if(requests == NULL)
+    {
+        return GATT_SIM_ERR_NOT_CONNECTED;
+    }
+    if(done == NULL)
+    {
+        done = xSemaphoreCreateBinary();
+    }
+    request->done = done;
+    if(xQueueSend(requests, &request, portMAX_DELAY) != pdPASS)
+    {
+        return GATT_SIM_ERR_TIMEOUT;
+    }
+    xSemaphoreTake(done, portMAX_DELAY);
+    return request->result;
+}
+
+static int gatt_sim_event(gatt_sim_conn_t *conn, struct ble_gap_event *event)
+{
+    ble_gap_event_fn *cb;
+    void             *arg;
+
+    pthread_mutex_lock(&lock);
+    cb  = conn->cb;
+    arg = conn->cb_arg;
+    pthread_mutex_unlock(&lock);
+
+    return cb != NULL ? cb(event, arg) : 0;
+}
+
+static void gatt_sim_connect_event(gatt_sim_request_t *request)
+{
+    gatt_sim_conn_t      *conn = NULL;
+    struct ble_gap_event event;
+
+    pthread_mutex_lock(&lock);
+    if(advertising && gatt_sim_conn(request->conn_handle) == NULL)
+    {
+        for(int i = 0; i < GATT_SIM_CONN_AMOUNT && conn == NULL; i++)
+        {
+            if(!conns[i].in_use)
+            {
+                conn = &conns[i];
+            }
+        }
+    }
+    if(conn == NULL)
+    {
+        pthread_mutex_unlock(&lock);
+        request->result = false;
+        return;
+    }
+
+    memset(conn, 0, sizeof(gatt_sim_conn_t));
+    conn->in_use           = true;
+    conn->handle           = request->conn_handle;
+    conn->cb               = advCb;
+    conn->cb_arg           = advCbArg;
+    conn->desc.conn_handle = request->conn_handle;
+    conn->desc.peer_id_addr.type   = BLE_ADDR_PUBLIC;
+    conn->desc.peer_id_addr.val[0] = request->conn_handle & 0xFF;
+    conn->desc.peer_id_addr.val[1] = request->conn_handle >> 8;
+    conn->desc.peer_id_addr.val[2] = 0x5E;
+    conn->desc.peer_id_addr.val[3] = 0xA5;
+    conn->desc.peer_id_addr.val[4] = 0xDE;
+    conn->desc.peer_id_addr.val[5] = 0xC0;
+    conn->desc.peer_ota_addr = conn->desc.peer_id_addr;
+    // A connection ends the advertising that accepted it.
+    advertising = false;
+    stats.connects++;
+    pthread_mutex_unlock(&lock);
+
+    memset(&event, 0, sizeof(event));
+    event.type                = BLE_GAP_EVENT_CONNECT;
+    event.connect.status      = 0;
+    event.connect.conn_handle = request->conn_handle;
+    gatt_sim_event(conn, &event);
+
+    pthread_mutex_lock(&lock);
+    request->result = !conn->terminating;
+    if(conn->terminating)
+    {
+        stats.rejects++;
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+static void gatt_sim_disconnect_event(gatt_sim_request_t *request)
+{
+    gatt_sim_conn_t      *conn;
+    gatt_sim_conn_t      closed;
+    struct ble_gap_event event;
+
+    pthread_mutex_lock(&lock);
+    conn = gatt_sim_conn(request->conn_handle);
+    if(conn == NULL)
+    {
+        pthread_mutex_unlock(&lock);
+        request->result = false;
+        return;
+    }
+    closed       = *conn;
+    conn->in_use = false;
+    stats.disconnects++;
+    pthread_mutex_unlock(&lock);
+
+    memset(&event, 0, sizeof(event));
+    event.type              = BLE_GAP_EVENT_DISCONNECT;
+    event.disconnect.reason = BLE_HS_HCI_ERR(request->reason);
+    event.disconnect.conn   = closed.desc;
+    gatt_sim_event(&closed, &event);
+    request->result = true;
+}
+
+static void gatt_sim_enc_change_event(gatt_sim_request_t *request)
+{
+    gatt_sim_conn_t      *conn;
+    struct ble_gap_event event;
+
+    pthread_mutex_lock(&lock);
+    conn = gatt_sim_conn(request->conn_handle);
+    if(conn != NULL)
+    {
+        conn->desc.sec_state.encrypted = 1;
+        conn->desc.sec_state.bonded    = 1;
+        conn->desc.sec_state.key_size  = 16;
+    }
+    pthread_mutex_unlock(&lock);
+
+    if(conn != NULL)
+    {
+        memset(&event, 0, sizeof(event));
+        event.type                   = BLE_GAP_EVENT_ENC_CHANGE;
+        event.enc_change.status      = 0;
+        event.enc_change.conn_handle = request->conn_handle;
+        gatt_sim_event(conn, &event);
+    }
+}
+
+static void gatt_sim_access(gatt_sim_request_t *request)
+{
+    static uint8_t              value[BLE_ATT_ATTR_MAX_LEN];
+    const struct ble_gatt_chr_def *chr;
+    struct ble_gatt_access_ctxt ctxt;
+    struct os_mbuf              om;
+    uint16_t                    handle = 0;
+    bool                        read   = request->op == GATT_SIM_OP_READ;
+    bool                        connected;
+
+    pthread_mutex_lock(&lock);
+    connected = gatt_sim_conn(request->conn_handle) != NULL;
+    chr       = gatt_sim_find(request->uuid, &handle);
+    pthread_mutex_unlock(&lock);
+
+    if(!connected)
+    {
+        request->result = GATT_SIM_ERR_NOT_CONNECTED;
+        return;
+    }
+    if(chr == NULL)
+    {
+        request->result = BLE_ATT_ERR_INVALID_HANDLE;
+        return;
+    }
+    if(read && !(chr->flags & BLE_GATT_CHR_F_READ))
+    {
+        request->result = BLE_ATT_ERR_READ_NOT_PERMITTED;
+        return;
+    }
+    if(!read && !(chr->flags & (BLE_GATT_CHR_F_WRITE | BLE_GATT_CHR_F_WRITE_NO_RSP)))
+    {
+        request->result = BLE_ATT_ERR_WRITE_NOT_PERMITTED;
+        return;
+    }
+    if(!read && request->len > BLE_ATT_ATTR_MAX_LEN)
+    {
+        request->result = BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+        return;
+    }
+
+    om.om_data = value;
+    om.om_size = sizeof(value);
+    om.om_len  = 0;
+    if(!read)
+    {
+        memcpy(value, request->data, request->len);
+        om.om_len = request->len;
+    }
+    ctxt.op  = read ? BLE_GATT_ACCESS_OP_READ_CHR : BLE_GATT_ACCESS_OP_WRITE_CHR;
+    ctxt.om  = &om;
+    ctxt.chr = chr;
+
+    request->result = chr->access_cb(request->conn_handle, handle, &ctxt, chr->arg);
+
+    pthread_mutex_lock(&lock);
+    if(request->result != 0)
+    {
+        stats.att_errors++;
+    }
+    if(read)
+    {
+        // A long read continues with blobs of MTU - 1 bytes.
+        stats.reads++;
+        stats.read_bytes += om.om_len;
+        stats.att_pdus   += 1 + (om.om_len >= GATT_SIM_MTU - 1 ? 
+                                 om.om_len / (GATT_SIM_MTU - 1) : 0);
+        if(request->result == 0)
+        {
+            request->len = om.om_len < request->len ? om.om_len : request->len;
+            memcpy(request->data, value, request->len);
+        }
+    }
+    else
+    {
+        // A long write is prepared in parts of MTU - 5 bytes and executed.
+        stats.writes++;
+        stats.write_bytes += request->len;
+        stats.att_pdus    += request->len <= GATT_SIM_MTU - 3 ? 1 :
+                             (request->len + GATT_SIM_MTU - 6) / (GATT_SIM_MTU - 5) + 1;
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+void gatt_sim_execute(gatt_sim_request_t *request)
+{
+    switch(request->op)
+    {
+        case GATT_SIM_OP_CONNECT:
+            gatt_sim_connect_event(request);
+            break;
+        case GATT_SIM_OP_DISCONNECT:
+            gatt_sim_disconnect_event(request);
+            break;
+        case GATT_SIM_OP_ENC_CHANGE:
+            gatt_sim_enc_change_event(request);
+            break;
+        case GATT_SIM_OP_READ:
+        case GATT_SIM_OP_WRITE:
+            gatt_sim_access(request);
+            break;
+    }
+}
+
+/******************************* NIMBLE HOST *****************************/
+
+esp_err_t esp_nimble_hci_init(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t nimble_port_init(void)
+{
+    if(requests == NULL)
+    {
+        requests = xQueueCreate(GATT_SIM_REQUEST_AMOUNT, 
+                                sizeof(gatt_sim_request_t*));
+    }
+    return requests != NULL ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+void nimble_port_freertos_init(TaskFunction_t host_task_fn)
+{
+    xTaskCreate(host_task_fn, "nimble_host", 4096, NULL, 5, NULL);
+}
+
+// The host task, serves the requests of the clients.
+void nimble_port_run(void)
+{
+    gatt_sim_request_t *request;
+
+    if(ble_hs_cfg.sync_cb != NULL)
+    {
+        ble_hs_cfg.sync_cb();
+    }
+    pthread_mutex_lock(&lock);
+    synced = true;
+    pthread_mutex_unlock(&lock);
+
+    for(;;)
+    {
+        if(xQueueReceive(requests, &request, portMAX_DELAY) == pdPASS)
+        {
+            gatt_sim_execute(request);
+            if(request->done != NULL)
+            {
+                xSemaphoreGive(request->done);
+            }
+            else
+            {
+                free(request);
+            }
+        }
+    }
+}
+
+uint16_t ble_uuid_u16(const ble_uuid_t *uuid)
+{
+    return uuid->type == BLE_UUID_TYPE_16 ? ((const ble_uuid16_t*)uuid)->value : 0;
+}
+
+int os_mbuf_append(struct os_mbuf *om, const void *data, uint16_t len)
+{
+    if(om->om_len + len > om->om_size)
+    {
+        return BLE_HS_ENOMEM;
+    }
+    memcpy(om->om_data + om->om_len, data, len);
+    om->om_len += len;
+    return 0;
+}
+
+int ble_gatts_count_cfg(const struct ble_gatt_svc_def *defs)
+{
+    return defs != NULL ? 0 : BLE_HS_EINVAL;
+}
+
+int ble_gatts_add_svcs(const struct ble_gatt_svc_def *svcs)
+{
+    int ret = BLE_HS_ENOMEM;
+
+    pthread_mutex_lock(&lock);
+    if(svcTableAmount < GATT_SIM_SVC_TABLES)
+    {
+        svcTables[svcTableAmount++] = svcs;
+        ret = 0;
+    }
+    pthread_mutex_unlock(&lock);
+    return ret;
+}
+
+int ble_gap_adv_set_fields(const struct ble_hs_adv_fields *adv_fields)
+{
+    pthread_mutex_lock(&lock);
+    advMfgLen = adv_fields->mfg_data_len < GATT_SIM_ADV_DATA_MAX ?
+                adv_fields->mfg_data_len : GATT_SIM_ADV_DATA_MAX;
+    if(adv_fields->mfg_data != NULL)
+    {
+        memcpy(advMfgData, adv_fields->mfg_data, advMfgLen);
+    }
+    stats.adv_updates++;
+    pthread_mutex_unlock(&lock);
+    return 0;
+}
+
+int ble_gap_adv_start(uint8_t                         own_addr_type, 
+                      const ble_addr_t                *direct_addr,
+                      int32_t                         duration_ms, 
+                      const struct ble_gap_adv_params *adv_params,
+                      ble_gap_event_fn                *cb, 
+                      void                            *cb_arg)
+{
+    int ret = 0;
+
+    pthread_mutex_lock(&lock);
+    if(advertising)
+    {
+        ret = BLE_HS_EALREADY;
+    }
+    else
+    {
+        advertising = true;
+        advCb       = cb;
+        advCbArg    = cb_arg;
+        stats.adv_starts++;
+    }
+    pthread_mutex_unlock(&lock);
+    return ret;
+}
+
+int ble_gap_adv_stop(void)
+{
+    int ret;
+
+    pthread_mutex_lock(&lock);
+    ret         = advertising ? 0 : BLE_HS_EALREADY;
+    advertising = false;
+    pthread_mutex_unlock(&lock);
+    return ret;
+}
+
+int ble_gap_adv_active(void)
+{
+    return gatt_sim_advertising();
+}
+
+// The disconnect event follows once the current event is handled.
+int ble_gap_terminate(uint16_t conn_handle, uint8_t hci_reason)
+{
+    gatt_sim_conn_t    *conn;
+    gatt_sim_request_t request = {
+        .op          = GATT_SIM_OP_DISCONNECT,
+        .conn_handle = conn_handle,
+        .reason      = hci_reason,
+    };
+
+    pthread_mutex_lock(&lock);
+    conn = gatt_sim_conn(conn_handle);
+    if(conn == NULL || conn->terminating)
+    {
+        pthread_mutex_unlock(&lock);
+        return BLE_HS_ENOTCONN;
+    }
+    conn->terminating = true;
+    pthread_mutex_unlock(&lock);
+
+    return gatt_sim_post(&request) ? 0 : BLE_HS_ENOMEM;
+}
+
+int ble_gap_security_initiate(uint16_t conn_handle)
+{
+    bool               connected;
+    gatt_sim_request_t request = {
+        .op          = GATT_SIM_OP_ENC_CHANGE,
+        .conn_handle = conn_handle,
+    };
+
+    pthread_mutex_lock(&lock);
+    connected = gatt_sim_conn(conn_handle) != NULL;
+    pthread_mutex_unlock(&lock);
+
+    if(!connected)
+    {
+        return BLE_HS_ENOTCONN;
+    }
+    return gatt_sim_post(&request) ? 0 : BLE_HS_ENOMEM;
+}
+
+int ble_gap_conn_find(uint16_t conn_handle, struct ble_gap_conn_desc *out_desc)
+{
+    gatt_sim_conn_t *conn;
+
+    pthread_mutex_lock(&lock);
+    conn = gatt_sim_conn(conn_handle);
+    if(conn != NULL && out_desc != NULL)
+    {
+        *out_desc = conn->desc;
+    }
+    pthread_mutex_unlock(&lock);
+    return conn != NULL ? 0 : BLE_HS_ENOTCONN;
+}
+
+int ble_store_util_status_rr(struct ble_store_status_event *event, void *arg)
+{
+    return 0;
+}
+
+int ble_store_util_delete_peer(const ble_addr_t *peer_id_addr)
+{
+    return 0;
+}
+
+void ble_store_config_init(void)
+{
+}
+
+int ble_hs_id_infer_auto(int privacy, uint8_t *out_addr_type)
+{
+    *out_addr_type = BLE_ADDR_PUBLIC;
+    return 0;
+}
+
+void ble_svc_gap_init(void)
+{
+}
+
+const char* ble_svc_gap_device_name(void)
+{
+    return deviceName;
+}
+
+int ble_svc_gap_device_name_set(const char *name)
+{
+    pthread_mutex_lock(&lock);
+    snprintf(deviceName, sizeof(deviceName), "%s", name);
+    pthread_mutex_unlock(&lock);
+    return 0;
+}
+
+void ble_svc_gatt_init(void)
+{
+}
+
+void ble_svc_gatt_changed(uint16_t start_handle, uint16_t end_handle)
+{
+    pthread_mutex_lock(&lock);
+    stats.service_changed++;
+    pthread_mutex_unlock(&lock);
+}
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+bool gatt_sim_wait_sync(uint32_t timeout_ms)
+{
+    TickType_t start = xTaskGetTickCount();
+
+    while(!synced || !gatt_sim_advertising())
+    {
+        if(xTaskGetTickCount() - start > pdMS_TO_TICKS(timeout_ms))
+        {
+            return false;
+        }
+        vTaskDelay(1);
+    }
+    return true;
+}
+
+bool gatt_sim_connect(uint16_t conn_handle)
+{
+    gatt_sim_request_t request = {
+        .op          = GATT_SIM_OP_CONNECT,
+        .conn_handle = conn_handle,
+    };
+
+    return gatt_sim_call(&request) == true;
+}
+
+bool gatt_sim_disconnect(uint16_t conn_handle, uint8_t hci_reason)
+{
+    gatt_sim_request_t request = {
+        .op          = GATT_SIM_OP_DISCONNECT,
+        .conn_handle = conn_handle,
+        .reason      = hci_reason,
+    };
+
+    return gatt_sim_call(&request) == true;
+}
+
+int gatt_sim_write(uint16_t   conn_handle, 
+                   uint16_t   uuid, 
+                   const void *data, 
+                   uint16_t   len)
+{
+    gatt_sim_request_t request = {
+        .op          = GATT_SIM_OP_WRITE,
+        .conn_handle = conn_handle,
+        .uuid        = uuid,
+        .data        = (uint8_t*)data,
+        .len         = len,
+    };
+
+    return gatt_sim_call(&request);
+}
+
+int gatt_sim_read(uint16_t conn_handle, 
+                  uint16_t uuid, 
+                  void     *data, 
+                  uint16_t *len)
+{
+    int                ret;
+    gatt_sim_request_t request = {
+        .op          = GATT_SIM_OP_READ,
+        .conn_handle = conn_handle,
+        .uuid        = uuid,
+        .data        = data,
+        .len         = *len,
+    };
+
+    ret  = gatt_sim_call(&request);
+    *len = ret == 0 ? request.len : 0;
+    return ret;
+}
+
+uint8_t gatt_sim_adv_mfg_data(uint8_t *data, uint8_t len)
+{
+    pthread_mutex_lock(&lock);
+    len = advMfgLen < len ? advMfgLen : len;
+    memcpy(data, advMfgData, len);
+    pthread_mutex_unlock(&lock);
+    return len;
+}
+
+bool gatt_sim_advertising(void)
+{
+    bool active;
+
+    pthread_mutex_lock(&lock);
+    active = advertising;
+    pthread_mutex_unlock(&lock);
+    return active;
+}
+
+void gatt_sim_get_stats(gatt_sim_stats_t *out)
+{
+    pthread_mutex_lock(&lock);
+    *out = stats;
+    pthread_mutex_unlock(&lock);
+}
+
+void gatt_sim_clear_stats(void)
+{
+    pthread_mutex_lock(&lock);
+    memset(&stats, 0, sizeof(stats));
+    pthread_mutex_unlock(&lock);
+}
+
+/******************************* THE END *********************************/
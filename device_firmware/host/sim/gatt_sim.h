@@ -0,0 +1,140 @@
+/*
+ * gatt_sim.h
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Stand-in for the NimBLE host and the BLE clients on the host build. It
+ * implements the host API of port/host/ble_hs.h and lets a bench play 
+ * clients: connect, read and write characteristics, disconnect.
+ *
+ * Like in NimBLE, every GAP event and every characteristic access runs on
+ * the host task, one at a time. A client call queues its request for the
+ * host task and waits until the firmware callback returned, so the time 
+ * a call takes is what a client would see minus the radio.
+ *
+ * Not modeled: the radio and its timing, pairing (security completes 
+ * right away and bonds) and advertising timeouts.
+ *
+ */
+#ifndef GATT_SIM_H_
+#define GATT_SIM_H_
+
+/******************************* INCLUDES ********************************/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "host/ble_hs.h"
+
+/******************************* DEFINES *********************************/
+
+#define GATT_SIM_CONN_AMOUNT      8
+#define GATT_SIM_SVC_TABLES       4
+#define GATT_SIM_REQUEST_AMOUNT   16
+#define GATT_SIM_MTU              247
+#define GATT_SIM_NAME_LEN         32
+#define GATT_SIM_ADV_DATA_MAX     31
+
+// Results of gatt_sim_read() and gatt_sim_write() besides 0 and the ATT 
+// errors the firmware returns.
+#define GATT_SIM_ERR_NOT_CONNECTED 0x100
+#define GATT_SIM_ERR_TIMEOUT       0x101
+
+#define GATT_SIM_OP_CONNECT       0
+#define GATT_SIM_OP_DISCONNECT    1
+#define GATT_SIM_OP_ENC_CHANGE    2
+#define GATT_SIM_OP_READ          3
+#define GATT_SIM_OP_WRITE         4
+
+/******************************* TYPEDEFS ********************************/
+
+typedef struct
+{
+    uint32_t connects;
+    uint32_t rejects;           /* Terminated during the connect     */
+    uint32_t disconnects;
+    uint32_t reads;
+    uint32_t writes;
+    uint32_t read_bytes;
+    uint32_t write_bytes;
+    uint32_t att_errors;        /* Access callbacks that failed      */
+    uint32_t att_pdus;          /* Requests over the air at the MTU  */
+    uint32_t adv_starts;
+    uint32_t adv_updates;       /* Advertising data changes          */
+    uint32_t service_changed;
+} gatt_sim_stats_t;
+
+typedef struct
+{
+    bool                     in_use;
+    bool                     terminating;
+    uint16_t                 handle;
+    struct ble_gap_conn_desc desc;
+    ble_gap_event_fn         *cb;
+    void                     *cb_arg;
+} gatt_sim_conn_t;
+
+typedef struct
+{
+    uint8_t           op;
+    uint16_t          conn_handle;
+    uint16_t          uuid;
+    uint8_t           reason;
+    uint8_t           *data;
+    uint16_t          len;
+    int               result;
+    // Given when done, NULL for events nobody waits for.
+    SemaphoreHandle_t done;
+} gatt_sim_request_t;
+
+/******************************* LOCAL FUNCTIONS *************************/
+
+const struct ble_gatt_chr_def* gatt_sim_find(uint16_t uuid, uint16_t *handle);
+
+gatt_sim_conn_t* gatt_sim_conn(uint16_t conn_handle);
+
+bool gatt_sim_post(gatt_sim_request_t *request);
+
+int gatt_sim_call(gatt_sim_request_t *request);
+
+void gatt_sim_execute(gatt_sim_request_t *request);
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+// Waits until the firmware synced with the host and advertises.
+bool gatt_sim_wait_sync(uint32_t timeout_ms);
+
+// Connects a client, true when the firmware kept the connection.
+bool gatt_sim_connect(uint16_t conn_handle);
+
+bool gatt_sim_disconnect(uint16_t conn_handle, uint8_t hci_reason);
+
+// Returns 0, an ATT error or a GATT_SIM_ERR.
+int gatt_sim_write(uint16_t   conn_handle, 
+                   uint16_t   uuid, 
+                   const void *data, 
+                   uint16_t   len);
+
+// Reads the whole value, a long read when it exceeds the MTU. len is the
+// size of data and returns the length of the value.
+int gatt_sim_read(uint16_t conn_handle, 
+                  uint16_t uuid, 
+                  void     *data, 
+                  uint16_t *len);
+
+// Manufacturer data of the last advertising data, returns its length.
+uint8_t gatt_sim_adv_mfg_data(uint8_t *data, uint8_t len);
+
+bool gatt_sim_advertising(void);
+
+void gatt_sim_get_stats(gatt_sim_stats_t *stats);
+
+void gatt_sim_clear_stats(void);
+
+/******************************* THE END *********************************/
+
+#endif /* GATT_SIM_H_ */
@@ -0,0 +1,606 @@
+/*
+ * sim_i2c.c
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Simulated I2C buses, see sim_i2c.h. Implements the functions of the
+ * i2c_master and the legacy driver the firmware uses on top of the device
+ * models.
+ *
+ */
+/******************************* INCLUDES ********************************/
+
+#include "sim_i2c.h"
+#include "host_port.h"
+
+/******************************* GLOBAL VARIABLES ************************/
+
+static sim_i2c_port_t ports[SIM_I2C_PORT_AMOUNT] = {
+    { .lock = PTHREAD_MUTEX_INITIALIZER },
+    { .lock = PTHREAD_MUTEX_INITIALIZER },
+};
+
+static struct i2c_master_bus_t buses[SIM_I2C_PORT_AMOUNT];
+static sim_i2c_legacy_t        legacy[SIM_I2C_PORT_AMOUNT];
+
+/******************************* LOCAL FUNCTIONS *************************/
+
+// Only called with the lock of the port taken.
+sim_i2c_device_t* sim_i2c_device(uint8_t port, uint8_t address)
+{
+    for(int i = 0; i < SIM_I2C_DEVICE_AMOUNT; i++)
+    {
+        if(ports[port].devices[i].used && 
+           ports[port].devices[i].address == address)
+        {
+            return &ports[port].devices[i];
+        }
+    }
+    return NULL;
+}
+
+/* Function: sim_i2c_transfer
+ *
+ * One transaction from start to stop. Writes first when there is 
+ * something to write, a read after a write gets a repeated start. An 
+ * address only transaction is a probe. Without a device on the address 
+ * nobody acknowledges it.
+ *
+ */
+static esp_err_t sim_i2c_transfer(struct i2c_master_dev_t *dev,
+                                  const uint8_t           *write,
+                                  size_t                  write_len,
+                                  uint8_t                 *read,
+                                  size_t                  read_len)
+{
+    sim_i2c_port_t   *port    = &ports[dev->bus->port];
+    uint64_t         bits     = SIM_I2C_START_BITS;
+    bool             ack      = true;
+    bool             started  = false;
+    bool             probe    = (write_len == 0 && read_len == 0);
+
+    pthread_mutex_lock(&port->lock);
+
+    sim_i2c_device_t *device = sim_i2c_device(dev->bus->port, dev->address);
+
+    if(write_len > 0 || probe)
+    {
+        bits += SIM_I2C_BYTE_BITS;
+        ack   = device != NULL && device->ops->start(device->ctx, false);
+        started = ack;
+        if(ack && write_len > 0)
+        {
+            bits += (uint64_t)SIM_I2C_BYTE_BITS * write_len;
+            port->stats.bytes += write_len;
+            ack = device->ops->write(device->ctx, write, write_len);
+        }
+    }
+    if(ack && read_len > 0)
+    {
+        if(started)
+        {
+            bits += SIM_I2C_START_BITS;
+        }
+        bits += SIM_I2C_BYTE_BITS;
+        ack   = device != NULL && device->ops->start(device->ctx, true);
+        started |= ack;
+        if(ack)
+        {
+            bits += (uint64_t)SIM_I2C_BYTE_BITS * read_len;
+            port->stats.bytes += read_len;
+            device->ops->read(device->ctx, read, read_len);
+        }
+    }
+    bits += SIM_I2C_STOP_BITS;
+    if(started)
+    {
+        device->ops->stop(device->ctx);
+    }
+
+    uint32_t clock_hz = port->clock_hz != 0 ? port->clock_hz : dev->scl_speed_hz;
+    uint64_t ns       = bits * 1000000000ULL / clock_hz;
+
+    port->stats.transactions++;
+    port->stats.bus_ns += ns;
+    if(!ack)
+    {
+        port->stats.nacks++;
+    }
+    if(port->realtime)
+    {
+        // The bus stays taken while the transaction is on the wire.
+        host_sleep_us(ns / 1000);
+    }
+    pthread_mutex_unlock(&port->lock);
+
+    if(!ack)
+    {
+        return probe ? ESP_ERR_NOT_FOUND : ESP_ERR_INVALID_STATE;
+    }
+    return ESP_OK;
+}
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+bool sim_i2c_attach(uint8_t             port, 
+                    uint8_t             address, 
+                    const sim_i2c_ops_t *ops, 
+                    void                *ctx)
+{
+    bool attached = false;
+
+    if(port >= SIM_I2C_PORT_AMOUNT || ops == NULL)
+    {
+        return false;
+    }
+
+    pthread_mutex_lock(&ports[port].lock);
+    if(sim_i2c_device(port, address) == NULL)
+    {
+        for(int i = 0; i < SIM_I2C_DEVICE_AMOUNT; i++)
+        {
+            sim_i2c_device_t *device = &ports[port].devices[i];
+
+            if(!device->used)
+            {
+                device->used    = true;
+                device->address = address;
+                device->ops     = ops;
+                device->ctx     = ctx;
+                attached        = true;
+                break;
+            }
+        }
+    }
+    pthread_mutex_unlock(&ports[port].lock);
+    return attached;
+}
+
+void sim_i2c_detach(uint8_t port, uint8_t address)
+{
+    if(port < SIM_I2C_PORT_AMOUNT)
+    {
+        pthread_mutex_lock(&ports[port].lock);
+        sim_i2c_device_t *device = sim_i2c_device(port, address);
+        if(device != NULL)
+        {
+            device->used = false;
+        }
+        pthread_mutex_unlock(&ports[port].lock);
+    }
+}
+
+void sim_i2c_set_clock(uint8_t port, uint32_t clock_hz)
+{
+    if(port < SIM_I2C_PORT_AMOUNT)
+    {
+        pthread_mutex_lock(&ports[port].lock);
+        ports[port].clock_hz = clock_hz;
+        pthread_mutex_unlock(&ports[port].lock);
+    }
+}
+
+void sim_i2c_set_realtime(uint8_t port, bool realtime)
+{
+    if(port < SIM_I2C_PORT_AMOUNT)
+    {
+        pthread_mutex_lock(&ports[port].lock);
+        ports[port].realtime = realtime;
+        pthread_mutex_unlock(&ports[port].lock);
+    }
+}
+
+void sim_i2c_get_stats(uint8_t port, sim_i2c_stats_t *stats)
+{
+    if(port < SIM_I2C_PORT_AMOUNT)
+    {
+        pthread_mutex_lock(&ports[port].lock);
+        *stats = ports[port].stats;
+        pthread_mutex_unlock(&ports[port].lock);
+    }
+}
+
+void sim_i2c_clear_stats(uint8_t port)
+{
+    if(port < SIM_I2C_PORT_AMOUNT)
+    {
+        pthread_mutex_lock(&ports[port].lock);
+        memset(&ports[port].stats, 0, sizeof(ports[port].stats));
+        pthread_mutex_unlock(&ports[port].lock);
+    }
+}
+
+esp_err_t i2c_new_master_bus(const i2c_master_bus_config_t *bus_config, 
+                             i2c_master_bus_handle_t       *ret_bus_handle)
+{
+    int port = bus_config->i2c_port;
+
+    if(port < 0 || port >= SIM_I2C_PORT_AMOUNT)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if(buses[port].used || legacy[port].installed)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    buses[port].port = port;
+    buses[port].used = true;
+    *ret_bus_handle  = &buses[port];
+    return ESP_OK;
+}
+
+esp_err_t i2c_del_master_bus(i2c_master_bus_handle_t bus_handle)
+{
+    bus_handle->used = false;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_bus_add_device(i2c_master_bus_handle_t   bus_handle,
+                                    const i2c_device_config_t *dev_config,
+                                    i2c_master_dev_handle_t   *ret_handle)
+{
+    struct i2c_master_dev_t *dev = malloc(sizeof(struct i2c_master_dev_t));
+
+    if(dev == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    dev->bus          = bus_handle;
+    dev->address      = dev_config->device_address;
+    dev->scl_speed_hz = dev_config->scl_speed_hz;
+    *ret_handle       = dev;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_bus_rm_device(i2c_master_dev_handle_t handle)
+{
+    free(handle);
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_transmit(i2c_master_dev_handle_t i2c_dev,
+                              const uint8_t           *write_buffer,
+                              size_t                  write_size,
+                              int                     xfer_timeout_ms)
+{
+    (void)xfer_timeout_ms;
+    if(write_size == 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return sim_i2c_transfer(i2c_dev, write_buffer, write_size, NULL, 0);
+}
+
+// The buffers go out in one transaction, the device sees one stream.
+esp_err_t i2c_master_multi_buffer_transmit(i2c_master_dev_handle_t                 i2c_dev,
+                                           i2c_master_transmit_multi_buffer_info_t *buffer_info_array,
+                                           size_t                                  array_size,
+                                           int                                     xfer_timeout_ms)
+{
+    uint8_t   local[SIM_I2C_BUFFER_SIZE];
+    uint8_t   *buffer = local;
+    size_t    len     = 0;
+    esp_err_t ret;
+
+    (void)xfer_timeout_ms;
+
+    for(size_t i = 0; i < array_size; i++)
+    {
+        len += buffer_info_array[i].buffer_size;
+    }
+    if(len == 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if(len > sizeof(local))
+    {
+        buffer = malloc(len);
+        if(buffer == NULL)
+        {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    len = 0;
+    for(size_t i = 0; i < array_size; i++)
+    {
+        memcpy(buffer + len, 
+               buffer_info_array[i].write_buffer, 
+               buffer_info_array[i].buffer_size);
+        len += buffer_info_array[i].buffer_size;
+    }
+
+    ret = sim_i2c_transfer(i2c_dev, buffer, len, NULL, 0);
+
+    if(buffer != local)
+    {
+        free(buffer);
+    }
+    return ret;
+}
+
+esp_err_t i2c_master_transmit_receive(i2c_master_dev_handle_t i2c_dev,
+                                      const uint8_t           *write_buffer,
+                                      size_t                  write_size,
+                                      uint8_t                 *read_buffer,
+                                      size_t                  read_size,
+                                      int                     xfer_timeout_ms)
+{
+    (void)xfer_timeout_ms;
+    if(write_size == 0 || read_size == 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return sim_i2c_transfer(i2c_dev, 
+                            write_buffer, 
+                            write_size, 
+                            read_buffer, 
+                            read_size);
+}
+
+esp_err_t i2c_master_receive(i2c_master_dev_handle_t i2c_dev,
+                             uint8_t                 *read_buffer,
+                             size_t                  read_size,
+                             int                     xfer_timeout_ms)
+{
+    (void)xfer_timeout_ms;
+    if(read_size == 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return sim_i2c_transfer(i2c_dev, NULL, 0, read_buffer, read_size);
+}
+
+// Probes are not tied to a device handle, a temporary one at the standard
+// mode clock is used.
+esp_err_t i2c_master_probe(i2c_master_bus_handle_t bus_handle,
+                           uint16_t                address,
+                           int                     xfer_timeout_ms)
+{
+    struct i2c_master_dev_t dev = {
+        .bus          = bus_handle,
+        .address      = address,
+        .scl_speed_hz = 100000,
+    };
+
+    (void)xfer_timeout_ms;
+    return sim_i2c_transfer(&dev, NULL, 0, NULL, 0);
+}
+
+esp_err_t i2c_param_config(i2c_port_t i2c_num, const i2c_config_t *i2c_conf)
+{
+    if(i2c_num < 0 || i2c_num >= SIM_I2C_PORT_AMOUNT || 
+       i2c_conf->mode != I2C_MODE_MASTER)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    legacy[i2c_num].clk_speed = i2c_conf->master.clk_speed;
+    return ESP_OK;
+}
+
+esp_err_t i2c_driver_install(i2c_port_t i2c_num,
+                             i2c_mode_t mode,
+                             size_t     slv_rx_buf_len,
+                             size_t     slv_tx_buf_len,
+                             int        intr_alloc_flags)
+{
+    (void)slv_rx_buf_len;
+    (void)slv_tx_buf_len;
+    (void)intr_alloc_flags;
+    if(i2c_num < 0 || i2c_num >= SIM_I2C_PORT_AMOUNT || 
+       mode != I2C_MODE_MASTER || legacy[i2c_num].clk_speed == 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if(legacy[i2c_num].installed || buses[i2c_num].used)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    legacy[i2c_num].installed = true;
+    buses[i2c_num].port       = i2c_num;
+    return ESP_OK;
+}
+
+esp_err_t i2c_driver_delete(i2c_port_t i2c_num)
+{
+    if(i2c_num < 0 || i2c_num >= SIM_I2C_PORT_AMOUNT)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    legacy[i2c_num].installed = false;
+    return ESP_OK;
+}
+
+i2c_cmd_handle_t i2c_cmd_link_create_static(uint8_t *buffer, uint32_t size)
+{
+    i2c_cmd_link_t *link = (i2c_cmd_link_t*)buffer;
+
+    if(buffer == NULL || size < sizeof(i2c_cmd_link_t))
+    {
+        return NULL;
+    }
+    link->amount = 0;
+    link->size   = (size - sizeof(i2c_cmd_link_t)) / sizeof(i2c_cmd_t);
+    return link;
+}
+
+void i2c_cmd_link_delete_static(i2c_cmd_handle_t cmd_handle)
+{
+    (void)cmd_handle;
+}
+
+static esp_err_t sim_i2c_link_add(i2c_cmd_handle_t cmd_handle, i2c_cmd_t cmd)
+{
+    i2c_cmd_link_t *link = (i2c_cmd_link_t*)cmd_handle;
+
+    if(link == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if(link->amount >= link->size)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    link->cmds[link->amount++] = cmd;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_start(i2c_cmd_handle_t cmd_handle)
+{
+    return sim_i2c_link_add(cmd_handle, (i2c_cmd_t){ .op = I2C_CMD_START });
+}
+
+esp_err_t i2c_master_write_byte(i2c_cmd_handle_t cmd_handle,
+                                uint8_t          data,
+                                bool             ack_en)
+{
+    (void)ack_en;
+    return sim_i2c_link_add(cmd_handle, 
+                            (i2c_cmd_t){ .op = I2C_CMD_WRITE, .byte = data, .len = 1 });
+}
+
+esp_err_t i2c_master_write(i2c_cmd_handle_t cmd_handle,
+                           const uint8_t    *data,
+                           size_t           data_len,
+                           bool             ack_en)
+{
+    (void)ack_en;
+    if(data == NULL || data_len == 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return sim_i2c_link_add(cmd_handle, 
+                            (i2c_cmd_t){ .op = I2C_CMD_WRITE, .write = data, .len = data_len });
+}
+
+esp_err_t i2c_master_read(i2c_cmd_handle_t cmd_handle,
+                          uint8_t          *data,
+                          size_t           data_len,
+                          i2c_ack_type_t   ack)
+{
+    (void)ack;
+    if(data == NULL || data_len == 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return sim_i2c_link_add(cmd_handle, 
+                            (i2c_cmd_t){ .op = I2C_CMD_READ, .read = data, .len = data_len });
+}
+
+esp_err_t i2c_master_stop(i2c_cmd_handle_t cmd_handle)
+{
+    return sim_i2c_link_add(cmd_handle, (i2c_cmd_t){ .op = I2C_CMD_STOP });
+}
+
+/* Function: i2c_master_cmd_begin
+ *
+ * Runs the link as one transaction. The first byte after a start is the
+ * address, the bytes written after it are collected, a read after a 
+ * repeated start goes to its buffer. The shapes i2c_bus.c builds are a 
+ * probe, a write, a write followed by a read and a read.
+ *
+ */
+esp_err_t i2c_master_cmd_begin(i2c_port_t       i2c_num,
+                               i2c_cmd_handle_t cmd_handle,
+                               TickType_t       ticks_to_wait)
+{
+    i2c_cmd_link_t          *link    = (i2c_cmd_link_t*)cmd_handle;
+    uint8_t                 local[SIM_I2C_BUFFER_SIZE];
+    uint8_t                 *buffer  = local;
+    size_t                  size     = 0;
+    size_t                  written  = 0;
+    uint8_t                 *read    = NULL;
+    size_t                  readLen  = 0;
+    bool                    address  = false;
+    bool                    valid    = true;
+    bool                    stopped  = false;
+    struct i2c_master_dev_t dev;
+    esp_err_t               ret;
+
+    (void)ticks_to_wait;
+    if(i2c_num < 0 || i2c_num >= SIM_I2C_PORT_AMOUNT || link == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if(!legacy[i2c_num].installed)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    dev.bus          = &buses[i2c_num];
+    dev.address      = 0;
+    dev.scl_speed_hz = legacy[i2c_num].clk_speed;
+
+    for(size_t i = 0; i < link->amount; i++)
+    {
+        if(link->cmds[i].op == I2C_CMD_WRITE)
+        {
+            size += link->cmds[i].len;
+        }
+    }
+    if(size > sizeof(local))
+    {
+        buffer = malloc(size);
+        if(buffer == NULL)
+        {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    for(size_t i = 0; i < link->amount && valid && !stopped; i++)
+    {
+        i2c_cmd_t *cmd = &link->cmds[i];
+
+        if(cmd->op == I2C_CMD_START)
+        {
+            address = true;
+        }
+        else if(cmd->op == I2C_CMD_WRITE && address)
+        {
+            dev.address = cmd->byte >> 1;
+            address     = false;
+        }
+        else if(cmd->op == I2C_CMD_WRITE)
+        {
+            // Nothing is written after the read.
+            valid = (read == NULL);
+            if(valid)
+            {
+                if(cmd->write != NULL)
+                {
+                    memcpy(&buffer[written], cmd->write, cmd->len);
+                }
+                else
+                {
+                    buffer[written] = cmd->byte;
+                }
+                written += cmd->len;
+            }
+        }
+        else if(cmd->op == I2C_CMD_READ)
+        {
+            valid   = (read == NULL);
+            read    = cmd->read;
+            readLen = cmd->len;
+        }
+        else
+        {
+            stopped = true;
+        }
+    }
+
+    ret = ESP_ERR_INVALID_ARG;
+    if(valid && stopped)
+    {
+        // The legacy driver doesn't tell a NACK from other failures.
+        ret = sim_i2c_transfer(&dev, buffer, written, read, readLen) == ESP_OK ?
+              ESP_OK : ESP_FAIL;
+    }
+    if(buffer != local)
+    {
+        free(buffer);
+    }
+    return ret;
+}
+
+/******************************* THE END *********************************/
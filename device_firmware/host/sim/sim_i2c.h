@@ -0,0 +1,130 @@
+/*
+ * sim_i2c.h
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Simulated I2C buses behind the host i2c_master driver and the legacy
+ * command link driver, so both branches of i2c_bus.c run. Device models
+ * attach to an address on a port with a table of operations, the bus
+ * calls them for the phases of every transaction: start with the address,
+ * written bytes, read bytes and stop. Any model can be put behind it, the
+ * firmware sees a normal bus of either driver.
+ *
+ * Every port counts its transactions, bytes, NACKs and the time the 
+ * transactions would take on the wire at the bus clock. In realtime mode
+ * a transfer also takes that long, for latency measurements.
+ *
+ */
+#ifndef SIM_I2C_H_
+#define SIM_I2C_H_
+
+/******************************* INCLUDES ********************************/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+#include "esp_err.h"
+#include "driver/i2c_master.h"
+#include "driver/i2c.h"
+
+/******************************* DEFINES *********************************/
+
+#define SIM_I2C_PORT_AMOUNT   2
+#define SIM_I2C_DEVICE_AMOUNT 8
+#define SIM_I2C_BUFFER_SIZE   256  /* Multi buffer writes up to this  */
+
+// Bits of a transaction: start, 8 bits + ack per byte, stop.
+#define SIM_I2C_START_BITS    1
+#define SIM_I2C_STOP_BITS     1
+#define SIM_I2C_BYTE_BITS     9
+
+/******************************* TYPEDEFS ********************************/
+
+// Operations of a device model. They run in the task doing the transfer
+// while the bus is held, one transaction at a time per port.
+typedef struct
+{
+    // Address phase, returns false to NACK it.
+    bool (*start)(void *ctx, bool read);
+    // Bytes from the master, returns false to NACK them.
+    bool (*write)(void *ctx, const uint8_t *data, size_t len);
+    // Bytes to the master.
+    void (*read)(void *ctx, uint8_t *data, size_t len);
+    void (*stop)(void *ctx);
+} sim_i2c_ops_t;
+
+typedef struct
+{
+    uint32_t transactions;  /* Start to stop, probes included       */
+    uint32_t bytes;         /* Written and read, without addressing */
+    uint32_t nacks;
+    uint64_t bus_ns;        /* Time on the wire at the bus clock    */
+} sim_i2c_stats_t;
+
+typedef struct
+{
+    bool                used;
+    uint8_t             address;
+    const sim_i2c_ops_t *ops;
+    void                *ctx;
+} sim_i2c_device_t;
+
+typedef struct
+{
+    pthread_mutex_t  lock;
+    uint32_t         clock_hz;  /* 0 uses the clock of the device    */
+    bool             realtime;
+    sim_i2c_stats_t  stats;
+    sim_i2c_device_t devices[SIM_I2C_DEVICE_AMOUNT];
+} sim_i2c_port_t;
+
+struct i2c_master_bus_t
+{
+    uint8_t port;
+    bool    used;
+};
+
+struct i2c_master_dev_t
+{
+    struct i2c_master_bus_t *bus;
+    uint8_t                 address;
+    uint32_t                scl_speed_hz;
+};
+
+// A port installed with the legacy driver.
+typedef struct
+{
+    bool     installed;
+    uint32_t clk_speed;
+} sim_i2c_legacy_t;
+
+/******************************* LOCAL FUNCTIONS *************************/
+
+sim_i2c_device_t* sim_i2c_device(uint8_t port, uint8_t address);
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+// Connects a device model to an address, before or after the firmware
+// added the device.
+bool sim_i2c_attach(uint8_t             port, 
+                    uint8_t             address, 
+                    const sim_i2c_ops_t *ops, 
+                    void                *ctx);
+
+void sim_i2c_detach(uint8_t port, uint8_t address);
+
+// Overrides the clock the firmware configured, 0 to use that again.
+void sim_i2c_set_clock(uint8_t port, uint32_t clock_hz);
+
+void sim_i2c_set_realtime(uint8_t port, bool realtime);
+
+void sim_i2c_get_stats(uint8_t port, sim_i2c_stats_t *stats);
+
+void sim_i2c_clear_stats(uint8_t port);
+
+/******************************* THE END *********************************/
+
+#endif /* SIM_I2C_H_ */
@@ -0,0 +1,464 @@
+/*
+ * biquad_bench.c
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Runs the coefficients of the firmware through the bit exact ADAU1701
+ * cascade of sim/biquad_sim.h:
+ *
+ *  per filter  Every design of the coeff_bench sweep as one band of a
+ *              channel, the other bands off.
+ *  channels    Channels of 5 random bands from the same sweep, every
+ *              other one with only bands in the gated range.
+ *
+ * Per group it reports the largest response deviation from the same
+ * cascade in double precision, the largest deviation from the exact
+ * design, the worst offset and noise floor, the limit cycles, the least
+ * headroom and the overflows and saturations.
+ *
+ * A direct form I biquad in 5.23 amplifies its truncation error by the
+ * gain of the poles, roughly 1 / w0^2 near DC and the same near Nyquist.
+ * Bands below a few hundred Hz have a noise floor of -45 to -90 dBFS and
+ * limit cycles of thousands of LSBs, a property of the cascade the
+ * coefficients can't change. So the limits are fixed and only gate the
+ * channels whose bands are all between BENCH_GATE_FREQ_MIN and
+ * BENCH_GATE_FREQ_MAX, at the points of the response in that range:
+ *
+ *  dev_db      Against double precision with the same 5.23 coefficients,
+ *              only the arithmetic of the cascade is in it.
+ *  design_db   Against the exact design in double precision, a wrong
+ *              design or packing shows up here.
+ *  loud        Channels with noise or a limit cycle above the noise at the
+ *              output, the ADC's through the channel plus the DAC's. Only
+ *              gated for single bands, 5 random bands can stack a boost
+ *              ahead of a cut.
+ *  dc_lsb      Limit cycles of period 1, a DC offset, below
+ *              BENCH_MAX_DC_DB.
+ *
+ * Both deviations only count within BENCH_DESIGN_RANGE_DB of the peak
+ * and BIQUAD_SIM_SNR_DB above the noise floor.
+ *
+ * Exits with 1 when the accumulator overflows or a limit is exceeded.
+ *
+ * Usage: biquad_bench [-s stride] [-r channels] [-l length] [-v]
+ *
+ */
+/******************************* INCLUDES ********************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include "host_port.h"
+#include "biquad_sim.h"
+#include "coeff_bench.h"
+#include "dsp_control.h"
+
+/******************************* DEFINES *********************************/
+
+#define BENCH_STAGES           DEVICE_SETTINGS_OUTPUT_EQ_AMOUNT
+#define BENCH_CHANNELS         500
+#define BENCH_SEED             0x5EED
+
+// Bands in this range are gated, see above.
+#define BENCH_GATE_FREQ_MIN    600
+#define BENCH_GATE_FREQ_MAX    16000
+#define BENCH_DESIGN_RANGE_DB  40
+
+#define BENCH_MAX_DEVIATION_DB 0.1
+#define BENCH_MAX_DESIGN_DB    0.1
+#define BENCH_ADC_FLOOR_DB     -100    /* dBFS, ADC dynamic range        */
+#define BENCH_DAC_FLOOR_DB     -104    /* dBFS, DAC dynamic range        */
+#define BENCH_MAX_DC_DB        -60     /* dBFS, a mV at the line output  */
+#define BENCH_SINE_RMS_DB      3.01    /* Peak over rms of a sine        */
+
+/******************************* TYPEDEFS ********************************/
+
+typedef struct
+{
+    uint32_t configs;
+    uint32_t gated;
+    uint32_t limit_cycles;
+    uint32_t max_cycle_lsb;    /* Gated channels                     */
+    uint32_t max_dc_lsb;       /* Gated channels, period 1           */
+    uint32_t loud;             /* Gated, above the output floor      */
+    uint32_t saturated;
+    uint32_t overflowed;
+    double   deviation_db;     /* Gated channels                     */
+    double   design_db;        /* Gated channels                     */
+    double   offset_db;
+    double   noise_db;         /* Gated channels                     */
+    double   headroom_db;
+} bench_group_t;
+
+/******************************* GLOBAL VARIABLES ************************/
+
+static const char *groupNames[COEFF_BENCH_FILTER_AMOUNT] = {
+    "peak", "lowshelf", "highshelf", "lowpass", "highpass", "bandpass", "bandstop"
+};
+
+static uint32_t randomState = BENCH_SEED;
+static bool     verbose     = false;
+static bool     failed      = false;
+
+/******************************* LOCAL FUNCTIONS *************************/
+
+// xorshift32, repeatable channels.
+static uint32_t bench_random(void)
+{
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return randomState;
+}
+
+static void bench_pack(const equalizer_t *eq, uint8_t *data)
+{
+    float coefficients[ADA_COEFFICIENT_AMOUNT];
+
+    dsp_control_eq_coefficients(eq, coefficients);
+    dsp_control_pack_coefficients(coefficients, data);
+}
+
+static void bench_group_begin(bench_group_t *group)
+{
+    memset(group, 0, sizeof(bench_group_t));
+    group->offset_db   = -INFINITY;
+    group->noise_db    = -INFINITY;
+    group->headroom_db = INFINITY;
+}
+
+static bool bench_band_gated(const equalizer_t *eq)
+{
+    return eq->state != STATE_ON ||
+           (eq->freq >= BENCH_GATE_FREQ_MIN && eq->freq <= BENCH_GATE_FREQ_MAX);
+}
+
+// Channels whose bands that are on are all in the gated range.
+static bool bench_gated(const equalizer_t *bands)
+{
+    for(int i = 0; i < BENCH_STAGES; i++)
+    {
+        if(!bench_band_gated(&bands[i]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Function: bench_deviation
+ *
+ * Largest difference of the response of the cascade to double precision
+ * with the same coefficients and to the exact design, the coefficients of
+ * coeff_bench_reference() without any rounding. Only the points in the
+ * gated range, within BENCH_DESIGN_RANGE_DB of the peak of the design and
+ * BIQUAD_SIM_SNR_DB above the noise floor count, a notch has no exact
+ * depth.
+ */
+static void bench_deviation(const equalizer_t         *bands,
+                            const biquad_sim_report_t *report,
+                            double                    *deviation,
+                            double                    *design)
+{
+    double exact[BIQUAD_SIM_POINTS];
+    double peak = -INFINITY;
+
+    for(int i = 0; i < BIQUAD_SIM_POINTS; i++)
+    {
+        double w = 2 * M_PI * report->freq[i] / BIQUAD_SIM_SAMPLE_FREQ;
+
+        exact[i] = 0;
+        for(int j = 0; j < BENCH_STAGES; j++)
+        {
+            double c[ADA_COEFFICIENT_AMOUNT];
+            double numRe, numIm, denRe, denIm;
+
+            if(bands[j].state != STATE_ON)
+            {
+                continue;
+            }
+            coeff_bench_reference(&bands[j], c);
+            numRe = c[0] + c[1] * cos(w) + c[2] * cos(2 * w);
+            numIm = -c[1] * sin(w) - c[2] * sin(2 * w);
+            denRe = 1 - c[3] * cos(w) - c[4] * cos(2 * w);
+            denIm = c[3] * sin(w) + c[4] * sin(2 * w);
+            exact[i] += 10 * log10((numRe * numRe + numIm * numIm) /
+                                   (denRe * denRe + denIm * denIm));
+        }
+        peak = fmax(peak, exact[i]);
+    }
+
+    *deviation = 0;
+    *design    = 0;
+    for(int i = 0; i < BIQUAD_SIM_POINTS; i++)
+    {
+        if(report->freq[i] >= BENCH_GATE_FREQ_MIN &&
+           report->freq[i] <= BENCH_GATE_FREQ_MAX &&
+           exact[i] >= peak - BENCH_DESIGN_RANGE_DB &&
+           report->reference_db[i] >= report->floor_db[i] + BIQUAD_SIM_SNR_DB)
+        {
+            *deviation = fmax(*deviation,
+                              fabs(report->response_db[i] - report->reference_db[i]));
+            *design    = fmax(*design, fabs(report->response_db[i] - exact[i]));
+        }
+    }
+}
+
+// Peak of a number of LSBs in dBFS.
+static double bench_lsb_db(uint32_t lsb)
+{
+    return lsb > 0 ? 20 * log10((double)lsb / BIQUAD_SIM_ONE) : -INFINITY;
+}
+
+/* Function: bench_output_floor
+ *
+ * Noise at the output of a channel with the given peak gain, the noise
+ * of the ADC through the channel and the noise of the DAC added up. The
+ * cascade adds nothing audible while its noise stays below it.
+ */
+static double bench_output_floor(double peak_db)
+{
+    return 10 * log10(pow(10, (BENCH_ADC_FLOOR_DB + peak_db) / 10) +
+                      pow(10, BENCH_DAC_FLOOR_DB / 10.0));
+}
+
+static void bench_group_add(bench_group_t             *group,
+                            const equalizer_t         *bands,
+                            const biquad_sim_report_t *report)
+{
+    bool   gated = bench_gated(bands);
+    double floor = bench_output_floor(report->peak_db);
+    double deviation;
+    double design;
+
+    group->configs++;
+    // A limit cycle of period 1 is a constant, a DC offset.
+    if(report->limit_cycle)
+    {
+        group->limit_cycles++;
+        if(gated && report->limit_cycle_period == 1)
+        {
+            group->max_dc_lsb = fmax(group->max_dc_lsb, report->limit_cycle_lsb);
+        }
+        else if(gated)
+        {
+            group->max_cycle_lsb = fmax(group->max_cycle_lsb, report->limit_cycle_lsb);
+            if(bench_lsb_db(report->limit_cycle_lsb) - BENCH_SINE_RMS_DB > floor)
+            {
+                group->loud++;
+            }
+        }
+    }
+    if(report->overflows > 0)
+    {
+        group->overflowed++;
+    }
+    if(report->headroom_db < group->headroom_db)
+    {
+        group->headroom_db = report->headroom_db;
+    }
+    // A saturated or overflowed cascade isn't linear, it has no deviation
+    // or noise.
+    if(report->saturations > 0)
+    {
+        group->saturated++;
+    }
+    if(report->saturations > 0 || report->overflows > 0)
+    {
+        return;
+    }
+    group->offset_db = fmax(group->offset_db, report->offset_db);
+    if(gated)
+    {
+        bench_deviation(bands, report, &deviation, &design);
+        group->gated++;
+        group->deviation_db = fmax(group->deviation_db, deviation);
+        group->design_db    = fmax(group->design_db, design);
+        group->noise_db     = fmax(group->noise_db, report->noise_db);
+        if(report->noise_db > floor)
+        {
+            group->loud++;
+        }
+    }
+}
+
+static void bench_group_end(const bench_group_t *group,
+                            const char          *name,
+                            bool                quiet)
+{
+    printf("%-10s %7lu %6lu %8.3f %9.3f %9.1f %9.1f %7lu %6lu %6lu %6lu %9.1f %6lu %6lu\n",
+           name,
+           (unsigned long)group->configs,
+           (unsigned long)group->gated,
+           group->deviation_db,
+           group->design_db,
+           group->offset_db,
+           group->noise_db,
+           (unsigned long)group->limit_cycles,
+           (unsigned long)group->max_cycle_lsb,
+           (unsigned long)group->max_dc_lsb,
+           (unsigned long)group->loud,
+           group->headroom_db,
+           (unsigned long)group->saturated,
+           (unsigned long)group->overflowed);
+
+    if(group->overflowed > 0 ||
+       group->deviation_db > BENCH_MAX_DEVIATION_DB ||
+       group->design_db > BENCH_MAX_DESIGN_DB ||
+       (quiet && group->loud > 0) ||
+       bench_lsb_db(group->max_dc_lsb) > BENCH_MAX_DC_DB)
+    {
+        printf("FAIL: %s\n", name);
+        failed = true;
+    }
+}
+
+static void bench_analyze(bench_group_t     *group,
+                          const equalizer_t *bands,
+                          uint32_t          length)
+{
+    uint8_t             data[BENCH_STAGES * BIQUAD_SIM_STAGE_BYTES];
+    biquad_sim_report_t report;
+
+    for(int i = 0; i < BENCH_STAGES; i++)
+    {
+        bench_pack(&bands[i], &data[i * BIQUAD_SIM_STAGE_BYTES]);
+    }
+    if(!biquad_sim_analyze(data, BENCH_STAGES, length, &report))
+    {
+        printf("FAIL: analysis\n");
+        failed = true;
+        return;
+    }
+    bench_group_add(group, bands, &report);
+
+    if(verbose && (report.limit_cycle || report.saturations > 0 ||
+                   report.overflows > 0))
+    {
+        for(int i = 0; i < BENCH_STAGES; i++)
+        {
+            if(bands[i].state == STATE_ON)
+            {
+                printf("  %s %.0f Hz q %.2f s %.2f bw %.2f boost %.0f gain %.0f\n",
+                       groupNames[bands[i].filter_type],
+                       bands[i].freq, bands[i].q, bands[i].s,
+                       bands[i].bandwidth, bands[i].boost, bands[i].gain);
+            }
+        }
+        printf("  -> limit cycle %lu lsb period %lu, %lu saturations, "
+               "%lu overflows\n",
+               (unsigned long)report.limit_cycle_lsb,
+               (unsigned long)report.limit_cycle_period,
+               (unsigned long)report.saturations,
+               (unsigned long)report.overflows);
+    }
+}
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+int main(int argc, char **argv)
+{
+    uint32_t      stride   = 1;
+    uint32_t      channels = BENCH_CHANNELS;
+    uint32_t      length   = BIQUAD_SIM_LENGTH;
+    uint32_t      total    = 0;
+    equalizer_t   bands[BENCH_STAGES];
+    bench_group_t group;
+    int64_t       start;
+    int           opt;
+
+    while((opt = getopt(argc, argv, "s:r:l:v")) != -1)
+    {
+        switch(opt)
+        {
+            case 's':
+                stride = strtoul(optarg, NULL, 0);
+                break;
+            case 'r':
+                channels = strtoul(optarg, NULL, 0);
+                break;
+            case 'l':
+                length = strtoul(optarg, NULL, 0);
+                break;
+            case 'v':
+                verbose = true;
+                break;
+            default:
+                fprintf(stderr,
+                        "usage: %s [-s stride] [-r channels] [-l length] [-v]\n",
+                        argv[0]);
+                return 2;
+        }
+    }
+    if(stride == 0 || length < BIQUAD_SIM_CYCLE_WINDOW)
+    {
+        fprintf(stderr, "Use a stride of 1 or more and at least %d samples\n",
+                BIQUAD_SIM_CYCLE_WINDOW);
+        return 2;
+    }
+
+    printf("ADAU1701 cascade of %d stages, %lu samples per run\n\n",
+           BENCH_STAGES, (unsigned long)length);
+    printf("%-10s %7s %6s %8s %9s %9s %9s %7s %6s %6s %6s %9s %6s %6s\n",
+           "group", "configs", "gated", "dev_db", "design_db", "offset_db",
+           "noise_db", "cycles", "lsb", "dc_lsb", "loud", "headroom", "sat",
+           "ovf");
+
+    // A band that is off passes the signal, its coefficients are 1 0 0 0 0.
+    for(int i = 0; i < BENCH_STAGES; i++)
+    {
+        coeff_bench_config(FILTER_TYPE_PEAK, 0, &bands[i]);
+        bands[i].state = STATE_OFF;
+    }
+
+    start = esp_timer_get_time();
+    for(uint8_t type = 0; type < COEFF_BENCH_FILTER_AMOUNT; type++)
+    {
+        bench_group_begin(&group);
+        for(uint32_t i = 0; i < coeff_bench_configs(); i += stride)
+        {
+            coeff_bench_config(type, i, &bands[0]);
+            bench_analyze(&group, bands, length);
+        }
+        bench_group_end(&group, groupNames[type], true);
+        total += group.configs;
+    }
+
+    bench_group_begin(&group);
+    for(uint32_t i = 0; i < channels; i++)
+    {
+        // Every other channel only has bands in the gated range.
+        for(int j = 0; j < BENCH_STAGES; j++)
+        {
+            do
+            {
+                coeff_bench_config(bench_random() % COEFF_BENCH_FILTER_AMOUNT,
+                                   bench_random() % coeff_bench_configs(),
+                                   &bands[j]);
+            } while(i % 2 == 1 && !bench_band_gated(&bands[j]));
+        }
+        bench_analyze(&group, bands, length);
+    }
+    if(channels > 0)
+    {
+        bench_group_end(&group, "channels", false);
+    }
+    total += group.configs;
+
+    double seconds = (esp_timer_get_time() - start) / 1e6;
+
+    printf("\n%lu cascades in %.2f s, %.0f per second\n",
+           (unsigned long)total, seconds, total / seconds);
+    printf("dev_db against double precision, offset_db and noise_db relative "
+           "to 1.0 for a\n%d dBFS sine, headroom over the 5.23 range for a "
+           "full scale input.\n",
+           BIQUAD_SIM_NOISE_DBFS);
+
+    printf("\n%s\n", failed ? "FAILED" : "OK");
+    return failed ? 1 : 0;
+}
+
+/******************************* THE END *********************************/
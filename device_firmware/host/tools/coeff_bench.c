@@ -0,0 +1,53 @@
+/*
+ * coeff_bench.c
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Host run of the coefficient microbenchmark, see main/coeff_bench.h.
+ * Cycles are time stamp counter cycles on x86. The sweep is repeated to
+ * steady the timing, the errors are the same every pass. Exits with 1
+ * when a coefficient is off more than COEFF_BENCH_MAX_ERROR_LSB.
+ *
+ * Usage: coeff_bench [-r repeats]
+ *
+ */
+/******************************* INCLUDES ********************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "coeff_bench.h"
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+int main(int argc, char **argv)
+{
+    uint32_t repeats = 3;
+    bool     passed  = true;
+    int      opt;
+
+    while((opt = getopt(argc, argv, "r:")) != -1)
+    {
+        switch(opt)
+        {
+            case 'r':
+                repeats = strtoul(optarg, NULL, 0);
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-r repeats]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    for(uint32_t i = 0; i < repeats; i++)
+    {
+        printf("\npass %lu\n", (unsigned long)i + 1);
+        passed = coeff_bench_run() && passed;
+    }
+
+    printf("\n%s\n", passed ? "OK" : "FAILED");
+    return passed ? 0 : 1;
+}
+
+/******************************* THE END *********************************/
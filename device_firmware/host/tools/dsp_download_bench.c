@@ -0,0 +1,346 @@
+/*
+ * dsp_download_bench.c
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Runs the DSP side of the firmware against an ADAU1701 model per line of
+ * DSP_CONTROL_CONFIGS on the simulated buses and reports what goes over 
+ * the wires, summed over all buses and DSPs:
+ *
+ *  cold boot   Reset and full download of the boot image.
+ *  warm boot   Init again while the DSP still runs the image, the 
+ *              download must be skipped.
+ *  eq writes   EQ updates through dsp_control, as the DSP task does them.
+ *  same prog   Switch to the program that already runs, nothing may go
+ *              over the wire.
+ *  scrub       One scrubber pass over both RAMs, after a bit flip was
+ *              injected in the last DSP. Exactly that word has to be 
+ *              repaired.
+ *  scrub prog  The same for a bit flip in program RAM. The core has to
+ *              be stopped while the word is written.
+ *
+ * Every phase also checks the model saw no protocol errors and no program
+ * writes while the core ran. Exits with 1 when a check fails.
+ *
+ * Usage: dsp_download_bench [-c clock_hz] [-n eq_writes] [image.bin]
+ *
+ */
+/******************************* INCLUDES ********************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "host_port.h"
+#include "sim_i2c.h"
+#include "adau1701_sim.h"
+#include "dsp_control.h"
+#include "dsp_image.h"
+#include "i2c_bus.h"
+
+/******************************* DEFINES *********************************/
+
+#define BENCH_PARTITION_SIZE   0x20000
+#define BENCH_EQ_WRITES        200
+#define BENCH_SCRUB_STEPS      ((SIGMA_DSP_REGISTER_ADDR - SIGMA_DSP_PARAMETER_RAM_ADDR) / \
+                                SIGMA_DSP_SCRUB_WORDS)
+#define BENCH_FLIP_ADDR        0x0100
+#define BENCH_FLIP_PROGRAM     0x0500
+
+/******************************* TYPEDEFS ********************************/
+
+typedef struct
+{
+    int64_t              start_us;
+    sim_i2c_stats_t      bus;
+    adau1701_sim_stats_t dsp;
+} bench_phase_t;
+
+/******************************* GLOBAL VARIABLES ************************/
+
+static const dsp_control_config_t benchConfigs[] = {DSP_CONTROL_CONFIGS};
+static adau1701_sim_t             dsps[DEVICE_SETTINGS_DSP_AMOUNT];
+static bool                       failed = false;
+
+/******************************* LOCAL FUNCTIONS *************************/
+
+static void bench_check(bool ok, const char *what)
+{
+    if(!ok)
+    {
+        printf("FAIL: %s\n", what);
+        failed = true;
+    }
+}
+
+static void bench_begin(bench_phase_t *phase)
+{
+    for(int port = 0; port < SIM_I2C_PORT_AMOUNT; port++)
+    {
+        sim_i2c_clear_stats(port);
+    }
+    for(int i = 0; i < DEVICE_SETTINGS_DSP_AMOUNT; i++)
+    {
+        adau1701_sim_clear_stats(&dsps[i]);
+    }
+    phase->start_us = esp_timer_get_time();
+}
+
+static void bench_end(bench_phase_t *phase, const char *name, uint32_t items)
+{
+    int64_t wall_us = esp_timer_get_time() - phase->start_us;
+
+    memset(&phase->bus, 0, sizeof(phase->bus));
+    memset(&phase->dsp, 0, sizeof(phase->dsp));
+    for(int port = 0; port < SIM_I2C_PORT_AMOUNT; port++)
+    {
+        sim_i2c_stats_t bus;
+
+        sim_i2c_get_stats(port, &bus);
+        phase->bus.transactions += bus.transactions;
+        phase->bus.bytes        += bus.bytes;
+        phase->bus.nacks        += bus.nacks;
+        phase->bus.bus_ns       += bus.bus_ns;
+    }
+    for(int i = 0; i < DEVICE_SETTINGS_DSP_AMOUNT; i++)
+    {
+        adau1701_sim_stats_t dsp;
+
+        adau1701_sim_get_stats(&dsps[i], &dsp);
+        phase->dsp.words_written          += dsp.words_written;
+        phase->dsp.resets                 += dsp.resets;
+        phase->dsp.protocol_errors        += dsp.protocol_errors;
+        phase->dsp.running_program_writes += dsp.running_program_writes;
+    }
+
+    printf("%-10s %7lu %8lu %9.2f %9.2f %7lu %6lu",
+           name,
+           (unsigned long)phase->bus.transactions,
+           (unsigned long)phase->bus.bytes,
+           phase->bus.bus_ns / 1e6,
+           wall_us / 1e3,
+           (unsigned long)phase->dsp.words_written,
+           (unsigned long)phase->dsp.resets);
+    if(items > 0)
+    {
+        printf("   %.1f txn, %.1f bytes, %.1f us per item",
+               (double)phase->bus.transactions / items,
+               (double)phase->bus.bytes / items,
+               phase->bus.bus_ns / 1e3 / items);
+    }
+    printf("\n");
+
+    bench_check(phase->dsp.protocol_errors == 0, "no protocol errors");
+    bench_check(phase->dsp.running_program_writes == 0, 
+                "no program writes while the core runs");
+    bench_check(phase->bus.nacks == 0, "no NACKs");
+}
+
+// Program RAM of every model has to be the program of the image.
+static bool bench_program_matches(void)
+{
+    static uint8_t expected[SIGMA_DSP_PROGRAM_SIZE];
+    static uint8_t actual[SIGMA_DSP_PROGRAM_SIZE];
+    dsp_image_t    image;
+
+    if(dsp_image_open(SIGMA_DSP_BOOT_IMAGE, &image) != DSP_IMAGE_SUCCESS)
+    {
+        return false;
+    }
+    sigma_dsp_image_region(&image,
+                           SIGMA_DSP_PROGRAM_RAM_ADDR,
+                           SIGMA_DSP_PROGRAM_REGSIZE,
+                           SIGMA_DSP_PROGRAM_SIZE,
+                           expected);
+    dsp_image_close(&image);
+
+    for(int i = 0; i < DEVICE_SETTINGS_DSP_AMOUNT; i++)
+    {
+        if(!adau1701_sim_peek(&dsps[i], 
+                              SIGMA_DSP_PROGRAM_RAM_ADDR, 
+                              SIGMA_DSP_PROGRAM_SIZE, 
+                              actual) ||
+           memcmp(expected, actual, sizeof(actual)) != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool bench_running(void)
+{
+    for(int i = 0; i < DEVICE_SETTINGS_DSP_AMOUNT; i++)
+    {
+        if(!adau1701_sim_running(&dsps[i]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void bench_eq_writes(uint32_t amount)
+{
+    for(uint32_t i = 0; i < amount; i++)
+    {
+        equalizer_t eq = {
+            .q           = 1.41,
+            .s           = 1,
+            .bandwidth   = 1,
+            .boost       = (float)(i % 13) - 6,
+            .freq        = 100 + (i * 37) % 15000,
+            .gain        = 0,
+            .filter_type = FILTER_TYPE_PEAK,
+            .phase       = PHASE_NON_INVERTED,
+            .state       = STATE_ON,
+            .dsp_index   = DEVICE_SETTINGS_DSP_ALL,
+        };
+        eq.sigma_dsp_address = MOD_INPUT1_EQ_ALG0_STAGE0_B0_ADDR + 
+                               (i % DEVICE_SETTINGS_INPUT_EQ_AMOUNT) * 
+                               ADA_COEFFICIENT_AMOUNT;
+
+        bench_check(dsp_control_eq_secondorder(&eq), "EQ write queued");
+    }
+    bench_check(dsp_control_flush(), "EQ writes flushed");
+}
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+int main(int argc, char **argv)
+{
+    const char    *path     = DSP_IMAGES_BIN;
+    uint32_t      clock_hz  = I2C_MASTER_FREQ_HZ;
+    uint32_t      eqWrites  = BENCH_EQ_WRITES;
+    bench_phase_t phase;
+    int           opt;
+
+    while((opt = getopt(argc, argv, "c:n:")) != -1)
+    {
+        switch(opt)
+        {
+            case 'c':
+                clock_hz = strtoul(optarg, NULL, 0);
+                break;
+            case 'n':
+                eqWrites = strtoul(optarg, NULL, 0);
+                break;
+            default:
+                fprintf(stderr, 
+                        "usage: %s [-c clock_hz] [-n eq_writes] [image.bin]\n", 
+                        argv[0]);
+                return 2;
+        }
+    }
+    if(optind < argc)
+    {
+        path = argv[optind];
+    }
+
+    if(!host_partition_add(DSP_IMAGE_PARTITION_LABEL, 
+                           ESP_PARTITION_TYPE_DATA,
+                           DSP_IMAGE_PARTITION_SUBTYPE, 
+                           BENCH_PARTITION_SIZE) ||
+       !host_partition_load(DSP_IMAGE_PARTITION_LABEL, path))
+    {
+        fprintf(stderr, "Unable to load %s\n", path);
+        return 2;
+    }
+    for(int i = 0; i < DEVICE_SETTINGS_DSP_AMOUNT; i++)
+    {
+        if(!adau1701_sim_attach(&dsps[i], 
+                                benchConfigs[i].port, 
+                                benchConfigs[i].address, 
+                                benchConfigs[i].reset))
+        {
+            fprintf(stderr, "Unable to set up the simulated bus\n");
+            return 2;
+        }
+    }
+    if(!init_i2c_bus())
+    {
+        fprintf(stderr, "Unable to set up the simulated bus\n");
+        return 2;
+    }
+    for(int port = 0; port < SIM_I2C_PORT_AMOUNT; port++)
+    {
+        sim_i2c_set_clock(port, clock_hz);
+    }
+
+    printf("%d ADAU1701 on simulated buses at %lu Hz, image %s\n\n", 
+           DEVICE_SETTINGS_DSP_AMOUNT,
+           (unsigned long)clock_hz, 
+           path);
+    printf("%-10s %7s %8s %9s %9s %7s %6s\n",
+           "phase", "txn", "bytes", "bus_ms", "wall_ms", "words", "resets");
+
+    bench_begin(&phase);
+    bench_check(init_dsp_control(), "cold boot loads the DSP");
+    bench_end(&phase, "cold boot", 0);
+    bench_check(phase.dsp.resets == DEVICE_SETTINGS_DSP_AMOUNT, 
+                "cold boot resets every DSP");
+    bench_check(bench_running(), "cores run after the download");
+    bench_check(bench_program_matches(), "program RAM matches the image");
+
+    deinit_dsp_control();
+    bench_begin(&phase);
+    bench_check(init_dsp_control(), "warm boot finds the DSP");
+    bench_end(&phase, "warm boot", 0);
+    bench_check(phase.dsp.resets == 0 && phase.dsp.words_written == 0, 
+                "warm boot skips the download");
+
+    bench_begin(&phase);
+    bench_eq_writes(eqWrites);
+    bench_end(&phase, "eq writes", eqWrites);
+
+    bench_begin(&phase);
+    bench_check(dsp_control_switch_program(dsp_control_program()), 
+                "switch to the running program");
+    bench_end(&phase, "same prog", 0);
+    bench_check(phase.bus.transactions == 0, 
+                "switch to the running program is a no-op");
+
+    // One flipped bit in parameter RAM, the scrubber has to find it.
+    adau1701_sim_t *dsp = &dsps[DEVICE_SETTINGS_DSP_AMOUNT - 1];
+    uint8_t        word[SIGMA_DSP_PARAMETER_REGSIZE];
+    uint32_t       repairs = dsp_control_scrub_repairs();
+
+    adau1701_sim_peek(dsp, BENCH_FLIP_ADDR, sizeof(word), word);
+    word[3] ^= 0x01;
+    adau1701_sim_poke(dsp, BENCH_FLIP_ADDR, sizeof(word), word);
+
+    bench_begin(&phase);
+    for(int i = 0; i < BENCH_SCRUB_STEPS; i++)
+    {
+        dsp_control_scrub();
+    }
+    bench_end(&phase, "scrub", BENCH_SCRUB_STEPS);
+    bench_check(dsp_control_scrub_repairs() - repairs == 1, 
+                "scrubber repairs the flipped word only");
+    bench_check(bench_program_matches(), "program RAM still matches the image");
+
+    // One flipped bit in program RAM.
+    uint8_t instruction[SIGMA_DSP_PROGRAM_REGSIZE];
+
+    repairs = dsp_control_scrub_repairs();
+    adau1701_sim_peek(dsp, BENCH_FLIP_PROGRAM, sizeof(instruction), instruction);
+    instruction[4] ^= 0x01;
+    adau1701_sim_poke(dsp, BENCH_FLIP_PROGRAM, sizeof(instruction), instruction);
+
+    bench_begin(&phase);
+    for(int i = 0; i < BENCH_SCRUB_STEPS; i++)
+    {
+        dsp_control_scrub();
+    }
+    bench_end(&phase, "scrub prog", BENCH_SCRUB_STEPS);
+    bench_check(dsp_control_scrub_repairs() - repairs == 1, 
+                "scrubber repairs the flipped instruction only");
+    bench_check(bench_program_matches(), "program RAM matches the image again");
+    bench_check(bench_running(), "cores run after the repair");
+
+    printf("\n%s\n", failed ? "FAILED" : "OK");
+    return failed ? 1 : 0;
+}
+
+/******************************* THE END *********************************/
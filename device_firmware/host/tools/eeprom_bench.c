@@ -0,0 +1,363 @@
+/*
+ * eeprom_bench.c
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Runs the settings storage of the firmware against the 24LC128 model on a
+ * simulated bus. First every edit pattern is stored after each edit and 
+ * the cost per store is reported:
+ *
+ *  eq gain     The gain of one EQ, like a client dragging a slider.
+ *  eq sweep    One EQ after the other over all channels.
+ *  mux         The input select of the outputs.
+ *  preset      Every EQ at once.
+ *
+ * After that the power is cut during a random write cycle of random stores.
+ * A store only writes the pages that changed, so every store first runs
+ * on a copy of the EEPROM to count its write cycles.
+ * After every power loss the settings are loaded again, they have to be 
+ * the settings of the last store or of the interrupted one, nothing else.
+ * Exits with 1 when a check fails.
+ *
+ * Usage: eeprom_bench [-c clock_hz] [-n edits] [-l power_losses] [-s seed]
+ *
+ */
+/******************************* INCLUDES ********************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "host_port.h"
+#include "esp_timer.h"
+#include "sim_i2c.h"
+#include "eeprom24_sim.h"
+#include "device_settings.h"
+#include "i2c_bus.h"
+
+/******************************* DEFINES *********************************/
+
+#define BENCH_EEPROM_SIZE      16384   /* 24LC128 */
+#define BENCH_EDITS            50
+#define BENCH_POWER_LOSSES     200
+#define BENCH_SLOT_PAGES       (NV_STORAGE_SLOT_SIZE / EEPROM_PAGE_SIZE)
+#define BENCH_NV_SIZE          (NV_STORAGE_SLOT_AMOUNT * NV_STORAGE_SLOT_SIZE)
+
+#define BENCH_PATTERN_AMOUNT   4
+
+/******************************* TYPEDEFS ********************************/
+
+typedef void (*bench_edit_t)(uint32_t n);
+
+typedef struct
+{
+    const char   *name;
+    bench_edit_t edit;
+} bench_pattern_t;
+
+/******************************* GLOBAL VARIABLES ************************/
+
+static eeprom24_sim_t eeprom;
+static bool           failed = false;
+
+/******************************* LOCAL FUNCTIONS *************************/
+
+static void bench_check(bool ok, const char *what)
+{
+    if(!ok)
+    {
+        printf("FAIL: %s\n", what);
+        failed = true;
+    }
+}
+
+static equalizer_t* bench_eq(uint32_t n)
+{
+    device_settings_t *settings = get_device_settings_address();
+    uint32_t          inputEqs  = DEVICE_SETTINGS_INPUT_AMOUNT * 
+                                  DEVICE_SETTINGS_INPUT_EQ_AMOUNT;
+    uint32_t          outputEqs = DEVICE_SETTINGS_OUTPUT_AMOUNT * 
+                                  DEVICE_SETTINGS_OUTPUT_EQ_AMOUNT;
+
+    n %= inputEqs + outputEqs;
+    if(n < inputEqs)
+    {
+        return &settings->inputs[n / DEVICE_SETTINGS_INPUT_EQ_AMOUNT]
+                        .eq[n % DEVICE_SETTINGS_INPUT_EQ_AMOUNT];
+    }
+    n -= inputEqs;
+    return &settings->outputs[n / DEVICE_SETTINGS_OUTPUT_EQ_AMOUNT]
+                     .eq[n % DEVICE_SETTINGS_OUTPUT_EQ_AMOUNT];
+}
+
+static void bench_edit_gain(uint32_t n)
+{
+    bench_eq(0)->gain = (float)(n % 25) - 12;
+}
+
+static void bench_edit_sweep(uint32_t n)
+{
+    bench_eq(n)->freq = 100 + (n * 37) % 15000;
+}
+
+static void bench_edit_mux(uint32_t n)
+{
+    device_settings_t *settings = get_device_settings_address();
+
+    settings->outputs[n % DEVICE_SETTINGS_OUTPUT_AMOUNT].mux.index = 
+        (settings->outputs[n % DEVICE_SETTINGS_OUTPUT_AMOUNT].mux.index + 1) % 3;
+}
+
+static void bench_edit_preset(uint32_t n)
+{
+    for(uint32_t i = 0; ; i++)
+    {
+        equalizer_t *eq = bench_eq(i);
+
+        if(i > 0 && eq == bench_eq(0))
+        {
+            break;
+        }
+        eq->boost = (float)((n + i) % 13) - 6;
+        eq->q     = 0.5 + ((n + i) % 7) * 0.25;
+    }
+}
+
+static const bench_pattern_t patterns[BENCH_PATTERN_AMOUNT] = {
+    {"eq gain",  bench_edit_gain},
+    {"eq sweep", bench_edit_sweep},
+    {"mux",      bench_edit_mux},
+    {"preset",   bench_edit_preset},
+};
+
+static void bench_edit(const bench_pattern_t *pattern, uint32_t n)
+{
+    device_settings_write_begin();
+    pattern->edit(n);
+    device_settings_write_end();
+}
+
+static void bench_pattern(const bench_pattern_t *pattern, uint32_t edits)
+{
+    eeprom24_sim_stats_t stats;
+    sim_i2c_stats_t      bus;
+    uint32_t             wear;
+    int64_t              start;
+    int64_t              wall_us;
+    double               modeled_ms;
+
+    eeprom24_sim_clear_stats(&eeprom);
+    eeprom24_sim_clear_wear(&eeprom);
+    sim_i2c_clear_stats(NV_STORAGE_I2C_INTERFACE);
+    start = esp_timer_get_time();
+
+    for(uint32_t i = 0; i < edits; i++)
+    {
+        bench_edit(pattern, i);
+        bench_check(device_settings_store_nv() == NV_RW_SUCCESS, "store");
+    }
+
+    wall_us = esp_timer_get_time() - start;
+    eeprom24_sim_get_stats(&eeprom, &stats);
+    sim_i2c_get_stats(NV_STORAGE_I2C_INTERFACE, &bus);
+    wear = eeprom24_sim_max_wear(&eeprom, NULL);
+
+    // Time the store takes on the device: bus time and the write cycles.
+    modeled_ms = (bus.bus_ns / 1e6 + 
+                  (double)stats.write_cycles * eeprom.write_cycle_us / 1e3) / edits;
+
+    printf("%-9s %6lu %7.2f %8.1f %8.2f %8.2f %6lu\n",
+           pattern->name,
+           (unsigned long)edits,
+           (double)stats.write_cycles / edits,
+           (double)stats.bytes_programmed / edits,
+           modeled_ms,
+           wall_us / 1e3 / edits,
+           (unsigned long)wear);
+
+    bench_check(stats.protocol_errors == 0, "no protocol errors");
+    bench_check(stats.write_cycles <= (uint64_t)edits * BENCH_SLOT_PAGES, 
+                "at most one slot per store");
+}
+
+/* Function: bench_store_cycles
+ *
+ * Write cycles the next store takes. The store runs and the EEPROM is put
+ * back afterwards, the storage scans it again on the load. The settings 
+ * in RAM are restored too, the load replaced them.
+ */
+static uint32_t bench_store_cycles(void)
+{
+    static uint8_t       nv[BENCH_NV_SIZE];
+    device_settings_t    settings;
+    eeprom24_sim_stats_t stats;
+
+    memcpy(&settings, get_device_settings_address(), sizeof(settings));
+    eeprom24_sim_peek(&eeprom, NV_STORAGE_SETTINGS_ADDRESS, sizeof(nv), nv);
+
+    eeprom24_sim_clear_stats(&eeprom);
+    device_settings_store_nv();
+    eeprom24_sim_get_stats(&eeprom, &stats);
+
+    eeprom24_sim_poke(&eeprom, NV_STORAGE_SETTINGS_ADDRESS, sizeof(nv), nv);
+    device_settings_load_nv();
+    device_settings_write_begin();
+    memcpy(get_device_settings_address(), &settings, sizeof(settings));
+    device_settings_write_end();
+    return stats.write_cycles;
+}
+
+/* Function: bench_power_loss
+ *
+ * Cuts the power during a random write cycle of a store and boots again.
+ * The loaded settings have to be either the committed ones or the 
+ * attempted ones. A store without write cycles has nothing to cut, its
+ * settings have to be loaded.
+ */
+static void bench_power_loss(uint32_t losses, uint32_t seed)
+{
+    device_settings_t committed;
+    device_settings_t attempted;
+    uint32_t          newer = 0;
+    uint32_t          older = 0;
+    uint32_t          missed = 0;
+
+    srand(seed);
+    memcpy(&committed, get_device_settings_address(), sizeof(committed));
+
+    for(uint32_t i = 0; i < losses && !failed; i++)
+    {
+        eeprom24_sim_stats_t stats;
+        uint32_t             cycles;
+
+        bench_edit(&patterns[rand() % BENCH_PATTERN_AMOUNT], rand());
+        memcpy(&attempted, get_device_settings_address(), sizeof(attempted));
+
+        cycles = bench_store_cycles();
+        eeprom24_sim_clear_stats(&eeprom);
+        eeprom24_sim_power_loss(&eeprom, 
+                                cycles ? rand() % cycles : EEPROM24_SIM_NO_LOSS, 
+                                rand());
+        device_settings_store_nv();
+        eeprom24_sim_power_loss(&eeprom, EEPROM24_SIM_NO_LOSS, 0);
+        eeprom24_sim_get_stats(&eeprom, &stats);
+
+        // Reboot, the RAM copy is gone.
+        eeprom24_sim_power_on(&eeprom);
+        memset(get_device_settings_address(), 0xA5, sizeof(device_settings_t));
+        if(device_settings_load_nv() != NV_RW_SUCCESS)
+        {
+            bench_check(false, "settings load after a power loss");
+            break;
+        }
+
+        if(memcmp(get_device_settings_address(), &attempted, sizeof(attempted)) == 0)
+        {
+            memcpy(&committed, &attempted, sizeof(committed));
+            newer++;
+            if(stats.power_losses == 0)
+            {
+                bench_check(cycles == 0, "power loss during a write cycle");
+                missed++;
+            }
+        }
+        else if(memcmp(get_device_settings_address(), &committed, sizeof(committed)) == 0)
+        {
+            bench_check(stats.power_losses > 0, "store without power loss lands");
+            older++;
+        }
+        else
+        {
+            bench_check(false, "settings are the committed or the attempted ones");
+        }
+    }
+
+    printf("\npower losses: %lu, new settings %lu (%lu without writes), "
+           "old settings %lu, corrupt %lu\n",
+           (unsigned long)losses,
+           (unsigned long)newer,
+           (unsigned long)missed,
+           (unsigned long)older,
+           (unsigned long)(losses - newer - older));
+}
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+int main(int argc, char **argv)
+{
+    uint32_t clock_hz = 400000;
+    uint32_t edits    = BENCH_EDITS;
+    uint32_t losses   = BENCH_POWER_LOSSES;
+    uint32_t seed     = 1;
+    int      opt;
+
+    while((opt = getopt(argc, argv, "c:n:l:s:")) != -1)
+    {
+        switch(opt)
+        {
+            case 'c':
+                clock_hz = strtoul(optarg, NULL, 0);
+                break;
+            case 'n':
+                edits = strtoul(optarg, NULL, 0);
+                break;
+            case 'l':
+                losses = strtoul(optarg, NULL, 0);
+                break;
+            case 's':
+                seed = strtoul(optarg, NULL, 0);
+                break;
+            default:
+                fprintf(stderr, 
+                        "usage: %s [-c clock_hz] [-n edits] [-l power_losses] [-s seed]\n", 
+                        argv[0]);
+                return 2;
+        }
+    }
+    if(edits == 0)
+    {
+        edits = 1;
+    }
+
+    if(!eeprom24_sim_attach(&eeprom, 
+                            NV_STORAGE_I2C_INTERFACE, 
+                            NV_STORAGE_I2C_ADDRESS,
+                            BENCH_EEPROM_SIZE,
+                            EEPROM_PAGE_SIZE,
+                            EEPROM24_SIM_WRITE_CYCLE_US) ||
+       !init_i2c_bus() ||
+       !init_device_settings() ||
+       !device_settings_load_factory())
+    {
+        fprintf(stderr, "Unable to set up the simulated bus\n");
+        return 2;
+    }
+    sim_i2c_set_clock(NV_STORAGE_I2C_INTERFACE, clock_hz);
+
+    printf("24LC128 on a simulated bus at %lu Hz, settings %d bytes, "
+           "slot %d bytes (%d pages)\n\n",
+           (unsigned long)clock_hz,
+           (int)sizeof(device_settings_t),
+           (int)NV_STORAGE_SLOT_SIZE,
+           (int)BENCH_SLOT_PAGES);
+
+    bench_check(device_settings_load_nv() == NV_RW_FAILED, 
+                "erased EEPROM has no settings");
+    bench_check(device_settings_store_nv() == NV_RW_SUCCESS, "first store");
+    bench_check(device_settings_store_nv() == NV_RW_SUCCESS, "second store");
+
+    printf("%-9s %6s %7s %8s %8s %8s %6s\n",
+           "pattern", "stores", "cycles", "bytes", "ms", "wall_ms", "wear");
+    for(int i = 0; i < BENCH_PATTERN_AMOUNT; i++)
+    {
+        bench_pattern(&patterns[i], edits);
+    }
+
+    bench_power_loss(losses, seed);
+
+    printf("\n%s\n", failed ? "FAILED" : "OK");
+    return failed ? 1 : 0;
+}
+
+/******************************* THE END *********************************/
@@ -0,0 +1,693 @@
+/*
+ * pipeline_bench.c
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Runs the whole firmware like app_main starts it: the DSP, settings and
+ * interfaces tasks with the real BLE service on top of the NimBLE
+ * stand-in, an ADAU1701 per line of DSP_CONTROL_CONFIGS and the EEPROM
+ * on simulated buses. Clients
+ * connect and go through the command pipeline end to end, from the GATT
+ * write to the coefficients on the DSP:
+ *
+ *  boot        From starting the tasks until the settings are pushed and
+ *              the unit advertises.
+ *  writes      Every client selects its own output band and writes the
+ *              gain, all clients at the same time. The clients take the 
+ *              DSPs in turn.
+ *  reads       Settings blob reads of every client.
+ *  curves      EQ curve reads of every client, with the phase at the
+ *              most points. Only the first read of a channel and the
+ *              first after a band of it changed evaluate the cascade.
+ *
+ * Reports throughput, latency percentiles and the I2C traffic per
+ * command. Checks the written gains arrived in the settings and over the
+ * GATT read, the DSP saw no protocol errors and the curves match a double
+ * precision design of the bands. Exits with 1 when a check fails.
+ *
+ * The buses run in realtime by default, so the latencies include the
+ * time on the wire. -f runs them as fast as possible. -o captures the
+ * commands of the session to a trace for replay_bench.
+ *
+ * Usage: pipeline_bench [-c clients] [-n writes] [-k clock_hz] [-f]
+ *                       [-o trace] [image.bin]
+ *
+ */
+/******************************* INCLUDES ********************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "host_port.h"
+#include "sim_i2c.h"
+#include "adau1701_sim.h"
+#include "eeprom24_sim.h"
+#include "gatt_sim.h"
+#include "dsp_control.h"
+#include "dsp_image.h"
+#include "device_settings.h"
+#include "event.h"
+#include "telemetry.h"
+#include "trace.h"
+#include "boot_profile.h"
+#include "i2c_bus.h"
+#include "eq_curve.h"
+#include "coeff_bench.h"
+#include "capture.h"
+
+/******************************* DEFINES *********************************/
+
+#define BENCH_PARTITION_SIZE  0x20000
+#define BENCH_CAPTURE_SIZE    0xC0000   /* As in partitions.csv */
+#define BENCH_EEPROM_SIZE     16384   /* 24LC128 */
+#define BENCH_WRITES          100
+#define BENCH_READS           20
+#define BENCH_BOOT_TIMEOUT_MS 10000
+// Float curve against the double precision design, where it is above
+// the floor.
+#define BENCH_CURVE_MAX_DB    0.05
+
+// Characteristics of the EasyDSP service, see gatt_svcs in ble.c.
+#define BENCH_UUID_CHAN_INDEX 0x0002
+#define BENCH_UUID_IS_OUTPUT  0x0003
+#define BENCH_UUID_EQ_INDEX   0x0004
+#define BENCH_UUID_BOOST      0x0009
+#define BENCH_UUID_GAIN       0x000B
+#define BENCH_UUID_STATE      0x000E
+#define BENCH_UUID_SETTINGS   0x0012
+#define BENCH_UUID_EQ_CURVE   0x0016
+
+/******************************* TYPEDEFS ********************************/
+
+typedef struct
+{
+    uint16_t          conn_handle;
+    uint8_t           channel;
+    uint8_t           eq;
+    uint32_t          writes;
+
+    int32_t           last_gain;
+    uint32_t          failures;
+    int64_t           *latency_us;
+    SemaphoreHandle_t finished;
+} bench_client_t;
+
+/******************************* GLOBAL VARIABLES ************************/
+
+static const dsp_control_config_t benchConfigs[] = {DSP_CONTROL_CONFIGS};
+static adau1701_sim_t             dsps[DEVICE_SETTINGS_DSP_AMOUNT];
+static eeprom24_sim_t             eeprom;
+static bool                       failed = false;
+
+// What app_main passes to the tasks.
+static settings_task_communications_t settingsQueues;
+
+/******************************* TASK FUNCTIONS **************************/
+
+void settings_task(void* pvParameters);
+void dsp_task(void* pvParameters);
+void task_interfaces(void* pvParameters);
+
+/******************************* LOCAL FUNCTIONS *************************/
+
+static void bench_check(bool ok, const char *what)
+{
+    if(!ok)
+    {
+        printf("FAIL: %s\n", what);
+        failed = true;
+    }
+}
+
+static int bench_compare(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t*)a;
+    int64_t y = *(const int64_t*)b;
+
+    return (x > y) - (x < y);
+}
+
+// Sorts the latencies and prints the percentiles in ms.
+static void bench_latency(const char *name, int64_t *latency_us, uint32_t amount,
+                          int64_t wall_us)
+{
+    if(amount == 0)
+    {
+        return;
+    }
+    qsort(latency_us, amount, sizeof(int64_t), bench_compare);
+    printf("%-8s %6lu %9.1f %8.2f %8.2f %8.2f %8.2f\n",
+           name,
+           (unsigned long)amount,
+           amount * 1e6 / wall_us,
+           latency_us[amount / 2] / 1e3,
+           latency_us[(amount * 90) / 100] / 1e3,
+           latency_us[(amount * 99) / 100] / 1e3,
+           latency_us[amount - 1] / 1e3);
+}
+
+static bool bench_write_u8(uint16_t conn_handle, uint16_t uuid, uint8_t value)
+{
+    return gatt_sim_write(conn_handle, uuid, &value, sizeof(value)) == 0;
+}
+
+// Starts the tasks the way app_main does, without the CLI.
+static void bench_start_firmware(void)
+{
+    settingsQueues.settings_dsp = dsp_communication_create();
+    for(int i = 0; i < SETTINGS_INTERFACE_AMOUNT; i++)
+    {
+        settingsQueues.settings_interfaces[i] = dsp_communication_create();
+    }
+    init_telemetry();
+    init_capture();
+
+    xTaskCreatePinnedToCore(dsp_task,
+                            "DSP_handler",
+                            4096,
+                            (void*)settingsQueues.settings_dsp,
+                            2,
+                            NULL,
+                            tskNO_AFFINITY);
+    xTaskCreatePinnedToCore(task_interfaces,
+                            "Interfaces",
+                            4096,
+                            (void*)settingsQueues.settings_interfaces,
+                            2,
+                            NULL,
+                            tskNO_AFFINITY);
+    xTaskCreatePinnedToCore(settings_task,
+                            "Settings_handler",
+                            4096,
+                            (void*)&settingsQueues,
+                            2,
+                            NULL,
+                            tskNO_AFFINITY);
+}
+
+static bool bench_wait_boot(void)
+{
+    TickType_t start = xTaskGetTickCount();
+
+    while(!boot_profile_done())
+    {
+        if(xTaskGetTickCount() - start > pdMS_TO_TICKS(BENCH_BOOT_TIMEOUT_MS))
+        {
+            return false;
+        }
+        vTaskDelay(1);
+    }
+    return gatt_sim_wait_sync(BENCH_BOOT_TIMEOUT_MS);
+}
+
+// Connects and selects the band of the client, like the app does.
+static bool bench_client_select(bench_client_t *client)
+{
+    return gatt_sim_connect(client->conn_handle) &&
+           bench_write_u8(client->conn_handle, BENCH_UUID_IS_OUTPUT, 1) &&
+           bench_write_u8(client->conn_handle, BENCH_UUID_CHAN_INDEX,
+                          client->channel) &&
+           bench_write_u8(client->conn_handle, BENCH_UUID_EQ_INDEX,
+                          client->eq);
+}
+
+// Gain writes of one client, in hundredths of a dB like the app sends them.
+static void bench_client_task(void *pvParameters)
+{
+    bench_client_t *client = (bench_client_t*)pvParameters;
+
+    for(uint32_t i = 0; i < client->writes; i++)
+    {
+        int32_t gain  = (int32_t)((i + client->channel) % 25) * 50 - 600;
+        int64_t start = esp_timer_get_time();
+
+        if(gatt_sim_write(client->conn_handle,
+                          BENCH_UUID_GAIN,
+                          &gain,
+                          sizeof(gain)) == 0)
+        {
+            client->last_gain = gain;
+        }
+        else
+        {
+            client->failures++;
+        }
+        client->latency_us[i] = esp_timer_get_time() - start;
+    }
+    xSemaphoreGive(client->finished);
+    vTaskDelete(NULL);
+}
+
+// Largest difference of a curve record to the bands of the channel
+// designed in double precision, in dB.
+static double bench_curve_error(const uint8_t *record, uint8_t channel)
+{
+    uint8_t points = record[7];
+    double  error  = 0;
+
+    for(int i = 0; i < points; i++)
+    {
+        double freq     = EQ_CURVE_FREQ_MIN *
+                          pow((double)EQ_CURVE_FREQ_MAX / EQ_CURVE_FREQ_MIN,
+                              (double)i / (points - 1));
+        double w        = 2 * M_PI * freq / ADA_SAMPLE_FREQ;
+        double expected = 0;
+
+        for(int j = 0; j < DEVICE_SETTINGS_OUTPUT_EQ_AMOUNT; j++)
+        {
+            equalizer_t eq;
+            double      c[ADA_COEFFICIENT_AMOUNT];
+
+            if(!device_settings_read_eq(true, channel, j, &eq) ||
+               eq.state != STATE_ON)
+            {
+                continue;
+            }
+            coeff_bench_reference(&eq, c);
+
+            double numReal = c[0] + c[1] * cos(w) + c[2] * cos(2 * w);
+            double numImag = -c[1] * sin(w) - c[2] * sin(2 * w);
+            double denReal = 1 - c[3] * cos(w) - c[4] * cos(2 * w);
+            double denImag = c[3] * sin(w) + c[4] * sin(2 * w);
+
+            expected += 10 * log10((numReal * numReal + numImag * numImag) /
+                                   (denReal * denReal + denImag * denImag));
+        }
+
+        const uint8_t *value = &record[EQ_CURVE_RECORD_HEADER + i * 2];
+        double        actual = (int16_t)(value[0] | value[1] << 8) / 100.0;
+
+        if(expected > EQ_CURVE_FLOOR_DB + 20)
+        {
+            error = fmax(error, fabs(actual - expected));
+        }
+    }
+    return error;
+}
+
+static void bench_print_bus(uint8_t port, uint32_t items)
+{
+    const char      *name = port == NV_STORAGE_I2C_INTERFACE ? "eeprom" : "dsp";
+    sim_i2c_stats_t bus;
+
+    for(int i = 0; i < DEVICE_SETTINGS_DSP_AMOUNT; i++)
+    {
+        if(benchConfigs[i].port == port && port == NV_STORAGE_I2C_INTERFACE)
+        {
+            name = "dsp+nv";
+        }
+    }
+
+    sim_i2c_get_stats(port, &bus);
+    if(bus.transactions == 0)
+    {
+        return;
+    }
+    printf("%-8s %7lu txn %8lu bytes %9.2f bus_ms",
+           name,
+           (unsigned long)bus.transactions,
+           (unsigned long)bus.bytes,
+           bus.bus_ns / 1e6);
+    if(items > 0)
+    {
+        printf("   %.1f txn, %.1f bytes per command",
+               (double)bus.transactions / items,
+               (double)bus.bytes / items);
+    }
+    printf("\n");
+}
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+int main(int argc, char **argv)
+{
+    const char       *path     = DSP_IMAGES_BIN;
+    const char       *output   = NULL;
+    uint32_t         clock_hz  = I2C_MASTER_FREQ_HZ;
+    uint32_t         writes    = BENCH_WRITES;
+    uint8_t          amount    = SETTINGS_INTERFACE_AMOUNT;
+    bool             realtime  = true;
+    bench_client_t   clients[SETTINGS_INTERFACE_AMOUNT];
+    int64_t          *latency;
+    int64_t          start;
+    int64_t          wall_us;
+    uint32_t         total;
+    sim_i2c_stats_t  bus;
+    adau1701_sim_stats_t dspStats[DEVICE_SETTINGS_DSP_AMOUNT];
+    gatt_sim_stats_t gatt;
+    int              opt;
+
+    while((opt = getopt(argc, argv, "c:n:k:fo:")) != -1)
+    {
+        switch(opt)
+        {
+            case 'c':
+                amount = strtoul(optarg, NULL, 0);
+                break;
+            case 'n':
+                writes = strtoul(optarg, NULL, 0);
+                break;
+            case 'k':
+                clock_hz = strtoul(optarg, NULL, 0);
+                break;
+            case 'f':
+                realtime = false;
+                break;
+            case 'o':
+                output = optarg;
+                break;
+            default:
+                fprintf(stderr,
+                        "usage: %s [-c clients] [-n writes] [-k clock_hz] [-f] "
+                        "[-o trace] [image.bin]\n",
+                        argv[0]);
+                return 2;
+        }
+    }
+    if(optind < argc)
+    {
+        path = argv[optind];
+    }
+    if(amount < 1 || amount > SETTINGS_INTERFACE_AMOUNT ||
+       amount > DEVICE_SETTINGS_OUTPUT_AMOUNT || writes == 0)
+    {
+        fprintf(stderr, "Use 1 to %d clients and at least one write\n",
+                SETTINGS_INTERFACE_AMOUNT);
+        return 2;
+    }
+
+    if(!host_partition_add(DSP_IMAGE_PARTITION_LABEL,
+                           ESP_PARTITION_TYPE_DATA,
+                           DSP_IMAGE_PARTITION_SUBTYPE,
+                           BENCH_PARTITION_SIZE) ||
+       !host_partition_load(DSP_IMAGE_PARTITION_LABEL, path) ||
+       !host_partition_add(CAPTURE_PARTITION_LABEL,
+                           ESP_PARTITION_TYPE_DATA,
+                           CAPTURE_PARTITION_SUBTYPE,
+                           BENCH_CAPTURE_SIZE))
+    {
+        fprintf(stderr, "Unable to load %s\n", path);
+        return 2;
+    }
+    for(int i = 0; i < DEVICE_SETTINGS_DSP_AMOUNT; i++)
+    {
+        if(!adau1701_sim_attach(&dsps[i],
+                                benchConfigs[i].port,
+                                benchConfigs[i].address,
+                                benchConfigs[i].reset))
+        {
+            fprintf(stderr, "Unable to set up the simulated buses\n");
+            return 2;
+        }
+    }
+    if(!eeprom24_sim_attach(&eeprom,
+                            NV_STORAGE_I2C_INTERFACE,
+                            NV_STORAGE_I2C_ADDRESS,
+                            BENCH_EEPROM_SIZE,
+                            EEPROM_PAGE_SIZE,
+                            EEPROM24_SIM_WRITE_CYCLE_US) ||
+       !init_i2c_bus())
+    {
+        fprintf(stderr, "Unable to set up the simulated buses\n");
+        return 2;
+    }
+    for(int i = 0; i < SIM_I2C_PORT_AMOUNT; i++)
+    {
+        sim_i2c_set_clock(i, clock_hz);
+        sim_i2c_set_realtime(i, realtime);
+    }
+
+    printf("Firmware pipeline, %d DSPs, %u clients x %lu writes, "
+           "buses at %lu Hz%s\n\n",
+           DEVICE_SETTINGS_DSP_AMOUNT,
+           amount,
+           (unsigned long)writes,
+           (unsigned long)clock_hz,
+           realtime ? "" : " (not realtime)");
+
+    start = esp_timer_get_time();
+    bench_start_firmware();
+    bench_check(bench_wait_boot(), "firmware boots and advertises");
+    printf("boot %.2f ms\n\n", (esp_timer_get_time() - start) / 1e3);
+    if(failed)
+    {
+        printf("\nFAILED\n");
+        return 1;
+    }
+
+    latency = calloc((size_t)amount * writes, sizeof(int64_t));
+    if(latency == NULL)
+    {
+        return 2;
+    }
+    if(output != NULL)
+    {
+        bench_check(capture_start(), "capture starts");
+    }
+    for(int i = 0; i < amount; i++)
+    {
+        clients[i] = (bench_client_t){
+            .conn_handle = i + 1,
+            .channel     = (i % DEVICE_SETTINGS_DSP_AMOUNT) *
+                               DEVICE_SETTINGS_DSP_OUTPUT_AMOUNT +
+                           i / DEVICE_SETTINGS_DSP_AMOUNT,
+            .eq          = i % DEVICE_SETTINGS_OUTPUT_EQ_AMOUNT,
+            .writes      = writes,
+            .latency_us  = &latency[i * writes],
+            .finished    = xSemaphoreCreateBinary(),
+        };
+        bench_check(bench_client_select(&clients[i]), "client connects and selects");
+        // Every connection stops the advertising, the firmware restarts it
+        // while there is room for another client.
+        bench_check(i + 1 == amount || gatt_sim_wait_sync(BENCH_BOOT_TIMEOUT_MS),
+                    "advertising again after a connect");
+    }
+
+    // All clients write at the same time.
+    for(int i = 0; i < SIM_I2C_PORT_AMOUNT; i++)
+    {
+        sim_i2c_clear_stats(i);
+    }
+    for(int i = 0; i < DEVICE_SETTINGS_DSP_AMOUNT; i++)
+    {
+        adau1701_sim_clear_stats(&dsps[i]);
+    }
+    gatt_sim_clear_stats();
+    trace_clear();
+
+    start = esp_timer_get_time();
+    for(int i = 0; i < amount; i++)
+    {
+        xTaskCreate(bench_client_task, "bench_client", 4096, &clients[i], 3, NULL);
+    }
+    for(int i = 0; i < amount; i++)
+    {
+        xSemaphoreTake(clients[i].finished, portMAX_DELAY);
+    }
+    wall_us = esp_timer_get_time() - start;
+    total   = amount * writes;
+
+    printf("%-8s %6s %9s %8s %8s %8s %8s\n",
+           "phase", "ops", "ops/s", "p50_ms", "p90_ms", "p99_ms", "max_ms");
+    bench_latency("writes", latency, total, wall_us);
+
+    for(int i = 0; i < DEVICE_SETTINGS_DSP_AMOUNT; i++)
+    {
+        adau1701_sim_get_stats(&dsps[i], &dspStats[i]);
+    }
+    gatt_sim_get_stats(&gatt);
+    printf("\n");
+    for(int i = 0; i < SIM_I2C_PORT_AMOUNT; i++)
+    {
+        bench_print_bus(i, total);
+    }
+    printf("gatt     %7lu writes %7lu bytes %6lu pdus %6lu errors\n\n",
+           (unsigned long)gatt.writes,
+           (unsigned long)gatt.write_bytes,
+           (unsigned long)gatt.att_pdus,
+           (unsigned long)gatt.att_errors);
+
+    bench_check(gatt.att_errors == 0, "no ATT errors");
+    for(int i = 0; i < DEVICE_SETTINGS_DSP_AMOUNT; i++)
+    {
+        bench_check(dspStats[i].protocol_errors == 0, "no DSP protocol errors");
+        bench_check(dspStats[i].running_program_writes == 0,
+                    "no program writes while the core runs");
+        bench_check(i >= amount || dspStats[i].words_written > 0,
+                    "the gains reach the DSP of the client");
+
+        // The EEPROM NACKs while it writes, only a bus of DSPs alone has
+        // to be clean.
+        sim_i2c_get_stats(benchConfigs[i].port, &bus);
+        bench_check(benchConfigs[i].port == NV_STORAGE_I2C_INTERFACE || 
+                    bus.nacks == 0, 
+                    "no NACKs from the DSP");
+    }
+
+    // The last gain of every client has to be everywhere.
+    for(int i = 0; i < amount; i++)
+    {
+        equalizer_t eq;
+        int32_t     gain = 0;
+        uint16_t    len  = sizeof(gain);
+
+        bench_check(clients[i].failures == 0, "every write is accepted");
+        bench_check(gatt_sim_read(clients[i].conn_handle,
+                                  BENCH_UUID_GAIN,
+                                  &gain,
+                                  &len) == 0 &&
+                    len == sizeof(gain) &&
+                    gain == clients[i].last_gain,
+                    "gain reads back over GATT");
+        bench_check(device_settings_read_eq(true,
+                                            clients[i].channel,
+                                            clients[i].eq,
+                                            &eq) &&
+                    (int32_t)(eq.gain * 100 + (eq.gain < 0 ? -0.5f : 0.5f)) ==
+                        clients[i].last_gain,
+                    "gain arrives in the settings");
+    }
+
+    // Reads of the settings blob, the largest characteristic.
+    static uint8_t blob[BLE_ATT_ATTR_MAX_LEN];
+
+    total = 0;
+    start = esp_timer_get_time();
+    for(int r = 0; r < BENCH_READS; r++)
+    {
+        for(int i = 0; i < amount; i++)
+        {
+            int64_t  begin = esp_timer_get_time();
+            uint16_t len   = sizeof(blob);
+
+            bench_check(gatt_sim_read(clients[i].conn_handle,
+                                      BENCH_UUID_SETTINGS,
+                                      blob,
+                                      &len) == 0 && len > 0,
+                        "settings blob reads");
+            latency[total++] = esp_timer_get_time() - begin;
+        }
+    }
+    bench_latency("reads", latency, total, esp_timer_get_time() - start);
+
+    // Curve reads, the first of every channel evaluates it. The band of
+    // every client is turned on as a peak first, so the curves differ.
+    static uint8_t   curve[BLE_ATT_ATTR_MAX_LEN];
+    eq_curve_stats_t before;
+    eq_curve_stats_t after;
+    uint8_t          request[2] = {EQ_CURVE_POINTS_MAX, EQ_CURVE_FLAG_PHASE};
+    uint16_t         curveLen   = EQ_CURVE_RECORD_HEADER +
+                                  EQ_CURVE_POINTS_MAX * 2 * sizeof(int16_t);
+    double           curveError = 0;
+
+    // The old one byte format is refused, not taken as another value.
+    uint8_t shortBoost = 6;
+    bench_check(gatt_sim_write(clients[0].conn_handle, BENCH_UUID_BOOST,
+                               &shortBoost, sizeof(shortBoost)) == 
+                BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN,
+                "float write of the wrong length is refused");
+
+    total = 0;
+    for(int i = 0; i < amount; i++)
+    {
+        int32_t boost = 600 + i * 300;
+
+        bench_check(gatt_sim_write(clients[i].conn_handle, BENCH_UUID_BOOST,
+                                   &boost, sizeof(boost)) == 0 &&
+                    bench_write_u8(clients[i].conn_handle, BENCH_UUID_STATE,
+                                   STATE_ON),
+                    "band is turned on");
+        bench_check(gatt_sim_write(clients[i].conn_handle,
+                                   BENCH_UUID_EQ_CURVE,
+                                   request,
+                                   sizeof(request)) == 0,
+                    "curve request is accepted");
+    }
+    eq_curve_get_stats(&before);
+    start = esp_timer_get_time();
+    for(int r = 0; r < BENCH_READS; r++)
+    {
+        for(int i = 0; i < amount; i++)
+        {
+            int64_t  begin = esp_timer_get_time();
+            uint16_t len   = sizeof(curve);
+
+            bench_check(gatt_sim_read(clients[i].conn_handle,
+                                      BENCH_UUID_EQ_CURVE,
+                                      curve,
+                                      &len) == 0 &&
+                        len == curveLen &&
+                        curve[0] == EQ_CURVE_RECORD_FORMAT &&
+                        curve[5] == 1 &&
+                        curve[6] == clients[i].channel,
+                        "curve reads");
+            latency[total++] = esp_timer_get_time() - begin;
+            if(r == 0)
+            {
+                curveError = fmax(curveError,
+                                  bench_curve_error(curve, clients[i].channel));
+            }
+        }
+    }
+    bench_latency("curves", latency, total, esp_timer_get_time() - start);
+    eq_curve_get_stats(&after);
+    bench_check(after.computed - before.computed == amount,
+                "one curve evaluation per channel");
+    bench_check(curveError < BENCH_CURVE_MAX_DB, "curve matches the design");
+
+    // A band of the first channel changes, only that curve is evaluated.
+    int32_t  gain = clients[0].last_gain + 100;
+    uint16_t len  = sizeof(curve);
+
+    bench_check(gatt_sim_write(clients[0].conn_handle, BENCH_UUID_GAIN,
+                               &gain, sizeof(gain)) == 0,
+                "gain write is accepted");
+    for(int i = 0; i < amount; i++)
+    {
+        len = sizeof(curve);
+        bench_check(gatt_sim_read(clients[i].conn_handle, BENCH_UUID_EQ_CURVE,
+                                  curve, &len) == 0 && len == curveLen,
+                    "curve reads after a change");
+    }
+    eq_curve_get_stats(&before);
+    bench_check(before.computed - after.computed == 1,
+                "only the changed channel is evaluated again");
+    printf("curve    %.1f us per evaluation, %.3f dB from the design\n",
+           (double)before.compute_us, curveError);
+    free(latency);
+
+    if(output != NULL)
+    {
+        capture_stats_t captured;
+
+        bench_check(capture_stop(), "capture stops");
+        capture_get_stats(&captured);
+        bench_check(captured.dropped == 0, "no commands dropped");
+        bench_check(host_partition_save(CAPTURE_PARTITION_LABEL, output,
+                                        captured.bytes),
+                    "trace is saved");
+        printf("capture  %lu commands, %lu bytes to %s\n",
+               (unsigned long)captured.records,
+               (unsigned long)captured.bytes,
+               output);
+    }
+
+    for(int i = 0; i < amount; i++)
+    {
+        bench_check(gatt_sim_disconnect(clients[i].conn_handle,
+                                        BLE_ERR_REM_USER_CONN_TERM),
+                    "client disconnects");
+    }
+
+    printf("\n");
+    trace_print_histograms();
+    telemetry_sample();
+    telemetry_print();
+
+    printf("\n%s\n", failed ? "FAILED" : "OK");
+    return failed ? 1 : 0;
+}
+
+/******************************* THE END *********************************/
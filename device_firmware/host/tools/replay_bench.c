@@ -0,0 +1,532 @@
+/*
+ * replay_bench.c
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Replays a command trace (see main/capture.h) against the firmware on
+ * the host, with the ADAU1701 and the EEPROM on simulated buses. Every
+ * interface of the trace gets a player that sends its commands into the
+ * settings task at the time they were captured, so a session recorded on
+ * a unit becomes a repeatable benchmark.
+ *
+ * Reports the throughput, latency percentiles from sending a command
+ * until the settings task answers, how late the players fell behind the
+ * trace and the I2C traffic per command. Exits with 1 when a command
+ * isn't answered or the DSP saw protocol errors.
+ *
+ * Pauses in the trace are cut to -g ms. -s scales the time, 2 replays
+ * twice as fast, 0 sends every command as soon as the previous one of
+ * its interface is answered. The buses run in realtime unless -f.
+ *
+ * Traces come from 'capture dump' on the CLI of a unit, through
+ * `xxd -r -p`, or from pipeline_bench -o.
+ *
+ * Usage: replay_bench [-s speed] [-g gap_ms] [-k clock_hz] [-f] trace
+ *                     [image.bin]
+ *
+ */
+/******************************* INCLUDES ********************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "host_port.h"
+#include "sim_i2c.h"
+#include "adau1701_sim.h"
+#include "eeprom24_sim.h"
+#include "dsp_control.h"
+#include "dsp_image.h"
+#include "device_settings.h"
+#include "event.h"
+#include "capture.h"
+#include "boot_profile.h"
+#include "i2c_bus.h"
+
+/******************************* DEFINES *********************************/
+
+#define BENCH_PARTITION_SIZE  0x20000
+#define BENCH_EEPROM_SIZE     16384   /* 24LC128 */
+#define BENCH_BOOT_TIMEOUT_MS 10000
+#define BENCH_MAX_GAP_MS      1000
+#define BENCH_TRACE_MAX       0xC0000 /* The capture partition */
+#define BENCH_TYPE_AMOUNT     (DSP_SET_PRESET + 1)
+
+/******************************* TYPEDEFS ********************************/
+
+typedef struct
+{
+    uint8_t           interface;
+    uint32_t          amount;
+    capture_event_t   *events;
+    int64_t           *due_us;       /* From the start of the replay    */
+    int64_t           *latency_us;
+
+    int64_t           start_us;
+    int64_t           max_lag_us;
+    uint32_t          failures;      /* Not answered                    */
+    uint32_t          errors;        /* Answered with an error          */
+    SemaphoreHandle_t finished;
+} bench_player_t;
+
+/******************************* GLOBAL VARIABLES ************************/
+
+static const char *typeNames[BENCH_TYPE_AMOUNT] = {
+    "set_eq", "set_mux", "set_gain", "get_eq", "get_mux", "get_gain", "preset"
+};
+
+static adau1701_sim_t dsp;
+static eeprom24_sim_t eeprom;
+static bool           failed = false;
+
+// What app_main passes to the tasks.
+static settings_task_communications_t settingsQueues;
+
+/******************************* TASK FUNCTIONS **************************/
+
+void settings_task(void* pvParameters);
+void dsp_task(void* pvParameters);
+void task_interfaces(void* pvParameters);
+
+/******************************* LOCAL FUNCTIONS *************************/
+
+static void bench_check(bool ok, const char *what)
+{
+    if(!ok)
+    {
+        printf("FAIL: %s\n", what);
+        failed = true;
+    }
+}
+
+static int bench_compare(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t*)a;
+    int64_t y = *(const int64_t*)b;
+
+    return (x > y) - (x < y);
+}
+
+static uint8_t* bench_read_file(const char *path, uint32_t *len)
+{
+    FILE    *file = fopen(path, "rb");
+    uint8_t *data = malloc(BENCH_TRACE_MAX);
+
+    if(file == NULL || data == NULL)
+    {
+        if(file != NULL)
+        {
+            fclose(file);
+        }
+        free(data);
+        return NULL;
+    }
+    *len = fread(data, 1, BENCH_TRACE_MAX, file);
+    fclose(file);
+    return data;
+}
+
+/* Function: bench_load
+ *
+ * Decodes the trace and hands every command to the player of its
+ * interface, with the time it is due. Returns the amount of commands, 0
+ * when the trace can't be used.
+ *
+ */
+static uint32_t bench_load(const uint8_t  *trace,
+                           uint32_t       len,
+                           double         speed,
+                           uint32_t       max_gap_ms,
+                           bench_player_t *players)
+{
+    capture_event_t event;
+    uint32_t        offset = CAPTURE_HEADER_LEN;
+    uint32_t        amount = 0;
+    uint8_t         size;
+    double          due    = 0;
+
+    if(!capture_check_header(trace, len))
+    {
+        fprintf(stderr, "Not a trace of format %d\n", CAPTURE_FORMAT);
+        return 0;
+    }
+    // Every command fits in a player, so count first.
+    for(uint32_t i = 0; i < SETTINGS_INTERFACE_AMOUNT; i++)
+    {
+        players[i].amount = 0;
+    }
+    while((size = capture_decode(&trace[offset], len - offset, &event)) > 0)
+    {
+        if(event.interface >= SETTINGS_INTERFACE_AMOUNT)
+        {
+            fprintf(stderr, "Interface %u is not in this firmware\n",
+                    event.interface);
+            return 0;
+        }
+        players[event.interface].amount++;
+        offset += size;
+    }
+
+    if(offset + CAPTURE_END_LEN <= len && trace[offset] == CAPTURE_RECORD_END)
+    {
+        uint32_t dropped = trace[offset + 5] | trace[offset + 6] << 8 |
+                           trace[offset + 7] << 16 |
+                           (uint32_t)trace[offset + 8] << 24;
+
+        if(dropped > 0)
+        {
+            printf("The capture dropped %lu commands\n", (unsigned long)dropped);
+        }
+    }
+    else
+    {
+        printf("The trace has no end, it was cut short\n");
+    }
+
+    for(uint32_t i = 0; i < SETTINGS_INTERFACE_AMOUNT; i++)
+    {
+        players[i] = (bench_player_t){
+            .interface  = i,
+            .events     = calloc(players[i].amount + 1, sizeof(capture_event_t)),
+            .due_us     = calloc(players[i].amount + 1, sizeof(int64_t)),
+            .latency_us = calloc(players[i].amount + 1, sizeof(int64_t)),
+            .finished   = xSemaphoreCreateBinary(),
+        };
+        if(players[i].events == NULL || players[i].due_us == NULL ||
+           players[i].latency_us == NULL)
+        {
+            return 0;
+        }
+    }
+
+    offset = CAPTURE_HEADER_LEN;
+    while((size = capture_decode(&trace[offset], len - offset, &event)) > 0)
+    {
+        bench_player_t *player = &players[event.interface];
+        double         delta   = event.delta_us;
+
+        if(delta > max_gap_ms * 1000.0)
+        {
+            delta = max_gap_ms * 1000.0;
+        }
+        due += speed > 0 ? delta / speed : 0;
+
+        player->events[player->amount] = event;
+        player->due_us[player->amount] = (int64_t)due;
+        player->amount++;
+        amount++;
+        offset += size;
+    }
+    return amount;
+}
+
+// Sends the commands of one interface at their time, or right after the
+// previous one when it is late.
+static void bench_player_task(void *pvParameters)
+{
+    bench_player_t       *player = (bench_player_t*)pvParameters;
+    communication_t      *pipeline;
+    dsp_event_response_t response;
+
+    pipeline = settingsQueues.settings_interfaces[player->interface];
+    for(uint32_t i = 0; i < player->amount; i++)
+    {
+        int64_t lag = esp_timer_get_time() - (player->start_us + player->due_us[i]);
+        int64_t begin;
+
+        if(lag < 0)
+        {
+            host_sleep_us(-lag);
+        }
+        else if(lag > player->max_lag_us)
+        {
+            player->max_lag_us = lag;
+        }
+
+        begin = esp_timer_get_time();
+        if(!send_event(pipeline, &player->events[i].event, &response,
+                       EVENT_STD_TIMEOUT_TICKS))
+        {
+            player->failures++;
+        }
+        else if(response.response_event_type == EVENT_RESPONSE_ERROR ||
+                response.response_event_type == EVENT_RESPONSE_DSP_ERROR ||
+                response.response_event_type == EVENT_RESPONSE_SETTINGS_ERROR)
+        {
+            player->errors++;
+        }
+        player->latency_us[i] = esp_timer_get_time() - begin;
+    }
+    xSemaphoreGive(player->finished);
+    vTaskDelete(NULL);
+}
+
+// Starts the tasks the way app_main does, without the CLI.
+static void bench_start_firmware(void)
+{
+    settingsQueues.settings_dsp = dsp_communication_create();
+    for(int i = 0; i < SETTINGS_INTERFACE_AMOUNT; i++)
+    {
+        settingsQueues.settings_interfaces[i] = dsp_communication_create();
+    }
+
+    xTaskCreatePinnedToCore(dsp_task,
+                            "DSP_handler",
+                            4096,
+                            (void*)settingsQueues.settings_dsp,
+                            2,
+                            NULL,
+                            tskNO_AFFINITY);
+    xTaskCreatePinnedToCore(task_interfaces,
+                            "Interfaces",
+                            4096,
+                            (void*)settingsQueues.settings_interfaces,
+                            2,
+                            NULL,
+                            tskNO_AFFINITY);
+    xTaskCreatePinnedToCore(settings_task,
+                            "Settings_handler",
+                            4096,
+                            (void*)&settingsQueues,
+                            2,
+                            NULL,
+                            tskNO_AFFINITY);
+}
+
+static bool bench_wait_boot(void)
+{
+    TickType_t start = xTaskGetTickCount();
+
+    while(!boot_profile_done())
+    {
+        if(xTaskGetTickCount() - start > pdMS_TO_TICKS(BENCH_BOOT_TIMEOUT_MS))
+        {
+            return false;
+        }
+        vTaskDelay(1);
+    }
+    return true;
+}
+
+static void bench_print_bus(const char *name, uint8_t port, uint32_t items)
+{
+    sim_i2c_stats_t bus;
+
+    sim_i2c_get_stats(port, &bus);
+    printf("%-8s %7lu txn %8lu bytes %9.2f bus_ms",
+           name,
+           (unsigned long)bus.transactions,
+           (unsigned long)bus.bytes,
+           bus.bus_ns / 1e6);
+    if(items > 0)
+    {
+        printf("   %.1f txn, %.1f bytes per command",
+               (double)bus.transactions / items,
+               (double)bus.bytes / items);
+    }
+    printf("\n");
+}
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+int main(int argc, char **argv)
+{
+    const char           *path       = DSP_IMAGES_BIN;
+    const char           *tracePath;
+    uint32_t             clock_hz    = I2C_MASTER_FREQ_HZ;
+    uint32_t             max_gap_ms  = BENCH_MAX_GAP_MS;
+    double               speed       = 1;
+    bool                 realtime    = true;
+    bench_player_t       players[SETTINGS_INTERFACE_AMOUNT];
+    uint32_t             types[BENCH_TYPE_AMOUNT] = {0};
+    uint8_t              *trace;
+    uint32_t             traceLen;
+    uint32_t             amount;
+    uint32_t             total       = 0;
+    uint32_t             failures    = 0;
+    uint32_t             errors      = 0;
+    int64_t              *latency;
+    int64_t              maxLag      = 0;
+    int64_t              start;
+    int64_t              wall_us;
+    adau1701_sim_stats_t dspStats;
+    int                  opt;
+
+    while((opt = getopt(argc, argv, "s:g:k:f")) != -1)
+    {
+        switch(opt)
+        {
+            case 's':
+                speed = strtod(optarg, NULL);
+                break;
+            case 'g':
+                max_gap_ms = strtoul(optarg, NULL, 0);
+                break;
+            case 'k':
+                clock_hz = strtoul(optarg, NULL, 0);
+                break;
+            case 'f':
+                realtime = false;
+                break;
+            default:
+                optind = argc + 1;
+                break;
+        }
+    }
+    if(optind >= argc || speed < 0)
+    {
+        fprintf(stderr,
+                "usage: %s [-s speed] [-g gap_ms] [-k clock_hz] [-f] trace "
+                "[image.bin]\n",
+                argv[0]);
+        return 2;
+    }
+    tracePath = argv[optind];
+    if(optind + 1 < argc)
+    {
+        path = argv[optind + 1];
+    }
+
+    trace = bench_read_file(tracePath, &traceLen);
+    if(trace == NULL)
+    {
+        fprintf(stderr, "Unable to read %s\n", tracePath);
+        return 2;
+    }
+    amount = bench_load(trace, traceLen, speed, max_gap_ms, players);
+    free(trace);
+    if(amount == 0)
+    {
+        fprintf(stderr, "No commands in %s\n", tracePath);
+        return 2;
+    }
+
+    if(!host_partition_add(DSP_IMAGE_PARTITION_LABEL,
+                           ESP_PARTITION_TYPE_DATA,
+                           DSP_IMAGE_PARTITION_SUBTYPE,
+                           BENCH_PARTITION_SIZE) ||
+       !host_partition_load(DSP_IMAGE_PARTITION_LABEL, path))
+    {
+        fprintf(stderr, "Unable to load %s\n", path);
+        return 2;
+    }
+    if(!adau1701_sim_attach(&dsp, ADA_I2C_PORT_NUM, ADA_I2C_ADDRESS, ADA_GPIO_RESET) ||
+       !eeprom24_sim_attach(&eeprom,
+                            NV_STORAGE_I2C_INTERFACE,
+                            NV_STORAGE_I2C_ADDRESS,
+                            BENCH_EEPROM_SIZE,
+                            EEPROM_PAGE_SIZE,
+                            EEPROM24_SIM_WRITE_CYCLE_US) ||
+       !init_i2c_bus())
+    {
+        fprintf(stderr, "Unable to set up the simulated buses\n");
+        return 2;
+    }
+    for(int i = 0; i < SIM_I2C_PORT_AMOUNT; i++)
+    {
+        sim_i2c_set_clock(i, clock_hz);
+        sim_i2c_set_realtime(i, realtime);
+    }
+
+    printf("Replay of %s, %lu commands ", tracePath, (unsigned long)amount);
+    if(speed > 0)
+    {
+        printf("at %.2fx, pauses cut to %lu ms", speed, (unsigned long)max_gap_ms);
+    }
+    else
+    {
+        printf("flat out");
+    }
+    printf(", buses at %lu Hz%s\n\n",
+           (unsigned long)clock_hz,
+           realtime ? "" : " (not realtime)");
+
+    bench_start_firmware();
+    bench_check(bench_wait_boot(), "firmware boots");
+    if(failed)
+    {
+        printf("\nFAILED\n");
+        return 1;
+    }
+
+    sim_i2c_clear_stats(ADA_I2C_PORT_NUM);
+    sim_i2c_clear_stats(NV_STORAGE_I2C_INTERFACE);
+    adau1701_sim_clear_stats(&dsp);
+
+    start = esp_timer_get_time();
+    for(int i = 0; i < SETTINGS_INTERFACE_AMOUNT; i++)
+    {
+        players[i].start_us = start;
+        xTaskCreate(bench_player_task, "bench_player", 4096, &players[i], 3, NULL);
+    }
+    for(int i = 0; i < SETTINGS_INTERFACE_AMOUNT; i++)
+    {
+        xSemaphoreTake(players[i].finished, portMAX_DELAY);
+    }
+    wall_us = esp_timer_get_time() - start;
+
+    latency = calloc(amount, sizeof(int64_t));
+    if(latency == NULL)
+    {
+        return 2;
+    }
+    for(int i = 0; i < SETTINGS_INTERFACE_AMOUNT; i++)
+    {
+        for(uint32_t j = 0; j < players[i].amount; j++)
+        {
+            uint8_t type = players[i].events[j].event.event_type;
+
+            latency[total++] = players[i].latency_us[j];
+            if(type < BENCH_TYPE_AMOUNT)
+            {
+                types[type]++;
+            }
+        }
+        failures += players[i].failures;
+        errors   += players[i].errors;
+        maxLag    = players[i].max_lag_us > maxLag ? players[i].max_lag_us : maxLag;
+    }
+    qsort(latency, total, sizeof(int64_t), bench_compare);
+
+    printf("%-8s %6s %9s %8s %8s %8s %8s %8s\n",
+           "", "cmds", "cmds/s", "p50_ms", "p90_ms", "p99_ms", "p999_ms", "max_ms");
+    printf("%-8s %6lu %9.1f %8.2f %8.2f %8.2f %8.2f %8.2f\n",
+           "replay",
+           (unsigned long)total,
+           total * 1e6 / wall_us,
+           latency[total / 2] / 1e3,
+           latency[(total * 90) / 100] / 1e3,
+           latency[(total * 99) / 100] / 1e3,
+           latency[(total * 999) / 1000] / 1e3,
+           latency[total - 1] / 1e3);
+    printf("\nwall %.2f s", wall_us / 1e6);
+    if(speed > 0)
+    {
+        printf(", players at most %.2f ms behind the trace", maxLag / 1e3);
+    }
+    printf("\n");
+    for(int i = 0; i < BENCH_TYPE_AMOUNT; i++)
+    {
+        if(types[i] > 0)
+        {
+            printf("%s %lu  ", typeNames[i], (unsigned long)types[i]);
+        }
+    }
+    printf("\n%lu answered with an error\n\n", (unsigned long)errors);
+
+    bench_print_bus("dsp", ADA_I2C_PORT_NUM, total);
+    bench_print_bus("eeprom", NV_STORAGE_I2C_INTERFACE, total);
+    adau1701_sim_get_stats(&dsp, &dspStats);
+
+    bench_check(failures == 0, "every command is answered");
+    bench_check(dspStats.protocol_errors == 0, "no DSP protocol errors");
+    bench_check(dspStats.running_program_writes == 0,
+                "no program writes while the core runs");
+    free(latency);
+
+    printf("\n%s\n", failed ? "FAILED" : "OK");
+    return failed ? 1 : 0;
+}
+
+/******************************* THE END *********************************/
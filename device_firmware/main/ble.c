@@ -18,23 +18,40 @@
   
 /******************************* GLOBAL VARIABLES ************************/
 
-uint8_t     channelIndex = 0;
-uint8_t     eqIndex      = 0;
-bool        isOutput     = false;
-
-equalizer_t currentEq;
-mux_t       currentMux;
-
-communication_t*     toSettings = NULL;
-dsp_event_t          event;
-dsp_event_response_t event_response;
+// Every connected client gets its own context, so two phones can select
+// different channels and bands without corrupting each other.
+ble_conn_ctx_t conn_ctx[BLE_MAX_CONNECTIONS];
+uint8_t        conn_amount = 0;
 
 void (*ble_event_handler)(dsp_event_t) = NULL;
 static const char *TAG = "BLE";
 uint8_t ble_addr_type;
 
+// Advertised status and its encoded record. The host task advertises and
+// the interfaces task refreshes the status, both only under statusLock.
+ble_status_t      status;
+bool              status_dirty = true;
+uint8_t           status_record[BLE_STATUS_LEN];
+SemaphoreHandle_t statusLock   = NULL;
+
+// Last bonded central, we advertise directly to it after a link loss.
+ble_addr_t last_peer;
+bool       last_peer_valid = false;
+
 int32_t fToIntBuf;
 
+// Only touched from the host task, one buffer serves every connection.
+uint8_t settingsBlob[DEVICE_SETTINGS_BLOB_LEN];
+_Static_assert(DEVICE_SETTINGS_BLOB_LEN <= BLE_ATT_ATTR_MAX_LEN, 
+               "Settings snapshot does not fit in one attribute");
+uint8_t traceRecord[TRACE_RECORD_LEN];
+uint8_t telemetryRecord[TELEMETRY_RECORD_MAX];
+_Static_assert(TELEMETRY_RECORD_MAX <= BLE_ATT_ATTR_MAX_LEN, 
+               "Telemetry record does not fit in one attribute");
+uint8_t curveRecord[EQ_CURVE_RECORD_MAX];
+_Static_assert(EQ_CURVE_RECORD_MAX <= BLE_ATT_ATTR_MAX_LEN, 
+               "Curve record does not fit in one attribute");
+
 // Describes services and characteristics
 static const struct ble_gatt_svc_def gatt_svcs[] = {
     /* INDEXES */
@@ -113,6 +130,48 @@ static const struct ble_gatt_svc_def gatt_svcs[] = {
         {0}    
      }
     },
+    /* DEVICE STATE SERVICE */
+    {.type = BLE_GATT_SVC_TYPE_PRIMARY,
+     .uuid = BLE_UUID16_DECLARE(0x0011),
+     .characteristics = (struct ble_gatt_chr_def[])
+     {
+        /* SETTINGS SNAPSHOT */
+        // Larger than the MTU so clients use long reads. See 
+        // DEVICE_SETTINGS_BLOB_LEN for the layout. There is one snapshot 
+        // per DSP, writing the DSP index selects it.
+        {.uuid = BLE_UUID16_DECLARE(0x0012),
+         .flags = BLE_GATT_CHR_F_READ | BLE_GATT_CHR_F_WRITE,  
+         .access_cb = settings_blob_action,
+        },
+        /* PRESET */
+        // Slot of the DSP program, writing it switches the program.
+        {.uuid = BLE_UUID16_DECLARE(0x0013),
+         .flags = BLE_GATT_CHR_F_READ | BLE_GATT_CHR_F_WRITE,  
+         .access_cb = preset_action,
+        },
+        /* TRACE HISTOGRAMS */
+        // Latency per request stage, see TRACE_RECORD_LEN for the layout.
+        {.uuid = BLE_UUID16_DECLARE(0x0014),
+         .flags = BLE_GATT_CHR_F_READ,  
+         .access_cb = trace_action,
+        },
+        /* TELEMETRY */
+        // Last health sample, see TELEMETRY_RECORD_MAX for the layout.
+        {.uuid = BLE_UUID16_DECLARE(0x0015),
+         .flags = BLE_GATT_CHR_F_READ,  
+         .access_cb = telemetry_action,
+        },
+        /* EQ CURVE */
+        // Response of the selected channel, see EQ_CURVE_RECORD_FORMAT.
+        // Writing u8 points and optionally u8 flags sets the curve of
+        // this connection.
+        {.uuid = BLE_UUID16_DECLARE(0x0016),
+         .flags = BLE_GATT_CHR_F_READ | BLE_GATT_CHR_F_WRITE,  
+         .access_cb = eq_curve_action,
+        },
+        {0}    
+     }
+    },
     /* MUX SERVICE */
     {.type = BLE_GATT_SVC_TYPE_PRIMARY,
      .uuid = BLE_UUID16_DECLARE(0x000F),
@@ -134,23 +193,40 @@ static const struct ble_gatt_svc_def gatt_svcs[] = {
 
 /******************************* LOCAL FUNCTIONS *************************/
 
-bool send_current_eq()
+// Float fields are written like they are read, an int32_t in hundredths.
+// Clients that wrote one byte get BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN, see
+// control_software/ble.txt.
+bool ble_get_hundredths(struct os_mbuf *om, float *value)
 {
-    if(toSettings != NULL)
+    int32_t hundredths;
+
+    if(om->om_len != sizeof(int32_t))
     {
-        event.chan_num   = channelIndex;
-        event.eq_num     = eqIndex;
-        event.output     = isOutput;
-        event.eq         = currentEq;
+        return false;
+    }
+    memcpy(&hundredths, om->om_data, sizeof(int32_t));
+    *value = (float)hundredths / 100;
+    return true;
+}
 
-        event.event_type = DSP_SET_EQ;
+bool send_current_eq(ble_conn_ctx_t *ctx)
+{
+    if(ctx->to_settings != NULL)
+    {
+        ctx->event.chan_num   = ctx->channel_index;
+        ctx->event.eq_num     = ctx->eq_index;
+        ctx->event.output     = ctx->is_output;
+        ctx->event.eq         = ctx->current_eq;
+
+        ctx->event.event_type = DSP_SET_EQ;
+        ctx->event.trace_id   = trace_begin();
 
-        if(send_event(toSettings, 
-                      &event, 
-                      &event_response, 
+        if(send_event(ctx->to_settings, 
+                      &ctx->event, 
+                      &ctx->event_response, 
                       EVENT_STD_TIMEOUT_TICKS))
         {
-            if(event_response.response_event_type == EVENT_RESPONSE_OK)
+            if(ctx->event_response.response_event_type == EVENT_RESPONSE_OK)
             {
                 ESP_LOGI(TAG, "Response to send eq ok.");
                 return true;
@@ -160,50 +236,51 @@ bool send_current_eq()
     return false;
 }
 
-bool send_current_mux()
+bool send_preset(ble_conn_ctx_t *ctx, uint8_t preset)
 {
-    if(toSettings != NULL)
-    {
-        event.chan_num   = channelIndex;
-        event.output     = isOutput;
-        event.mux        = currentMux;
+    bool switched = false;
 
-        event.event_type = DSP_SET_MUX;
+    if(ctx->to_settings != NULL)
+    {
+        ctx->event.preset     = preset;
+        ctx->event.event_type = DSP_SET_PRESET;
+        ctx->event.trace_id   = trace_begin();
 
-        if(send_event(toSettings, 
-                      &event, 
-                      &event_response, 
+        if(send_event(ctx->to_settings, 
+                      &ctx->event, 
+                      &ctx->event_response, 
                       EVENT_STD_TIMEOUT_TICKS))
         {
-            if(event_response.response_event_type == EVENT_RESPONSE_OK)
+            if(ctx->event_response.response_event_type == EVENT_RESPONSE_OK)
             {
-                ESP_LOGI(TAG, "Response to send mux ok.");
-                return true;
+                ESP_LOGI(TAG, "Response to send preset ok.");
+                ble_set_status_preset(preset);
+                switched = true;
             }
         }
     }
-    return false;
+    return switched;
 }
 
-bool update_current_eq()
+bool send_current_mux(ble_conn_ctx_t *ctx)
 {
-    if(toSettings != NULL)
+    if(ctx->to_settings != NULL)
     {
-        event.chan_num   = channelIndex;
-        event.eq_num     = eqIndex;
-        event.output     = isOutput;
+        ctx->event.chan_num   = ctx->channel_index;
+        ctx->event.output     = ctx->is_output;
+        ctx->event.mux        = ctx->current_mux;
 
-        event.event_type = DSP_GET_EQ;
+        ctx->event.event_type = DSP_SET_MUX;
+        ctx->event.trace_id   = trace_begin();
 
-        if(send_event(toSettings, 
-                      &event, 
-                      &event_response, 
+        if(send_event(ctx->to_settings, 
+                      &ctx->event, 
+                      &ctx->event_response, 
                       EVENT_STD_TIMEOUT_TICKS))
         {
-            if(event_response.response_event_type == EVENT_RESPONSE_OK)
+            if(ctx->event_response.response_event_type == EVENT_RESPONSE_OK)
             {
-                currentEq = event_response.response_eq;
-                ESP_LOGI(TAG, "Response to get eq ok.");
+                ESP_LOGI(TAG, "Response to send mux ok.");
                 return true;
             }
         }
@@ -211,27 +288,28 @@ bool update_current_eq()
     return false;
 }
 
-bool update_current_mux()
+// Reads come straight from the settings snapshot, no round trip through 
+// the settings task is needed.
+bool update_current_eq(ble_conn_ctx_t *ctx)
 {
-    if(toSettings != NULL)
+    if(device_settings_read_eq(ctx->is_output,
+                               ctx->channel_index,
+                               ctx->eq_index,
+                               &ctx->current_eq))
     {
-        event.chan_num   = channelIndex;
-        event.output     = isOutput;
-
-        event.event_type = DSP_GET_MUX;
+        ESP_LOGI(TAG, "Get eq ok.");
+        return true;
+    }
+    return false;
+}
 
-        if(send_event(toSettings, 
-                      &event, 
-                      &event_response, 
-                      EVENT_STD_TIMEOUT_TICKS))
-        {
-            if(event_response.response_event_type == EVENT_RESPONSE_OK)
-            {
-                currentMux = event_response.response_mux;
-                ESP_LOGI(TAG, "Response to get mux ok.");
-                return true;
-            }
-        }
+bool update_current_mux(ble_conn_ctx_t *ctx)
+{
+    if(ctx->is_output && 
+       device_settings_read_mux(ctx->channel_index, &ctx->current_mux))
+    {
+        ESP_LOGI(TAG, "Get mux ok.");
+        return true;
     }
     return false;
 }
@@ -243,34 +321,36 @@ int chan_index_action(uint16_t conn_handle,
                      struct ble_gatt_access_ctxt *ctxt, 
                      void *arg)
 {
-    if(toSettings != NULL)
+    ble_conn_ctx_t *ctx = ble_conn_ctx_get(conn_handle);
+
+    if(ctx != NULL && ctx->to_settings != NULL)
     {
         switch(ctxt->op)
         {  
             // Get channel index.
             case BLE_GATT_ACCESS_OP_READ_CHR:
-                os_mbuf_append(ctxt->om, &channelIndex, sizeof(uint8_t));  
+                os_mbuf_append(ctxt->om, &ctx->channel_index, sizeof(uint8_t));  
                 break;
 
             // Set channel index.
             case BLE_GATT_ACCESS_OP_WRITE_CHR:
-                uint8_t previous_index = channelIndex;
-                channelIndex = *(ctxt->om->om_data);
+                uint8_t previous_index = ctx->channel_index;
+                ctx->channel_index = *(ctxt->om->om_data);
                 
-                if(isOutput)
+                if(ctx->is_output)
                 {
-                    if(!update_current_eq() ||
-                    !update_current_mux()  )
+                    if(!update_current_eq(ctx) ||
+                    !update_current_mux(ctx)  )
                     {
-                        channelIndex = previous_index;
+                        ctx->channel_index = previous_index;
                     }
                 }
                 else
                 {
-                    currentMux.index = 0;
-                    if(!update_current_eq())
+                    ctx->current_mux.index = 0;
+                    if(!update_current_eq(ctx))
                     {
-                       channelIndex = previous_index; 
+                       ctx->channel_index = previous_index; 
                     }
                 }
                 break;
@@ -284,23 +364,25 @@ int is_output_action(uint16_t conn_handle,
                      struct ble_gatt_access_ctxt *ctxt, 
                      void *arg)
 {
-    if(toSettings != NULL)
+    ble_conn_ctx_t *ctx = ble_conn_ctx_get(conn_handle);
+
+    if(ctx != NULL && ctx->to_settings != NULL)
     {
         switch(ctxt->op)
         {
             // get is output
             case BLE_GATT_ACCESS_OP_READ_CHR:
-                os_mbuf_append(ctxt->om, &isOutput, sizeof(uint8_t));  
+                os_mbuf_append(ctxt->om, &ctx->is_output, sizeof(uint8_t));  
                 break;
 
             // Set is output
             case BLE_GATT_ACCESS_OP_WRITE_CHR:
-                bool prev = isOutput;
-                isOutput = *(ctxt->om->om_data);
-                if(!update_current_eq() ||
-                   !update_current_mux())
+                bool prev = ctx->is_output;
+                ctx->is_output = *(ctxt->om->om_data);
+                if(!update_current_eq(ctx) ||
+                   !update_current_mux(ctx))
                 {
-                    isOutput = prev;
+                    ctx->is_output = prev;
                 }
                 break;
         }
@@ -313,22 +395,24 @@ int eq_index_action(uint16_t conn_handle,
                     struct ble_gatt_access_ctxt *ctxt, 
                     void *arg)
 {
-    if(toSettings != NULL)
+    ble_conn_ctx_t *ctx = ble_conn_ctx_get(conn_handle);
+
+    if(ctx != NULL && ctx->to_settings != NULL)
     {
         switch(ctxt->op)
         {
             // Get eq index.
             case BLE_GATT_ACCESS_OP_READ_CHR:
-                os_mbuf_append(ctxt->om, &eqIndex, sizeof(uint8_t));  
+                os_mbuf_append(ctxt->om, &ctx->eq_index, sizeof(uint8_t));  
                 break;
 
             // Set eq index.
             case BLE_GATT_ACCESS_OP_WRITE_CHR:
-                uint8_t prev = eqIndex;
-                eqIndex = *(ctxt->om->om_data);
-                if(!update_current_eq())
+                uint8_t prev = ctx->eq_index;
+                ctx->eq_index = *(ctxt->om->om_data);
+                if(!update_current_eq(ctx))
                 {
-                    eqIndex = prev;
+                    ctx->eq_index = prev;
                 }
                 break;
         }
@@ -336,28 +420,33 @@ int eq_index_action(uint16_t conn_handle,
     return 0;
 }
 
-int q_action(uint16_t con_handle, 
+int q_action(uint16_t conn_handle, 
              uint16_t attr_handle, 
              struct ble_gatt_access_ctxt *ctxt, 
              void *arg)
 {
-    if(toSettings != NULL)
+    ble_conn_ctx_t *ctx = ble_conn_ctx_get(conn_handle);
+
+    if(ctx != NULL && ctx->to_settings != NULL)
     {
         switch(ctxt->op)
         {
             // Get q.
             case BLE_GATT_ACCESS_OP_READ_CHR:
-                fToIntBuf = (int32_t)(currentEq.q * 100);
+                fToIntBuf = (int32_t)(ctx->current_eq.q * 100);
                 os_mbuf_append(ctxt->om, &fToIntBuf, sizeof(int32_t));  
                 break;
 
             // Set q.
             case BLE_GATT_ACCESS_OP_WRITE_CHR:
-                float old = currentEq.q;
-                currentEq.q = (float)(*(ctxt->om->om_data) / 100);
-                if(!send_current_eq())
+                float old = ctx->current_eq.q;
+                if(!ble_get_hundredths(ctxt->om, &ctx->current_eq.q))
                 {
-                    currentEq.q = old;
+                    return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+                }
+                if(!send_current_eq(ctx))
+                {
+                    ctx->current_eq.q = old;
                 }
                 break;
         }
@@ -365,28 +454,33 @@ int q_action(uint16_t con_handle,
     return 0;
 }
 
-int s_action(uint16_t con_handle, 
+int s_action(uint16_t conn_handle, 
              uint16_t attr_handle, 
              struct ble_gatt_access_ctxt *ctxt, 
              void *arg)
 {
-    if(toSettings != NULL)
+    ble_conn_ctx_t *ctx = ble_conn_ctx_get(conn_handle);
+
+    if(ctx != NULL && ctx->to_settings != NULL)
     {
         switch(ctxt->op)
         {
             // Get s.
             case BLE_GATT_ACCESS_OP_READ_CHR:
-                fToIntBuf = (int32_t)(currentEq.s * 100);
+                fToIntBuf = (int32_t)(ctx->current_eq.s * 100);
                 os_mbuf_append(ctxt->om, &fToIntBuf, sizeof(int32_t));  
                 break;
 
             // Set s.
             case BLE_GATT_ACCESS_OP_WRITE_CHR:
-                float old = currentEq.s;
-                currentEq.s = (float)(*(ctxt->om->om_data) / 100);
-                if(!send_current_eq())
+                float old = ctx->current_eq.s;
+                if(!ble_get_hundredths(ctxt->om, &ctx->current_eq.s))
+                {
+                    return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+                }
+                if(!send_current_eq(ctx))
                 {
-                    currentEq.s = old;
+                    ctx->current_eq.s = old;
                 }
                 break;
         }
@@ -394,28 +488,33 @@ int s_action(uint16_t con_handle,
     return 0;
 }
 
-int bandwith_action(uint16_t con_handle, 
+int bandwith_action(uint16_t conn_handle, 
              uint16_t attr_handle, 
              struct ble_gatt_access_ctxt *ctxt, 
              void *arg)
 {
-    if(toSettings != NULL)
+    ble_conn_ctx_t *ctx = ble_conn_ctx_get(conn_handle);
+
+    if(ctx != NULL && ctx->to_settings != NULL)
     {
         switch(ctxt->op)
         {
             // Get bandwith.
             case BLE_GATT_ACCESS_OP_READ_CHR:
-                fToIntBuf = (int32_t)(currentEq.bandwidth * 100);
+                fToIntBuf = (int32_t)(ctx->current_eq.bandwidth * 100);
                 os_mbuf_append(ctxt->om, &fToIntBuf, sizeof(int32_t));  
                 break;
 
             // Set bandwith.
             case BLE_GATT_ACCESS_OP_WRITE_CHR:
-                float old = currentEq.bandwidth;
-                currentEq.bandwidth = (float)(*(ctxt->om->om_data) / 100);
-                if(!send_current_eq())
+                float old = ctx->current_eq.bandwidth;
+                if(!ble_get_hundredths(ctxt->om, &ctx->current_eq.bandwidth))
+                {
+                    return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+                }
+                if(!send_current_eq(ctx))
                 {
-                    currentEq.bandwidth = old;
+                    ctx->current_eq.bandwidth = old;
                 }
                 break;
         }
@@ -423,28 +522,33 @@ int bandwith_action(uint16_t con_handle,
     return 0;
 }
 
-int boost_action(uint16_t con_handle, 
+int boost_action(uint16_t conn_handle, 
              uint16_t attr_handle, 
              struct ble_gatt_access_ctxt *ctxt, 
              void *arg)
 {
-    if(toSettings != NULL)
+    ble_conn_ctx_t *ctx = ble_conn_ctx_get(conn_handle);
+
+    if(ctx != NULL && ctx->to_settings != NULL)
     {
         switch(ctxt->op)
         {
             // Get boost.
             case BLE_GATT_ACCESS_OP_READ_CHR:
-                fToIntBuf = (int32_t)(currentEq.boost * 100);
+                fToIntBuf = (int32_t)(ctx->current_eq.boost * 100);
                 os_mbuf_append(ctxt->om, &fToIntBuf, sizeof(int32_t));  
                 break;
 
             // Set boost.
             case BLE_GATT_ACCESS_OP_WRITE_CHR:
-                float old = currentEq.boost;
-                currentEq.boost = (float)(*(ctxt->om->om_data) / 100);
-                if(!send_current_eq())
+                float old = ctx->current_eq.boost;
+                if(!ble_get_hundredths(ctxt->om, &ctx->current_eq.boost))
                 {
-                    currentEq.boost = old;
+                    return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+                }
+                if(!send_current_eq(ctx))
+                {
+                    ctx->current_eq.boost = old;
                 }
                 break;
         }
@@ -452,30 +556,35 @@ int boost_action(uint16_t con_handle,
     return 0;
 }
 
-int freq_action(uint16_t con_handle, 
+int freq_action(uint16_t conn_handle, 
              uint16_t attr_handle, 
              struct ble_gatt_access_ctxt *ctxt, 
              void *arg)
 {
-    if(toSettings != NULL)
+    ble_conn_ctx_t *ctx = ble_conn_ctx_get(conn_handle);
+
+    if(ctx != NULL && ctx->to_settings != NULL)
     {
         switch(ctxt->op)
         {
             // Get boost.
             case BLE_GATT_ACCESS_OP_READ_CHR:
-                ESP_LOGW(TAG, "%f", currentEq.freq);
-                fToIntBuf = (int32_t)(currentEq.freq * 100);
+                ESP_LOGW(TAG, "%f", ctx->current_eq.freq);
+                fToIntBuf = (int32_t)(ctx->current_eq.freq * 100);
                 ESP_LOGW(TAG, "%ld", fToIntBuf);
                 os_mbuf_append(ctxt->om, &fToIntBuf, sizeof(int32_t));  
                 break;
 
             // Set boost.
             case BLE_GATT_ACCESS_OP_WRITE_CHR:
-                float old = currentEq.freq;
-                currentEq.freq = (float)(*(ctxt->om->om_data) / 100);
-                if(!send_current_eq())
+                float old = ctx->current_eq.freq;
+                if(!ble_get_hundredths(ctxt->om, &ctx->current_eq.freq))
+                {
+                    return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+                }
+                if(!send_current_eq(ctx))
                 {
-                    currentEq.freq = old;
+                    ctx->current_eq.freq = old;
                 }
                 break;
         }
@@ -483,28 +592,33 @@ int freq_action(uint16_t con_handle,
     return 0;
 }
 
-int gain_action(uint16_t con_handle, 
+int gain_action(uint16_t conn_handle, 
              uint16_t attr_handle, 
              struct ble_gatt_access_ctxt *ctxt, 
              void *arg)
 {
-    if(toSettings != NULL)
+    ble_conn_ctx_t *ctx = ble_conn_ctx_get(conn_handle);
+
+    if(ctx != NULL && ctx->to_settings != NULL)
     {
         switch(ctxt->op)
         {
             // Get gain.
             case BLE_GATT_ACCESS_OP_READ_CHR:
-                fToIntBuf = (int32_t)(currentEq.gain * 100);
+                fToIntBuf = (int32_t)(ctx->current_eq.gain * 100);
                 os_mbuf_append(ctxt->om, &fToIntBuf, sizeof(int32_t));  
                 break;
 
             // Set gain.
             case BLE_GATT_ACCESS_OP_WRITE_CHR:
-                float old = currentEq.gain;
-                currentEq.gain = (float)(*(ctxt->om->om_data) / 100);
-                if(!send_current_eq())
+                float old = ctx->current_eq.gain;
+                if(!ble_get_hundredths(ctxt->om, &ctx->current_eq.gain))
+                {
+                    return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+                }
+                if(!send_current_eq(ctx))
                 {
-                    currentEq.gain = old;
+                    ctx->current_eq.gain = old;
                 }
                 break;
         }
@@ -512,27 +626,29 @@ int gain_action(uint16_t con_handle,
     return 0;
 }
 
-int filter_type_action(uint16_t con_handle, 
+int filter_type_action(uint16_t conn_handle, 
              uint16_t attr_handle, 
              struct ble_gatt_access_ctxt *ctxt, 
              void *arg)
 {
-    if(toSettings != NULL)
+    ble_conn_ctx_t *ctx = ble_conn_ctx_get(conn_handle);
+
+    if(ctx != NULL && ctx->to_settings != NULL)
     {
         switch(ctxt->op)
         {
             // Get filter type.
             case BLE_GATT_ACCESS_OP_READ_CHR:
-                os_mbuf_append(ctxt->om, &currentEq.filter_type, sizeof(uint8_t));  
+                os_mbuf_append(ctxt->om, &ctx->current_eq.filter_type, sizeof(uint8_t));  
                 break;
 
             // Set filter type.
             case BLE_GATT_ACCESS_OP_WRITE_CHR:
-                float old = currentEq.filter_type;
-                currentEq.filter_type = *ctxt->om->om_data;
-                if(!send_current_eq())
+                float old = ctx->current_eq.filter_type;
+                ctx->current_eq.filter_type = *ctxt->om->om_data;
+                if(!send_current_eq(ctx))
                 {
-                    currentEq.filter_type = old;
+                    ctx->current_eq.filter_type = old;
                 }
                 break;
         }
@@ -540,27 +656,29 @@ int filter_type_action(uint16_t con_handle,
     return 0;
 }
 
-int phase_action(uint16_t con_handle, 
+int phase_action(uint16_t conn_handle, 
              uint16_t attr_handle, 
              struct ble_gatt_access_ctxt *ctxt, 
              void *arg)
 {
-    if(toSettings != NULL)
+    ble_conn_ctx_t *ctx = ble_conn_ctx_get(conn_handle);
+
+    if(ctx != NULL && ctx->to_settings != NULL)
     {
         switch(ctxt->op)
         {
             // Get phase.
             case BLE_GATT_ACCESS_OP_READ_CHR:
-                os_mbuf_append(ctxt->om, &currentEq.phase, sizeof(uint8_t));  
+                os_mbuf_append(ctxt->om, &ctx->current_eq.phase, sizeof(uint8_t));  
                 break;
 
             // Set phase.
             case BLE_GATT_ACCESS_OP_WRITE_CHR:
-                float old = currentEq.phase;
-                currentEq.phase = *ctxt->om->om_data;
-                if(!send_current_eq())
+                float old = ctx->current_eq.phase;
+                ctx->current_eq.phase = *ctxt->om->om_data;
+                if(!send_current_eq(ctx))
                 {
-                    currentEq.phase = old;
+                    ctx->current_eq.phase = old;
                 }
                 break;
         }
@@ -568,27 +686,29 @@ int phase_action(uint16_t con_handle,
     return 0;
 }
 
-int state_action(uint16_t con_handle, 
+int state_action(uint16_t conn_handle, 
              uint16_t attr_handle, 
              struct ble_gatt_access_ctxt *ctxt, 
              void *arg)
 {
-    if(toSettings != NULL)
+    ble_conn_ctx_t *ctx = ble_conn_ctx_get(conn_handle);
+
+    if(ctx != NULL && ctx->to_settings != NULL)
     {
         switch(ctxt->op)
         {
             // Get state.
             case BLE_GATT_ACCESS_OP_READ_CHR:
-                os_mbuf_append(ctxt->om, &currentEq.state, sizeof(uint8_t));  
+                os_mbuf_append(ctxt->om, &ctx->current_eq.state, sizeof(uint8_t));  
                 break;
 
             // Set state.
             case BLE_GATT_ACCESS_OP_WRITE_CHR:
-                float old = currentEq.state;
-                currentEq.state = *ctxt->om->om_data;
-                if(!send_current_eq())
+                float old = ctx->current_eq.state;
+                ctx->current_eq.state = *ctxt->om->om_data;
+                if(!send_current_eq(ctx))
                 {
-                    currentEq.state = old;
+                    ctx->current_eq.state = old;
                 }
                 break;
         }
@@ -596,43 +716,342 @@ int state_action(uint16_t con_handle,
     return 0;
 }
 
-int mux_action(uint16_t con_handle, 
+int mux_action(uint16_t conn_handle, 
              uint16_t attr_handle, 
              struct ble_gatt_access_ctxt *ctxt, 
              void *arg)
 {
-    if(toSettings != NULL)
+    ble_conn_ctx_t *ctx = ble_conn_ctx_get(conn_handle);
+
+    if(ctx != NULL && ctx->to_settings != NULL)
     {
         switch(ctxt->op)
         {
             // Get mux.
             case BLE_GATT_ACCESS_OP_READ_CHR:
-                os_mbuf_append(ctxt->om, &currentMux.index, sizeof(uint8_t));  
+                os_mbuf_append(ctxt->om, &ctx->current_mux.index, sizeof(uint8_t));  
                 break;
 
             // Set mux.
             case BLE_GATT_ACCESS_OP_WRITE_CHR:
-                float old = currentMux.index;
-                currentMux.index = *ctxt->om->om_data;
-                if(!send_current_mux())
+                float old = ctx->current_mux.index;
+                ctx->current_mux.index = *ctxt->om->om_data;
+                if(!send_current_mux(ctx))
+                {
+                    ctx->current_mux.index = old;
+                }
+                break;
+        }
+    }
+    return 0;
+}
+
+ble_conn_ctx_t* ble_conn_ctx_get(uint16_t conn_handle)
+{
+    for(int i = 0; i < BLE_MAX_CONNECTIONS; i++)
+    {
+        if(conn_ctx[i].in_use && conn_ctx[i].conn_handle == conn_handle)
+        {
+            return &conn_ctx[i];
+        }
+    }
+    return NULL;
+}
+
+ble_conn_ctx_t* ble_conn_ctx_open(uint16_t conn_handle)
+{
+    for(int i = 0; i < BLE_MAX_CONNECTIONS; i++)
+    {
+        // A context without a pipeline to the settings task is useless.
+        if(!conn_ctx[i].in_use && conn_ctx[i].to_settings != NULL)
+        {
+            conn_ctx[i].in_use        = true;
+            conn_ctx[i].conn_handle   = conn_handle;
+            conn_ctx[i].channel_index = 0;
+            conn_ctx[i].eq_index      = 0;
+            conn_ctx[i].is_output     = false;
+            conn_ctx[i].dsp_index     = 0;
+            memset(&conn_ctx[i].current_eq,  0, sizeof(equalizer_t));
+            memset(&conn_ctx[i].current_mux, 0, sizeof(mux_t));
+            conn_ctx[i].curve_points  = EQ_CURVE_POINTS;
+            conn_ctx[i].curve_flags   = 0;
+            conn_amount++;
+            return &conn_ctx[i];
+        }
+    }
+    return NULL;
+}
+
+void ble_conn_ctx_close(uint16_t conn_handle)
+{
+    ble_conn_ctx_t *ctx = ble_conn_ctx_get(conn_handle);
+
+    if(ctx != NULL)
+    {
+        ctx->in_use      = false;
+        ctx->conn_handle = BLE_HS_CONN_HANDLE_NONE;
+        conn_amount--;
+    }
+}
+
+int settings_blob_action(uint16_t conn_handle, 
+                         uint16_t attr_handle, 
+                         struct ble_gatt_access_ctxt *ctxt, 
+                         void *arg)
+{
+    ble_conn_ctx_t *ctx = ble_conn_ctx_get(conn_handle);
+
+    if(ctx != NULL && ctx->to_settings != NULL)
+    {
+        switch(ctxt->op)
+        {
+            // Get settings snapshot. NimBLE calls us for every part of a
+            // long read and strips the offset itself. The version at the
+            // start and end of the blob lets the client detect a torn read.
+            case BLE_GATT_ACCESS_OP_READ_CHR:
+                uint16_t len = device_settings_serialize(ctx->dsp_index,
+                                                         settingsBlob, 
+                                                         sizeof(settingsBlob));
+                if(len == 0)
+                {
+                    return BLE_ATT_ERR_UNLIKELY;
+                }
+                os_mbuf_append(ctxt->om, settingsBlob, len);  
+                break;
+
+            // Select the DSP.
+            case BLE_GATT_ACCESS_OP_WRITE_CHR:
+                if(*ctxt->om->om_data >= DEVICE_SETTINGS_DSP_AMOUNT)
+                {
+                    return BLE_ATT_ERR_VALUE_NOT_ALLOWED;
+                }
+                ctx->dsp_index = *ctxt->om->om_data;
+                break;
+        }
+    }
+    return 0;
+}
+
+int preset_action(uint16_t conn_handle, 
+                  uint16_t attr_handle, 
+                  struct ble_gatt_access_ctxt *ctxt, 
+                  void *arg)
+{
+    ble_conn_ctx_t *ctx = ble_conn_ctx_get(conn_handle);
+
+    if(ctx != NULL && ctx->to_settings != NULL)
+    {
+        switch(ctxt->op)
+        {
+            // Get preset.
+            case BLE_GATT_ACCESS_OP_READ_CHR:
+                xSemaphoreTake(statusLock, portMAX_DELAY);
+                uint8_t preset = status.preset;
+                xSemaphoreGive(statusLock);
+                os_mbuf_append(ctxt->om, &preset, sizeof(uint8_t));  
+                break;
+
+            // Switch preset.
+            case BLE_GATT_ACCESS_OP_WRITE_CHR:
+                if(ctxt->om->om_len != sizeof(uint8_t))
+                {
+                    return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+                }
+                send_preset(ctx, *ctxt->om->om_data);
+                break;
+        }
+    }
+    return 0;
+}
+
+int trace_action(uint16_t conn_handle, 
+                 uint16_t attr_handle, 
+                 struct ble_gatt_access_ctxt *ctxt, 
+                 void *arg)
+{
+    if(ctxt->op == BLE_GATT_ACCESS_OP_READ_CHR)
+    {
+        uint16_t len = trace_serialize(traceRecord, sizeof(traceRecord));
+
+        if(len == 0)
+        {
+            return BLE_ATT_ERR_UNLIKELY;
+        }
+        os_mbuf_append(ctxt->om, traceRecord, len);
+    }
+    return 0;
+}
+
+int telemetry_action(uint16_t conn_handle, 
+                     uint16_t attr_handle, 
+                     struct ble_gatt_access_ctxt *ctxt, 
+                     void *arg)
+{
+    if(ctxt->op == BLE_GATT_ACCESS_OP_READ_CHR)
+    {
+        uint16_t len = telemetry_serialize(telemetryRecord, 
+                                           sizeof(telemetryRecord));
+
+        if(len == 0)
+        {
+            return BLE_ATT_ERR_UNLIKELY;
+        }
+        os_mbuf_append(ctxt->om, telemetryRecord, len);
+    }
+    return 0;
+}
+
+int eq_curve_action(uint16_t conn_handle, 
+                    uint16_t attr_handle, 
+                    struct ble_gatt_access_ctxt *ctxt, 
+                    void *arg)
+{
+    ble_conn_ctx_t *ctx = ble_conn_ctx_get(conn_handle);
+
+    if(ctx != NULL)
+    {
+        switch(ctxt->op)
+        {
+            // Get the curve. Served from the cache of the channel unless
+            // one of its bands changed, a long read costs one evaluation.
+            case BLE_GATT_ACCESS_OP_READ_CHR:
+                uint16_t len = eq_curve_serialize(ctx->is_output,
+                                                  ctx->channel_index,
+                                                  ctx->curve_points,
+                                                  ctx->curve_flags,
+                                                  curveRecord,
+                                                  sizeof(curveRecord));
+                if(len == 0)
+                {
+                    return BLE_ATT_ERR_UNLIKELY;
+                }
+                os_mbuf_append(ctxt->om, curveRecord, len);
+                break;
+
+            // Set points and flags.
+            case BLE_GATT_ACCESS_OP_WRITE_CHR:
+                if(ctxt->om->om_len < 1 || ctxt->om->om_len > 2 ||
+                   ctxt->om->om_data[0] < EQ_CURVE_POINTS_MIN ||
+                   ctxt->om->om_data[0] > EQ_CURVE_POINTS_MAX)
                 {
-                    currentMux.index = old;
+                    return BLE_ATT_ERR_VALUE_NOT_ALLOWED;
                 }
+                ctx->curve_points = ctxt->om->om_data[0];
+                ctx->curve_flags  = ctxt->om->om_len == 2 ?
+                                    ctxt->om->om_data[1] & EQ_CURVE_FLAGS : 0;
                 break;
         }
     }
     return 0;
 }
 
+void ble_last_peer_load(void)
+{
+    nvs_handle_t handle;
+    size_t       len = sizeof(ble_addr_t);
+
+    if(nvs_open(BLE_NVS_NAMESPACE, NVS_READONLY, &handle) == ESP_OK)
+    {
+        last_peer_valid = (nvs_get_blob(handle, 
+                                        BLE_NVS_LAST_PEER_KEY, 
+                                        &last_peer, 
+                                        &len) == ESP_OK) && 
+                          (len == sizeof(ble_addr_t));
+        nvs_close(handle);
+    }
+}
+
+void ble_last_peer_store(const ble_addr_t *peer)
+{
+    nvs_handle_t handle;
+
+    // Don't wear the flash when the same phone reconnects.
+    if(last_peer_valid && ble_addr_cmp(&last_peer, peer) == 0)
+    {
+        return;
+    }
+
+    last_peer       = *peer;
+    last_peer_valid = true;
+
+    if(nvs_open(BLE_NVS_NAMESPACE, NVS_READWRITE, &handle) == ESP_OK)
+    {
+        if(nvs_set_blob(handle, 
+                        BLE_NVS_LAST_PEER_KEY, 
+                        peer, 
+                        sizeof(ble_addr_t)) == ESP_OK)
+        {
+            nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+}
+
+// Type, UUID and flags of every service and characteristic, in order.
+// Those decide the handles a client caches. Only 16 bit UUIDs are used.
+uint32_t ble_gatt_db_hash(void)
+{
+    uint32_t hash = 0;
+
+    for(const struct ble_gatt_svc_def *svc = gatt_svcs; svc->type != 0; svc++)
+    {
+        uint8_t entry[4] = {svc->type, svc->uuid->type,
+                            ble_uuid_u16(svc->uuid) & 0xFF,
+                            ble_uuid_u16(svc->uuid) >> 8};
+
+        hash = esp_crc32_le(hash, entry, sizeof(entry));
+        for(const struct ble_gatt_chr_def *chr = svc->characteristics; 
+            chr != NULL && chr->uuid != NULL; 
+            chr++)
+        {
+            uint8_t chr_entry[5] = {chr->uuid->type,
+                                    ble_uuid_u16(chr->uuid) & 0xFF,
+                                    ble_uuid_u16(chr->uuid) >> 8,
+                                    chr->flags & 0xFF,
+                                    chr->flags >> 8};
+
+            hash = esp_crc32_le(hash, chr_entry, sizeof(chr_entry));
+        }
+    }
+    return hash;
+}
+
+void ble_gatt_db_check_revision(void)
+{
+    nvs_handle_t handle;
+    uint32_t     revision = 0;
+    uint32_t     hash     = ble_gatt_db_hash();
+
+    if(nvs_open(BLE_NVS_NAMESPACE, NVS_READWRITE, &handle) == ESP_OK)
+    {
+        nvs_get_u32(handle, BLE_NVS_GATT_REV_KEY, &revision);
+        if(revision != hash)
+        {
+            // Bonded clients hold a stale cache of our database. NimBLE
+            // indicates the change to them, also when they reconnect later.
+            ESP_LOGI(TAG, "GATT database changed, notifying bonded clients.");
+            ble_svc_gatt_changed(0x0001, 0xFFFF);
+            if(nvs_set_u32(handle, BLE_NVS_GATT_REV_KEY, hash) == ESP_OK)
+            {
+                nvs_commit(handle);
+            }
+        }
+        nvs_close(handle);
+    }
+}
+
 // On sync callback function
 void ble_app_on_sync(void)
 {
     ble_hs_id_infer_auto(0, &ble_addr_type);
+    ble_gatt_db_check_revision();
     ble_app_advertise();                     
 }
 
 int ble_gap_event(struct ble_gap_event *event, void *arg)
 {
+    ble_conn_ctx_t *ctx;
+
     switch (event->type)
     {
     // Advertise if connected
@@ -641,18 +1060,82 @@ int ble_gap_event(struct ble_gap_event *event, void *arg)
         if (event->connect.status != 0)
         {
             ble_app_advertise();
+            break;
         }
-        else
+
+        ctx = ble_conn_ctx_open(event->connect.conn_handle);
+        if(ctx == NULL)
+        {
+            ESP_LOGW(TAG, "No free connection context, dropping client.");
+            ble_gap_terminate(event->connect.conn_handle, 
+                              BLE_ERR_CONN_LIMIT);
+            break;
+        }
+
+        update_current_eq(ctx);
+        update_current_mux(ctx);
+
+        // Bond with the client, a bonded client can skip service 
+        // discovery and is remembered for fast reconnection.
+        ble_gap_security_initiate(event->connect.conn_handle);
+
+        if(conn_amount == 1)
         {
             led_fade_stop();
             led_static();
         }
+        // Keep advertising while there is room for another client.
+        if(conn_amount < BLE_MAX_CONNECTIONS)
+        {
+            ble_app_advertise();
+        }
         break;
     case BLE_GAP_EVENT_DISCONNECT:
         ESP_LOGI(TAG, "Client disconnected.");
-        led_fade_start();
-        ble_app_advertise();
+        if(ble_conn_ctx_get(event->disconnect.conn.conn_handle) != NULL)
+        {
+            ble_conn_ctx_close(event->disconnect.conn.conn_handle);
+            if(conn_amount == 0)
+            {
+                led_fade_start();
+            }
+        }
+        // The last central walked out of range, give it a short burst of
+        // fast advertising so it reconnects right away.
+        if(event->disconnect.reason == BLE_HS_HCI_ERR(BLE_ERR_CONN_SPVN_TMO) &&
+           last_peer_valid &&
+           ble_addr_cmp(&event->disconnect.conn.peer_id_addr, &last_peer) == 0)
+        {
+            ble_app_advertise_fast();
+        }
+        else
+        {
+            ble_app_advertise();
+        }
         break;    
+    case BLE_GAP_EVENT_ENC_CHANGE:
+        if(event->enc_change.status == 0)
+        {
+            struct ble_gap_conn_desc desc;
+            if(ble_gap_conn_find(event->enc_change.conn_handle, &desc) == 0 &&
+               desc.sec_state.bonded)
+            {
+                ble_last_peer_store(&desc.peer_id_addr);
+            }
+        }
+        break;
+    case BLE_GAP_EVENT_REPEAT_PAIRING:
+        // The client lost its bond, forget ours and pair again.
+        {
+            struct ble_gap_conn_desc desc;
+            if(ble_gap_conn_find(event->repeat_pairing.conn_handle, 
+                                 &desc) == 0)
+            {
+                ble_store_util_delete_peer(&desc.peer_id_addr);
+            }
+        }
+        return BLE_GAP_REPEAT_PAIRING_RETRY;
+    // Fast burst or advertising is over, back to the normal interval.
     case BLE_GAP_EVENT_ADV_COMPLETE:
         ESP_LOGI(TAG, "BLE GAP EVENT");
         ble_app_advertise();
@@ -663,30 +1146,84 @@ int ble_gap_event(struct ble_gap_event *event, void *arg)
     return 0;
 }
 
-void ble_app_advertise(void)
+void ble_app_set_adv_fields(void)
 {
+    xSemaphoreTake(statusLock, portMAX_DELAY);
+    // Status record, see BLE_STATUS_LEN for the layout.
+    status_record[0]  = BLE_STATUS_COMPANY_ID & 0xFF;
+    status_record[1]  = BLE_STATUS_COMPANY_ID >> 8;
+    status_record[2]  = BLE_STATUS_FORMAT;
+    status_record[3]  = status.preset;
+    status_record[4]  = status.version & 0xFF;
+    status_record[5]  = (status.version >>  8) & 0xFF;
+    status_record[6]  = (status.version >> 16) & 0xFF;
+    status_record[7]  = status.version >> 24;
+    status_record[8]  = status.flags;
+    status_record[9]  = FIRMWARE_VERSION_MAJOR;
+    status_record[10] = FIRMWARE_VERSION_MINOR;
+    status_record[11] = FIRMWARE_VERSION_PATCH;
+
     // GAP - device name definition
     struct ble_hs_adv_fields fields;
     const char *device_name;
     memset(&fields, 0, sizeof(fields));
+    fields.flags = BLE_HS_ADV_F_DISC_GEN | BLE_HS_ADV_F_BREDR_UNSUP;
     device_name = ble_svc_gap_device_name(); 
     fields.name = (uint8_t *)device_name;
     fields.name_len = strlen(device_name);
     fields.name_is_complete = 1;
     fields.tx_pwr_lvl = -128; // auto power level is -128
+    fields.mfg_data     = status_record;
+    fields.mfg_data_len = BLE_STATUS_LEN;
     ble_gap_adv_set_fields(&fields);
+    xSemaphoreGive(statusLock);
+}
+
+void ble_app_advertise(void)
+{
+    ble_app_set_adv_fields();
 
     // GAP - device connectivity definition
     struct ble_gap_adv_params adv_params;
     memset(&adv_params, 0, sizeof(adv_params));
     adv_params.conn_mode = BLE_GAP_CONN_MODE_UND; 
     adv_params.disc_mode = BLE_GAP_DISC_MODE_GEN;
-    ble_gap_adv_start(ble_addr_type, 
-                      NULL, 
-                      BLE_HS_FOREVER, 
-                      &adv_params, 
-                      ble_gap_event, 
-                      NULL);
+    // Returns BLE_HS_EALREADY when we are still advertising, that's fine.
+    if(ble_gap_adv_start(ble_addr_type, 
+                         NULL, 
+                         BLE_HS_FOREVER, 
+                         &adv_params, 
+                         ble_gap_event, 
+                         NULL) == 0)
+    {
+        boot_profile_milestone(BOOT_MILESTONE_ADVERTISING);
+    }
+}
+
+void ble_app_advertise_fast(void)
+{
+    ble_app_set_adv_fields();
+
+    // Undirected, so any client can connect, at the shortest interval
+    // phones scan for.
+    struct ble_gap_adv_params adv_params;
+    memset(&adv_params, 0, sizeof(adv_params));
+    adv_params.conn_mode = BLE_GAP_CONN_MODE_UND;
+    adv_params.disc_mode = BLE_GAP_DISC_MODE_GEN;
+    adv_params.itvl_min  = BLE_FAST_ADV_ITVL;
+    adv_params.itvl_max  = BLE_FAST_ADV_ITVL;
+
+    // Advertising at the normal interval might still run for other clients.
+    ble_gap_adv_stop();
+    if(ble_gap_adv_start(ble_addr_type, 
+                         NULL, 
+                         BLE_FAST_ADV_MS, 
+                         &adv_params, 
+                         ble_gap_event, 
+                         NULL) != 0)
+    {
+        ble_app_advertise();
+    }
 }
 
 // The infinite RTOS task. This is the taks that runs the actual BLE stack
@@ -697,8 +1234,12 @@ void host_task(void *param)
 
 /******************************* GLOBAL FUNCTIONS ************************/
 
-bool init_ble(uint8_t* name, communication_t* communication_data)
+bool init_ble(uint8_t* name, 
+              communication_t** communication_data, 
+              uint8_t amount)
 {
+    boot_profile_begin(BOOT_PHASE_BLE);
+
     //https://github.com/SIMS-IOT-Devices/FreeRTOS-ESP-IDF-BLE-Server/blob/main/proj3.c
     /* Initialize NVS — it is used to store PHY calibration data */
     esp_err_t ret = nvs_flash_init();
@@ -711,31 +1252,96 @@ bool init_ble(uint8_t* name, communication_t* communication_data)
 
     ESP_LOGI(TAG, "Staring BLE...");
 
+    statusLock = xSemaphoreCreateMutex();
+
     esp_nimble_hci_init();
     nimble_port_init();
     ble_svc_gap_device_name_set((char*)name); 
     ble_svc_gap_init();                        
     ble_svc_gatt_init();
 
+    // Every connection context gets its own pipeline into the settings
+    // task. Contexts without one are never handed out. This has to be done
+    // before the host task runs, a client could connect right away.
+    for(int i = 0; i < BLE_MAX_CONNECTIONS; i++)
+    {
+        conn_ctx[i].in_use      = false;
+        conn_ctx[i].conn_handle = BLE_HS_CONN_HANDLE_NONE;
+        conn_ctx[i].to_settings = (communication_data != NULL && i < amount) ?
+                                  communication_data[i] : NULL;
+    }
+    if(amount < BLE_MAX_CONNECTIONS)
+    {
+        ESP_LOGW(TAG, "Only %d of %d connections have a pipeline.", 
+                 amount, 
+                 BLE_MAX_CONNECTIONS);
+    }
+
     ble_gatts_count_cfg(gatt_svcs); 
     ble_gatts_add_svcs(gatt_svcs);
     ble_hs_cfg.sync_cb = ble_app_on_sync;
+
+    // Just works bonding, keys are stored in NVS.
+    ble_hs_cfg.sm_io_cap         = BLE_HS_IO_NO_INPUT_OUTPUT;
+    ble_hs_cfg.sm_bonding        = 1;
+    ble_hs_cfg.sm_sc             = 1;
+    ble_hs_cfg.sm_our_key_dist   = BLE_SM_PAIR_KEY_DIST_ENC | 
+                                   BLE_SM_PAIR_KEY_DIST_ID;
+    ble_hs_cfg.sm_their_key_dist = BLE_SM_PAIR_KEY_DIST_ENC | 
+                                   BLE_SM_PAIR_KEY_DIST_ID;
+    ble_hs_cfg.store_status_cb   = ble_store_util_status_rr;
+    ble_store_config_init();
+    ble_last_peer_load();
     nimble_port_freertos_init(host_task);
 
     // Initialize led
-    if(led_init() && (communication_data != NULL))
-    {
-        toSettings = communication_data;
-
-        update_current_eq();
-        update_current_mux();
+    bool ledReady = led_init();
+    boot_profile_end(BOOT_PHASE_BLE);
 
+    if(ledReady && (communication_data != NULL))
+    {
         led_fade_start();
         return true;
     }
     return false;
 }
 
+void ble_refresh_status(void)
+{
+    uint32_t version = device_settings_get_version();
+    uint8_t  flags   = 0;
+    bool     changed;
+
+    if(boot_profile_failed(BOOT_PHASE_DSP_CONTROL))
+    {
+        flags |= BLE_STATUS_FLAG_DSP_FAILED;
+    }
+
+    xSemaphoreTake(statusLock, portMAX_DELAY);
+    changed = status_dirty || version != status.version || flags != status.flags;
+    if(changed)
+    {
+        status.version = version;
+        status.flags   = flags;
+        status_dirty   = false;
+    }
+    xSemaphoreGive(statusLock);
+
+    if(changed)
+    {
+        // Allowed while advertising, the next advertisement carries it.
+        ble_app_set_adv_fields();
+    }
+}
+
+void ble_set_status_preset(uint8_t preset)
+{
+    xSemaphoreTake(statusLock, portMAX_DELAY);
+    status.preset = preset;
+    status_dirty  = true;
+    xSemaphoreGive(statusLock);
+}
+
 void set_event_handler(void (*event_handler)(dsp_event_t))
 {   
     ble_event_handler = event_handler; 
@@ -19,7 +19,9 @@
 #include <stdint.h>
 #include "esp_log.h"
 #include "esp_err.h"
+#include "sdkconfig.h"
 #include "event.h"
+#include "freertos/semphr.h"
 #include "nvs_flash.h"
 #include "esp_nimble_hci.h"
 #include "nimble/nimble_port.h"
@@ -30,30 +32,124 @@
 #include "console/console.h"
 #include "services/gap/ble_svc_gap.h"
 #include "services/gatt/ble_svc_gatt.h"
+#include "nvs.h"
+#include "esp_crc.h"
 #include "buffer.h"
 #include "device_settings.h"
 #include "led.h"
+#include "firmware_version.h"
+#include "trace.h"
+#include "telemetry.h"
+#include "boot_profile.h"
+#include "eq_curve.h"
 
 /******************************* DEFINES *********************************/
 
 #define CHAN_TOTAL DEVICE_SETTINGS_INPUT_AMOUNT + DEVICE_SETTINGS_OUTPUT_AMOUNT
 
+#define BLE_MAX_CONNECTIONS CONFIG_BT_NIMBLE_MAX_CONNECTIONS
+
+// Burst of fast undirected advertising after the last client walked out
+// of range. Directed advertising would need the resolving list, phones
+// with a private address don't answer it at their identity address.
+#define BLE_FAST_ADV_MS     5000
+#define BLE_FAST_ADV_ITVL   32      /* 0.625 ms units, 20 ms             */
+
+#define BLE_NVS_NAMESPACE     "easydsp_ble"
+#define BLE_NVS_LAST_PEER_KEY "last_peer"
+#define BLE_NVS_GATT_REV_KEY  "gatt_rev"
+
+// Bonded clients cache our GATT database and skip discovery. A hash of
+// gatt_svcs is kept in NVS, a changed table gets them a Service Changed
+// indication.
+
+// Status record in the manufacturer specific advertising data, lets a 
+// scanner watch units without connecting. Layout (little endian):
+//   u16 company id, u8 format, u8 active preset, u32 settings version,
+//   u8 flags (BLE_STATUS_FLAG_*), u8 firmware major, u8 minor, u8 patch
+// 0xFFFF is the ID the SIG reserves for testing, a product that ships
+// defines its assigned company ID in the build.
+#ifndef BLE_STATUS_COMPANY_ID
+#define BLE_STATUS_COMPANY_ID  0xFFFF
+#endif
+#define BLE_STATUS_FORMAT      2
+#define BLE_STATUS_LEN         12
+
+// Not every DSP came up, the unit runs without audio on their outputs.
+#define BLE_STATUS_FLAG_DSP_FAILED 0x01
+
 /******************************* TYPEDEFS ********************************/
 
+typedef struct
+{
+    uint8_t  preset;
+    uint32_t version;
+    uint8_t  flags;
+} ble_status_t;
+
+// Selection state of a single connected client. Every connection has its
+// own context and its own pipeline into the settings task.
+typedef struct
+{
+    bool     in_use;
+    uint16_t conn_handle;
+
+    uint8_t  channel_index;
+    uint8_t  eq_index;
+    bool     is_output;
+    // DSP of the settings snapshot.
+    uint8_t  dsp_index;
+
+    equalizer_t current_eq;
+    mux_t       current_mux;
+
+    // Curve of the selected channel, see eq_curve.h.
+    uint8_t     curve_points;
+    uint8_t     curve_flags;
+
+    communication_t*     to_settings;
+    dsp_event_t          event;
+    dsp_event_response_t event_response;
+} ble_conn_ctx_t;
+
 /******************************* LOCAL FUNCTIONS *************************/
 
+ble_conn_ctx_t* ble_conn_ctx_get(uint16_t conn_handle);
+
+ble_conn_ctx_t* ble_conn_ctx_open(uint16_t conn_handle);
+
+void ble_conn_ctx_close(uint16_t conn_handle);
+
 void ble_app_on_sync(void);
 
 int ble_gap_event(struct ble_gap_event *event, void *arg);
 
 void ble_app_advertise(void);
 
+void ble_app_advertise_fast(void);
+
+void ble_app_set_adv_fields(void);
+
+void ble_last_peer_load(void);
+
+void ble_last_peer_store(const ble_addr_t *peer);
+
+uint32_t ble_gatt_db_hash(void);
+
+void ble_gatt_db_check_revision(void);
+
+// Provided by NimBLE, persists bonds in NVS.
+void ble_store_config_init(void);
+
 void host_task(void *param);
 
-bool send_current_eq(void);
-bool send_current_mux(void);
-bool update_current_eq(void);
-bool update_current_mux(void);
+bool ble_get_hundredths(struct os_mbuf *om, float *value);
+
+bool send_current_eq(ble_conn_ctx_t *ctx);
+bool send_current_mux(ble_conn_ctx_t *ctx);
+bool update_current_eq(ble_conn_ctx_t *ctx);
+bool update_current_mux(ble_conn_ctx_t *ctx);
+bool send_preset(ble_conn_ctx_t *ctx, uint8_t preset);
 
 /******************************* CHARACTERSTIC CALLBACKS *****************/
 
@@ -121,9 +217,43 @@ int mux_action(uint16_t con_handle,
                  struct ble_gatt_access_ctxt *ctxt, 
                  void *arg);   
 
+int settings_blob_action(uint16_t con_handle, 
+                         uint16_t attr_handle, 
+                         struct ble_gatt_access_ctxt *ctxt, 
+                         void *arg);
+
+int preset_action(uint16_t con_handle, 
+                  uint16_t attr_handle, 
+                  struct ble_gatt_access_ctxt *ctxt, 
+                  void *arg);
+
+int trace_action(uint16_t con_handle, 
+                 uint16_t attr_handle, 
+                 struct ble_gatt_access_ctxt *ctxt, 
+                 void *arg);
+
+int telemetry_action(uint16_t con_handle, 
+                     uint16_t attr_handle, 
+                     struct ble_gatt_access_ctxt *ctxt, 
+                     void *arg);
+
+int eq_curve_action(uint16_t con_handle, 
+                    uint16_t attr_handle, 
+                    struct ble_gatt_access_ctxt *ctxt, 
+                    void *arg);
+
 /******************************* GLOBAL FUNCTIONS ************************/
 
-bool init_ble(uint8_t* name, communication_t* communication_data);
+// Takes one communication per simultaneous connection.
+bool init_ble(uint8_t* name, 
+              communication_t** communication_data, 
+              uint8_t amount);
+
+// Call periodically, refreshes the advertised status record when the 
+// settings or status changed.
+void ble_refresh_status(void);
+
+void ble_set_status_preset(uint8_t preset);
 
 void set_event_handler(void (*event_handler)(dsp_event_t));
 void remove_event_handler(void);
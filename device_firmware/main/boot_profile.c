@@ -0,0 +1,248 @@
+/*
+ * boot_profile.c
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Boot timeline, see boot_profile.h.
+ *
+ */
+/******************************* INCLUDES ********************************/
+
+#include "boot_profile.h"
+
+/******************************* GLOBAL VARIABLES ************************/
+
+static const char *TAG = "Boot";
+
+static portMUX_TYPE   profile_lock = portMUX_INITIALIZER_UNLOCKED;
+static boot_profile_t profile;
+static bool           stored = false;
+
+static const char *phase_names[BOOT_PHASE_AMOUNT] = {
+    "app_main",
+    "dsp_control",
+    "dsp_image",
+    "dsp_check",
+    "dsp_reset",
+    "dsp_download",
+    "dsp_stop",
+    "dsp_program",
+    "dsp_parameter",
+    "dsp_hw_conf",
+    "dsp_start",
+    "settings",
+    "settings_push",
+    "ble",
+};
+
+/******************************* LOCAL FUNCTIONS *************************/
+
+static uint32_t boot_profile_now(void)
+{
+    // Never 0, that means not reached.
+    return (uint32_t)esp_timer_get_time() | 1;
+}
+
+// The boot is done when the settings are pushed and both milestones are
+// reached, or a phase failed and there won't be audio. Only called with
+// the lock taken.
+bool boot_profile_done(void)
+{
+    return profile.end[BOOT_PHASE_SETTINGS_PUSH] != 0 &&
+           (profile.milestones[BOOT_MILESTONE_AUDIO] != 0 ||
+            profile.failed != 0) &&
+           profile.milestones[BOOT_MILESTONE_ADVERTISING] != 0;
+}
+
+// Stores the profile once the boot is done. NVS is up by then, 
+// init_ble() initializes it before advertising starts.
+static void boot_profile_check(void)
+{
+    bool store = false;
+
+    taskENTER_CRITICAL(&profile_lock);
+    if(!stored && boot_profile_done())
+    {
+        stored = true;
+        store  = true;
+    }
+    taskEXIT_CRITICAL(&profile_lock);
+
+    if(store)
+    {
+        boot_profile_store();
+    }
+}
+
+// Reads the stored boots, oldest first. Returns the amount.
+uint8_t boot_profile_history(boot_profile_t *history)
+{
+    nvs_handle_t handle;
+    size_t       len    = BOOT_PROFILE_HISTORY * sizeof(boot_profile_t);
+    uint8_t      amount = 0;
+
+    if(nvs_open(BOOT_PROFILE_NVS_NAMESPACE, NVS_READONLY, &handle) == ESP_OK)
+    {
+        if(nvs_get_blob(handle, BOOT_PROFILE_NVS_KEY, history, &len) == ESP_OK &&
+           len % sizeof(boot_profile_t) == 0)
+        {
+            amount = len / sizeof(boot_profile_t);
+        }
+        nvs_close(handle);
+    }
+    return amount;
+}
+
+void boot_profile_store(void)
+{
+    static boot_profile_t history[BOOT_PROFILE_HISTORY];
+    nvs_handle_t          handle;
+    uint8_t               amount = boot_profile_history(history);
+
+    profile.boot         = amount ? history[amount - 1].boot + 1 : 0;
+    profile.reset_reason = esp_reset_reason();
+
+    if(amount == BOOT_PROFILE_HISTORY)
+    {
+        memmove(&history[0], &history[1], 
+                (BOOT_PROFILE_HISTORY - 1) * sizeof(boot_profile_t));
+        amount--;
+    }
+    history[amount++] = profile;
+
+    if(nvs_open(BOOT_PROFILE_NVS_NAMESPACE, NVS_READWRITE, &handle) == ESP_OK)
+    {
+        if(nvs_set_blob(handle, 
+                        BOOT_PROFILE_NVS_KEY, 
+                        history, 
+                        amount * sizeof(boot_profile_t)) == ESP_OK)
+        {
+            nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+
+    ESP_LOGI(TAG, "Boot %d: first audio at %d ms, advertising at %d ms.",
+             (int)profile.boot,
+             (int)(profile.milestones[BOOT_MILESTONE_AUDIO] / 1000),
+             (int)(profile.milestones[BOOT_MILESTONE_ADVERTISING] / 1000));
+}
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+void boot_profile_begin(uint8_t phase)
+{
+    uint32_t now = boot_profile_now();
+
+    if(phase < BOOT_PHASE_AMOUNT)
+    {
+        taskENTER_CRITICAL(&profile_lock);
+        if(profile.start[phase] == 0)
+        {
+            profile.start[phase] = now;
+        }
+        taskEXIT_CRITICAL(&profile_lock);
+    }
+}
+
+void boot_profile_end(uint8_t phase)
+{
+    uint32_t now = boot_profile_now();
+
+    if(phase < BOOT_PHASE_AMOUNT)
+    {
+        taskENTER_CRITICAL(&profile_lock);
+        if(now > profile.end[phase])
+        {
+            profile.end[phase] = now;
+        }
+        taskEXIT_CRITICAL(&profile_lock);
+        boot_profile_check();
+    }
+}
+
+void boot_profile_fail(uint8_t phase)
+{
+    if(phase < BOOT_PHASE_AMOUNT)
+    {
+        taskENTER_CRITICAL(&profile_lock);
+        profile.failed |= 1 << phase;
+        taskEXIT_CRITICAL(&profile_lock);
+        boot_profile_end(phase);
+    }
+}
+
+bool boot_profile_failed(uint8_t phase)
+{
+    bool failed;
+
+    taskENTER_CRITICAL(&profile_lock);
+    failed = phase < BOOT_PHASE_AMOUNT && (profile.failed & (1 << phase));
+    taskEXIT_CRITICAL(&profile_lock);
+
+    return failed;
+}
+
+void boot_profile_milestone(uint8_t milestone)
+{
+    uint32_t now = boot_profile_now();
+
+    if(milestone < BOOT_MILESTONE_AMOUNT)
+    {
+        taskENTER_CRITICAL(&profile_lock);
+        if(profile.milestones[milestone] == 0)
+        {
+            profile.milestones[milestone] = now;
+        }
+        taskEXIT_CRITICAL(&profile_lock);
+        boot_profile_check();
+    }
+}
+
+void boot_profile_print(void)
+{
+    static boot_profile_t history[BOOT_PROFILE_HISTORY];
+    boot_profile_t        current;
+    uint8_t               amount = boot_profile_history(history);
+
+    taskENTER_CRITICAL(&profile_lock);
+    current = profile;
+    taskEXIT_CRITICAL(&profile_lock);
+
+    printf("%-14s %10s %10s\n", "phase", "start ms", "length ms");
+    for(int i = 0; i < BOOT_PHASE_AMOUNT; i++)
+    {
+        if(current.start[i] == 0)
+        {
+            printf("%-14s %10s\n", phase_names[i], "-");
+            continue;
+        }
+        printf("%-14s %10.1f %10.1f%s\n",
+               phase_names[i],
+               current.start[i] / 1000.0,
+               current.end[i] > current.start[i] ? 
+               (current.end[i] - current.start[i]) / 1000.0 : 0.0,
+               (current.failed & (1 << i)) ? " failed" : "");
+    }
+    printf("first audio %.1f ms, advertising %.1f ms\n",
+           current.milestones[BOOT_MILESTONE_AUDIO] / 1000.0,
+           current.milestones[BOOT_MILESTONE_ADVERTISING] / 1000.0);
+
+    // Enough to spot a regression, the full timelines are in NVS.
+    printf("\n%6s %6s %10s %10s %10s %8s\n", 
+           "boot", "reset", "audio ms", "adv ms", "dsp ms", "failed");
+    for(int i = 0; i < amount; i++)
+    {
+        printf("%6lu %6u %10.1f %10.1f %10.1f   0x%04x\n",
+               (unsigned long)history[i].boot,
+               history[i].reset_reason,
+               history[i].milestones[BOOT_MILESTONE_AUDIO] / 1000.0,
+               history[i].milestones[BOOT_MILESTONE_ADVERTISING] / 1000.0,
+               (history[i].end[BOOT_PHASE_DSP_CONTROL] - 
+                history[i].start[BOOT_PHASE_DSP_CONTROL]) / 1000.0,
+               history[i].failed);
+    }
+}
+
+/******************************* THE END *********************************/
@@ -0,0 +1,103 @@
+/*
+ * boot_profile.h
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Boot timeline. The startup code marks the start and end of its phases
+ * and two milestones: first audio, when every DSP runs its program, and
+ * the first advertisement. Times are esp_timer microseconds.
+ *
+ * Phases that run once per DSP keep the earliest start and latest end, 
+ * the DSPs are programmed in parallel. Once the boot is done the profile
+ * is added to the last BOOT_PROFILE_HISTORY boots in NVS. A boot where a
+ * phase failed never reaches first audio, it is stored once advertising
+ * started.
+ *
+ */
+#ifndef BOOT_PROFILE_H_
+#define BOOT_PROFILE_H_
+
+/******************************* INCLUDES ********************************/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_system.h"
+#include "nvs.h"
+#include "freertos/FreeRTOS.h"
+
+/******************************* DEFINES *********************************/
+
+#define BOOT_PHASE_APP_MAIN       0
+#define BOOT_PHASE_DSP_CONTROL    1  /* init_dsp_control()            */
+#define BOOT_PHASE_DSP_IMAGE      2  /* Map image, load shadow        */
+#define BOOT_PHASE_DSP_CHECK      3  /* Is the image already running  */
+#define BOOT_PHASE_DSP_RESET      4
+#define BOOT_PHASE_DSP_DOWNLOAD   5
+// Parts of the download, by section type of the image.
+#define BOOT_PHASE_DSP_STOP       6  /* Core control before the RAMs  */
+#define BOOT_PHASE_DSP_PROGRAM    7
+#define BOOT_PHASE_DSP_PARAMETER  8
+#define BOOT_PHASE_DSP_HW_CONF    9
+#define BOOT_PHASE_DSP_START      10 /* Core control and marker       */
+#define BOOT_PHASE_SETTINGS       11 /* init_device_settings(), load  */
+#define BOOT_PHASE_SETTINGS_PUSH  12 /* Settings sent to the DSPs     */
+#define BOOT_PHASE_BLE            13 /* init_ble()                    */
+#define BOOT_PHASE_AMOUNT         14
+
+#define BOOT_MILESTONE_AUDIO       0
+#define BOOT_MILESTONE_ADVERTISING 1
+#define BOOT_MILESTONE_AMOUNT      2
+
+#define BOOT_PROFILE_HISTORY      8
+#define BOOT_PROFILE_NVS_NAMESPACE "easydsp_boot"
+#define BOOT_PROFILE_NVS_KEY      "history2"
+
+/******************************* TYPEDEFS ********************************/
+
+// Stored as is, change BOOT_PROFILE_NVS_KEY when the layout changes. 
+// A time of 0 means not reached.
+typedef struct
+{
+    uint32_t boot;                /* Boots since the history started */
+    uint8_t  reset_reason;        /* esp_reset_reason_t              */
+    uint8_t  reserved;
+    uint16_t failed;              /* Bit per phase that failed       */
+    uint32_t start[BOOT_PHASE_AMOUNT];
+    uint32_t end[BOOT_PHASE_AMOUNT];
+    uint32_t milestones[BOOT_MILESTONE_AMOUNT];
+} boot_profile_t;
+
+/******************************* LOCAL FUNCTIONS *************************/
+
+bool boot_profile_done(void);
+
+void boot_profile_store(void);
+
+uint8_t boot_profile_history(boot_profile_t *history);
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+void boot_profile_begin(uint8_t phase);
+
+void boot_profile_end(uint8_t phase);
+
+// Ends the phase and marks it failed.
+void boot_profile_fail(uint8_t phase);
+
+// True when the phase failed during this boot.
+bool boot_profile_failed(uint8_t phase);
+
+// Only the first time a milestone is reached counts.
+void boot_profile_milestone(uint8_t milestone);
+
+// Prints the timeline of this boot and a line per stored boot.
+void boot_profile_print(void);
+
+/******************************* THE END *********************************/
+
+#endif /* BOOT_PROFILE_H_ */
@@ -0,0 +1,444 @@
+/*
+ * capture.c
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Capture of the command stream of the settings task, see capture.h.
+ *
+ */
+/******************************* INCLUDES ********************************/
+
+#include "capture.h"
+
+/******************************* GLOBAL VARIABLES ************************/
+
+static const char *TAG = "Capture";
+
+static const esp_partition_t *partition = NULL;
+static QueueHandle_t         queue      = NULL;
+static SemaphoreHandle_t     stopped    = NULL;
+static volatile bool         running    = false;
+
+// Used by the settings task while running, set by capture_start() before
+// running is. Volatile keeps that order.
+static volatile int64_t  lastTime     = 0;
+static volatile uint32_t queueDropped = 0;
+
+// Only used by the capture task.
+static uint8_t           buffer[CAPTURE_BUFFER_SIZE];
+static uint32_t          fill         = 0;
+static volatile uint32_t written      = 0;
+static volatile uint32_t records      = 0;
+static volatile uint32_t fullDropped  = 0;
+static volatile uint32_t flushes      = 0;
+
+/******************************* LOCAL FUNCTIONS *************************/
+
+static uint8_t* put_u16(uint8_t *buf, uint16_t value)
+{
+    *buf++ = value;
+    *buf++ = value >> 8;
+    return buf;
+}
+
+static uint8_t* put_u32(uint8_t *buf, uint32_t value)
+{
+    *buf++ = value;
+    *buf++ = value >> 8;
+    *buf++ = value >> 16;
+    *buf++ = value >> 24;
+    return buf;
+}
+
+static uint16_t get_u16(const uint8_t *buf)
+{
+    return buf[0] | (buf[1] << 8);
+}
+
+static uint32_t get_u32(const uint8_t *buf)
+{
+    return buf[0] | (buf[1] << 8) | (buf[2] << 16) | ((uint32_t)buf[3] << 24);
+}
+
+// Hundredths, rounded so a value that came in as hundredths comes back
+// the same.
+static uint8_t* put_eq(uint8_t *buf, const equalizer_t *eq)
+{
+    buf = put_u16(buf, (uint16_t)lroundf(eq->q         * 100));
+    buf = put_u16(buf, (uint16_t)lroundf(eq->s         * 100));
+    buf = put_u16(buf, (uint16_t)lroundf(eq->bandwidth * 100));
+    buf = put_u16(buf, (uint16_t)(int16_t)lroundf(eq->boost * 100));
+    buf = put_u16(buf, (uint16_t)(int16_t)lroundf(eq->gain  * 100));
+    buf = put_u32(buf, (uint32_t)lroundf(eq->freq      * 100));
+    *buf = (eq->filter_type & 0x0F) |
+           ((eq->phase & 0x01) << 4) |
+           ((eq->state & 0x01) << 5);
+    return buf + 1;
+}
+
+static void get_eq(const uint8_t *buf, equalizer_t *eq)
+{
+    eq->q           = (float)get_u16(buf + 0) / 100;
+    eq->s           = (float)get_u16(buf + 2) / 100;
+    eq->bandwidth   = (float)get_u16(buf + 4) / 100;
+    eq->boost       = (float)(int16_t)get_u16(buf + 6) / 100;
+    eq->gain        = (float)(int16_t)get_u16(buf + 8) / 100;
+    eq->freq        = (float)get_u32(buf + 10) / 100;
+    eq->filter_type = buf[14] & 0x0F;
+    eq->phase       = (buf[14] >> 4) & 0x01;
+    eq->state       = (buf[14] >> 5) & 0x01;
+}
+
+/* Function: capture_task
+ *
+ * Collects the queued records in a buffer of a sector and writes it when
+ * it is full, when no record came for CAPTURE_IDLE_FLUSH_MS or at the
+ * end of the trace. A trace begins with the start record and ends with
+ * the end record. The settings task can queue a record just after the
+ * end record when it raced with capture_stop(), those are dropped.
+ *
+ */
+void capture_task(void *pvParameters)
+{
+    capture_record_t record;
+    bool             active = false;
+
+    for(;;)
+    {
+        if(xQueueReceive(queue, &record, pdMS_TO_TICKS(CAPTURE_IDLE_FLUSH_MS)))
+        {
+            if(record.data[0] == CAPTURE_RECORD_START)
+            {
+                uint8_t header[CAPTURE_HEADER_LEN] = {0};
+
+                put_u32(header, CAPTURE_MAGIC);
+                header[4] = CAPTURE_FORMAT;
+                header[5] = SETTINGS_INTERFACE_AMOUNT;
+
+                fill        = 0;
+                written     = 0;
+                records     = 0;
+                flushes     = 0;
+                fullDropped = 0;
+                capture_append(header, sizeof(header));
+                active = true;
+            }
+            else if(!active)
+            {
+                // After the end record, not part of the trace.
+            }
+            else if(record.data[0] == CAPTURE_RECORD_END)
+            {
+                uint8_t end[CAPTURE_END_LEN];
+
+                end[0] = CAPTURE_RECORD_END;
+                put_u32(&end[1], records);
+                put_u32(&end[5], queueDropped + fullDropped);
+                capture_append(end, sizeof(end));
+                capture_flush();
+                active = false;
+                xSemaphoreGive(stopped);
+            }
+            // The end record always fits, there is room kept for it.
+            else if(written + fill + record.len + CAPTURE_END_LEN <=
+                    partition->size)
+            {
+                capture_append(record.data, record.len);
+                records++;
+            }
+            else
+            {
+                fullDropped++;
+            }
+        }
+        else if(fill > 0)
+        {
+            capture_flush();
+        }
+    }
+}
+
+uint8_t capture_encode(const dsp_event_t *event,
+                       uint8_t           interface,
+                       uint32_t          delta_us,
+                       uint8_t           *buf)
+{
+    uint8_t *start = buf;
+
+    *buf++ = event->event_type;
+    *buf++ = (interface & CAPTURE_INTERFACE_MASK) |
+             (event->output ? CAPTURE_FLAG_OUTPUT : 0);
+    buf    = put_u32(buf, delta_us);
+    *buf++ = event->chan_num;
+    *buf++ = event->eq_num;
+
+    switch(event->event_type)
+    {
+        case DSP_SET_EQ:
+            buf = put_eq(buf, &event->eq);
+            break;
+        case DSP_SET_MUX:
+            *buf++ = event->mux.index;
+            break;
+        case DSP_SET_PRESET:
+            *buf++ = event->preset;
+            break;
+    }
+    return buf - start;
+}
+
+void capture_append(const uint8_t *data, uint8_t len)
+{
+    if(fill + len > sizeof(buffer))
+    {
+        capture_flush();
+    }
+    memcpy(&buffer[fill], data, len);
+    fill += len;
+}
+
+// The partition is erased at the start, the buffer goes right after what
+// was written before.
+void capture_flush(void)
+{
+    if(fill == 0)
+    {
+        return;
+    }
+    if(esp_partition_write(partition, written, buffer, fill) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Unable to write the trace at 0x%lx",
+                 (unsigned long)written);
+    }
+    written += fill;
+    fill     = 0;
+    flushes++;
+}
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+uint8_t init_capture(void)
+{
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                         CAPTURE_PARTITION_SUBTYPE,
+                                         CAPTURE_PARTITION_LABEL);
+    if(partition == NULL)
+    {
+        ESP_LOGW(TAG, "No capture partition.");
+        return CAPTURE_INIT_FAILED;
+    }
+    queue   = xQueueCreate(CAPTURE_QUEUE_LEN, sizeof(capture_record_t));
+    stopped = xSemaphoreCreateBinary();
+    if(queue != NULL && stopped != NULL &&
+       xTaskCreatePinnedToCore(capture_task,
+                               "Capture",
+                               CAPTURE_STACK_SIZE,
+                               NULL,
+                               CAPTURE_PRIORITY,
+                               NULL,
+                               tskNO_AFFINITY) == pdPASS)
+    {
+        return CAPTURE_INIT_SUCCESS;
+    }
+    ESP_LOGE(TAG, "Unable to start capture!");
+    return CAPTURE_INIT_FAILED;
+}
+
+bool capture_start(void)
+{
+    capture_record_t start = {.len = 1, .data = {CAPTURE_RECORD_START}};
+
+    if(queue == NULL || running)
+    {
+        return false;
+    }
+    if(esp_partition_erase_range(partition, 0, partition->size) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Unable to erase the capture partition!");
+        return false;
+    }
+
+
+    // The start record goes first, the events queued once running is set
+    // come after it.
+    queueDropped = 0;
+    if(!xQueueSend(queue, &start, pdMS_TO_TICKS(CAPTURE_STOP_TIMEOUT_MS)))
+    {
+        return false;
+    }
+    lastTime = esp_timer_get_time();
+    running  = true;
+    ESP_LOGI(TAG, "Capturing to %s, %lu bytes.", partition->label,
+             (unsigned long)partition->size);
+    return true;
+}
+
+bool capture_stop(void)
+{
+    capture_record_t end = {.len = 1, .data = {CAPTURE_RECORD_END}};
+
+    if(queue == NULL || !running)
+    {
+        return false;
+    }
+    running = false;
+    xSemaphoreTake(stopped, 0);
+    return xQueueSend(queue, &end, pdMS_TO_TICKS(CAPTURE_STOP_TIMEOUT_MS)) &&
+           xSemaphoreTake(stopped, pdMS_TO_TICKS(CAPTURE_STOP_TIMEOUT_MS));
+}
+
+void capture_event(const dsp_event_t *event, uint8_t interface)
+{
+    capture_record_t record;
+    int64_t          now;
+    int64_t          delta;
+
+    if(!running)
+    {
+        return;
+    }
+    now      = esp_timer_get_time();
+    delta    = now - lastTime;
+    lastTime = now;
+
+    record.len = capture_encode(event, interface,
+                                delta > UINT32_MAX ? UINT32_MAX : delta,
+                                record.data);
+    if(xQueueSend(queue, &record, 0) != pdTRUE)
+    {
+        queueDropped++;
+    }
+}
+
+void capture_get_stats(capture_stats_t *stats)
+{
+    stats->running = running;
+    stats->records = records;
+    stats->dropped = queueDropped + fullDropped;
+    stats->bytes   = written + fill;
+    stats->flushes = flushes;
+}
+
+bool capture_check_header(const uint8_t *buf, uint32_t len)
+{
+    return len >= CAPTURE_HEADER_LEN &&
+           get_u32(buf) == CAPTURE_MAGIC &&
+           buf[4] == CAPTURE_FORMAT;
+}
+
+uint8_t capture_decode(const uint8_t *buf, uint32_t len, capture_event_t *out)
+{
+    uint8_t size = CAPTURE_RECORD_HEADER;
+
+    if(len < CAPTURE_RECORD_HEADER)
+    {
+        return 0;
+    }
+    switch(buf[0])
+    {
+        case DSP_SET_EQ:
+            size += CAPTURE_EQ_LEN;
+            break;
+        case DSP_SET_MUX:
+        case DSP_SET_PRESET:
+            size += 1;
+            break;
+        case DSP_SET_GAIN:
+        case DSP_GET_EQ:
+        case DSP_GET_MUX:
+        case DSP_GET_GAIN:
+            break;
+        // The end, erased flash or not a record.
+        default:
+            return 0;
+    }
+    if(len < size)
+    {
+        return 0;
+    }
+
+    memset(out, 0, sizeof(capture_event_t));
+    out->event.event_type = buf[0];
+    out->event.output     = (buf[1] & CAPTURE_FLAG_OUTPUT) != 0;
+    out->interface        = buf[1] & CAPTURE_INTERFACE_MASK;
+    out->delta_us         = get_u32(&buf[2]);
+    out->event.chan_num   = buf[6];
+    out->event.eq_num     = buf[7];
+
+    switch(buf[0])
+    {
+        case DSP_SET_EQ:
+            get_eq(&buf[CAPTURE_RECORD_HEADER], &out->event.eq);
+            break;
+        case DSP_SET_MUX:
+            out->event.mux.index = buf[CAPTURE_RECORD_HEADER];
+            break;
+        case DSP_SET_PRESET:
+            out->event.preset = buf[CAPTURE_RECORD_HEADER];
+            break;
+    }
+    return size;
+}
+
+void capture_print_status(void)
+{
+    capture_stats_t stats;
+
+    capture_get_stats(&stats);
+    printf("capture %s, %lu records, %lu dropped, %lu bytes in %lu writes\n",
+           stats.running ? "running" : "stopped",
+           (unsigned long)stats.records,
+           (unsigned long)stats.dropped,
+           (unsigned long)stats.bytes,
+           (unsigned long)stats.flushes);
+}
+
+void capture_print_dump(void)
+{
+    const uint8_t               *trace;
+    esp_partition_mmap_handle_t handle;
+    capture_event_t             event;
+    uint32_t                    len;
+
+    if(partition == NULL || running ||
+       esp_partition_mmap(partition, 0, partition->size,
+                          ESP_PARTITION_MMAP_DATA,
+                          (const void**)&trace, &handle) != ESP_OK)
+    {
+        printf("No trace to dump\n");
+        return;
+    }
+    if(!capture_check_header(trace, partition->size))
+    {
+        printf("No trace to dump\n");
+        esp_partition_munmap(handle);
+        return;
+    }
+
+    // Up to and with the end record.
+    len = CAPTURE_HEADER_LEN;
+    for(;;)
+    {
+        uint8_t size = capture_decode(&trace[len], partition->size - len, &event);
+
+        if(size == 0)
+        {
+            if(trace[len] == CAPTURE_RECORD_END &&
+               len + CAPTURE_END_LEN <= partition->size)
+            {
+                len += CAPTURE_END_LEN;
+            }
+            break;
+        }
+        len += size;
+    }
+
+    for(uint32_t i = 0; i < len; i++)
+    {
+        printf("%02x%s", trace[i], (i % 32 == 31 || i + 1 == len) ? "\n" : "");
+    }
+    esp_partition_munmap(handle);
+}
+
+/******************************* THE END *********************************/
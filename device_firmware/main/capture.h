@@ -0,0 +1,155 @@
+/*
+ * capture.h
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Capture of the commands the settings task receives, from BLE or any
+ * other interface, as a compact binary trace in the capture partition.
+ * A session recorded on a unit can be replayed against the firmware on
+ * the host with host/tools/replay_bench.
+ *
+ * The settings task only encodes the event and queues it, it never
+ * waits. A low priority task collects the records and writes them to
+ * flash once a sector worth has been collected, the capture is idle or
+ * stopped. Records that don't fit in the queue or the partition are
+ * dropped and counted. Starting erases the partition, so a capture cut
+ * short by a reset ends at the first erased byte.
+ *
+ * Trace, little endian:
+ *   u32 magic, u8 format, u8 interface amount, u16 reserved,
+ *   records until an end record or an erased (0xFF) byte.
+ * Record:
+ *   u8 event type, u8 interface | output << 7,
+ *   u32 us since the previous record (since the start for the first),
+ *   u8 channel, u8 eq,
+ *   DSP_SET_EQ:     the eq as in DEVICE_SETTINGS_BLOB_EQ_LEN, rounded
+ *   DSP_SET_MUX:    u8 mux index
+ *   DSP_SET_PRESET: u8 preset
+ * End record:
+ *   u8 CAPTURE_RECORD_END, u32 records, u32 dropped
+ *
+ * The BLE characteristics take hundredths, so the eq of a BLE write is
+ * captured exactly.
+ *
+ */
+#ifndef CAPTURE_H_
+#define CAPTURE_H_
+
+/******************************* INCLUDES ********************************/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include "esp_log.h"
+#include "esp_err.h"
+#include "esp_timer.h"
+#include "esp_partition.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "event.h"
+
+/******************************* DEFINES *********************************/
+
+#define CAPTURE_PARTITION_LABEL   "capture"
+#define CAPTURE_PARTITION_SUBTYPE 0x41
+
+#define CAPTURE_STACK_SIZE        3072
+#define CAPTURE_PRIORITY          1
+#define CAPTURE_QUEUE_LEN         32
+#define CAPTURE_BUFFER_SIZE       4096    /* A flash sector             */
+#define CAPTURE_IDLE_FLUSH_MS     1000
+#define CAPTURE_STOP_TIMEOUT_MS   2000
+
+#define CAPTURE_MAGIC             0x31434445  /* "EDC1" */
+#define CAPTURE_FORMAT            1
+#define CAPTURE_HEADER_LEN        8
+#define CAPTURE_RECORD_HEADER     8
+#define CAPTURE_EQ_LEN            DEVICE_SETTINGS_BLOB_EQ_LEN
+#define CAPTURE_RECORD_MAX        (CAPTURE_RECORD_HEADER + CAPTURE_EQ_LEN)
+#define CAPTURE_END_LEN           9
+
+#define CAPTURE_RECORD_START      0xFD    /* Only queued, not in a trace  */
+#define CAPTURE_RECORD_END        0xFE
+#define CAPTURE_RECORD_ERASED     0xFF
+#define CAPTURE_FLAG_OUTPUT       0x80
+#define CAPTURE_INTERFACE_MASK    0x7F
+
+#define CAPTURE_INIT_SUCCESS      1
+#define CAPTURE_INIT_FAILED       0
+
+/******************************* TYPEDEFS ********************************/
+
+// Queued from the settings task to the capture task.
+typedef struct
+{
+    uint8_t len;
+    uint8_t data[CAPTURE_RECORD_MAX];
+} capture_record_t;
+
+typedef struct
+{
+    bool     running;
+    uint32_t records;
+    uint32_t dropped;
+    uint32_t bytes;          /* Trace length in flash, header included  */
+    uint32_t flushes;
+} capture_stats_t;
+
+// A decoded record.
+typedef struct
+{
+    dsp_event_t event;
+    uint8_t     interface;
+    uint32_t    delta_us;
+} capture_event_t;
+
+/******************************* LOCAL FUNCTIONS *************************/
+
+void capture_task(void *pvParameters);
+
+uint8_t capture_encode(const dsp_event_t *event,
+                       uint8_t           interface,
+                       uint32_t          delta_us,
+                       uint8_t           *buf);
+
+void capture_append(const uint8_t *data, uint8_t len);
+
+void capture_flush(void);
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+uint8_t init_capture(void);
+
+// Erases the partition and starts a new trace, takes a few seconds.
+bool capture_start(void);
+
+// Ends the trace and waits until it is in flash.
+bool capture_stop(void);
+
+// Called by the settings task for every event it receives, interface is
+// the index of the pipeline. Returns at once when not capturing.
+void capture_event(const dsp_event_t *event, uint8_t interface);
+
+void capture_get_stats(capture_stats_t *stats);
+
+// Checks the trace header, returns false when buf doesn't start a trace.
+bool capture_check_header(const uint8_t *buf, uint32_t len);
+
+// Decodes the record at buf. Returns its length, 0 at the end of the
+// trace, for an unknown record or one that doesn't fit in len.
+uint8_t capture_decode(const uint8_t *buf, uint32_t len, capture_event_t *out);
+
+void capture_print_status(void);
+
+// Prints the trace as hex, 32 bytes a line. `xxd -r -p` turns it back
+// into a file for replay_bench.
+void capture_print_dump(void);
+
+/******************************* THE END *********************************/
+
+#endif /* CAPTURE_H_ */
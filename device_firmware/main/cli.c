@@ -0,0 +1,158 @@
+/*
+ * cli.c
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Command line on the debug UART, runs the esp_console REPL in its own
+ * task. New commands go in the commands table.
+ *
+ */
+/******************************* INCLUDES ********************************/
+
+#include "cli.h"
+
+/******************************* GLOBAL VARIABLES ************************/
+
+static const char *TAG = "CLI";
+
+static const esp_console_cmd_t commands[] = {
+    {.command = "trace",
+     .help    = "Request latency per stage. 'trace dump' prints the marks "
+                "as csv, 'trace clear' starts over.",
+     .hint    = "[dump|clear]",
+     .func    = cli_trace,
+    },
+    {.command = "telemetry",
+     .help    = "Task, heap, queue and bus health of the last sample.",
+     .func    = cli_telemetry,
+    },
+    {.command = "boot",
+     .help    = "Timeline of this boot and a summary of the stored boots.",
+     .func    = cli_boot,
+    },
+    {.command = "coeffs",
+     .help    = "Cycles and 5.23 errors of the EQ coefficient design for "
+                "every filter type. Blocks the CLI for a few seconds.",
+     .func    = cli_coeffs,
+    },
+    {.command = "capture",
+     .help    = "Records the commands of the settings task for replay_bench. "
+                "'capture start' erases the partition first, 'capture dump' "
+                "prints the trace as hex.",
+     .hint    = "[start|stop|dump]",
+     .func    = cli_capture,
+    },
+};
+
+/******************************* LOCAL FUNCTIONS *************************/
+
+int cli_trace(int argc, char **argv)
+{
+    if(argc == 1)
+    {
+        trace_print_histograms();
+    }
+    else if(strcmp(argv[1], "dump") == 0)
+    {
+        trace_print_ring();
+    }
+    else if(strcmp(argv[1], "clear") == 0)
+    {
+        trace_clear();
+    }
+    else
+    {
+        printf("Unknown argument %s\n", argv[1]);
+        return 1;
+    }
+    return 0;
+}
+
+int cli_telemetry(int argc, char **argv)
+{
+    telemetry_print();
+    return 0;
+}
+
+int cli_boot(int argc, char **argv)
+{
+    boot_profile_print();
+    return 0;
+}
+
+int cli_coeffs(int argc, char **argv)
+{
+    return coeff_bench_run() ? 0 : 1;
+}
+
+int cli_capture(int argc, char **argv)
+{
+    if(argc == 1)
+    {
+        capture_print_status();
+    }
+    else if(strcmp(argv[1], "start") == 0)
+    {
+        if(!capture_start())
+        {
+            printf("Unable to start the capture\n");
+            return 1;
+        }
+    }
+    else if(strcmp(argv[1], "stop") == 0)
+    {
+        if(!capture_stop())
+        {
+            printf("Unable to stop the capture\n");
+            return 1;
+        }
+        capture_print_status();
+    }
+    else if(strcmp(argv[1], "dump") == 0)
+    {
+        capture_print_dump();
+    }
+    else
+    {
+        printf("Unknown argument %s\n", argv[1]);
+        return 1;
+    }
+    return 0;
+}
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+uint8_t init_cli(void)
+{
+    esp_console_repl_t            *repl       = NULL;
+    esp_console_repl_config_t     replConfig  = ESP_CONSOLE_REPL_CONFIG_DEFAULT();
+    esp_console_dev_uart_config_t uartConfig  = ESP_CONSOLE_DEV_UART_CONFIG_DEFAULT();
+
+    replConfig.prompt          = CLI_PROMPT;
+    replConfig.task_stack_size = CLI_STACK_SIZE;
+
+    if(esp_console_new_repl_uart(&uartConfig, &replConfig, &repl) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Unable to create console!");
+        return CLI_FAILED;
+    }
+
+    esp_console_register_help_command();
+    for(int i = 0; i < sizeof(commands) / sizeof(commands[0]); i++)
+    {
+        if(esp_console_cmd_register(&commands[i]) != ESP_OK)
+        {
+            ESP_LOGW(TAG, "Unable to register %s!", commands[i].command);
+        }
+    }
+
+    if(esp_console_start_repl(repl) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Unable to start console!");
+        return CLI_FAILED;
+    }
+    return CLI_SUCCESS;
+}
+
+/******************************* THE END *********************************/
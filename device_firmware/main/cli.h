@@ -0,0 +1,53 @@
+/*
+ * cli.h
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Command line on the debug UART. Diagnostics the BLE app does not show
+ * are read here, type "help" for the commands.
+ *
+ */
+#ifndef CLI_H_
+#define CLI_H_
+
+/******************************* INCLUDES ********************************/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include "esp_console.h"
+#include "esp_log.h"
+#include "trace.h"
+#include "telemetry.h"
+#include "boot_profile.h"
+#include "coeff_bench.h"
+#include "capture.h"
+
+/******************************* DEFINES *********************************/
+
+#define CLI_PROMPT     "easydsp>"
+#define CLI_STACK_SIZE 4096
+
+#define CLI_SUCCESS 1
+#define CLI_FAILED  0
+
+/******************************* LOCAL FUNCTIONS *************************/
+
+int cli_trace(int argc, char **argv);
+
+int cli_telemetry(int argc, char **argv);
+
+int cli_boot(int argc, char **argv);
+
+int cli_coeffs(int argc, char **argv);
+
+int cli_capture(int argc, char **argv);
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+uint8_t init_cli(void);
+
+/******************************* THE END *********************************/
+
+#endif /* CLI_H_ */
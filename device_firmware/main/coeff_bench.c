@@ -0,0 +1,317 @@
+/*
+ * coeff_bench.c
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Microbenchmark of the coefficient path of dsp_control, see
+ * coeff_bench.h.
+ *
+ */
+/******************************* INCLUDES ********************************/
+
+#include "coeff_bench.h"
+
+/******************************* GLOBAL VARIABLES ************************/
+
+static const char *filterNames[COEFF_BENCH_FILTER_AMOUNT] = {
+    "peak", "lowshelf", "highshelf", "lowpass", "highpass", "bandpass", "bandstop"
+};
+
+// Q for peak and the passes, S for the shelves, octaves for the bands.
+static const float qPoints[COEFF_BENCH_SHAPE_POINTS]         = {0.5, 0.707, 1.41, 4, 10};
+static const float sPoints[COEFF_BENCH_SHAPE_POINTS]         = {0.3, 0.5, 0.7, 0.9, 1};
+static const float bandwidthPoints[COEFF_BENCH_SHAPE_POINTS] = {0.1, 0.33, 0.67, 1, 2};
+
+/******************************* LOCAL FUNCTIONS *************************/
+
+// Design number index of the sweep of a filter type. The level is the
+// boost of peaks and shelves and the gain of the other types.
+void coeff_bench_config(uint8_t     filter_type,
+                        uint32_t    index,
+                        equalizer_t *eq)
+{
+    uint32_t freqPoint  = index % COEFF_BENCH_FREQ_POINTS;
+    uint32_t shapePoint = (index / COEFF_BENCH_FREQ_POINTS) % COEFF_BENCH_SHAPE_POINTS;
+    uint32_t levelPoint = index / (COEFF_BENCH_FREQ_POINTS * COEFF_BENCH_SHAPE_POINTS);
+    float    level      = COEFF_BENCH_LEVEL_MIN +
+                          (float)levelPoint * COEFF_BENCH_LEVEL_STEP;
+
+    eq->q           = qPoints[shapePoint];
+    eq->s           = sPoints[shapePoint];
+    eq->bandwidth   = bandwidthPoints[shapePoint];
+    eq->freq        = COEFF_BENCH_FREQ_MIN *
+                      pow((double)COEFF_BENCH_FREQ_MAX / COEFF_BENCH_FREQ_MIN,
+                          (double)freqPoint / (COEFF_BENCH_FREQ_POINTS - 1));
+    eq->filter_type = filter_type;
+    eq->phase       = PHASE_NON_INVERTED;
+    eq->state       = STATE_ON;
+
+    if(filter_type == FILTER_TYPE_PEAK     ||
+       filter_type == FILTER_TYPE_LOWSHELF ||
+       filter_type == FILTER_TYPE_HIGHSHELF)
+    {
+        eq->boost = level;
+        eq->gain  = 0;
+    }
+    else
+    {
+        eq->boost = 0;
+        eq->gain  = level;
+    }
+}
+
+// The design of dsp_control_eq_coefficients() in double precision.
+void coeff_bench_reference(const equalizer_t *eq, double *coefficients)
+{
+    double A          = pow(10, (double)eq->boost / 40);
+    double w0         = 2 * M_PI * eq->freq / ADA_SAMPLE_FREQ;
+    double gainLinear = pow(10, (double)eq->gain / 20);
+    double cosW0      = cos(w0);
+    double alpha;
+    double b0, b1, b2, a0, a1, a2;
+
+    switch(eq->filter_type)
+    {
+        case FILTER_TYPE_LOWSHELF:
+            alpha = sin(w0) / 2 * sqrt((A + 1 / A) * (1 / (double)eq->s - 1) + 2);
+            a0    = (A + 1) + (A - 1) * cosW0 + 2 * sqrt(A) * alpha;
+            a1    = -2 * ((A - 1) + (A + 1) * cosW0);
+            a2    = (A + 1) + (A - 1) * cosW0 - 2 * sqrt(A) * alpha;
+            b0    = A * ((A + 1) - (A - 1) * cosW0 + 2 * sqrt(A) * alpha) * gainLinear;
+            b1    = 2 * A * ((A - 1) - (A + 1) * cosW0) * gainLinear;
+            b2    = A * ((A + 1) - (A - 1) * cosW0 - 2 * sqrt(A) * alpha) * gainLinear;
+            break;
+        case FILTER_TYPE_HIGHSHELF:
+            alpha = sin(w0) / 2 * sqrt((A + 1 / A) * (1 / (double)eq->s - 1) + 2);
+            a0    = (A + 1) - (A - 1) * cosW0 + 2 * sqrt(A) * alpha;
+            a1    = 2 * ((A - 1) - (A + 1) * cosW0);
+            a2    = (A + 1) - (A - 1) * cosW0 - 2 * sqrt(A) * alpha;
+            b0    = A * ((A + 1) + (A - 1) * cosW0 + 2 * sqrt(A) * alpha) * gainLinear;
+            b1    = -2 * A * ((A - 1) + (A + 1) * cosW0) * gainLinear;
+            b2    = A * ((A + 1) + (A - 1) * cosW0 - 2 * sqrt(A) * alpha) * gainLinear;
+            break;
+        case FILTER_TYPE_LOWPASS:
+            alpha = sin(w0) / (2 * (double)eq->q);
+            a0    = 1 + alpha;
+            a1    = -2 * cosW0;
+            a2    = 1 - alpha;
+            b0    = (1 - cosW0) * (gainLinear / 2);
+            b1    = (1 - cosW0) * gainLinear;
+            b2    = (1 - cosW0) * (gainLinear / 2);
+            break;
+        case FILTER_TYPE_HIGHPASS:
+            alpha = sin(w0) / (2 * (double)eq->q);
+            a0    = 1 + alpha;
+            a1    = -2 * cosW0;
+            a2    = 1 - alpha;
+            b0    = (1 + cosW0) * (gainLinear / 2);
+            b1    = -(1 + cosW0) * gainLinear;
+            b2    = (1 + cosW0) * (gainLinear / 2);
+            break;
+        case FILTER_TYPE_BANDPASS:
+            alpha = sin(w0) * sinh(log(2) / (2 * (double)eq->bandwidth * w0 / sin(w0)));
+            a0    = 1 + alpha;
+            a1    = -2 * cosW0;
+            a2    = 1 - alpha;
+            b0    = alpha * gainLinear;
+            b1    = 0;
+            b2    = -alpha * gainLinear;
+            break;
+        case FILTER_TYPE_BANDSTOP:
+            alpha = sin(w0) * sinh(log(2) / (2 * (double)eq->bandwidth * w0 / sin(w0)));
+            a0    = 1 + alpha;
+            a1    = -2 * cosW0;
+            a2    = 1 - alpha;
+            b0    = gainLinear;
+            b1    = -2 * cosW0 * gainLinear;
+            b2    = gainLinear;
+            break;
+        default:
+            alpha = sin(w0) / (2 * (double)eq->q);
+            a0    = 1 + alpha / A;
+            a1    = -2 * cosW0;
+            a2    = 1 - alpha / A;
+            b0    = (1 + alpha * A) * gainLinear;
+            b1    = -2 * cosW0 * gainLinear;
+            b2    = (1 - alpha * A) * gainLinear;
+            break;
+    }
+    coefficients[0] = b0 / a0;
+    coefficients[1] = b1 / a0;
+    coefficients[2] = b2 / a0;
+    coefficients[3] = -a1 / a0;
+    coefficients[4] = -a2 / a0;
+}
+
+// Cycles of an empty measurement, the least of a few tries.
+esp_cpu_cycle_count_t coeff_bench_overhead(void)
+{
+    esp_cpu_cycle_count_t overhead = UINT32_MAX;
+
+    for(int i = 0; i < COEFF_BENCH_CALIBRATE_READS; i++)
+    {
+        esp_cpu_cycle_count_t start  = esp_cpu_get_cycle_count();
+        esp_cpu_cycle_count_t cycles = esp_cpu_get_cycle_count() - start;
+
+        if(cycles < overhead)
+        {
+            overhead = cycles;
+        }
+    }
+    return overhead;
+}
+
+// Cycles since start without the overhead. A measurement can be shorter 
+// than the calibration, the counter is unsigned.
+esp_cpu_cycle_count_t coeff_bench_elapsed(esp_cpu_cycle_count_t start,
+                                          esp_cpu_cycle_count_t overhead)
+{
+    esp_cpu_cycle_count_t cycles = esp_cpu_get_cycle_count() - start;
+
+    return cycles > overhead ? cycles - overhead : 0;
+}
+
+int coeff_bench_compare(const void *a, const void *b)
+{
+    uint32_t left  = *(const uint32_t*)a;
+    uint32_t right = *(const uint32_t*)b;
+
+    return (left > right) - (left < right);
+}
+
+/* Function: coeff_bench_filter
+ *
+ * Designs every config of the sweep of one filter type. The design and
+ * the packing are timed one by one with the cycle counter, the reference
+ * design and the error statistics are not timed. Every design time is 
+ * kept for the median. Returns false when there is no memory for them.
+ *
+ */
+bool coeff_bench_filter(uint8_t filter_type, coeff_bench_result_t *result)
+{
+    equalizer_t           eq;
+    float                 coefficients[ADA_COEFFICIENT_AMOUNT];
+    double                reference[ADA_COEFFICIENT_AMOUNT];
+    uint8_t               data[ADA_COEFFICIENT_AMOUNT * ADA_PARAM_REG_SIZE];
+    esp_cpu_cycle_count_t start;
+    esp_cpu_cycle_count_t cycles;
+    esp_cpu_cycle_count_t overhead = coeff_bench_overhead();
+    const double          lsb = (double)((int32_t)1 << COEFF_BENCH_FRACTION_BITS);
+    uint32_t              *designs = malloc(coeff_bench_configs() * sizeof(uint32_t));
+
+    memset(result, 0, sizeof(coeff_bench_result_t));
+    if(designs == NULL)
+    {
+        return false;
+    }
+
+    for(uint32_t i = 0; i < coeff_bench_configs(); i++)
+    {
+        coeff_bench_config(filter_type, i, &eq);
+
+        start  = esp_cpu_get_cycle_count();
+        dsp_control_eq_coefficients(&eq, coefficients);
+        cycles = coeff_bench_elapsed(start, overhead);
+        result->design_cycles += cycles;
+        designs[i]             = cycles;
+
+        start = esp_cpu_get_cycle_count();
+        dsp_control_pack_coefficients(coefficients, data);
+        result->pack_cycles += coeff_bench_elapsed(start, overhead);
+
+        result->configs++;
+        coeff_bench_reference(&eq, reference);
+
+        bool inRange = true;
+
+        for(int j = 0; j < ADA_COEFFICIENT_AMOUNT; j++)
+        {
+            inRange = inRange && fabs(reference[j]) < COEFF_BENCH_RANGE;
+        }
+        if(!inRange)
+        {
+            result->out_of_range++;
+            continue;
+        }
+
+        for(int j = 0; j < ADA_COEFFICIENT_AMOUNT; j++)
+        {
+            int32_t packed = (int32_t)(((uint32_t)data[j * 4 + 0] << 24) |
+                                       ((uint32_t)data[j * 4 + 1] << 16) |
+                                       ((uint32_t)data[j * 4 + 2] <<  8) |
+                                        (uint32_t)data[j * 4 + 3]);
+            double  floatError  = fabs(coefficients[j] - reference[j]) * lsb;
+            double  packedError = fabs(packed - reference[j] * lsb);
+
+            if(floatError > result->float_error)
+            {
+                result->float_error = floatError;
+            }
+            if(packedError > result->packed_error)
+            {
+                result->packed_error = packedError;
+            }
+            result->packed_square += packedError * packedError;
+        }
+    }
+
+    qsort(designs, result->configs, sizeof(uint32_t), coeff_bench_compare);
+    result->design_min    = designs[0];
+    result->design_median = designs[result->configs / 2];
+    free(designs);
+    return true;
+}
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+uint32_t coeff_bench_configs(void)
+{
+    return COEFF_BENCH_FREQ_POINTS *
+           COEFF_BENCH_SHAPE_POINTS *
+           COEFF_BENCH_LEVEL_POINTS;
+}
+
+bool coeff_bench_run(void)
+{
+    coeff_bench_result_t result;
+    bool                 passed = true;
+
+    printf("%-10s %7s %9s %9s %9s %8s %10s %10s %10s %6s\n",
+           "filter", "configs", "median", "min", "mean", "pack",
+           "float_lsb", "packed_lsb", "rms_lsb", "range");
+
+    for(uint8_t i = 0; i < COEFF_BENCH_FILTER_AMOUNT; i++)
+    {
+        if(!coeff_bench_filter(i, &result))
+        {
+            printf("No memory for the sweep.\n");
+            return false;
+        }
+
+        uint32_t counted = (result.configs - result.out_of_range) *
+                           ADA_COEFFICIENT_AMOUNT;
+
+        printf("%-10s %7lu %9lu %9lu %9.1f %8.1f %10.2f %10.2f %10.2f %6lu\n",
+               filterNames[i],
+               (unsigned long)result.configs,
+               (unsigned long)result.design_median,
+               (unsigned long)result.design_min,
+               (double)result.design_cycles / result.configs,
+               (double)result.pack_cycles / result.configs,
+               result.float_error,
+               result.packed_error,
+               counted > 0 ? sqrt(result.packed_square / counted) : 0,
+               (unsigned long)result.out_of_range);
+
+        if(result.packed_error > COEFF_BENCH_MAX_ERROR_LSB)
+        {
+            passed = false;
+        }
+    }
+    printf("Design cycles per filter, the mean includes interrupted designs. "
+           "Errors in 5.23 LSBs against double precision.\n");
+    return passed;
+}
+
+/******************************* THE END *********************************/
@@ -0,0 +1,110 @@
+/*
+ * coeff_bench.h
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Microbenchmark of the coefficient path of dsp_control. Every filter
+ * type is designed over a sweep of frequency, shape (q, s or bandwidth)
+ * and level (boost or gain). Per filter it counts the CPU cycles of the
+ * design and of the 5.23 packing, and compares both to a double
+ * precision design:
+ *
+ *  float err   Largest error of the float coefficients, in 5.23 LSBs.
+ *  packed err  Largest and rms error of the register value, in LSBs.
+ *  range       Designs with a coefficient outside of the 5.23 range,
+ *              their errors are not counted.
+ *
+ * Cycles are without the cost of reading the cycle counter itself. The
+ * design is reported as the median and the least of the sweep, a design
+ * that was interrupted or preempted only moves the mean. Runs on the 
+ * target with the 'coeffs' command of the CLI and on the host with 
+ * host/tools/coeff_bench.
+ *
+ */
+#ifndef COEFF_BENCH_H_
+#define COEFF_BENCH_H_
+
+/******************************* INCLUDES ********************************/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "esp_cpu.h"
+#include "device_settings.h"
+#include "dsp_control.h"
+
+/******************************* DEFINES *********************************/
+
+#define COEFF_BENCH_FILTER_AMOUNT (FILTER_TYPE_BANDSTOP + 1)
+
+// Sweep of every filter type: log spaced frequencies, shapes and levels.
+#define COEFF_BENCH_FREQ_POINTS  31
+#define COEFF_BENCH_FREQ_MIN     20
+#define COEFF_BENCH_FREQ_MAX     20000
+#define COEFF_BENCH_SHAPE_POINTS 5
+#define COEFF_BENCH_LEVEL_POINTS 11
+#define COEFF_BENCH_LEVEL_MIN    -15
+#define COEFF_BENCH_LEVEL_STEP   3
+
+// 5.23 fixed point.
+#define COEFF_BENCH_FRACTION_BITS 23
+#define COEFF_BENCH_RANGE         16.0
+
+// A register value further off than this from the double precision
+// design is a regression. The float design is off up to 15 LSBs, for
+// coefficients above 8 at +15 dB where a float step is 8 LSBs.
+#define COEFF_BENCH_MAX_ERROR_LSB 16.0
+
+// Reads of the cycle counter to find its own cost, that is subtracted.
+#define COEFF_BENCH_CALIBRATE_READS 64
+
+/******************************* TYPEDEFS ********************************/
+
+typedef struct
+{
+    uint32_t configs;
+    uint32_t out_of_range;
+
+    uint64_t design_cycles;
+    uint32_t design_min;
+    uint32_t design_median;
+    uint64_t pack_cycles;
+
+    double   float_error;
+    double   packed_error;
+    double   packed_square;
+} coeff_bench_result_t;
+
+/******************************* LOCAL FUNCTIONS *************************/
+
+void coeff_bench_config(uint8_t     filter_type,
+                        uint32_t    index,
+                        equalizer_t *eq);
+
+void coeff_bench_reference(const equalizer_t *eq, double *coefficients);
+
+esp_cpu_cycle_count_t coeff_bench_overhead(void);
+
+esp_cpu_cycle_count_t coeff_bench_elapsed(esp_cpu_cycle_count_t start,
+                                          esp_cpu_cycle_count_t overhead);
+
+int coeff_bench_compare(const void *a, const void *b);
+
+bool coeff_bench_filter(uint8_t filter_type, coeff_bench_result_t *result);
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+// Designs per filter type.
+uint32_t coeff_bench_configs(void);
+
+// Runs the sweep for every filter type and prints a table. Returns false
+// when a packed coefficient is off more than COEFF_BENCH_MAX_ERROR_LSB.
+bool coeff_bench_run(void);
+
+/******************************* THE END *********************************/
+
+#endif /* COEFF_BENCH_H_ */
@@ -7,10 +7,11 @@
  * The device_settings library contains the settings of the device. The
  * settings for the device are stored in a datatype. This datatype can be 
  *
+ *  The settings are stored in two slots with a crc, see device_settings.h.
+ *
  *  TODO: On initializing of the device settings, if the EEPROM is not 
- *  responding, we should load factory data to the local settings. Also, we
- *  should add a CRC checksum to see if data is valid. If not, load 
- *  factory to local and write local to EEPROM.
+ *  responding or has no valid slot, we should load factory data to the 
+ *  local settings and write them to the EEPROM.
  * 
  */ 
 /******************************* INCLUDES ********************************/
@@ -21,10 +22,123 @@
 
 device_settings_t *device_settings = NULL;
 
+// Sequence counter guarding the settings (seqlock). It is odd while the 
+// settings task is writing, readers retry when it changed during their
+// copy. Half of it is the settings version. Writers are only the settings
+// task and hold a critical section, so a reader never waits on a preempted
+// writer.
+volatile uint32_t settings_seq = 0;
+portMUX_TYPE      settings_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Slot holding the newest valid settings, -1 when there is none. Found by
+// the first load or store.
+static int8_t   nvSlot     = -1;
+static uint32_t nvSequence = 0;
+static bool     nvScanned  = false;
+
 static const char *TAG = "Device_settings";
 
 /******************************* LOCAL FUNCTIONS *************************/
 
+static uint32_t read_begin(void)
+{
+    uint32_t seq;
+    // Spin while a write is in progress, this is only ever a few copies on
+    // the other core.
+    while((seq = __atomic_load_n(&settings_seq, __ATOMIC_ACQUIRE)) & 1);
+    return seq;
+}
+
+static bool read_retry(uint32_t seq)
+{
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&settings_seq, __ATOMIC_RELAXED) != seq;
+}
+
+static uint8_t* put_u16(uint8_t *buf, uint16_t value)
+{
+    buf[0] = value & 0xFF;
+    buf[1] = value >> 8;
+    return buf + 2;
+}
+
+static uint8_t* put_u32(uint8_t *buf, uint32_t value)
+{
+    buf[0] = value & 0xFF;
+    buf[1] = (value >>  8) & 0xFF;
+    buf[2] = (value >> 16) & 0xFF;
+    buf[3] = value >> 24;
+    return buf + 4;
+}
+
+static uint8_t* put_eq(uint8_t *buf, equalizer_t *eq)
+{
+    buf = put_u16(buf, (uint16_t)(eq->q         * 100));
+    buf = put_u16(buf, (uint16_t)(eq->s         * 100));
+    buf = put_u16(buf, (uint16_t)(eq->bandwidth * 100));
+    buf = put_u16(buf, (uint16_t)(int16_t)(eq->boost * 100));
+    buf = put_u16(buf, (uint16_t)(int16_t)(eq->gain  * 100));
+    buf = put_u32(buf, (uint32_t)(eq->freq      * 100));
+    *buf = (eq->filter_type & 0x0F) | 
+           ((eq->phase & 0x01) << 4) | 
+           ((eq->state & 0x01) << 5);
+    return buf + 1;
+}
+
+static uint16_t get_u16(const uint8_t *buf)
+{
+    return buf[0] | (buf[1] << 8);
+}
+
+static uint32_t get_u32(const uint8_t *buf)
+{
+    return buf[0] | (buf[1] << 8) | (buf[2] << 16) | ((uint32_t)buf[3] << 24);
+}
+
+static uint32_t nv_slot_crc(const uint8_t *slot)
+{
+    uint32_t crc = esp_crc32_le(0, slot, NV_STORAGE_HEADER_LEN - 4);
+    return esp_crc32_le(crc, 
+                        slot + NV_STORAGE_HEADER_LEN, 
+                        sizeof(device_settings_t));
+}
+
+// Reads a whole slot, true when it holds valid settings.
+static bool nv_slot_read(uint8_t index, uint8_t *slot)
+{
+    if(!eeprom_sequential_read(NV_STORAGE_SLOT_ADDRESS(index),
+                               slot,
+                               NV_STORAGE_SLOT_SIZE))
+    {
+        return false;
+    }
+    return get_u32(slot)      == NV_STORAGE_SLOT_MAGIC &&
+           get_u16(slot + 8)  == sizeof(device_settings_t) &&
+           get_u32(slot + 12) == nv_slot_crc(slot);
+}
+
+// Finds the newest valid slot. The slot read last is left in slot.
+static bool nv_scan(uint8_t *slot)
+{
+    nvSlot = -1;
+    for(int i = 0; i < NV_STORAGE_SLOT_AMOUNT; i++)
+    {
+        if(nv_slot_read(i, slot))
+        {
+            uint32_t sequence = get_u32(slot + 4);
+
+            // Wrap safe, the sequence only ever counts up by one.
+            if(nvSlot < 0 || (int32_t)(sequence - nvSequence) > 0)
+            {
+                nvSlot     = i;
+                nvSequence = sequence;
+            }
+        }
+    }
+    nvScanned = true;
+    return nvSlot >= 0;
+}
+
 /******************************* GLOBAL FUNCTIONS ************************/
 
 
@@ -86,6 +200,7 @@ uint8_t device_settings_load_factory()
 {
     if(device_settings != NULL)
     {
+        device_settings_write_begin();
         // Set memory block to 0
         memset(device_settings, 0, sizeof(device_settings_t));
         // Manually set settings that shouldn't be 0
@@ -101,6 +216,8 @@ uint8_t device_settings_load_factory()
                     MOD_INPUT1_EQ_ALG0_STAGE0_B0_ADDR + 
                     (j * ADA_COEFFICIENT_AMOUNT) + 
                     (i * MOD_INPUT1_EQ_COUNT );
+                device_settings->inputs[i].eq[j].dsp_index = 
+                    DEVICE_SETTINGS_DSP_ALL;
 
                 device_settings->inputs[i].eq[j].freq         = 1000;
                 device_settings->inputs[i].eq[j].q            = 1.41;
@@ -112,18 +229,25 @@ uint8_t device_settings_load_factory()
         // TODO: add gain to factory settings.
         for(int i = 0; i < DEVICE_SETTINGS_OUTPUT_AMOUNT; i++)
         {
-            device_settings->outputs[i].mux.index = MUX_SELECT_INPUT1;
+            // Every DSP runs the same program, output n of a DSP has 
+            // the same addresses on all of them.
+            uint8_t dspIndex  = i / DEVICE_SETTINGS_DSP_OUTPUT_AMOUNT;
+            uint8_t dspOutput = i % DEVICE_SETTINGS_DSP_OUTPUT_AMOUNT;
+
+            device_settings->outputs[i].mux.index     = MUX_SELECT_INPUT1;
+            device_settings->outputs[i].mux.dsp_index = dspIndex;
 
             // Set the dsp address to the first mux address + output n
             device_settings->outputs[i].mux.sigma_dsp_address = 
-                MOD_OUTPUT1_SELECT_MONOSWSLEW_ADDR + i;
+                MOD_OUTPUT1_SELECT_MONOSWSLEW_ADDR + dspOutput;
 
             for(int j = 0; j < DEVICE_SETTINGS_OUTPUT_EQ_AMOUNT; j++)
             {
                 device_settings->outputs[i].eq[j].sigma_dsp_address = 
                     MOD_OUTPUT1_EQ_ALG0_STAGE0_B0_ADDR + 
                     (j * ADA_COEFFICIENT_AMOUNT) + 
-                    (i * MOD_OUTPUT1_EQ_COUNT);
+                    (dspOutput * MOD_OUTPUT1_EQ_COUNT);
+                device_settings->outputs[i].eq[j].dsp_index = dspIndex;
 
                 device_settings->outputs[i].eq[j].freq        = 1000;
                 device_settings->outputs[i].eq[j].q           = 1.41;
@@ -131,70 +255,231 @@ uint8_t device_settings_load_factory()
             }
         }
 
+        device_settings_write_end();
+
         ESP_LOGI(TAG, "Loaded factory settings.");
         return 1;
     }
     return 0;
 }
 
+/* Function: device_settings_store_nv
+ *
+ * Writes the settings to the slot that doesn't hold the newest ones. The
+ * slot is read first and only the pages that changed are written, an 
+ * edit of one EQ costs the page with the header and the page of the EQ.
+ * The header is in the first page, written first. Until the last page 
+ * is written the crc doesn't match, the slot only becomes valid at the
+ * end of the store.
+ */
 uint8_t device_settings_store_nv()
 {
-    bool write_success = true;
-    if(device_settings != NULL)
+    bool    write_success = false;
+    uint8_t *stored       = malloc(NV_STORAGE_SLOT_SIZE);
+    uint8_t *slot         = malloc(NV_STORAGE_SLOT_SIZE);
+
+    if(device_settings != NULL && stored != NULL && slot != NULL)
     {
-        // The EEPROM used can only write one page at once.
-        // Let's see how many pages we have, we then program page for page.
-        uint16_t page_amount = sizeof(device_settings_t) / EEPROM_PAGE_SIZE;
-        uint8_t  remainder = sizeof(device_settings_t) % EEPROM_PAGE_SIZE;
-        
-        printf("Size of settings: %d\n", sizeof(device_settings_t));
-        printf("Amount of pages: %d\n", page_amount);
-        printf("Remaining bytes: %d\n", remainder);
-        
-        for(int i = 0; i < page_amount; i++)
+        uint8_t  target;
+        uint32_t sequence;
+
+        if(!nvScanned)
         {
-            if(!eeprom_write_page(NV_STORAGE_SETTINGS_ADDRESS + (i * EEPROM_PAGE_SIZE), 
-                                  (uint8_t*)device_settings + (i * EEPROM_PAGE_SIZE), 
+            nv_scan(stored);
+        }
+        target   = (nvSlot < 0) ? 0 : (nvSlot + 1) % NV_STORAGE_SLOT_AMOUNT;
+        sequence = (nvSlot < 0) ? 0 : nvSequence + 1;
+
+        // The settings task is the only writer, no need for the seqlock.
+        memset(slot, 0xFF, NV_STORAGE_SLOT_SIZE);
+        put_u32(slot,     NV_STORAGE_SLOT_MAGIC);
+        put_u32(slot + 4, sequence);
+        put_u16(slot + 8, sizeof(device_settings_t));
+        put_u16(slot + 10, 0);
+        memcpy(slot + NV_STORAGE_HEADER_LEN, 
+               device_settings, 
+               sizeof(device_settings_t));
+        put_u32(slot + 12, nv_slot_crc(slot));
+
+        // When the target can't be read, everything is written.
+        bool known = eeprom_sequential_read(NV_STORAGE_SLOT_ADDRESS(target),
+                                            stored,
+                                            NV_STORAGE_SLOT_SIZE);
+
+        write_success = true;
+        for(int i = 0; i < NV_STORAGE_SLOT_SIZE; i += EEPROM_PAGE_SIZE)
+        {
+            if((!known || memcmp(slot + i, stored + i, EEPROM_PAGE_SIZE) != 0) &&
+               !eeprom_write_page(NV_STORAGE_SLOT_ADDRESS(target) + i,
+                                  slot + i,
                                   EEPROM_PAGE_SIZE))
             {
                 write_success = false;
+                break;
             }
         }
-        // Remaining bytes:
-        if(!eeprom_write_page(NV_STORAGE_SETTINGS_ADDRESS + (page_amount * (EEPROM_PAGE_SIZE)),
-                             (uint8_t*)device_settings + (page_amount * EEPROM_PAGE_SIZE),
-                             remainder))
-        {
-            write_success = false;
-        }
 
-        if(!write_success)
+        if(write_success)
         {
-            ESP_LOGW(TAG, "Failed to write settings to NV storage!");
+            nvSlot     = target;
+            nvSequence = sequence;
+            ESP_LOGI(TAG, "Wrote settings to NV storage slot %d!", target);
         }
-        else 
+        else
         {
-            ESP_LOGI(TAG, "Wrote settings to NV storage!");
+            // The target is torn now, the newest slot is still valid.
+            ESP_LOGW(TAG, "Failed to write settings to NV storage!");
         }
     }   
+    free(stored);
+    free(slot);
     return (uint8_t)write_success;
 }
 
 uint8_t device_settings_load_nv()
 {
-    if(device_settings != NULL)
+    uint8_t *slot = malloc(NV_STORAGE_SLOT_SIZE);
+
+    // Readers may be copying the settings, so read the slot into a scratch
+    // buffer first and publish it in one go.
+    if(device_settings != NULL && slot != NULL && nv_scan(slot))
     {
-        // Do a sequential read for all settings starting on device_settings pointer.
-        if(eeprom_sequential_read(NV_STORAGE_SETTINGS_ADDRESS,
-                                  (uint8_t*)device_settings,
-                                  sizeof(device_settings_t)))
+        if(nvSlot == NV_STORAGE_SLOT_AMOUNT - 1 || 
+           nv_slot_read(nvSlot, slot))
         {
-            ESP_LOGI(TAG, "Loaded device settings from NV storage.");
+            device_settings_write_begin();
+            memcpy(device_settings, 
+                   slot + NV_STORAGE_HEADER_LEN, 
+                   sizeof(device_settings_t));
+            device_settings_write_end();
+            free(slot);
+            ESP_LOGI(TAG, "Loaded device settings from NV storage slot %d.",
+                     nvSlot);
             return NV_RW_SUCCESS;
         }
     }
+    free(slot);
     ESP_LOGW(TAG, "Failed to load device settings from NV storage");
     return NV_RW_FAILED;
 }
 
+void device_settings_write_begin()
+{
+    taskENTER_CRITICAL(&settings_lock);
+    __atomic_store_n(&settings_seq, settings_seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+void device_settings_write_end()
+{
+    __atomic_store_n(&settings_seq, settings_seq + 1, __ATOMIC_RELEASE);
+    taskEXIT_CRITICAL(&settings_lock);
+}
+
+uint32_t device_settings_get_version()
+{
+    return read_begin() >> 1;
+}
+
+bool device_settings_read_eq(bool        output,
+                             uint8_t     chan_num,
+                             uint8_t     eq_num,
+                             equalizer_t *eq)
+{
+    if(device_settings != NULL && eq != NULL)
+    {
+        equalizer_t *src = NULL;
+
+        if(output && chan_num < DEVICE_SETTINGS_OUTPUT_AMOUNT &&
+           eq_num < DEVICE_SETTINGS_OUTPUT_EQ_AMOUNT)
+        {
+            src = &device_settings->outputs[chan_num].eq[eq_num];
+        }
+        else if(!output && chan_num < DEVICE_SETTINGS_INPUT_AMOUNT &&
+                eq_num < DEVICE_SETTINGS_INPUT_EQ_AMOUNT)
+        {
+            src = &device_settings->inputs[chan_num].eq[eq_num];
+        }
+
+        if(src != NULL)
+        {
+            uint32_t seq;
+            do
+            {
+                seq = read_begin();
+                *eq = *src;
+            } while(read_retry(seq));
+            return true;
+        }
+    }
+    return false;
+}
+
+bool device_settings_read_mux(uint8_t chan_num, mux_t *mux)
+{
+    if(device_settings != NULL && mux != NULL &&
+       chan_num < DEVICE_SETTINGS_OUTPUT_AMOUNT)
+    {
+        uint32_t seq;
+        do
+        {
+            seq  = read_begin();
+            *mux = device_settings->outputs[chan_num].mux;
+        } while(read_retry(seq));
+        return true;
+    }
+    return false;
+}
+
+uint16_t device_settings_serialize(uint8_t  dsp_index, 
+                                   uint8_t  *buf, 
+                                   uint16_t len)
+{
+    if(device_settings != NULL && buf != NULL && 
+       len >= DEVICE_SETTINGS_BLOB_LEN &&
+       dsp_index < DEVICE_SETTINGS_DSP_AMOUNT)
+    {
+        uint8_t  first = dsp_index * DEVICE_SETTINGS_DSP_OUTPUT_AMOUNT;
+        uint8_t  *p;
+        uint32_t seq;
+
+        // Serialize straight from the live settings, start over when the
+        // settings task wrote in the meantime.
+        do
+        {
+            seq  = read_begin();
+            p    = buf;
+            *p++ = DEVICE_SETTINGS_BLOB_FORMAT;
+            p    = put_u32(p, seq >> 1);
+            *p++ = dsp_index;
+            *p++ = DEVICE_SETTINGS_DSP_AMOUNT;
+            *p++ = DEVICE_SETTINGS_INPUT_AMOUNT;
+            *p++ = DEVICE_SETTINGS_INPUT_EQ_AMOUNT;
+            *p++ = DEVICE_SETTINGS_OUTPUT_AMOUNT;
+            *p++ = DEVICE_SETTINGS_OUTPUT_EQ_AMOUNT;
+            *p++ = first;
+
+            for(int i = 0; i < DEVICE_SETTINGS_INPUT_AMOUNT; i++)
+            {
+                for(int j = 0; j < DEVICE_SETTINGS_INPUT_EQ_AMOUNT; j++)
+                {
+                    p = put_eq(p, &device_settings->inputs[i].eq[j]);
+                }
+            }
+            for(int i = first; i < first + DEVICE_SETTINGS_DSP_OUTPUT_AMOUNT; i++)
+            {
+                for(int j = 0; j < DEVICE_SETTINGS_OUTPUT_EQ_AMOUNT; j++)
+                {
+                    p = put_eq(p, &device_settings->outputs[i].eq[j]);
+                }
+                *p++ = device_settings->outputs[i].mux.index;
+            }
+            p = put_u32(p, seq >> 1);
+        } while(read_retry(seq));
+
+        return (uint16_t)(p - buf);
+    }
+    return 0;
+}
+
 /******************************* THE END *********************************/
\ No newline at end of file
@@ -20,7 +20,10 @@
 #include <stdbool.h>
 #include <string.h>
 #include "eeprom.h"
+#include "esp_crc.h"
 #include "sigma_dsp_module_data.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 
 /******************************* DEFINES *********************************/
 
@@ -32,14 +35,42 @@
 #define NV_RW_SUCCESS                  1
 #define NV_RW_FAILED                   0
 
+// The settings are stored twice, in slot A and B. A store writes the slot
+// that doesn't hold the newest settings, so a power loss during the store
+// leaves the other one intact. Every slot starts with a header 
+// (little endian):
+//   u32 magic, u32 sequence, u16 length, u16 reserved, u32 crc
+// followed by the settings. The crc covers the first 12 header bytes and 
+// the settings. A slot takes whole pages.
+#define NV_STORAGE_SLOT_AMOUNT         2
+#define NV_STORAGE_SLOT_MAGIC          0x31534445  /* "EDS1" */
+#define NV_STORAGE_HEADER_LEN          16
+#define NV_STORAGE_SLOT_SIZE           ((NV_STORAGE_HEADER_LEN + \
+                                         sizeof(device_settings_t) + \
+                                         EEPROM_PAGE_SIZE - 1) / \
+                                        EEPROM_PAGE_SIZE * EEPROM_PAGE_SIZE)
+#define NV_STORAGE_SLOT_ADDRESS(slot)  (NV_STORAGE_SETTINGS_ADDRESS + \
+                                        (slot) * NV_STORAGE_SLOT_SIZE)
+
 #define INIT_DEVICE_SETTINGS_SUCCESS   1
 #define INIT_DEVICE_SETTINGS_FAILED    0
 #define DEINIT_DEVICE_SETTINGS_SUCCESS 1
 #define DEINIT_DEVICE_SETTINGS_FAILED  0
 
 #define DEVICE_SETTINGS_DEVICE_NAME_LEN  63  
+// Every ADAU1701 drives DEVICE_SETTINGS_DSP_OUTPUT_AMOUNT outputs, output
+// n is on DSP n / DEVICE_SETTINGS_DSP_OUTPUT_AMOUNT. The inputs go to every
+// DSP, input settings are written to all of them. Boards with more DSPs
+// define DEVICE_SETTINGS_DSP_AMOUNT and DSP_CONTROL_CONFIGS in the build.
+#ifndef DEVICE_SETTINGS_DSP_AMOUNT
+#define DEVICE_SETTINGS_DSP_AMOUNT        1
+#endif
+#define DEVICE_SETTINGS_DSP_OUTPUT_AMOUNT 4
+#define DEVICE_SETTINGS_DSP_ALL           0xFF
+
 #define DEVICE_SETTINGS_INPUT_AMOUNT     2
-#define DEVICE_SETTINGS_OUTPUT_AMOUNT    4
+#define DEVICE_SETTINGS_OUTPUT_AMOUNT    (DEVICE_SETTINGS_DSP_AMOUNT * \
+                                          DEVICE_SETTINGS_DSP_OUTPUT_AMOUNT)
 #define DEVICE_SETTINGS_INPUT_EQ_AMOUNT  5
 #define DEVICE_SETTINGS_OUTPUT_EQ_AMOUNT 5
 
@@ -61,6 +92,25 @@
 #define MUX_SELECT_INPUT1_2 1
 #define MUX_SELECT_INPUT2   2
 
+// Compact serialized snapshot of the settings of one DSP, read by clients
+// in one go. Layout (little endian):
+//   u8  format, u32 version, u8 dsp index, u8 dsp amount,
+//   u8  in amount, u8 in eq amount, u8 out amount, u8 out eq amount,
+//   u8  first output,
+//   per input:  eq[] 
+//   per output of the DSP: eq[], u8 mux index
+//   u32 version (same as the header, differs when the read was torn)
+// Every eq is 15 bytes: u16 q, u16 s, u16 bandwidth, i16 boost, i16 gain,
+// u32 freq (all * 100) and u8 filter_type | phase << 4 | state << 5.
+#define DEVICE_SETTINGS_BLOB_FORMAT  2
+#define DEVICE_SETTINGS_BLOB_EQ_LEN  15
+#define DEVICE_SETTINGS_BLOB_LEN     (1 + 4 + 2 + 4 + 1 + 4 + \
+    (DEVICE_SETTINGS_INPUT_AMOUNT  * DEVICE_SETTINGS_INPUT_EQ_AMOUNT  * \
+     DEVICE_SETTINGS_BLOB_EQ_LEN) + \
+    (DEVICE_SETTINGS_DSP_OUTPUT_AMOUNT * DEVICE_SETTINGS_OUTPUT_EQ_AMOUNT * \
+     DEVICE_SETTINGS_BLOB_EQ_LEN) + \
+    DEVICE_SETTINGS_DSP_OUTPUT_AMOUNT)
+
 /******************************* TYPEDEFS ********************************/
 
 typedef struct
@@ -85,6 +135,8 @@ typedef struct
     // They should be stored in a const so that we don't have to store the
     // sigma dsp address on the EEPROM.
     uint16_t sigma_dsp_address;
+    // DSP the address is in, DEVICE_SETTINGS_DSP_ALL for the inputs.
+    uint8_t  dsp_index;
 } equalizer_t;
 
 typedef struct
@@ -92,6 +144,7 @@ typedef struct
     uint8_t index;
 
     uint16_t sigma_dsp_address;
+    uint8_t  dsp_index;
 } mux_t;
 
 typedef struct
@@ -128,10 +181,38 @@ device_settings_t* get_device_settings_address();
 
 uint8_t device_settings_load_factory();
 
+// Only pages that differ from what the slot already holds are written.
 uint8_t device_settings_store_nv();
 
+// Loads the newest slot with a valid crc. Fails when there is none, the
+// settings are left untouched then.
 uint8_t device_settings_load_nv();
 
+// Every modification of the settings has to be wrapped in a write_begin 
+// and write_end pair. Keep the section short, it runs in a critical 
+// section. Every pair bumps the settings version.
+void device_settings_write_begin();
+
+void device_settings_write_end();
+
+// Lock free readers, safe to call from any task. They return a consistent
+// copy without waking the settings task.
+uint32_t device_settings_get_version();
+
+bool device_settings_read_eq(bool        output,
+                             uint8_t     chan_num,
+                             uint8_t     eq_num,
+                             equalizer_t *eq);
+
+bool device_settings_read_mux(uint8_t chan_num, mux_t *mux);
+
+// Serializes the inputs and the outputs of one DSP in the blob format 
+// described above. Returns the amount of bytes written, 0 if the buffer 
+// is too small or the DSP doesn't exist.
+uint16_t device_settings_serialize(uint8_t  dsp_index, 
+                                   uint8_t  *buf, 
+                                   uint16_t len);
+
 /******************************* THE END *********************************/
 
 #endif /* DEVICE_SETTINGS_H_ */
\ No newline at end of file
@@ -20,30 +20,202 @@
 
  static const char *TAG = "DSP_control";
 
+static const dsp_control_config_t dspConfigs[] = {DSP_CONTROL_CONFIGS};
+_Static_assert(sizeof(dspConfigs) / sizeof(dspConfigs[0]) == DEVICE_SETTINGS_DSP_AMOUNT,
+               "Every DSP in the settings needs a line in dspConfigs");
+
+static sigma_dsp_t *dsps[DEVICE_SETTINGS_DSP_AMOUNT];
+
  /******************************* LOCAL FUNCTIONS *************************/
 
+// Loads the DSPs on one bus one after the other.
+void dsp_control_init_task(void *pvParameters)
+{
+    dsp_control_init_t *init = (dsp_control_init_t*)pvParameters;
+
+    for(int i = 0; i < DEVICE_SETTINGS_DSP_AMOUNT; i++)
+    {
+        if(dspConfigs[i].port == init->port)
+        {
+            dsps[i] = init_sigma_dsp(dspConfigs[i].scl,
+                                     dspConfigs[i].sda,
+                                     dspConfigs[i].port,
+                                     dspConfigs[i].address,
+                                     dspConfigs[i].reset);
+        }
+    }
+    xSemaphoreGive(init->done);
+    vTaskDelete(NULL);
+}
+
+// Writes to one DSP, or to all of them for DEVICE_SETTINGS_DSP_ALL.
+bool dsp_control_write(uint8_t  dsp_index,
+                       uint16_t address,
+                       uint16_t len,
+                       uint8_t  *data)
+{
+    bool written = true;
+
+    for(int i = 0; i < DEVICE_SETTINGS_DSP_AMOUNT; i++)
+    {
+        if(dsp_index != DEVICE_SETTINGS_DSP_ALL && dsp_index != i)
+        {
+            continue;
+        }
+        if(sigma_dsp_write_burst_async(dsps[i], 
+                                       address, 
+                                       len, 
+                                       data) != SIGMA_DSP_WRITE_SUCCESS)
+        {
+            written = false;
+        }
+    }
+    if(dsp_index != DEVICE_SETTINGS_DSP_ALL && 
+       dsp_index >= DEVICE_SETTINGS_DSP_AMOUNT)
+    {
+        written = false;
+    }
+    return written;
+}
+
+// Switches the DSPs that don't run the image in the slot yet. Stops at the
+// first commit that fails, the DSPs after it keep their program.
+bool dsp_control_switch(uint8_t index)
+{
+    bool applied;
+    bool staged[DEVICE_SETTINGS_DSP_AMOUNT] = {false};
+    int  switching = 0;
+
+    for(int i = 0; i < DEVICE_SETTINGS_DSP_AMOUNT; i++)
+    {
+        if(sigma_dsp_image_index(dsps[i]) == index)
+        {
+            continue;
+        }
+        if(sigma_dsp_switch_begin(dsps[i], index) != SIGMA_DSP_WRITE_SUCCESS)
+        {
+            // All DSPs switch or none, settings must not reach a DSP that
+            // runs the old program.
+            for(int j = 0; j < i; j++)
+            {
+                sigma_dsp_switch_abort(dsps[j]);
+            }
+            return false;
+        }
+        staged[i] = true;
+        switching++;
+    }
+
+    // Every DSP runs the image already, its settings are in place.
+    if(switching == 0)
+    {
+        return true;
+    }
+
+    // The images have the modules of the firmware at the same addresses, 
+    // sigma_dsp_switch_begin() checks the layout. The settings are applied
+    // to the new image before it is written.
+    applied = dsp_control_apply_settings();
+
+    for(int i = 0; i < DEVICE_SETTINGS_DSP_AMOUNT; i++)
+    {
+        if(!staged[i])
+        {
+            continue;
+        }
+        if(!applied)
+        {
+            sigma_dsp_switch_abort(dsps[i]);
+        }
+        else if(sigma_dsp_switch_commit(dsps[i]) != SIGMA_DSP_WRITE_SUCCESS)
+        {
+            // The failed DSP counts as switched, it got a full download
+            // of the new image.
+            applied = false;
+        }
+    }
+    return applied;
+}
+
  /******************************* GLOBAL FUNCTIONS ************************/
 
  bool init_dsp_control()
  {
-    if(init_sigma_dsp(ADA_I2C_SCL_PIN, 
-                      ADA_I2C_SDA_PIN, 
-                      ADA_I2C_PORT_NUM, 
-                      ADA_I2C_ADDRESS, 
-                      ADA_GPIO_RESET) == SIGMA_DSP_INIT_SUCCESS)
+    SemaphoreHandle_t  done    = xSemaphoreCreateCounting(I2C_BUS_PORT_AMOUNT, 0);
+    dsp_control_init_t inits[I2C_BUS_PORT_AMOUNT];
+    uint8_t            started = 0;
+    bool               loaded  = true;
+
+    if(done == NULL)
     {
-        return true;
+        return false;
     }
-    return false;
+    boot_profile_begin(BOOT_PHASE_DSP_CONTROL);
+
+    for(int port = 0; port < I2C_BUS_PORT_AMOUNT; port++)
+    {
+        bool used = false;
+
+        for(int i = 0; i < DEVICE_SETTINGS_DSP_AMOUNT; i++)
+        {
+            if(dspConfigs[i].port == port)
+            {
+                used = true;
+            }
+        }
+
+        inits[port].port = port;
+        inits[port].done = done;
+        if(used && xTaskCreate(dsp_control_init_task,
+                               "DSP init",
+                               DSP_CONTROL_INIT_STACK,
+                               &inits[port],
+                               uxTaskPriorityGet(NULL),
+                               NULL) == pdPASS)
+        {
+            started++;
+        }
+    }
+    for(int i = 0; i < started; i++)
+    {
+        xSemaphoreTake(done, portMAX_DELAY);
+    }
+    vSemaphoreDelete(done);
+
+    for(int i = 0; i < DEVICE_SETTINGS_DSP_AMOUNT; i++)
+    {
+        if(dsps[i] == NULL)
+        {
+            ESP_LOGW(TAG, "DSP %d is not available!", i);
+            loaded = false;
+        }
+    }
+    if(loaded)
+    {
+        // Every DSP runs its program.
+        boot_profile_end(BOOT_PHASE_DSP_CONTROL);
+        boot_profile_milestone(BOOT_MILESTONE_AUDIO);
+    }
+    else
+    {
+        boot_profile_fail(BOOT_PHASE_DSP_CONTROL);
+    }
+    return loaded;
  }
 
 bool deinit_dsp_control()
 {
-    if(deinit_sigma_dsp() == SIGMA_DSP_DEINIT_SUCCESS)
+    bool deinitialized = true;
+
+    for(int i = 0; i < DEVICE_SETTINGS_DSP_AMOUNT; i++)
     {
-        return true;
+        if(deinit_sigma_dsp(dsps[i]) != SIGMA_DSP_DEINIT_SUCCESS)
+        {
+            deinitialized = false;
+        }
+        dsps[i] = NULL;
     }
-    return false;
+    return deinitialized;
 }
 
 bool dsp_control_mux(mux_t *mux)
@@ -51,17 +223,18 @@ bool dsp_control_mux(mux_t *mux)
     uint8_t data[ADA_PARAM_REG_SIZE] = {0, 0, 0, 0};
     data[ADA_PARAM_REG_SIZE - 1] = mux->index;
 
-    if(sigma_dsp_write_burst(mux->sigma_dsp_address,
-                             sizeof(data),
-                             data) == SIGMA_DSP_WRITE_SUCCESS)
+    if(dsp_control_write(mux->dsp_index,
+                         mux->sigma_dsp_address,
+                         sizeof(data),
+                         data))
     {
-        ESP_LOGI(TAG, "Mux write success.");
+        ESP_LOGI(TAG, "Mux write queued.");
         return true;
     }
     return false;
 }
 
-bool dsp_control_eq_secondorder(equalizer_t *eq)
+void dsp_control_eq_coefficients(const equalizer_t *eq, float *coefficients)
 {
     float A;
     float w0;
@@ -73,7 +246,6 @@ bool dsp_control_eq_secondorder(equalizer_t *eq)
     float a0;
     float a1;
     float a2;
-    float coefficients[ADA_COEFFICIENT_AMOUNT];
 
     A=pow(10,(eq->boost/40));           // 10^(boost/40)
     w0=2*M_PI*eq->freq/ADA_SAMPLE_FREQ; // 2*PI*freq/FS
@@ -185,9 +357,11 @@ bool dsp_control_eq_secondorder(equalizer_t *eq)
         coefficients[3] = 0;
         coefficients[4] = 0;
     }
+}
 
-    uint8_t data[ADA_COEFFICIENT_AMOUNT * 4];
-
+// 5.23 fixed point, most significant byte first.
+void dsp_control_pack_coefficients(const float *coefficients, uint8_t *data)
+{
     for(int i = 0; i < ADA_COEFFICIENT_AMOUNT; i++)
     {
         int32_t fixedval = (coefficients[i] * ((int32_t)1 << 23));
@@ -197,15 +371,126 @@ bool dsp_control_eq_secondorder(equalizer_t *eq)
         data[i * 4 + 2] = (fixedval >>  8) & 0xFF;
         data[i * 4 + 3] = fixedval & 0xFF;
     }
+}
+
+bool dsp_control_eq_secondorder(equalizer_t *eq)
+{
+    float   coefficients[ADA_COEFFICIENT_AMOUNT];
+    uint8_t data[ADA_COEFFICIENT_AMOUNT * ADA_PARAM_REG_SIZE];
+
+    dsp_control_eq_coefficients(eq, coefficients);
+    dsp_control_pack_coefficients(coefficients, data);
+    trace_mark(TRACE_STAGE_COMPUTE);
+
+    if(dsp_control_write(eq->dsp_index,
+                         eq->sigma_dsp_address,
+                         sizeof(data),
+                         data))
+    {
+        ESP_LOGI(TAG, "EQ write queued.");
+        return true;
+    }
+    return false;
+}
+
+// Writes all current settings. The writes are queued back to back, the
+// next EQ is computed while the last one is on the wire.
+bool dsp_control_apply_settings(void)
+{
+    equalizer_t eq;
+    mux_t       mux;
+    bool        applied = true;
+
+    for(int i = 0; i < DEVICE_SETTINGS_INPUT_AMOUNT; i++)
+    {
+        for(int j = 0; j < DEVICE_SETTINGS_INPUT_EQ_AMOUNT; j++)
+        {
+            if(!device_settings_read_eq(false, i, j, &eq) ||
+               !dsp_control_eq_secondorder(&eq))
+            {
+                applied = false;
+            }
+        }
+    }
+    for(int i = 0; i < DEVICE_SETTINGS_OUTPUT_AMOUNT; i++)
+    {
+        if(!device_settings_read_mux(i, &mux) || !dsp_control_mux(&mux))
+        {
+            applied = false;
+        }
+        for(int j = 0; j < DEVICE_SETTINGS_OUTPUT_EQ_AMOUNT; j++)
+        {
+            if(!device_settings_read_eq(true, i, j, &eq) ||
+               !dsp_control_eq_secondorder(&eq))
+            {
+                applied = false;
+            }
+        }
+    }
+    return applied;
+}
+
+// One step of the background integrity check of the DSP memory.
+bool dsp_control_scrub(void)
+{
+    bool scrubbed = true;
 
-    if(sigma_dsp_write_burst(eq->sigma_dsp_address,
-                             sizeof(data),
-                             data) == SIGMA_DSP_WRITE_SUCCESS)
+    for(int i = 0; i < DEVICE_SETTINGS_DSP_AMOUNT; i++)
+    {
+        if(sigma_dsp_scrub_step(dsps[i]) != SIGMA_DSP_READ_SUCCESS)
+        {
+            scrubbed = false;
+        }
+    }
+    return scrubbed;
+}
+
+uint32_t dsp_control_scrub_repairs(void)
+{
+    uint32_t repairs = 0;
+
+    for(int i = 0; i < DEVICE_SETTINGS_DSP_AMOUNT; i++)
+    {
+        repairs += sigma_dsp_scrub_repairs(dsps[i]);
+    }
+    return repairs;
+}
+
+bool dsp_control_flush(void)
+{
+    bool flushed = true;
+
+    for(int i = 0; i < DEVICE_SETTINGS_DSP_AMOUNT; i++)
+    {
+        if(sigma_dsp_flush(dsps[i]) != SIGMA_DSP_WRITE_SUCCESS)
+        {
+            flushed = false;
+        }
+    }
+    return flushed;
+}
+
+bool dsp_control_switch_program(uint8_t index)
+{
+    uint8_t previous = dsp_control_program();
+
+    if(dsp_control_switch(index))
     {
-        ESP_LOGI(TAG, "EQ write success.");
         return true;
     }
+
+    // Some DSPs may run the new program already. Take them back to the one
+    // all of them ran, the settings are applied to it again.
+    if(!dsp_control_switch(previous))
+    {
+        ESP_LOGE(TAG, "DSPs run different programs!");
+    }
     return false;
 }
 
+uint8_t dsp_control_program(void)
+{
+    return sigma_dsp_image_index(dsps[0]);
+}
+
  /******************************* THE END *********************************/
\ No newline at end of file
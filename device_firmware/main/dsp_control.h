@@ -11,6 +11,9 @@
  * the sigma dsp to the sigma_dsp module which then uses the safeload
  * write functionality of the dsp chip.
  * 
+ * Several DSPs can be used, each drives DEVICE_SETTINGS_DSP_OUTPUT_AMOUNT
+ * outputs. They are listed in dsp_control.c.
+ * 
  */ 
 #ifndef DSP_CONTROL_H_
 #define DSP_CONTROL_H_
@@ -24,15 +27,30 @@
 #include "device_settings.h"
 #include "driver/gpio.h"
 #include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
 
 /******************************* DEFINES *********************************/
 
+// First DSP. DSPs on the same bus need other ADDR0/ADDR1 pin settings.
 #define ADA_I2C_SCL_PIN  10
 #define ADA_I2C_SDA_PIN  11
 #define ADA_I2C_PORT_NUM 0
-#define ADA_I2C_ADDRESS  (0x68 >> 1) & 0xFE
+#define ADA_I2C_ADDRESS  ((0x68 >> 1) & 0xFE)
 #define ADA_GPIO_RESET   12
 
+// One {scl, sda, port, address, reset} line per DSP, in the order of the
+// DSP index in the settings.
+#ifndef DSP_CONTROL_CONFIGS
+#define DSP_CONTROL_CONFIGS \
+    {ADA_I2C_SCL_PIN, ADA_I2C_SDA_PIN, ADA_I2C_PORT_NUM, ADA_I2C_ADDRESS, ADA_GPIO_RESET}
+#endif
+
+// Every bus with DSPs gets a task that downloads their programs, so the 
+// buses are programmed in parallel.
+#define DSP_CONTROL_INIT_STACK 4096
+
 #define ADA_SAMPLE_FREQ  48000
 
 #define ADA_PARAM_REG_SIZE     4
@@ -40,6 +58,21 @@
 
 /******************************* TYPEDEFS ********************************/
 
+typedef struct
+{
+    uint8_t    scl;
+    uint8_t    sda;
+    uint8_t    port;
+    uint8_t    address;
+    gpio_num_t reset;   /* Every DSP needs its own reset pin          */
+} dsp_control_config_t;
+
+typedef struct
+{
+    uint8_t           port;
+    SemaphoreHandle_t done;
+} dsp_control_init_t;
+
 // typedef struct
 // {
 //     uint16_t addresses[DEVICE_SETTINGS_INPUT_EQ_AMOUNT]
@@ -60,6 +93,15 @@
 
 /******************************* LOCAL FUNCTIONS *************************/
 
+void dsp_control_init_task(void *pvParameters);
+
+bool dsp_control_write(uint8_t  dsp_index,
+                       uint16_t address,
+                       uint16_t len,
+                       uint8_t  *data);
+
+bool dsp_control_switch(uint8_t index);
+
 /******************************* GLOBAL FUNCTIONS ************************/
 
 bool init_dsp_control(void);
@@ -70,6 +112,31 @@ bool dsp_control_mux(mux_t *mux);
 
 bool dsp_control_eq_secondorder(equalizer_t *eq);
 
+// The steps of dsp_control_eq_secondorder(), without the write. Biquad
+// coefficients b0, b1, b2, -a1, -a2 normalized to a0, and their 5.23
+// fixed point register data.
+void dsp_control_eq_coefficients(const equalizer_t *eq, float *coefficients);
+
+void dsp_control_pack_coefficients(const float *coefficients, uint8_t *data);
+
+// Writes all current settings, see dsp_control_flush() for the result.
+bool dsp_control_apply_settings(void);
+
+bool dsp_control_flush(void);
+
+bool dsp_control_scrub(void);
+
+// Words the scrubber repaired, all DSPs together.
+uint32_t dsp_control_scrub_repairs(void);
+
+// Switches to the DSP image in a slot and applies the current settings to
+// it. The outputs are muted while the differences are written. When a DSP
+// fails to switch, the others go back to the program they ran.
+bool dsp_control_switch_program(uint8_t index);
+
+// Slot of the image the DSP runs.
+uint8_t dsp_control_program(void);
+
 //TODO: add gain adjustment support
 
 /******************************* THE END *********************************/
@@ -0,0 +1,145 @@
+/*
+ * dsp_image.c
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * DSP images are stored in their own flash partition, side by side in
+ * slots of DSP_IMAGE_SLOT_SIZE. They are generated from the SigmaStudio
+ * export by dsp_image_generator.py. Images are memory mapped, the
+ * sections are written to the DSP straight from flash.
+ *
+ */
+/******************************* INCLUDES ********************************/
+
+#include "dsp_image.h"
+
+/******************************* GLOBAL VARIABLES ************************/
+
+static const char *TAG = "DSP_image";
+
+/******************************* LOCAL FUNCTIONS *************************/
+
+static const esp_partition_t* dsp_image_partition(void)
+{
+    return esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                    DSP_IMAGE_PARTITION_SUBTYPE,
+                                    DSP_IMAGE_PARTITION_LABEL);
+}
+
+bool dsp_image_valid(const dsp_image_header_t *header)
+{
+    if(header->magic  != DSP_IMAGE_MAGIC  ||
+       header->format != DSP_IMAGE_FORMAT ||
+       header->size   <  sizeof(dsp_image_header_t) ||
+       header->size   >  DSP_IMAGE_SLOT_SIZE ||
+       header->section_amount > DSP_IMAGE_SECTION_MAX)
+    {
+        return false;
+    }
+
+    uint32_t tableEnd = sizeof(dsp_image_header_t) + 
+                        header->section_amount * sizeof(dsp_image_section_t);
+    if(tableEnd > header->size)
+    {
+        return false;
+    }
+
+    for(int i = 0; i < header->section_amount; i++)
+    {
+        const dsp_image_section_t *section = &header->sections[i];
+
+        if(section->type == DSP_IMAGE_SECTION_CLEAR)
+        {
+            continue;
+        }
+        if(section->type != DSP_IMAGE_SECTION_DATA ||
+           section->offset < tableEnd ||
+           section->offset + section->len > header->size)
+        {
+            return false;
+        }
+    }
+
+    const uint8_t *crcStart = (const uint8_t*)header + DSP_IMAGE_CRC_START;
+    uint32_t      crc       = esp_crc32_le(0,
+                                           crcStart,
+                                           header->size - DSP_IMAGE_CRC_START);
+    return crc == header->crc;
+}
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+uint8_t dsp_image_open(uint8_t index, dsp_image_t *image)
+{
+    const esp_partition_t *partition = dsp_image_partition();
+    const void            *mapped    = NULL;
+
+    image->header = NULL;
+
+    if(partition == NULL || index >= dsp_image_slots())
+    {
+        ESP_LOGW(TAG, "No DSP image slot %d!", index);
+        return DSP_IMAGE_FAILED;
+    }
+
+    if(esp_partition_mmap(partition,
+                          index * DSP_IMAGE_SLOT_SIZE,
+                          DSP_IMAGE_SLOT_SIZE,
+                          ESP_PARTITION_MMAP_DATA,
+                          &mapped,
+                          &image->handle) != ESP_OK)
+    {
+        ESP_LOGW(TAG, "Mapping DSP image %d failed!", index);
+        return DSP_IMAGE_FAILED;
+    }
+
+    if(!dsp_image_valid((const dsp_image_header_t*)mapped))
+    {
+        esp_partition_munmap(image->handle);
+        ESP_LOGW(TAG, "DSP image %d is invalid!", index);
+        return DSP_IMAGE_FAILED;
+    }
+
+    image->index  = index;
+    image->header = (const dsp_image_header_t*)mapped;
+    ESP_LOGI(TAG, "DSP image %d version %d opened.",
+             index,
+             (int)image->header->version);
+    return DSP_IMAGE_SUCCESS;
+}
+
+void dsp_image_close(dsp_image_t *image)
+{
+    if(image->header != NULL)
+    {
+        esp_partition_munmap(image->handle);
+        image->header = NULL;
+    }
+}
+
+uint8_t dsp_image_slots(void)
+{
+    const esp_partition_t *partition = dsp_image_partition();
+
+    if(partition == NULL)
+    {
+        return 0;
+    }
+    return partition->size / DSP_IMAGE_SLOT_SIZE;
+}
+
+const uint8_t* dsp_image_section_data(const dsp_image_t *image,
+                                      uint8_t           section)
+{
+    if(image->header == NULL || 
+       section >= image->header->section_amount ||
+       image->header->sections[section].type != DSP_IMAGE_SECTION_DATA)
+    {
+        return NULL;
+    }
+    return (const uint8_t*)image->header +
+           image->header->sections[section].offset;
+}
+
+/******************************* THE END *********************************/
@@ -0,0 +1,110 @@
+/*
+ * dsp_image.h
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * DSP images are stored in their own flash partition, side by side in
+ * slots of DSP_IMAGE_SLOT_SIZE. They are generated from the SigmaStudio
+ * export by dsp_image_generator.py. An image is a header with a section
+ * table followed by the section data. Images are memory mapped, the
+ * sections are written to the DSP straight from flash.
+ *
+ * Image layout, little endian:
+ *   magic, size, crc         crc over everything after it up to size
+ *   format, section amount
+ *   version, hash            hash is 28 bits, stored in the DSP
+ *   layout                   hash of the module addresses
+ *   section table            address, regsize, type, offset, len
+ *   section data
+ *
+ * Images are sparse. RAM is stored as runs of meaningful words, the zero
+ * regions between them are clear sections without data.
+ *
+ */
+#ifndef DSP_IMAGE_H_
+#define DSP_IMAGE_H_
+
+/******************************* INCLUDES ********************************/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_crc.h"
+
+/******************************* DEFINES *********************************/
+
+#define DSP_IMAGE_PARTITION_LABEL   "dsp_images"
+#define DSP_IMAGE_PARTITION_SUBTYPE 0x40
+#define DSP_IMAGE_SLOT_SIZE         0x8000
+
+#define DSP_IMAGE_MAGIC             0x50534445 /* "EDSP"              */
+#define DSP_IMAGE_FORMAT            3
+#define DSP_IMAGE_SECTION_MAX       64
+
+// Section types
+#define DSP_IMAGE_SECTION_DATA      0      /* Write the data             */
+#define DSP_IMAGE_SECTION_CLEAR     1      /* Region is zero, no data    */
+
+// The crc covers everything after the crc field.
+#define DSP_IMAGE_CRC_START         offsetof(dsp_image_header_t, format)
+
+#define DSP_IMAGE_SUCCESS           1
+#define DSP_IMAGE_FAILED            0
+
+/******************************* TYPEDEFS ********************************/
+
+typedef struct __attribute__((packed))
+{
+    uint16_t address;  /* DSP register address                  */
+    uint8_t  regsize;  /* Register size of the target memory    */
+    uint8_t  type;     /* DSP_IMAGE_SECTION_*                   */
+    uint32_t offset;   /* Offset of the data from image start   */
+    uint32_t len;      /* Length in bytes                       */
+} dsp_image_section_t;
+
+typedef struct __attribute__((packed))
+{
+    uint32_t magic;
+    uint32_t size;
+    uint32_t crc;
+    uint16_t format;
+    uint16_t section_amount;
+    uint32_t version;
+    uint32_t hash;
+    uint32_t layout;   /* Hash of the module addresses          */
+
+    // Sections in download order, section_amount of them.
+    dsp_image_section_t sections[];
+} dsp_image_header_t;
+
+typedef struct
+{
+    uint8_t                     index;
+    const dsp_image_header_t    *header;
+    esp_partition_mmap_handle_t handle;
+} dsp_image_t;
+
+/******************************* LOCAL FUNCTIONS *************************/
+
+bool dsp_image_valid(const dsp_image_header_t *header);
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+// Maps the image in a slot. It stays mapped until it is closed.
+uint8_t dsp_image_open(uint8_t index, dsp_image_t *image);
+
+void dsp_image_close(dsp_image_t *image);
+
+// Amount of slots in the partition, valid or not.
+uint8_t dsp_image_slots(void);
+
+const uint8_t* dsp_image_section_data(const dsp_image_t *image,
+                                      uint8_t           section);
+
+/******************************* THE END *********************************/
+
+#endif /* DSP_IMAGE_H_ */
@@ -23,6 +23,11 @@
 #include "esp_log.h"
 #include "event.h"
 #include "ble.h"
+#include "i2c_bus.h"
+#include "cli.h"
+#include "telemetry.h"
+#include "boot_profile.h"
+#include "capture.h"
 
 /******************************* GLOBAL VARIABLES ************************/
 
@@ -40,34 +45,29 @@ void dsp_task(void* pvParameters);
 
 void task_interfaces(void* pvParameters);
 
-void memory_watcher(void* arg)
-{
-    for(;;)
-    {
-        printf("RAM left %d\n", (int)esp_get_free_heap_size());
-        vTaskDelay(10000 / portTICK_PERIOD_MS);
-    }
-    vTaskDelete(NULL);   
-}
-
 /******************************** PROGRAM ENTRY **************************/
 
 void app_main(void)
 {
+    boot_profile_begin(BOOT_PHASE_APP_MAIN);
+
+    // Both the DSP and the settings task add devices to the bus.
+    init_i2c_bus();
+
     communication_t* settingstodsp        = dsp_communication_create();    
-    communication_t* settingstointerfaces = dsp_communication_create();
 
     settings_queues.settings_dsp        = settingstodsp;
-    settings_queues.settings_interfaces = settingstointerfaces;
+    // One pipeline per interface client.
+    for(int i = 0; i < SETTINGS_INTERFACE_AMOUNT; i++)
+    {
+        settings_queues.settings_interfaces[i] = dsp_communication_create();
+    }
 
-    // creates memory watcher task
-    // xTaskCreatePinnedToCore(memory_watcher, 
-    //                         "Memory", 
-    //                         4096, 
-    //                         NULL, 
-    //                         2, 
-    //                         NULL, 
-    //                         tskNO_AFFINITY);
+    // Samples task, heap, queue and bus health.
+    init_telemetry();
+
+    // Records the commands of the settings task when started on the CLI.
+    init_capture();
 
     // creates the dsp control task
     xTaskCreatePinnedToCore(dsp_task, 
@@ -82,7 +82,7 @@ void app_main(void)
     xTaskCreatePinnedToCore(task_interfaces, 
                             "Interfaces", 
                             4096, 
-                            (void*)settingstointerfaces, 
+                            (void*)settings_queues.settings_interfaces, 
                             2, 
                             NULL, 
                             tskNO_AFFINITY);
@@ -95,6 +95,11 @@ void app_main(void)
                             2, 
                             NULL, 
                             tskNO_AFFINITY);                            
+
+    // Diagnostics on the debug UART.
+    init_cli();
+
+    boot_profile_end(BOOT_PHASE_APP_MAIN);
 }
 
 /******************************* THE END *********************************/
\ No newline at end of file
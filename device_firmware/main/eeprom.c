@@ -7,7 +7,6 @@
  * Library to write and read data to and from a 24LC128 EEPROM.
  *
  */ 
-// TODO: Change adding to i2c command. Can be done without loop.
 /******************************* INCLUDES ********************************/
 
 #include "eeprom.h"
@@ -18,64 +17,10 @@ static const char *TAG = "eeprom_control";
 
 eeprom_data *eeprom = NULL;
 
-/******************************* LOCAL FUNCTIONS *************************/
-
-esp_err_t eeprom_i2c_master_init(uint8_t i2c_scl_gpio, 
-                                 uint8_t i2c_sda_gpio, 
-                                 uint8_t i2c_port_num,
-                                 bool    internal_pullup)
-{
-    uint8_t i2c_master_port = i2c_port_num;
-
-    i2c_config_t conf = {
-        .mode = I2C_MODE_MASTER,
-        .sda_io_num = i2c_sda_gpio,
-        .scl_io_num = i2c_scl_gpio,
-        .sda_pullup_en = internal_pullup,
-        .scl_pullup_en = internal_pullup,
-        .master.clk_speed = I2C_MASTER_FREQ_HZ,
-    };
-
-    i2c_param_config(i2c_master_port, &conf);
-
-    return i2c_driver_install(i2c_master_port, 
-                              conf.mode, 
-                              I2C_MASTER_RX_BUF_DISABLE, 
-                              I2C_MASTER_TX_BUF_DISABLE, 
-                              0);
-}
-
+// Write cycles since boot, a measure of the wear.
+static uint32_t commits = 0;
 
-uint8_t eeprom_ack_poll(void)
-{
-    long start = xTaskGetTickCount();
-
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-    i2c_master_start(cmd);
-    i2c_master_write_byte(cmd, 
-                          (eeprom->eeprom_address << 1) | WRITE_BIT, 
-                          ACK_CHECK_EN);
-    i2c_master_stop(cmd); 
-
-    while(1)
-    {
-        esp_err_t ret = i2c_master_cmd_begin(eeprom->i2c_port_num, 
-                                             cmd, 
-                                             I2C_TIMEOUT_MS / portTICK_PERIOD_MS);
-        if(ret == ESP_OK)
-        {
-            i2c_cmd_link_delete(cmd);
-            return ACK_POLL_SUCCESS;
-        }
-        if((xTaskGetTickCount() - start) > (ACK_POLL_TIMEOUT / portTICK_PERIOD_MS))
-        {
-            i2c_cmd_link_delete(cmd);
-            return ACK_POLL_FAILED;
-        }
-    }
-    i2c_cmd_link_delete(cmd);
-    return ACK_POLL_FAILED;
-}
+/******************************* LOCAL FUNCTIONS *************************/
 
 // depricated
 void write_cycle_task_hold(void)
@@ -98,21 +43,27 @@ uint8_t init_eeprom(uint8_t i2c_scl_gpio,
         eeprom->i2c_sda_gpio   = i2c_sda_gpio;
         eeprom->i2c_port_num   = i2c_port_num;
         eeprom->eeprom_address = eeprom_address;
+        eeprom->device         = NULL;
 
-        esp_err_t err_code = eeprom_i2c_master_init(i2c_scl_gpio,
-                                                    i2c_sda_gpio,
-                                                    i2c_port_num,
-                                                    true);
-
-        if(err_code == ESP_OK)
+        if(i2c_bus_port_init(i2c_port_num,
+                             i2c_scl_gpio,
+                             i2c_sda_gpio,
+                             true))
+        {
+            eeprom->device = i2c_bus_add_device(i2c_port_num,
+                                                eeprom_address,
+                                                EEPROM_WRITE_CYCLE_MS);
+        }
+        if(eeprom->device != NULL)
         {  
             // Let's poll the i2c line to see if we get a response.
-            if(eeprom_ack_poll())
+            if(i2c_bus_probe(eeprom->device, I2C_BUS_PRIO_LOW) == ESP_OK)
             {
                 ESP_LOGI(TAG, "EEPROM init succes!");
                 return EEPROM_INIT_SUCCESS;
             }
         }
+        i2c_bus_remove_device(eeprom->device);
     }
     free(eeprom);
     eeprom = NULL;
@@ -120,11 +71,12 @@ uint8_t init_eeprom(uint8_t i2c_scl_gpio,
     return EEPROM_INIT_FAILED;
 }
 
+// The port stays with the bus, other devices may still use it.
 uint8_t deinit_eeprom()
 {
     if(eeprom != NULL)
     {
-        i2c_driver_delete(eeprom->i2c_port_num);
+        i2c_bus_remove_device(eeprom->device);
         free(eeprom);
         eeprom = NULL;
         return EEPROM_DEINIT_SUCCESS;
@@ -135,73 +87,22 @@ uint8_t deinit_eeprom()
 uint8_t eeprom_read_random_byte(uint16_t data_address, 
                                 uint8_t  *rx_data)
 {
-    if(eeprom != NULL)
-    {   
-        if(eeprom_ack_poll())
-        {
-            uint8_t address_low  = data_address;
-            uint8_t address_high = data_address >> 8;
-
-            i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-
-            i2c_master_start(cmd);
-            // Control byte ->
-            i2c_master_write_byte(cmd, 
-                                (eeprom->eeprom_address << 1) | WRITE_BIT, 
-                                ACK_CHECK_EN);
-            i2c_master_write_byte(cmd, address_high, ACK_CHECK_EN);
-            i2c_master_write_byte(cmd, address_low,  ACK_CHECK_EN);
-            i2c_master_start(cmd);
-            // Control byte ->
-            i2c_master_write_byte(cmd, 
-                                (eeprom->eeprom_address << 1) | READ_BIT, 
-                                ACK_CHECK_EN);
-            i2c_master_read_byte(cmd, rx_data, NACK_VAL);
-            i2c_master_stop(cmd); 
-
-            esp_err_t ret = i2c_master_cmd_begin(eeprom->i2c_port_num, 
-                                                cmd, 
-                                                I2C_TIMEOUT_MS / portTICK_PERIOD_MS);
-
-            i2c_cmd_link_delete(cmd);
-
-            if(ret == ESP_OK)
-            {
-                return EEPROM_READ_SUCCESS;
-            }
-        }
-    }
-    ESP_LOGW(TAG, "EEPROM read failed.");
-    return EEPROM_READ_FAILED;
+    return eeprom_sequential_read(data_address, rx_data, 1);
 }
 
 uint8_t eeprom_current_address_read(uint8_t  *rx_data)
 {
     if(eeprom != NULL)
     {
-        if(eeprom_ack_poll())
+        if(i2c_bus_read(eeprom->device, 
+                        I2C_BUS_PRIO_LOW, 
+                        NULL, 
+                        0, 
+                        rx_data, 
+                        1) == ESP_OK)
         {
-            i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-            i2c_master_start(cmd);
-            // Control byte ->
-            i2c_master_write_byte(cmd, 
-                                (eeprom->eeprom_address << 1) | READ_BIT, 
-                                ACK_CHECK_EN);
-
-            i2c_master_read_byte(cmd, rx_data, NACK_VAL);
-            i2c_master_stop(cmd); 
-
-            esp_err_t ret = i2c_master_cmd_begin(eeprom->i2c_port_num, 
-                                                cmd, 
-                                                I2C_TIMEOUT_MS / portTICK_PERIOD_MS);
-
-            i2c_cmd_link_delete(cmd);
-
-            if(ret == ESP_OK)
-            {
-                return EEPROM_READ_SUCCESS;
-            }
-        }   
+            return EEPROM_READ_SUCCESS;
+        }
     }
     ESP_LOGW(TAG, "EEPROM read failed.");
     return EEPROM_READ_FAILED;
@@ -211,50 +112,18 @@ uint8_t eeprom_sequential_read(uint16_t data_address,
                                uint8_t  *rx_data,
                                uint16_t len)
 {
-    if(eeprom != NULL)
+    if(eeprom != NULL && len > 0)
     {
-        if(eeprom_ack_poll())
+        uint8_t address[2] = {data_address >> 8, data_address};
+
+        if(i2c_bus_read(eeprom->device, 
+                        I2C_BUS_PRIO_LOW, 
+                        address, 
+                        sizeof(address), 
+                        rx_data, 
+                        len) == ESP_OK)
         {
-            if(len > 1)
-            {
-                uint8_t address_low  = data_address;
-                uint8_t address_high = data_address >> 8;
-
-                i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-
-                i2c_master_start(cmd);
-                // Control byte ->
-                i2c_master_write_byte(cmd, 
-                                    (eeprom->eeprom_address << 1) | WRITE_BIT, 
-                                    ACK_CHECK_EN);
-                i2c_master_write_byte(cmd, address_high, ACK_CHECK_EN);
-                i2c_master_write_byte(cmd, address_low,  ACK_CHECK_EN);
-                i2c_master_start(cmd);
-                // Control byte ->
-                i2c_master_write_byte(cmd, 
-                                    (eeprom->eeprom_address << 1) | READ_BIT, 
-                                    ACK_CHECK_EN);
-
-                // We now sequentially read every byte from EEPROM
-                // Every byte is ended with an ACK. The last byte is ended with
-                // NACK and stop bit.
-                for(int i = 0; i < len - 1; i++)
-                {
-                    i2c_master_read_byte(cmd, rx_data + i, ACK_VAL);
-                }
-                i2c_master_read_byte(cmd, rx_data + (len - 1), NACK_VAL);
-                i2c_master_stop(cmd);
-                esp_err_t ret = i2c_master_cmd_begin(eeprom->i2c_port_num, 
-                                                cmd, 
-                                                I2C_TIMEOUT_MS / portTICK_PERIOD_MS);
-
-                i2c_cmd_link_delete(cmd);
-
-                if(ret == ESP_OK)
-                {
-                    return EEPROM_READ_SUCCESS;
-                } 
-            }
+            return EEPROM_READ_SUCCESS;
         }
     }
     ESP_LOGW(TAG, "EEPROM read failed.");
@@ -266,33 +135,17 @@ uint8_t eeprom_write_random_byte(uint16_t data_address,
 {
     if(eeprom != NULL)
     {
-        if(eeprom_ack_poll())
-        {
-            uint8_t address_low  = data_address;
-            uint8_t address_high = data_address >> 8;
-
-            i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-
-            i2c_master_start(cmd);
-            // Control byte ->
-            i2c_master_write_byte(cmd, 
-                                (eeprom->eeprom_address << 1) | WRITE_BIT, 
-                                ACK_CHECK_EN);
-            i2c_master_write_byte(cmd, address_high, ACK_CHECK_EN);
-            i2c_master_write_byte(cmd, address_low,  ACK_CHECK_EN);
-            i2c_master_write_byte(cmd, tx_data, ACK_CHECK_EN);
-            i2c_master_stop(cmd);
-
-            esp_err_t ret = i2c_master_cmd_begin(eeprom->i2c_port_num, 
-                                                cmd, 
-                                                I2C_TIMEOUT_MS / portTICK_PERIOD_MS);
-
-            i2c_cmd_link_delete(cmd);
-
-            if(ret == ESP_OK)
-            {   
-                return EEPROM_WRITE_SUCCESS;
-            } 
+        uint8_t address[2] = {data_address >> 8, data_address};
+
+        if(i2c_bus_write(eeprom->device, 
+                         I2C_BUS_PRIO_LOW, 
+                         address, 
+                         sizeof(address), 
+                         &tx_data, 
+                         1) == ESP_OK)
+        {   
+            commits++;
+            return EEPROM_WRITE_SUCCESS;
         }
     }
     return EEPROM_WRITE_FAILED;
@@ -304,46 +157,32 @@ uint8_t eeprom_write_page(uint16_t page_address,
 {
     if(eeprom != NULL)
     {
-        if(eeprom_ack_poll())
+        if((len <= EEPROM_PAGE_SIZE) && (len > 1)) 
         {
-            if((len <= EEPROM_PAGE_SIZE) && (len > 1)) 
+            //Check if given address is a page start address.
+            if((page_address % EEPROM_PAGE_SIZE)  == 0)
             {
-                //Check if given address is a page start address.
-                if((page_address % EEPROM_PAGE_SIZE)  == 0)
-                {
-                    uint8_t address_low  = page_address;
-                    uint8_t address_high = page_address >> 8;
-
-                    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-
-                    i2c_master_start(cmd);
-                    // Control byte ->
-                    i2c_master_write_byte(cmd, 
-                                        (eeprom->eeprom_address << 1) | WRITE_BIT, 
-                                        ACK_CHECK_EN);
-                    i2c_master_write_byte(cmd, address_high, ACK_CHECK_EN);
-                    i2c_master_write_byte(cmd, address_low,  ACK_CHECK_EN);
-                    for(int i = 0; i < len; i++)
-                    {
-                        i2c_master_write_byte(cmd, tx_data[i], ACK_CHECK_EN);
-                    }
-                    i2c_master_stop(cmd);
-
-                    esp_err_t ret = i2c_master_cmd_begin(eeprom->i2c_port_num, 
-                                                cmd, 
-                                                I2C_TIMEOUT_MS / portTICK_PERIOD_MS);
-
-                    i2c_cmd_link_delete(cmd);
-
-                    if(ret == ESP_OK)
-                    {   
-                        return EEPROM_WRITE_SUCCESS;
-                    }        
-                }
+                uint8_t address[2] = {page_address >> 8, page_address};
+
+                if(i2c_bus_write(eeprom->device, 
+                                 I2C_BUS_PRIO_LOW, 
+                                 address, 
+                                 sizeof(address), 
+                                 tx_data, 
+                                 len) == ESP_OK)
+                {   
+                    commits++;
+                    return EEPROM_WRITE_SUCCESS;
+                }        
             }
         }
     }
     return EEPROM_WRITE_FAILED;
 }
 
+uint32_t eeprom_commits(void)
+{
+    return commits;
+}
+
 /******************************* THE END *********************************/
\ No newline at end of file
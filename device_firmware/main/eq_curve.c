@@ -0,0 +1,285 @@
+/*
+ * eq_curve.c
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Frequency response of the EQ cascade of a channel, see eq_curve.h.
+ *
+ */
+/******************************* INCLUDES ********************************/
+
+#include "eq_curve.h"
+
+/******************************* GLOBAL VARIABLES ************************/
+
+static eq_curve_cache_t caches[EQ_CURVE_CHANNELS];
+static eq_curve_stats_t curveStats;
+
+// Points of the grid, e^-jw and e^-2jw of every point.
+static uint8_t gridPoints = 0;
+static float   cos1[EQ_CURVE_POINTS_MAX];
+static float   sin1[EQ_CURVE_POINTS_MAX];
+static float   cos2[EQ_CURVE_POINTS_MAX];
+static float   sin2[EQ_CURVE_POINTS_MAX];
+
+// Numerator and denominator of one band, the cascade so far.
+static float   numReal[EQ_CURVE_POINTS_MAX];
+static float   numImag[EQ_CURVE_POINTS_MAX];
+static float   denReal[EQ_CURVE_POINTS_MAX];
+static float   denImag[EQ_CURVE_POINTS_MAX];
+static float   power[EQ_CURVE_POINTS_MAX];
+static float   phases[EQ_CURVE_POINTS_MAX];
+
+/******************************* LOCAL FUNCTIONS *************************/
+
+static uint8_t* put_u16(uint8_t *buf, uint16_t value)
+{
+    *buf++ = value;
+    *buf++ = value >> 8;
+    return buf;
+}
+
+static uint8_t* put_u32(uint8_t *buf, uint32_t value)
+{
+    *buf++ = value;
+    *buf++ = value >> 8;
+    *buf++ = value >> 16;
+    *buf++ = value >> 24;
+    return buf;
+}
+
+void eq_curve_grid(uint8_t points)
+{
+    if(points == gridPoints)
+    {
+        return;
+    }
+    for(int i = 0; i < points; i++)
+    {
+        float freq = EQ_CURVE_FREQ_MIN *
+                     powf((float)EQ_CURVE_FREQ_MAX / EQ_CURVE_FREQ_MIN,
+                          (float)i / (points - 1));
+        float w    = 2 * M_PI * freq / ADA_SAMPLE_FREQ;
+
+        cos1[i] = cosf(w);
+        sin1[i] = sinf(w);
+        cos2[i] = cosf(2 * w);
+        sin2[i] = sinf(2 * w);
+    }
+    gridPoints = points;
+}
+
+// out = a * x + b * y + c
+void eq_curve_axpby(float       *out,
+                    const float *x,
+                    float       a,
+                    const float *y,
+                    float       b,
+                    float       c,
+                    uint8_t     len)
+{
+    for(int i = 0; i < len; i++)
+    {
+        out[i] = a * x[i] + b * y[i] + c;
+    }
+}
+
+/* Function: eq_curve_section
+ *
+ * Adds one band to the cascade. With the coefficients b0, b1, b2, -a1,
+ * -a2 as dsp_control designs them the band is
+ *
+ *   H(w) = (b0 + b1 e^-jw + b2 e^-2jw) / (1 + a1 e^-jw + a2 e^-2jw)
+ *
+ * The power of the cascade is multiplied by |H|^2 and kept above the
+ * floor, the phase of H is added.
+ *
+ */
+void eq_curve_section(const float *coefficients, uint8_t points, bool phase)
+{
+    const float floor = powf(10, EQ_CURVE_FLOOR_DB / 10.0f);
+
+    eq_curve_axpby(numReal, cos1,  coefficients[1], cos2,  coefficients[2],
+                   coefficients[0], points);
+    eq_curve_axpby(numImag, sin1, -coefficients[1], sin2, -coefficients[2],
+                   0, points);
+    eq_curve_axpby(denReal, cos1, -coefficients[3], cos2, -coefficients[4],
+                   1, points);
+    eq_curve_axpby(denImag, sin1,  coefficients[3], sin2,  coefficients[4],
+                   0, points);
+
+    for(int i = 0; i < points; i++)
+    {
+        float num = numReal[i] * numReal[i] + numImag[i] * numImag[i];
+        float den = denReal[i] * denReal[i] + denImag[i] * denImag[i];
+
+        power[i] = fmaxf(power[i] * num / fmaxf(den, FLT_MIN), floor);
+    }
+    if(phase)
+    {
+        for(int i = 0; i < points; i++)
+        {
+            phases[i] += atan2f(numImag[i], numReal[i]) -
+                         atan2f(denImag[i], denReal[i]);
+        }
+    }
+}
+
+void eq_curve_evaluate(const equalizer_t *bands,
+                       uint8_t           amount,
+                       uint8_t           points,
+                       bool              phase)
+{
+    float coefficients[ADA_COEFFICIENT_AMOUNT];
+
+    eq_curve_grid(points);
+    for(int i = 0; i < points; i++)
+    {
+        power[i]  = 1;
+        phases[i] = 0;
+    }
+    for(int i = 0; i < amount; i++)
+    {
+        // A band that is off passes the signal.
+        if(bands[i].state == STATE_ON)
+        {
+            dsp_control_eq_coefficients(&bands[i], coefficients);
+            eq_curve_section(coefficients, points, phase);
+        }
+    }
+}
+
+// Only the fields the design uses, the addresses don't matter.
+bool eq_curve_band_equal(const equalizer_t *a, const equalizer_t *b)
+{
+    return a->q           == b->q           &&
+           a->s           == b->s           &&
+           a->bandwidth   == b->bandwidth   &&
+           a->boost       == b->boost       &&
+           a->freq        == b->freq        &&
+           a->gain        == b->gain        &&
+           a->filter_type == b->filter_type &&
+           a->phase       == b->phase       &&
+           a->state       == b->state;
+}
+
+// Record of the last evaluation, see EQ_CURVE_RECORD_FORMAT.
+uint16_t eq_curve_record(bool     output,
+                         uint8_t  chan_num,
+                         uint32_t version,
+                         uint8_t  points,
+                         uint8_t  flags,
+                         uint8_t  *buf)
+{
+    uint8_t *start = buf;
+
+    *buf++ = EQ_CURVE_RECORD_FORMAT;
+    buf    = put_u32(buf, version);
+    *buf++ = output;
+    *buf++ = chan_num;
+    *buf++ = points;
+    *buf++ = flags;
+    buf    = put_u16(buf, EQ_CURVE_FREQ_MIN);
+    buf    = put_u16(buf, EQ_CURVE_FREQ_MAX);
+
+    for(int i = 0; i < points; i++)
+    {
+        buf = put_u16(buf, (uint16_t)(int16_t)lroundf(1000 * log10f(power[i])));
+    }
+    if(flags & EQ_CURVE_FLAG_PHASE)
+    {
+        for(int i = 0; i < points; i++)
+        {
+            float degrees = remainderf(phases[i] * (180 / M_PI), 360);
+
+            buf = put_u16(buf, (uint16_t)(int16_t)lroundf(degrees * 100));
+        }
+    }
+    return buf - start;
+}
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+/* Function: eq_curve_serialize
+ *
+ * The version is read before the bands. When a write slips in between
+ * the cache holds newer bands under an older version, the next read then
+ * compares the bands again and finds them equal.
+ *
+ */
+uint16_t eq_curve_serialize(bool     output,
+                            uint8_t  chan_num,
+                            uint8_t  points,
+                            uint8_t  flags,
+                            uint8_t  *buf,
+                            uint16_t len)
+{
+    uint8_t amount = output ? DEVICE_SETTINGS_OUTPUT_EQ_AMOUNT :
+                              DEVICE_SETTINGS_INPUT_EQ_AMOUNT;
+    uint8_t index  = output ? DEVICE_SETTINGS_INPUT_AMOUNT + chan_num :
+                              chan_num;
+
+    flags &= EQ_CURVE_FLAGS;
+    if(buf == NULL || points < EQ_CURVE_POINTS_MIN ||
+       points > EQ_CURVE_POINTS_MAX ||
+       chan_num >= (output ? DEVICE_SETTINGS_OUTPUT_AMOUNT :
+                             DEVICE_SETTINGS_INPUT_AMOUNT) ||
+       len < EQ_CURVE_RECORD_HEADER + points * sizeof(int16_t) *
+             ((flags & EQ_CURVE_FLAG_PHASE) ? 2 : 1))
+    {
+        return 0;
+    }
+
+    eq_curve_cache_t *cache   = &caches[index];
+    uint32_t         version = device_settings_get_version();
+    bool             same    = cache->valid          &&
+                               cache->points == points &&
+                               cache->flags  == flags;
+
+    curveStats.reads++;
+    if(!same || cache->version != version)
+    {
+        equalizer_t bands[EQ_CURVE_BAND_MAX];
+
+        for(int i = 0; i < amount; i++)
+        {
+            if(!device_settings_read_eq(output, chan_num, i, &bands[i]))
+            {
+                return 0;
+            }
+            same = same && eq_curve_band_equal(&bands[i], &cache->bands[i]);
+        }
+
+        if(same)
+        {
+            // Another channel changed, only the version moves.
+            put_u32(&cache->record[1], version);
+        }
+        else
+        {
+            int64_t start = esp_timer_get_time();
+
+            eq_curve_evaluate(bands, amount, points,
+                              flags & EQ_CURVE_FLAG_PHASE);
+            cache->len = eq_curve_record(output, chan_num, version,
+                                         points, flags, cache->record);
+            memcpy(cache->bands, bands, amount * sizeof(equalizer_t));
+            curveStats.compute_us = esp_timer_get_time() - start;
+            curveStats.computed++;
+        }
+        cache->valid   = true;
+        cache->version = version;
+        cache->points  = points;
+        cache->flags   = flags;
+    }
+    memcpy(buf, cache->record, cache->len);
+    return cache->len;
+}
+
+void eq_curve_get_stats(eq_curve_stats_t *stats)
+{
+    *stats = curveStats;
+}
+
+/******************************* THE END *********************************/
@@ -0,0 +1,128 @@
+/*
+ * eq_curve.h
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Frequency response of the EQ cascade of one channel, so a client can
+ * draw the curve without downloading the settings and designing the
+ * filters itself. The bands are designed with dsp_control, so the curve
+ * is the one of the coefficients the DSP runs, and evaluated at log
+ * spaced points between EQ_CURVE_FREQ_MIN and EQ_CURVE_FREQ_MAX.
+ *
+ * The evaluation works on whole arrays of points, one band at a time,
+ * in plain loops the compiler can keep in registers.
+ *
+ * Every channel keeps its last curve with the settings version it was
+ * made for. A read at the same version is served from the cache, a newer
+ * version only recomputes the curve when a band of that channel changed.
+ *
+ */
+#ifndef EQ_CURVE_H_
+#define EQ_CURVE_H_
+
+/******************************* INCLUDES ********************************/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include "esp_timer.h"
+#include "device_settings.h"
+#include "dsp_control.h"
+
+/******************************* DEFINES *********************************/
+
+#define EQ_CURVE_FREQ_MIN      20
+#define EQ_CURVE_FREQ_MAX      20000
+#define EQ_CURVE_POINTS_MIN    2
+#define EQ_CURVE_POINTS_MAX    120
+#define EQ_CURVE_POINTS        64      /* Default of a new client        */
+#define EQ_CURVE_BAND_MAX      5
+#define EQ_CURVE_CHANNELS      (DEVICE_SETTINGS_INPUT_AMOUNT + \
+                                DEVICE_SETTINGS_OUTPUT_AMOUNT)
+
+// Curves end at the floor, deep notches and stop bands don't underflow.
+#define EQ_CURVE_FLOOR_DB      -120
+
+#define EQ_CURVE_FLAG_PHASE    0x01
+#define EQ_CURVE_FLAGS         EQ_CURVE_FLAG_PHASE
+
+// Curve record, little endian:
+//   u8 format, u32 settings version, u8 is output, u8 channel,
+//   u8 points, u8 flags, u16 freq min, u16 freq max,
+//   i16 magnitude[points] in hundredths of a dB,
+//   i16 phase[points] in hundredths of a degree, with EQ_CURVE_FLAG_PHASE
+#define EQ_CURVE_RECORD_FORMAT 1
+#define EQ_CURVE_RECORD_HEADER 13
+#define EQ_CURVE_RECORD_MAX    (EQ_CURVE_RECORD_HEADER + \
+                                EQ_CURVE_POINTS_MAX * 2 * sizeof(int16_t))
+
+/******************************* TYPEDEFS ********************************/
+
+typedef struct
+{
+    bool        valid;
+    uint32_t    version;
+    uint8_t     points;
+    uint8_t     flags;
+    equalizer_t bands[EQ_CURVE_BAND_MAX];
+
+    uint16_t    len;
+    uint8_t     record[EQ_CURVE_RECORD_MAX];
+} eq_curve_cache_t;
+
+typedef struct
+{
+    uint32_t reads;
+    uint32_t computed;       /* Reads that evaluated the cascade        */
+    uint32_t compute_us;     /* Time of the last evaluation             */
+} eq_curve_stats_t;
+
+/******************************* LOCAL FUNCTIONS *************************/
+
+void eq_curve_grid(uint8_t points);
+
+void eq_curve_axpby(float       *out,
+                    const float *x,
+                    float       a,
+                    const float *y,
+                    float       b,
+                    float       c,
+                    uint8_t     len);
+
+void eq_curve_section(const float *coefficients, uint8_t points, bool phase);
+
+void eq_curve_evaluate(const equalizer_t *bands,
+                       uint8_t           amount,
+                       uint8_t           points,
+                       bool              phase);
+
+bool eq_curve_band_equal(const equalizer_t *a, const equalizer_t *b);
+
+uint16_t eq_curve_record(bool     output,
+                         uint8_t  chan_num,
+                         uint32_t version,
+                         uint8_t  points,
+                         uint8_t  flags,
+                         uint8_t  *buf);
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+// Writes the curve record of a channel, returns its length or 0 when the
+// channel or the amount of points doesn't exist. Not reentrant, the
+// caches are only used from the BLE host task.
+uint16_t eq_curve_serialize(bool     output,
+                            uint8_t  chan_num,
+                            uint8_t  points,
+                            uint8_t  flags,
+                            uint8_t  *buf,
+                            uint16_t len);
+
+void eq_curve_get_stats(eq_curve_stats_t *stats);
+
+/******************************* THE END *********************************/
+
+#endif /* EQ_CURVE_H_ */
@@ -17,6 +17,9 @@
 /******************************* GLOBAL VARIABLES ************************/
 
 static const char *TAG = "Event";
+
+static communication_t *communicationList[EVENT_COMMUNICATION_MAX];
+static uint8_t         communicationAmount = 0;
  
 /******************************* LOCAL FUNCTIONS *************************/
 
@@ -32,11 +35,84 @@ communication_t* dsp_communication_create()
         ret->event_queue = xQueueCreate(QUEUE_SIZE, sizeof(dsp_event_t));
         ret->event_response_queue = xQueueCreate(QUEUE_SIZE, 
                                           sizeof(dsp_event_response_t));
+
+        // Only created during startup, no lock needed.
+        if(communicationAmount < EVENT_COMMUNICATION_MAX)
+        {
+            communicationList[communicationAmount++] = ret;
+        }
         return ret;        
     }
     return ret;
 }
 
+uint8_t dsp_communication_amount(void)
+{
+    return communicationAmount;
+}
+
+communication_t* dsp_communication_get(uint8_t index)
+{
+    if(index < communicationAmount)
+    {
+        return communicationList[index];
+    }
+    return NULL;
+}
+
+communication_set_t* dsp_communication_set_create(communication_t** communications,
+                                                 uint8_t amount)
+{
+    communication_set_t* ret = 
+                  (communication_set_t*)malloc(sizeof(communication_set_t));
+
+    if(ret != NULL)
+    {
+        ret->communications = communications;
+        ret->amount         = amount;
+        ret->queue_set      = xQueueCreateSet(QUEUE_SIZE * amount);
+
+        if(ret->queue_set != NULL)
+        {
+            for(int i = 0; i < amount; i++)
+            {
+                if(xQueueAddToSet(communications[i]->event_queue, 
+                                  ret->queue_set) != pdPASS)
+                {
+                    ESP_LOGE(TAG, "Unable to add communication to set!");
+                }
+            }
+            return ret;
+        }
+        free(ret);
+    }
+    return NULL;
+}
+
+communication_t* await_event_set(communication_set_t *set,
+                                 void *event,
+                                 TickType_t timeout)
+{
+    if(set != NULL && event != NULL)
+    {
+        QueueSetMemberHandle_t member = xQueueSelectFromSet(set->queue_set, 
+                                                            timeout);
+        for(int i = 0; (member != NULL) && (i < set->amount); i++)
+        {
+            if(set->communications[i]->event_queue == member)
+            {
+                // The set only tells which queue holds an event, the event
+                // itself is still in it.
+                if(xQueueReceive(member, event, 0) == pdTRUE)
+                {
+                    return set->communications[i];
+                }
+            }
+        }
+    }
+    return NULL;
+}
+
 // Combination of communication and event has to be correct, queues in the 
 // communication have the be created for the event types using.
 bool await_event(communication_t *communication,
@@ -76,6 +152,8 @@ bool send_event(communication_t *communication,
 {
     if(communication != NULL && event != NULL && response != NULL)
     {
+        trace_mark(TRACE_STAGE_EVENT_SEND);
+
         // Send the event,
         if(xQueueSend(communication->event_queue, 
                       event, 
@@ -86,6 +164,7 @@ bool send_event(communication_t *communication,
                              response, 
                              timeout) == pdTRUE)
             {
+                trace_mark(TRACE_STAGE_RESPONSE);
                 return true;
             }
         }
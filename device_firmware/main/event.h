@@ -15,14 +15,22 @@
 
 /******************************* INCLUDES ********************************/
 
+#include "sdkconfig.h"
 #include "device_settings.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/queue.h"
+#include "trace.h"
 #include <stdbool.h>
 
 /******************************* DEFINES *********************************/
 
 #define QUEUE_SIZE              1
+// Every simultaneous client (BLE connection) has its own pipeline into the
+// settings task.
+#define SETTINGS_INTERFACE_AMOUNT CONFIG_BT_NIMBLE_MAX_CONNECTIONS
+// Communications are listed for telemetry. The DSP pipeline and the
+// interface pipelines.
+#define EVENT_COMMUNICATION_MAX (1 + SETTINGS_INTERFACE_AMOUNT)
 #define EVENT_STD_TIMEOUT_MS    5000
 #define EVENT_STD_TIMEOUT_TICKS (EVENT_STD_TIMEOUT_MS / portTICK_PERIOD_MS)
 
@@ -33,6 +41,9 @@
 #define DSP_GET_EQ   3
 #define DSP_GET_MUX  4
 #define DSP_GET_GAIN 5
+#define DSP_SET_PRESET 6
+// Settings task to DSP task, applies all current settings at once.
+#define DSP_SET_ALL    7
 
 // EVENT RESPONSE EVENT TYPES
 #define EVENT_RESPONSE_OK             0
@@ -57,6 +68,12 @@ typedef struct
     equalizer_t  eq;
     mux_t        mux;
     // gain_t      gain;
+
+    // DSP image slot to switch to.
+    uint8_t      preset;
+
+    // Request id for latency tracing, 0 when not traced.
+    uint16_t     trace_id;
 }dsp_event_t;
 
 typedef struct
@@ -74,12 +91,21 @@ typedef struct
     QueueHandle_t event_response_queue;
 }communication_t;
 
-// The settings task needs two different queues, one for communication with
-// The DSP task and one for communication with the interfaces task.
+// Several communications that can be awaited at once. The settings task
+// serves every interface pipeline this way.
+typedef struct
+{
+    QueueSetHandle_t  queue_set;
+    communication_t** communications;
+    uint8_t           amount;
+}communication_set_t;
+
+// The settings task needs two different kinds of queues, one for 
+// communication with the DSP task and one per client of the interfaces task.
 typedef struct
 {
     communication_t* settings_dsp;
-    communication_t* settings_interfaces;
+    communication_t* settings_interfaces[SETTINGS_INTERFACE_AMOUNT];
 }settings_task_communications_t;
 
 /******************************* LOCAL FUNCTIONS *************************/
@@ -89,6 +115,22 @@ typedef struct
 // For communication between interfaces, settings and dsp task
 communication_t* dsp_communication_create();
 
+// Communications created so far, in order of creation.
+uint8_t dsp_communication_amount(void);
+
+communication_t* dsp_communication_get(uint8_t index);
+
+// Groups communications so their events can be awaited together
+communication_set_t* dsp_communication_set_create(communication_t** communications,
+                                                 uint8_t amount);
+
+// Waits for a DSP event on any communication in the set until timeout.
+// Returns the communication the event came from, the response has to be 
+// sent on that one. Returns NULL on timeout.
+communication_t* await_event_set(communication_set_t *set,
+                                 void *event,
+                                 TickType_t timeout);
+
 // Waits for DSP event until timout
 bool await_event(communication_t *communication, 
                  void *event, 
@@ -0,0 +1,22 @@
+/*
+ * firmware_version.h
+ *
+ * Created: 19-10-2026 
+ * Author: Perry Petiet
+ *
+ * Version of the EasyDSP firmware. Reported to clients in the advertising
+ * status record so a rack of units can be checked without connecting.
+ * 
+ */ 
+#ifndef FIRMWARE_VERSION_H_
+#define FIRMWARE_VERSION_H_
+
+/******************************* DEFINES *********************************/
+
+#define FIRMWARE_VERSION_MAJOR 0
+#define FIRMWARE_VERSION_MINOR 1
+#define FIRMWARE_VERSION_PATCH 0
+
+/******************************* THE END *********************************/
+
+#endif /* FIRMWARE_VERSION_H_ */
@@ -0,0 +1,579 @@
+/*
+ * i2c_bus.c
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Shared I2C bus manager. It owns both I2C ports of the ESP32 and runs a
+ * worker task per port, so the ports are used in parallel. Drivers
+ * (sigma_dsp, eeprom, ...) register a device descriptor on a port and hand
+ * transactions to the bus from any task. The worker serializes the
+ * transactions of a port and always serves high priority transactions
+ * first.
+ *
+ */
+/******************************* INCLUDES ********************************/
+
+#include "i2c_bus.h"
+#include "esp_rom_sys.h"
+
+/******************************* GLOBAL VARIABLES ************************/
+
+static const char *TAG = "I2C_bus";
+
+static i2c_bus_port_t i2c_bus_ports[I2C_BUS_PORT_AMOUNT];
+
+static SemaphoreHandle_t i2c_bus_init_lock = NULL;
+
+/******************************* LOCAL FUNCTIONS *************************/
+
+// Sends only the address of the device, succeeds when it acknowledges.
+esp_err_t i2c_bus_address(i2c_bus_device_t *device)
+{
+    i2c_bus_port_t *port = &i2c_bus_ports[device->port];
+
+#if I2C_BUS_MASTER_DRIVER
+    return i2c_master_probe(port->bus, device->address, I2C_TIMEOUT_MS);
+#else
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create_static(port->link_buf,
+                                                      sizeof(port->link_buf));
+    i2c_master_start(cmd);
+    i2c_master_write_byte(cmd,
+                          (device->address << 1) | WRITE_BIT,
+                          ACK_CHECK_EN);
+    i2c_master_stop(cmd);
+
+    esp_err_t ret = i2c_master_cmd_begin(device->port,
+                                         cmd,
+                                         I2C_TIMEOUT_MS / portTICK_PERIOD_MS);
+    i2c_cmd_link_delete_static(cmd);
+    return ret;
+#endif
+}
+
+// Polls until the device acknowledges its address, with a doubling 
+// backoff in microseconds. An EEPROM write cycle is a few ms, shorter than 
+// a tick at CONFIG_FREERTOS_HZ 100, so waits below a tick spin. The worker
+// runs above every task that uses the bus, longer waits sleep so a 
+// missing device doesn't burn a core.
+uint8_t i2c_bus_ack_poll(i2c_bus_device_t *device)
+{
+    TickType_t start   = xTaskGetTickCount();
+    uint32_t   backoff = ACK_POLL_FIRST_BACKOFF_US;
+
+    while((xTaskGetTickCount() - start) <= (ACK_POLL_TIMEOUT / portTICK_PERIOD_MS))
+    {
+        if(i2c_bus_address(device) == ESP_OK)
+        {
+            device->alive         = true;
+            device->write_pending = false;
+            return ACK_POLL_SUCCESS;
+        }
+
+        if(backoff < portTICK_PERIOD_MS * 1000)
+        {
+            esp_rom_delay_us(backoff);
+        }
+        else
+        {
+            vTaskDelay(backoff / (portTICK_PERIOD_MS * 1000));
+        }
+        if(backoff < ACK_POLL_MAX_BACKOFF_US)
+        {
+            backoff *= 2;
+        }
+    }
+    device->alive = false;
+    return ACK_POLL_FAILED;
+}
+
+// Only polls when the device might not answer: after a failed transfer or
+// while the write cycle of the last write may still be running.
+static uint8_t i2c_bus_wait_ready(i2c_bus_device_t *device)
+{
+    if(device->alive && device->write_pending &&
+       (xTaskGetTickCount() - device->write_tick) >
+       (device->write_cycle_ms / portTICK_PERIOD_MS))
+    {
+        // Write cycle is over for sure.
+        device->write_pending = false;
+    }
+
+    if(device->alive && !device->write_pending)
+    {
+        return ACK_POLL_SUCCESS;
+    }
+    return i2c_bus_ack_poll(device);
+}
+
+esp_err_t i2c_bus_execute(i2c_bus_port_t *port, i2c_bus_transaction_t *txn)
+{
+    i2c_bus_device_t *device = txn->device;
+
+    if(txn->op == I2C_BUS_OP_PROBE)
+    {
+        return i2c_bus_ack_poll(device) ? ESP_OK : ESP_ERR_TIMEOUT;
+    }
+    if(!i2c_bus_wait_ready(device))
+    {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    esp_err_t ret;
+
+#if I2C_BUS_MASTER_DRIVER
+    if(txn->op == I2C_BUS_OP_WRITE)
+    {
+        i2c_master_transmit_multi_buffer_info_t buffers[2] = {
+            { .write_buffer = (uint8_t*)txn->header, .buffer_size = txn->header_len },
+            { .write_buffer = txn->data,             .buffer_size = txn->len        },
+        };
+
+        if(txn->header_len > 0 && txn->len > 0)
+        {
+            ret = i2c_master_multi_buffer_transmit(device->handle,
+                                                   buffers,
+                                                   2,
+                                                   I2C_TIMEOUT_MS);
+        }
+        else if(txn->header_len > 0)
+        {
+            ret = i2c_master_transmit(device->handle,
+                                      txn->header,
+                                      txn->header_len,
+                                      I2C_TIMEOUT_MS);
+        }
+        else
+        {
+            ret = i2c_master_transmit(device->handle,
+                                      txn->data,
+                                      txn->len,
+                                      I2C_TIMEOUT_MS);
+        }
+    }
+    else if(txn->header_len > 0)
+    {
+        ret = i2c_master_transmit_receive(device->handle,
+                                          txn->header,
+                                          txn->header_len,
+                                          txn->data,
+                                          txn->len,
+                                          I2C_TIMEOUT_MS);
+    }
+    else
+    {
+        ret = i2c_master_receive(device->handle,
+                                 txn->data,
+                                 txn->len,
+                                 I2C_TIMEOUT_MS);
+    }
+#else
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create_static(port->link_buf,
+                                                      sizeof(port->link_buf));
+    i2c_master_start(cmd);
+    if(txn->header_len > 0 || txn->op == I2C_BUS_OP_WRITE)
+    {
+        // Control byte -->
+        i2c_master_write_byte(cmd,
+                              (device->address << 1) | WRITE_BIT,
+                              ACK_CHECK_EN);
+        if(txn->header_len > 0)
+        {
+            i2c_master_write(cmd, txn->header, txn->header_len, ACK_CHECK_EN);
+        }
+    }
+    if(txn->op == I2C_BUS_OP_WRITE)
+    {
+        if(txn->len > 0)
+        {
+            i2c_master_write(cmd, txn->data, txn->len, ACK_CHECK_EN);
+        }
+    }
+    else
+    {
+        if(txn->header_len > 0)
+        {
+            // Repeated start for the read part.
+            i2c_master_start(cmd);
+        }
+        i2c_master_write_byte(cmd,
+                              (device->address << 1) | READ_BIT,
+                              ACK_CHECK_EN);
+        // Every byte is ended with an ACK, the last one with a NACK.
+        i2c_master_read(cmd, txn->data, txn->len, I2C_MASTER_LAST_NACK);
+    }
+    i2c_master_stop(cmd);
+
+    ret = i2c_master_cmd_begin(device->port,
+                               cmd,
+                               I2C_TIMEOUT_MS / portTICK_PERIOD_MS);
+
+    i2c_cmd_link_delete_static(cmd);
+#endif
+
+    if(ret == ESP_OK)
+    {
+        if(txn->op == I2C_BUS_OP_WRITE && device->write_cycle_ms > 0)
+        {
+            device->write_pending = true;
+            device->write_tick    = xTaskGetTickCount();
+        }
+    }
+    else
+    {
+        // Next transfer checks the device is back first.
+        device->alive = false;
+    }
+    return ret;
+}
+
+/* Function: i2c_bus_task
+ *
+ * Worker of one I2C port. Every queued transaction gives the pending
+ * semaphore once, the worker then takes the oldest high priority
+ * transaction, or a low priority one when there is none. Once the 
+ * transaction is done its callback runs and its semaphore is given, after
+ * that the worker doesn't touch it anymore.
+ *
+ */
+void i2c_bus_task(void *pvParameters)
+{
+    i2c_bus_port_t        *port = (i2c_bus_port_t*)pvParameters;
+    i2c_bus_transaction_t *txn  = NULL;
+
+    for(;;)
+    {
+        if(xSemaphoreTake(port->pending, portMAX_DELAY) == pdTRUE)
+        {
+            for(int prio = 0; prio < I2C_BUS_PRIO_AMOUNT; prio++)
+            {
+                if(xQueueReceive(port->queue[prio], &txn, 0) == pdTRUE)
+                {
+                    SemaphoreHandle_t done = txn->done;
+
+                    txn->result = i2c_bus_execute(port, txn);
+
+                    port->stats.transactions++;
+                    port->stats.bytes += txn->header_len + txn->len;
+                    if(txn->result != ESP_OK)
+                    {
+                        port->stats.errors++;
+                    }
+                    if(txn->callback != NULL)
+                    {
+                        txn->callback(txn);
+                    }
+                    if(done != NULL)
+                    {
+                        xSemaphoreGive(done);
+                    }
+                    break;
+                }
+            }
+        }
+    }
+    vTaskDelete(NULL);
+}
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+uint8_t init_i2c_bus(void)
+{
+    if(i2c_bus_init_lock == NULL)
+    {
+        i2c_bus_init_lock = xSemaphoreCreateMutex();
+    }
+    if(i2c_bus_init_lock != NULL)
+    {
+        return I2C_BUS_INIT_SUCCESS;
+    }
+    ESP_LOGW(TAG, "I2C bus init failed!");
+    return I2C_BUS_INIT_FAILED;
+}
+
+bool i2c_bus_port_init(uint8_t port_num,
+                       uint8_t i2c_scl_gpio,
+                       uint8_t i2c_sda_gpio,
+                       bool    internal_pullup)
+{
+    if(port_num >= I2C_BUS_PORT_AMOUNT || i2c_bus_init_lock == NULL)
+    {
+        return false;
+    }
+
+    xSemaphoreTake(i2c_bus_init_lock, portMAX_DELAY);
+
+    i2c_bus_port_t *port = &i2c_bus_ports[port_num];
+    bool           ret   = port->initialized;
+
+    if(!port->initialized)
+    {
+#if I2C_BUS_MASTER_DRIVER
+        i2c_master_bus_config_t conf = {
+            .i2c_port = port_num,
+            .sda_io_num = i2c_sda_gpio,
+            .scl_io_num = i2c_scl_gpio,
+            .clk_source = I2C_CLK_SRC_DEFAULT,
+            .glitch_ignore_cnt = I2C_BUS_GLITCH_IGNORE_CNT,
+            .flags.enable_internal_pullup = internal_pullup,
+        };
+
+        if(i2c_new_master_bus(&conf, &port->bus) == ESP_OK)
+#else
+        i2c_config_t conf = {
+            .mode = I2C_MODE_MASTER,
+            .sda_io_num = i2c_sda_gpio,
+            .scl_io_num = i2c_scl_gpio,
+            .sda_pullup_en = internal_pullup,
+            .scl_pullup_en = internal_pullup,
+            .master.clk_speed = I2C_MASTER_FREQ_HZ,
+        };
+
+        i2c_param_config(port_num, &conf);
+
+        if(i2c_driver_install(port_num,
+                              conf.mode,
+                              I2C_MASTER_RX_BUF_DISABLE,
+                              I2C_MASTER_TX_BUF_DISABLE,
+                              0) == ESP_OK)
+#endif
+        {
+            for(int prio = 0; prio < I2C_BUS_PRIO_AMOUNT; prio++)
+            {
+                port->queue[prio] = xQueueCreate(I2C_BUS_QUEUE_SIZE,
+                                                 sizeof(i2c_bus_transaction_t*));
+            }
+            port->pending = xSemaphoreCreateCounting(I2C_BUS_QUEUE_SIZE *
+                                                     I2C_BUS_PRIO_AMOUNT,
+                                                     0);
+
+            char name[configMAX_TASK_NAME_LEN];
+            snprintf(name, sizeof(name), "I2C_bus_%d", port_num);
+
+            if(port->queue[I2C_BUS_PRIO_HIGH] != NULL &&
+               port->queue[I2C_BUS_PRIO_LOW]  != NULL &&
+               port->pending                  != NULL &&
+               xTaskCreatePinnedToCore(i2c_bus_task,
+                                       name,
+                                       I2C_BUS_TASK_STACK,
+                                       (void*)port,
+                                       I2C_BUS_TASK_PRIORITY,
+                                       &port->worker,
+                                       tskNO_AFFINITY) == pdPASS)
+            {
+                port->initialized = true;
+                ret = true;
+                ESP_LOGI(TAG, "I2C port %d init success!", port_num);
+            }
+        }
+        if(!ret)
+        {
+            ESP_LOGW(TAG, "I2C port %d init failed!", port_num);
+        }
+    }
+
+    xSemaphoreGive(i2c_bus_init_lock);
+    return ret;
+}
+
+i2c_bus_device_t* i2c_bus_add_device(uint8_t port,
+                                     uint8_t address,
+                                     uint8_t write_cycle_ms)
+{
+    if(port >= I2C_BUS_PORT_AMOUNT || !i2c_bus_ports[port].initialized)
+    {
+        return NULL;
+    }
+
+    i2c_bus_device_t *device = malloc(sizeof(i2c_bus_device_t));
+    if(device != NULL)
+    {
+        device->port           = port;
+        device->address        = address;
+        device->write_cycle_ms = write_cycle_ms;
+        device->alive          = false;
+        device->write_pending  = false;
+        device->write_tick     = 0;
+        device->lock           = xSemaphoreCreateRecursiveMutex();
+        device->done           = xSemaphoreCreateBinary();
+
+#if I2C_BUS_MASTER_DRIVER
+        i2c_device_config_t conf = {
+            .dev_addr_length = I2C_ADDR_BIT_LEN_7,
+            .device_address = address,
+            .scl_speed_hz = I2C_MASTER_FREQ_HZ,
+        };
+
+        if(i2c_master_bus_add_device(i2c_bus_ports[port].bus,
+                                     &conf,
+                                     &device->handle) != ESP_OK)
+        {
+            device->handle = NULL;
+        }
+        if(device->lock != NULL && device->done != NULL && device->handle != NULL)
+#else
+        if(device->lock != NULL && device->done != NULL)
+#endif
+        {
+            return device;
+        }
+        i2c_bus_remove_device(device);
+    }
+    return NULL;
+}
+
+void i2c_bus_remove_device(i2c_bus_device_t *device)
+{
+    if(device != NULL)
+    {
+#if I2C_BUS_MASTER_DRIVER
+        if(device->handle != NULL)
+        {
+            i2c_master_bus_rm_device(device->handle);
+        }
+#endif
+        if(device->lock != NULL)
+        {
+            vSemaphoreDelete(device->lock);
+        }
+        if(device->done != NULL)
+        {
+            vSemaphoreDelete(device->done);
+        }
+        free(device);
+    }
+}
+
+bool i2c_bus_lock(i2c_bus_device_t *device, TickType_t timeout)
+{
+    return xSemaphoreTakeRecursive(device->lock, timeout) == pdTRUE;
+}
+
+void i2c_bus_unlock(i2c_bus_device_t *device)
+{
+    xSemaphoreGiveRecursive(device->lock);
+}
+
+esp_err_t i2c_bus_submit(i2c_bus_transaction_t *txn, uint8_t prio)
+{
+    if(txn == NULL || txn->device == NULL || prio >= I2C_BUS_PRIO_AMOUNT ||
+       (txn->done == NULL && txn->callback == NULL))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if(txn->op == I2C_BUS_OP_READ && (txn->data == NULL || txn->len == 0))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    i2c_bus_port_t *port = &i2c_bus_ports[txn->device->port];
+
+    txn->result = ESP_ERR_INVALID_STATE;
+    if(xQueueSend(port->queue[prio], &txn, portMAX_DELAY) != pdTRUE)
+    {
+        return ESP_FAIL;
+    }
+    xSemaphoreGive(port->pending);
+    return ESP_OK;
+}
+
+esp_err_t i2c_bus_wait(i2c_bus_transaction_t *txn, TickType_t timeout)
+{
+    if(txn->done == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if(xSemaphoreTake(txn->done, timeout) != pdTRUE)
+    {
+        return ESP_ERR_TIMEOUT;
+    }
+    return txn->result;
+}
+
+// The worker finishes every transaction within the ack poll and transfer
+// timeouts, so the synchronous helpers wait without a timeout. Returning
+// early would leave the worker with a dangling transaction.
+static esp_err_t i2c_bus_transfer(i2c_bus_device_t *device,
+                                  uint8_t          prio,
+                                  uint8_t          op,
+                                  const uint8_t    *header,
+                                  uint8_t          header_len,
+                                  uint8_t          *data,
+                                  uint16_t         len)
+{
+    if(device == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    i2c_bus_transaction_t txn = {
+        .device     = device,
+        .op         = op,
+        .header     = header,
+        .header_len = header_len,
+        .data       = data,
+        .len        = len,
+        .done       = device->done,
+    };
+
+    i2c_bus_lock(device, portMAX_DELAY);
+    esp_err_t ret = i2c_bus_submit(&txn, prio);
+    if(ret == ESP_OK)
+    {
+        ret = i2c_bus_wait(&txn, portMAX_DELAY);
+    }
+    i2c_bus_unlock(device);
+
+    return ret;
+}
+
+esp_err_t i2c_bus_write(i2c_bus_device_t *device,
+                        uint8_t          prio,
+                        const uint8_t    *header,
+                        uint8_t          header_len,
+                        const uint8_t    *data,
+                        uint16_t         len)
+{
+    return i2c_bus_transfer(device,
+                            prio,
+                            I2C_BUS_OP_WRITE,
+                            header,
+                            header_len,
+                            (uint8_t*)data,
+                            len);
+}
+
+esp_err_t i2c_bus_read(i2c_bus_device_t *device,
+                       uint8_t          prio,
+                       const uint8_t    *header,
+                       uint8_t          header_len,
+                       uint8_t          *data,
+                       uint16_t         len)
+{
+    return i2c_bus_transfer(device,
+                            prio,
+                            I2C_BUS_OP_READ,
+                            header,
+                            header_len,
+                            data,
+                            len);
+}
+
+esp_err_t i2c_bus_probe(i2c_bus_device_t *device, uint8_t prio)
+{
+    return i2c_bus_transfer(device, prio, I2C_BUS_OP_PROBE, NULL, 0, NULL, 0);
+}
+
+bool i2c_bus_stats(uint8_t port, i2c_bus_stats_t *stats)
+{
+    if(port >= I2C_BUS_PORT_AMOUNT || !i2c_bus_ports[port].initialized)
+    {
+        return false;
+    }
+    // Torn reads of single counters can't happen, between counters they
+    // don't matter.
+    *stats = i2c_bus_ports[port].stats;
+    return true;
+}
+
+/******************************* THE END *********************************/
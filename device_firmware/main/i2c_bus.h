@@ -0,0 +1,235 @@
+/*
+ * i2c_bus.h
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Shared I2C bus manager. It owns both I2C ports of the ESP32 and runs a
+ * worker task per port, so the ports are used in parallel. Drivers
+ * (sigma_dsp, eeprom, ...) register a device descriptor on a port and hand
+ * transactions to the bus from any task. The worker serializes the
+ * transactions of a port and always serves high priority transactions
+ * first.
+ *
+ * A device descriptor also keeps the ready state of the device, the bus
+ * only polls a device for an acknowledge after a failed transfer or while
+ * its write cycle may still be running.
+ *
+ * Transactions can be submitted asynchronously. The caller is told about
+ * the completion by a semaphore, a callback or both.
+ *
+ * With ESP-IDF 5.3 or newer the ports are driven by the i2c_master
+ * bus/device driver. Older versions use the legacy command link driver.
+ *
+ */
+#ifndef I2C_BUS_H_
+#define I2C_BUS_H_
+
+/******************************* INCLUDES ********************************/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_log.h"
+#include "esp_err.h"
+#include "esp_idf_version.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+
+/******************************* DEFINES *********************************/
+
+// The i2c_master driver writes a header and data without copying them
+// together since 5.3.
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 3, 0)
+#define I2C_BUS_MASTER_DRIVER       1
+#include "driver/i2c_master.h"
+#else
+#define I2C_BUS_MASTER_DRIVER       0
+#include "driver/i2c.h"
+#endif
+
+#define I2C_MASTER_FREQ_HZ          400000 /* I2C master clock frequency */
+#define I2C_MASTER_TX_BUF_DISABLE   0      /* Disable buffer as master   */
+#define I2C_MASTER_RX_BUF_DISABLE   0      /* Disable buffer as master   */
+#define I2C_TIMEOUT_MS              1000
+
+#define ACK_CHECK_EN                0x1    /* Check ACK from slave       */
+#define ACK_CHECK_DIS               0x0    /* Do not chekc ACK from slave*/
+#define ACK_VAL                     0x0    /* I2C ack value              */
+#define NACK_VAL                    0x1    /* I2C nack value             */
+
+#define WRITE_BIT                   0      /* I2C master write value     */
+#define READ_BIT                    1      /* I2C master read value      */
+
+#define ACK_POLL_TIMEOUT            1000
+#define ACK_POLL_SUCCESS            1
+#define ACK_POLL_FAILED             0
+#define ACK_POLL_FIRST_BACKOFF_US   100    /* First wait between polls   */
+#define ACK_POLL_MAX_BACKOFF_US     16000  /* Cap of the doubling wait   */
+
+#define I2C_BUS_PORT_AMOUNT         2
+#define I2C_BUS_GLITCH_IGNORE_CNT   7
+#define I2C_BUS_QUEUE_SIZE          8
+#define I2C_BUS_TASK_STACK          4096
+#define I2C_BUS_TASK_PRIORITY       3      /* Above the tasks using it   */
+#if !I2C_BUS_MASTER_DRIVER
+#define I2C_BUS_LINK_SIZE           I2C_LINK_RECOMMENDED_SIZE(8)
+#endif
+
+// Transaction priorities. Interactive writes go before background work
+// like EEPROM commits, meter polling and scrubbing.
+#define I2C_BUS_PRIO_HIGH           0
+#define I2C_BUS_PRIO_LOW            1
+#define I2C_BUS_PRIO_AMOUNT         2
+
+// Transaction operations
+#define I2C_BUS_OP_WRITE            0      /* header + data              */
+#define I2C_BUS_OP_READ             1      /* header, restart, read data */
+#define I2C_BUS_OP_PROBE            2      /* address only               */
+
+#define I2C_BUS_INIT_SUCCESS        1
+#define I2C_BUS_INIT_FAILED         0
+
+/******************************* TYPEDEFS ********************************/
+
+typedef struct
+{
+    uint8_t port;
+    uint8_t address;
+
+    // Time the device ignores its address after a write, for example the
+    // write cycle of an EEPROM. 0 when the device has none.
+    uint8_t write_cycle_ms;
+
+    // Ready state, only touched by the worker of the port.
+    bool       alive;
+    bool       write_pending;
+    TickType_t write_tick;
+
+    // Held by a caller during a session of several transactions. Also
+    // serializes the synchronous helpers, which share the done semaphore.
+    SemaphoreHandle_t lock;
+    SemaphoreHandle_t done;
+
+#if I2C_BUS_MASTER_DRIVER
+    i2c_master_dev_handle_t handle;
+#endif
+} i2c_bus_device_t;
+
+typedef struct i2c_bus_transaction i2c_bus_transaction_t;
+
+// Runs on the worker of the port when the transaction is done, before the
+// done semaphore is given. Must not block.
+typedef void (*i2c_bus_callback_t)(i2c_bus_transaction_t *txn);
+
+struct i2c_bus_transaction
+{
+    i2c_bus_device_t *device;
+    uint8_t          op;
+
+    // Written before data. For a register address for example. A read with
+    // no header reads from the current address of the device.
+    const uint8_t    *header;
+    uint8_t          header_len;
+
+    uint8_t          *data;
+    uint16_t         len;
+
+    // Completion, at least one of them has to be set.
+    SemaphoreHandle_t  done;
+    i2c_bus_callback_t callback;
+    void               *arg;
+
+    esp_err_t          result;
+};
+
+// Counters of a port, only written by its worker.
+typedef struct
+{
+    uint32_t transactions;
+    uint32_t bytes;       /* Header and data, without addressing    */
+    uint32_t errors;
+} i2c_bus_stats_t;
+
+typedef struct
+{
+    bool initialized;
+
+    QueueHandle_t     queue[I2C_BUS_PRIO_AMOUNT];
+    SemaphoreHandle_t pending;
+    TaskHandle_t      worker;
+
+    i2c_bus_stats_t   stats;
+
+#if I2C_BUS_MASTER_DRIVER
+    i2c_master_bus_handle_t bus;
+#else
+    uint8_t link_buf[I2C_BUS_LINK_SIZE];
+#endif
+} i2c_bus_port_t;
+
+/******************************* LOCAL FUNCTIONS *************************/
+
+esp_err_t i2c_bus_address(i2c_bus_device_t *device);
+
+uint8_t i2c_bus_ack_poll(i2c_bus_device_t *device);
+
+esp_err_t i2c_bus_execute(i2c_bus_port_t *port, i2c_bus_transaction_t *txn);
+
+void i2c_bus_task(void *pvParameters);
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+// Has to be called once before any port is used.
+uint8_t init_i2c_bus(void);
+
+// Installs the driver and starts the worker of a port. Calling it again
+// for a port that is already running does nothing.
+bool i2c_bus_port_init(uint8_t port,
+                       uint8_t i2c_scl_gpio,
+                       uint8_t i2c_sda_gpio,
+                       bool    internal_pullup);
+
+i2c_bus_device_t* i2c_bus_add_device(uint8_t port,
+                                     uint8_t address,
+                                     uint8_t write_cycle_ms);
+
+void i2c_bus_remove_device(i2c_bus_device_t *device);
+
+// Sessions keep other callers of the same device out between several
+// transactions. Sessions nest.
+bool i2c_bus_lock(i2c_bus_device_t *device, TickType_t timeout);
+
+void i2c_bus_unlock(i2c_bus_device_t *device);
+
+// Asynchronous interface. The transaction and its buffers have to stay
+// valid until it is done. i2c_bus_wait() needs the done semaphore.
+esp_err_t i2c_bus_submit(i2c_bus_transaction_t *txn, uint8_t prio);
+
+esp_err_t i2c_bus_wait(i2c_bus_transaction_t *txn, TickType_t timeout);
+
+// Synchronous helpers, block until the transaction is done.
+esp_err_t i2c_bus_write(i2c_bus_device_t *device,
+                        uint8_t          prio,
+                        const uint8_t    *header,
+                        uint8_t          header_len,
+                        const uint8_t    *data,
+                        uint16_t         len);
+
+esp_err_t i2c_bus_read(i2c_bus_device_t *device,
+                       uint8_t          prio,
+                       const uint8_t    *header,
+                       uint8_t          header_len,
+                       uint8_t          *data,
+                       uint16_t         len);
+
+esp_err_t i2c_bus_probe(i2c_bus_device_t *device, uint8_t prio);
+
+// Copies the counters of a port, false when it is not running.
+bool i2c_bus_stats(uint8_t port, i2c_bus_stats_t *stats);
+
+/******************************* THE END *********************************/
+
+#endif /* I2C_BUS_H_ */
@@ -6,188 +6,824 @@
  * 
  * This module is used to communicate with the ADAU1701 DSP chip. It 
  * loads the initial DSP program from the sigma studio software using
- * the exported parameters. The parameters can be found in 
- * sigma_studio_export.h.
+ * the exported parameters. The program is read from the DSP image
+ * partition, see dsp_image.h.
+ * 
+ * Every DSP is a handle returned by init_sigma_dsp(), one firmware can 
+ * drive several of them on one or both buses.
  * 
  * 
  */ 
-// TODO: Change adding to i2c command. Can be done without loop.
 /******************************* INCLUDES ********************************/
 
 #include "sigma_dsp.h"
-#include "sigma_dsp_program_data.h"
 
 /******************************* GLOBAL VARIABLES ************************/
 
-sigma_dsp_t *sigma_dsp = NULL;
-
 static const char *TAG = "Sigma_dsp";
 
+static portMUX_TYPE list_lock = portMUX_INITIALIZER_UNLOCKED;
+
 /******************************* LOCAL FUNCTIONS *************************/
 
-esp_err_t i2c_master_init(uint8_t i2c_scl_gpio, 
-                          uint8_t i2c_sda_gpio, 
-                          uint8_t i2c_port_num,
-                          bool    internal_pullup)
+void sigma_dsp_write_done(i2c_bus_transaction_t *txn)
 {
-    uint8_t i2c_master_port = i2c_port_num;
+    sigma_dsp_t            *dsp  = (sigma_dsp_t*)txn->arg;
+    sigma_dsp_async_slot_t *slot = (sigma_dsp_async_slot_t*)txn;
 
-    i2c_config_t conf = {
-        .mode = I2C_MODE_MASTER,
-        .sda_io_num = i2c_sda_gpio,
-        .scl_io_num = i2c_scl_gpio,
-        .sda_pullup_en = internal_pullup,
-        .scl_pullup_en = internal_pullup,
-        .master.clk_speed = I2C_MASTER_FREQ_HZ,
-    };
+    // Runs in the bus worker, the request is not current there.
+    trace_mark_id(slot->trace_id, TRACE_STAGE_WRITE_END);
+
+    if(txn->result != ESP_OK)
+    {
+        dsp->async_failed = true;
+    }
+}
+
+// Frees a slot, waits for its write when that is still on the wire.
+static void sigma_dsp_slot_wait(sigma_dsp_async_slot_t *slot)
+{
+    if(slot->busy)
+    {
+        i2c_bus_wait(&slot->txn, portMAX_DELAY);
+        slot->busy = false;
+    }
+}
+
+// Checks the segment stays inside one memory region and is a whole number
+// of registers of that region.
+bool sigma_dsp_segment_valid(const sigma_dsp_segment_t *segment)
+{
+    uint16_t regSize;
+    uint16_t regionEnd;
+
+    if(segment->data == NULL || segment->len == 0)
+    {
+        return false;
+    }
+
+    if(segment->address < SIGMA_DSP_PROGRAM_RAM_ADDR)
+    {
+        regSize   = SIGMA_DSP_PARAMETER_REGSIZE;
+        regionEnd = SIGMA_DSP_PROGRAM_RAM_ADDR;
+    }
+    else if(segment->address < SIGMA_DSP_REGISTER_ADDR)
+    {
+        regSize   = SIGMA_DSP_PROGRAM_REGSIZE;
+        regionEnd = SIGMA_DSP_REGISTER_ADDR;
+    }
+    else
+    {
+        // Control registers differ in size, a burst is a byte stream.
+        regSize   = SIGMA_DSP_REGISTER_REGSIZE;
+        regionEnd = SIGMA_DSP_REGISTER_END;
+    }
+
+    if((segment->len % regSize) != 0)
+    {
+        return false;
+    }
+    if(regSize > 1 && 
+       (segment->address + segment->len / regSize) > regionEnd)
+    {
+        return false;
+    }
+    if(regSize == 1 && segment->address >= regionEnd)
+    {
+        return false;
+    }
+    return true;
+}
+
+// Returns where a RAM address lives in the shadow image. len is limited to
+// what is left of the region. NULL for the control registers and for
+// program RAM when the image has no complete program.
+const uint8_t* sigma_dsp_shadow(sigma_dsp_t *dsp,
+                                uint16_t    reg_address,
+                                uint16_t    *len)
+{
+    const uint8_t *shadow;
+    uint16_t      left;
 
-    i2c_param_config(i2c_master_port, &conf);
+    if(reg_address < SIGMA_DSP_PROGRAM_RAM_ADDR)
+    {
+        shadow = dsp->parameter_shadow + 
+                 reg_address * SIGMA_DSP_PARAMETER_REGSIZE;
+        left   = SIGMA_DSP_PARAMETER_SIZE - 
+                 reg_address * SIGMA_DSP_PARAMETER_REGSIZE;
+    }
+    else if(reg_address < SIGMA_DSP_REGISTER_ADDR && 
+            dsp->program_shadow != NULL)
+    {
+        uint16_t offset = (reg_address - SIGMA_DSP_PROGRAM_RAM_ADDR) * 
+                          SIGMA_DSP_PROGRAM_REGSIZE;
+
+        shadow = dsp->program_shadow + offset;
+        left   = SIGMA_DSP_PROGRAM_SIZE - offset;
+    }
+    else
+    {
+        return NULL;
+    }
 
-    return i2c_driver_install(i2c_master_port, 
-                              conf.mode, 
-                              I2C_MASTER_RX_BUF_DISABLE, 
-                              I2C_MASTER_TX_BUF_DISABLE, 
-                              0);
+    if(*len > left)
+    {
+        *len = left;
+    }
+    return shadow;
 }
 
-uint8_t ack_poll(void)
+// Keeps the parameter shadow equal to what was written to the DSP. The
+// program shadow is the image in flash.
+void sigma_dsp_shadow_update(sigma_dsp_t   *dsp,
+                             uint16_t      reg_address, 
+                             uint16_t      len, 
+                             const uint8_t *data)
 {
-    long start = xTaskGetTickCount();
+    if(reg_address < SIGMA_DSP_PROGRAM_RAM_ADDR)
+    {
+        uint8_t *shadow = (uint8_t*)sigma_dsp_shadow(dsp, reg_address, &len);
+
+        if(shadow != data)
+        {
+            memcpy(shadow, data, len);
+        }
+    }
+}
 
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-    i2c_master_start(cmd);
-    i2c_master_write_byte(cmd, 
-                          (sigma_dsp->sigma_dsp_address << 1) | WRITE_BIT, 
-                          ACK_CHECK_EN);
-    i2c_master_stop(cmd); 
+// Copies a memory region as an image leaves it: its data sections on
+// top of zeros.
+void sigma_dsp_image_region(const dsp_image_t *image,
+                            uint16_t          region_address,
+                            uint8_t           regsize,
+                            uint16_t          size,
+                            uint8_t           *buffer)
+{
+    memset(buffer, 0, size);
 
-    while(1)
+    for(int i = 0; i < image->header->section_amount; i++)
     {
-        esp_err_t ret = i2c_master_cmd_begin(sigma_dsp->i2c_port_num, 
-                                             cmd, 
-                                             I2C_TIMEOUT_MS / portTICK_PERIOD_MS);
-        if(ret == ESP_OK)
+        const dsp_image_section_t *section = &image->header->sections[i];
+
+        if(section->type    != DSP_IMAGE_SECTION_DATA ||
+           section->regsize != regsize ||
+           section->address <  region_address)
         {
-            i2c_cmd_link_delete(cmd);
-            return ACK_POLL_SUCCESS;
+            continue;
         }
-        if((xTaskGetTickCount() - start) > (ACK_POLL_TIMEOUT / portTICK_PERIOD_MS))
+
+        uint32_t offset = (section->address - region_address) * regsize;
+        if(offset < size)
         {
-            i2c_cmd_link_delete(cmd);
-            return ACK_POLL_FAILED;
+            uint32_t len = section->len < size - offset ? 
+                           section->len : size - offset;
+            memcpy(buffer + offset, dsp_image_section_data(image, i), len);
         }
     }
-    i2c_cmd_link_delete(cmd);
-    return ACK_POLL_FAILED;
 }
 
-bool load_program(void)
+// The program of an image when it is one section, it can be used from 
+// flash as it is.
+static const uint8_t* sigma_dsp_image_program(const dsp_image_t *image)
 {
-    if(sigma_dsp != NULL)
+    for(int i = 0; i < image->header->section_amount; i++)
     {
-        // Load dsp_core_register_R0_data
-        if(!(sigma_dsp_write_burst(CORE_REGISTER_R0_ADDR,
-                                   CORE_REGISTER_R0_SIZE,
-                                   (uint8_t*)dsp_core_register_R0_data) 
-                                   == SIGMA_DSP_WRITE_SUCCESS))
+        const dsp_image_section_t *section = &image->header->sections[i];
+
+        if(section->type    == DSP_IMAGE_SECTION_DATA &&
+           section->address == SIGMA_DSP_PROGRAM_RAM_ADDR &&
+           section->len     == SIGMA_DSP_PROGRAM_SIZE)
         {
-            return false;
+            return dsp_image_section_data(image, i);
         }
-        // Load the program data:
-        if(!(sigma_dsp_write_burst(PROGRAM_ADDR,
-                                   PROGRAM_SIZE,
-                                   (uint8_t*)dsp_program_data) 
-                                   == SIGMA_DSP_WRITE_SUCCESS))
+    }
+    return NULL;
+}
+
+// Sets the shadow image to the defaults of an image: parameters are copied
+// to RAM, the program is used from flash.
+static void sigma_dsp_shadow_load(sigma_dsp_t *dsp, const dsp_image_t *image)
+{
+    sigma_dsp_image_region(image,
+                           SIGMA_DSP_PARAMETER_RAM_ADDR,
+                           SIGMA_DSP_PARAMETER_REGSIZE,
+                           SIGMA_DSP_PARAMETER_SIZE,
+                           dsp->parameter_shadow);
+    dsp->program_shadow = sigma_dsp_image_program(image);
+}
+
+// The core control register value the image ends with, the last write to
+// it starts the core.
+static const uint8_t* sigma_dsp_image_core_control(const dsp_image_t *image)
+{
+    const uint8_t *control = NULL;
+
+    for(int i = 0; i < image->header->section_amount; i++)
+    {
+        const dsp_image_section_t *section = &image->header->sections[i];
+
+        if(section->address == SIGMA_DSP_CORE_CONTROL_ADDR &&
+           section->type    == DSP_IMAGE_SECTION_DATA &&
+           section->len     >= SIGMA_DSP_CORE_CONTROL_SIZE)
+        {
+            control = dsp_image_section_data(image, i);
+        }
+    }
+    return control;
+}
+
+static void sigma_dsp_image_marker(const dsp_image_t *image, 
+                                   uint8_t           marker[SIGMA_DSP_PARAMETER_REGSIZE])
+{
+    uint32_t hash = image->header->hash;
+
+    marker[0] = (hash >> 24) & SIGMA_DSP_PARAMETER_MASK;
+    marker[1] = (hash >> 16) & 0xFF;
+    marker[2] = (hash >> 8)  & 0xFF;
+    marker[3] = hash & 0xFF;
+}
+
+// Counts down the segments of a write list, the last one wakes the caller.
+static void sigma_dsp_list_done(i2c_bus_transaction_t *txn)
+{
+    sigma_dsp_list_state_t *state = (sigma_dsp_list_state_t*)txn->arg;
+    bool                   last;
+
+    taskENTER_CRITICAL(&list_lock);
+    if(txn->result != ESP_OK)
+    {
+        state->failed++;
+    }
+    last = (--state->remaining == 0);
+    taskEXIT_CRITICAL(&list_lock);
+
+    if(last)
+    {
+        xSemaphoreGive(state->done);
+    }
+}
+
+// Reads back the fingerprint of the image: the hash written after the
+// download, the core control register and program words spread over the
+// program RAM.
+bool sigma_dsp_image_present(sigma_dsp_t *dsp, const dsp_image_t *image)
+{
+    uint8_t       word[SIGMA_DSP_PROGRAM_REGSIZE];
+    uint8_t       marker[SIGMA_DSP_PARAMETER_REGSIZE];
+    const uint8_t *control = sigma_dsp_image_core_control(image);
+
+    if(image->header->hash == 0 || 
+       control == NULL || 
+       dsp->program_shadow == NULL)
+    {
+        return false;
+    }
+
+    sigma_dsp_image_marker(image, marker);
+    if(!sigma_dsp_read_burst(dsp, SIGMA_DSP_IMAGE_MARKER_ADDR, 
+                             SIGMA_DSP_PARAMETER_REGSIZE, 
+                             word) ||
+       (word[0] & SIGMA_DSP_PARAMETER_MASK) != marker[0] ||
+       memcmp(&word[1], &marker[1], SIGMA_DSP_PARAMETER_REGSIZE - 1) != 0)
+    {
+        return false;
+    }
+
+    // A DSP that was reset in the meantime doesn't run.
+    if(!sigma_dsp_read_burst(dsp, SIGMA_DSP_CORE_CONTROL_ADDR, 
+                             SIGMA_DSP_CORE_CONTROL_SIZE, 
+                             word) ||
+       memcmp(word, control, SIGMA_DSP_CORE_CONTROL_SIZE) != 0)
+    {
+        return false;
+    }
+
+    uint16_t programWords = SIGMA_DSP_PROGRAM_SIZE / SIGMA_DSP_PROGRAM_REGSIZE;
+    for(int i = 0; i < SIGMA_DSP_FINGERPRINT_WORDS; i++)
+    {
+        uint16_t offset = (i * programWords) / SIGMA_DSP_FINGERPRINT_WORDS;
+
+        if(!sigma_dsp_read_burst(dsp, SIGMA_DSP_PROGRAM_RAM_ADDR + offset, 
+                                 SIGMA_DSP_PROGRAM_REGSIZE, 
+                                 word) ||
+           memcmp(word, 
+                  dsp->program_shadow + offset * SIGMA_DSP_PROGRAM_REGSIZE, 
+                  SIGMA_DSP_PROGRAM_REGSIZE) != 0)
         {
             return false;
         }
-        // Load the parameter data:
-        if(!(sigma_dsp_write_burst(PARAMETER_ADDR,
-                                   PARAMETER_SIZE,
-                                   (uint8_t*)dsp_parameter_data) 
-                                   == SIGMA_DSP_WRITE_SUCCESS))
+    }
+    return true;
+}
+
+bool sigma_dsp_reset(sigma_dsp_t *dsp)
+{
+    if(!set_reset_pin(dsp, 0))
+    {
+        return false;
+    }
+    vTaskDelay(pdMS_TO_TICKS(SIGMA_DSP_RESET_PULSE_MS));
+    if(!set_reset_pin(dsp, 1))
+    {
+        return false;
+    }
+    vTaskDelay(pdMS_TO_TICKS(SIGMA_DSP_RESET_INIT_MS));
+    return true;
+}
+
+// Writes sections first to last - 1 of an image in one list, the marker
+// after them when asked for.
+static uint8_t sigma_dsp_sections_write(sigma_dsp_t       *dsp,
+                                        const dsp_image_t *image,
+                                        uint16_t          first,
+                                        uint16_t          last,
+                                        bool              cleared,
+                                        bool              marked)
+{
+    static const uint8_t zeros[SIGMA_DSP_CLEAR_CHUNK] = {0};
+
+    uint16_t amount = marked ? 1 : 0;
+
+    for(int i = first; i < last; i++)
+    {
+        const dsp_image_section_t *section = &image->header->sections[i];
+
+        if(section->type != DSP_IMAGE_SECTION_CLEAR)
+        {
+            amount++;
+        }
+        else if(!cleared)
+        {
+            uint16_t chunk = SIGMA_DSP_CLEAR_CHUNK - 
+                             SIGMA_DSP_CLEAR_CHUNK % section->regsize;
+            amount += (section->len + chunk - 1) / chunk;
+        }
+    }
+    if(amount > UINT8_MAX)
+    {
+        ESP_LOGW(TAG, "DSP image has too many segments!");
+        return SIGMA_DSP_WRITE_FAILED;
+    }
+    if(amount == 0)
+    {
+        return SIGMA_DSP_WRITE_SUCCESS;
+    }
+
+    sigma_dsp_segment_t *program = malloc(amount * sizeof(sigma_dsp_segment_t));
+    uint8_t             marker[SIGMA_DSP_PARAMETER_REGSIZE];
+    uint8_t             result;
+    uint16_t            index  = 0;
+
+    if(program == NULL)
+    {
+        return SIGMA_DSP_WRITE_FAILED;
+    }
+
+    for(int i = first; i < last; i++)
+    {
+        const dsp_image_section_t *section = &image->header->sections[i];
+
+        if(section->type != DSP_IMAGE_SECTION_CLEAR)
+        {
+            program[index].address = section->address;
+            program[index].len     = section->len;
+            program[index].data    = dsp_image_section_data(image, i);
+            index++;
+            continue;
+        }
+        if(cleared)
+        {
+            continue;
+        }
+
+        uint16_t chunk   = SIGMA_DSP_CLEAR_CHUNK - 
+                           SIGMA_DSP_CLEAR_CHUNK % section->regsize;
+        uint16_t address = section->address;
+
+        for(uint32_t done = 0; done < section->len; done += chunk)
+        {
+            uint16_t len = section->len - done < chunk ? 
+                           section->len - done : chunk;
+
+            program[index].address = address;
+            program[index].len     = len;
+            program[index].data    = zeros;
+            address += len / section->regsize;
+            index++;
+        }
+    }
+    if(marked)
+    {
+        sigma_dsp_image_marker(image, marker);
+        program[index].address = SIGMA_DSP_IMAGE_MARKER_ADDR;
+        program[index].len     = SIGMA_DSP_PARAMETER_REGSIZE;
+        program[index].data    = marker;
+    }
+
+    result = sigma_dsp_write_list(dsp, program, amount);
+    free(program);
+    return result;
+}
+
+// Downloads a whole image. Sections go straight from flash to the DSP,
+// clear sections only when the RAM was not cleared by a reset. The marker 
+// goes last, it is only there after a full download.
+uint8_t sigma_dsp_image_write(sigma_dsp_t       *dsp,
+                              const dsp_image_t *image,
+                              bool              cleared)
+{
+    return sigma_dsp_sections_write(dsp, 
+                                    image, 
+                                    0, 
+                                    image->header->section_amount, 
+                                    cleared, 
+                                    true);
+}
+
+// Boot profile phase of a section. The image is in download order, core
+// control writes before the RAMs stop the core, the ones after start it.
+static uint8_t sigma_dsp_section_phase(const dsp_image_section_t *section,
+                                       bool                      ram_done)
+{
+    if(section->address < SIGMA_DSP_PROGRAM_RAM_ADDR)
+    {
+        return BOOT_PHASE_DSP_PARAMETER;
+    }
+    if(section->address < SIGMA_DSP_REGISTER_ADDR)
+    {
+        return BOOT_PHASE_DSP_PROGRAM;
+    }
+    if(section->len != SIGMA_DSP_CORE_CONTROL_SIZE)
+    {
+        return BOOT_PHASE_DSP_HW_CONF;
+    }
+    return ram_done ? BOOT_PHASE_DSP_START : BOOT_PHASE_DSP_STOP;
+}
+
+// The boot download, one list per run of sections of the same type so
+// every type gets its own boot profile phase.
+static uint8_t sigma_dsp_boot_write(sigma_dsp_t *dsp, const dsp_image_t *image)
+{
+    uint16_t amount  = image->header->section_amount;
+    uint16_t first   = 0;
+    bool     ramDone = false;
+
+    while(first < amount)
+    {
+        uint8_t  phase = sigma_dsp_section_phase(&image->header->sections[first],
+                                                 ramDone);
+        uint16_t last  = first + 1;
+
+        while(last < amount &&
+              sigma_dsp_section_phase(&image->header->sections[last], 
+                                      ramDone) == phase)
+        {
+            last++;
+        }
+        if(phase == BOOT_PHASE_DSP_PROGRAM || phase == BOOT_PHASE_DSP_PARAMETER)
+        {
+            ramDone = true;
+        }
+
+        boot_profile_begin(phase);
+        if(sigma_dsp_sections_write(dsp, 
+                                    image, 
+                                    first, 
+                                    last, 
+                                    true, 
+                                    last == amount) != SIGMA_DSP_WRITE_SUCCESS)
+        {
+            boot_profile_fail(phase);
+            return SIGMA_DSP_WRITE_FAILED;
+        }
+        boot_profile_end(phase);
+        first = last;
+    }
+    return SIGMA_DSP_WRITE_SUCCESS;
+}
+
+// While a switch is staged, parameter writes only change the new image.
+bool sigma_dsp_stage(sigma_dsp_t   *dsp,
+                     uint16_t      reg_address,
+                     uint16_t      len,
+                     const uint8_t *data)
+{
+    if(dsp->staged_parameters == NULL || 
+       reg_address >= SIGMA_DSP_PROGRAM_RAM_ADDR)
+    {
+        return false;
+    }
+
+    uint16_t offset = reg_address * SIGMA_DSP_PARAMETER_REGSIZE;
+    if(len > SIGMA_DSP_PARAMETER_SIZE - offset)
+    {
+        len = SIGMA_DSP_PARAMETER_SIZE - offset;
+    }
+    memcpy(dsp->staged_parameters + offset, data, len);
+    return true;
+}
+
+void sigma_dsp_batch_add(sigma_dsp_batch_t *batch,
+                         uint16_t          address,
+                         uint16_t          len,
+                         const uint8_t     *data)
+{
+    if(batch->amount == SIGMA_DSP_BATCH_SIZE)
+    {
+        sigma_dsp_batch_flush(batch);
+    }
+    batch->segments[batch->amount].address = address;
+    batch->segments[batch->amount].len     = len;
+    batch->segments[batch->amount].data    = data;
+    batch->amount++;
+}
+
+// Writes the collected segments. After a failure nothing is written 
+// anymore, the caller checks failed once at the end.
+void sigma_dsp_batch_flush(sigma_dsp_batch_t *batch)
+{
+    if(batch->amount > 0 && !batch->failed)
+    {
+        if(sigma_dsp_write_list(batch->dsp,
+                                batch->segments, 
+                                batch->amount) != SIGMA_DSP_WRITE_SUCCESS)
+        {
+            batch->failed = true;
+        }
+    }
+    batch->amount = 0;
+}
+
+// Adds the runs of registers that differ between old and new. Short gaps
+// are written along, one transaction less is cheaper than a few bytes.
+void sigma_dsp_diff(sigma_dsp_batch_t *batch,
+                    uint16_t          address,
+                    uint8_t           regsize,
+                    const uint8_t     *old,
+                    const uint8_t     *new,
+                    uint16_t          len)
+{
+    uint16_t words = len / regsize;
+    int32_t  start = -1;
+    uint16_t last  = 0;
+
+    for(uint16_t i = 0; i < words; i++)
+    {
+        if(memcmp(old + i * regsize, new + i * regsize, regsize) == 0)
+        {
+            continue;
+        }
+        if(start >= 0 && i - last - 1 > SIGMA_DSP_DIFF_MERGE_GAP)
+        {
+            sigma_dsp_batch_add(batch,
+                                address + start,
+                                (last - start + 1) * regsize,
+                                new + start * regsize);
+            start = -1;
+        }
+        if(start < 0)
+        {
+            start = i;
+        }
+        last = i;
+    }
+    if(start >= 0)
+    {
+        sigma_dsp_batch_add(batch,
+                            address + start,
+                            (last - start + 1) * regsize,
+                            new + start * regsize);
+    }
+}
+
+// Writes the register sections of the staged image that differ from the
+// running image. The core control register stays muted, the commit 
+// starts the core.
+void sigma_dsp_diff_registers(sigma_dsp_batch_t *batch,
+                              const uint8_t     mute[SIGMA_DSP_CORE_CONTROL_SIZE])
+{
+    sigma_dsp_t       *dsp     = batch->dsp;
+    const dsp_image_t *staged  = &dsp->staged_image;
+    const dsp_image_t *running = &dsp->image;
+    uint8_t           registers[SIGMA_DSP_REGISTER_END - SIGMA_DSP_REGISTER_ADDR];
+
+    sigma_dsp_batch_flush(batch);
+
+    for(int i = 0; i < staged->header->section_amount; i++)
+    {
+        const dsp_image_section_t *section = &staged->header->sections[i];
+        const uint8_t             *data    = dsp_image_section_data(staged, i);
+        bool                      same     = false;
+
+        if(section->type    != DSP_IMAGE_SECTION_DATA ||
+           section->address <  SIGMA_DSP_REGISTER_ADDR ||
+           (section->address == SIGMA_DSP_CORE_CONTROL_ADDR &&
+            section->len     == SIGMA_DSP_CORE_CONTROL_SIZE))
+        {
+            continue;
+        }
+
+        for(int j = 0; j < running->header->section_amount; j++)
+        {
+            const dsp_image_section_t *other = &running->header->sections[j];
+
+            if(other->type    == DSP_IMAGE_SECTION_DATA &&
+               other->address == section->address &&
+               other->len     == section->len &&
+               memcmp(dsp_image_section_data(running, j), 
+                      data, 
+                      section->len) == 0)
+            {
+                same = true;
+            }
+        }
+        if(same || batch->failed)
+        {
+            continue;
+        }
+        if(section->len > sizeof(registers))
+        {
+            batch->failed = true;
+            continue;
+        }
+
+        memcpy(registers, data, section->len);
+        if(section->address <= SIGMA_DSP_CORE_CONTROL_ADDR &&
+           section->address + section->len >= 
+           SIGMA_DSP_CORE_CONTROL_ADDR + SIGMA_DSP_CORE_CONTROL_SIZE)
+        {
+            memcpy(&registers[SIGMA_DSP_CORE_CONTROL_ADDR - section->address],
+                   mute,
+                   SIGMA_DSP_CORE_CONTROL_SIZE);
+        }
+        if(sigma_dsp_write_burst(dsp, section->address, 
+                                 section->len, 
+                                 registers) != SIGMA_DSP_WRITE_SUCCESS)
+        {
+            batch->failed = true;
+        }
+    }
+}
+
+bool load_program(sigma_dsp_t *dsp)
+{
+    if(dsp != NULL)
+    {
+        dsp_image_t *image = &dsp->image;
+        bool        present;
+
+        boot_profile_begin(BOOT_PHASE_DSP_IMAGE);
+        if(dsp_image_open(SIGMA_DSP_BOOT_IMAGE, image) != DSP_IMAGE_SUCCESS)
         {
+            boot_profile_fail(BOOT_PHASE_DSP_IMAGE);
             return false;
         }
-        // Load dsp_hardware_conf_data
-        if(!(sigma_dsp_write_burst(HARDWARE_CONF_ADDR,
-                                   HARDWARE_CONF_SIZE,
-                                   (uint8_t*)dsp_hardware_conf_data) 
-                                   == SIGMA_DSP_WRITE_SUCCESS))
+        sigma_dsp_shadow_load(dsp, image);
+        boot_profile_end(BOOT_PHASE_DSP_IMAGE);
+
+        boot_profile_begin(BOOT_PHASE_DSP_CHECK);
+        present = sigma_dsp_image_present(dsp, image);
+        boot_profile_end(BOOT_PHASE_DSP_CHECK);
+
+        if(present)
+        {
+            // The DSP kept running, for example after an MCU only reset.
+            // Take over its parameters so the shadow image matches.
+            ESP_LOGI(TAG, "DSP already runs this image, download skipped.");
+            if(sigma_dsp_read_burst(dsp, SIGMA_DSP_PARAMETER_RAM_ADDR, 
+                                    SIGMA_DSP_PARAMETER_SIZE, 
+                                    dsp->parameter_shadow))
+            {
+                return true;
+            }
+            sigma_dsp_shadow_load(dsp, image);
+        }
+
+        boot_profile_begin(BOOT_PHASE_DSP_RESET);
+        if(!sigma_dsp_reset(dsp))
         {
+            boot_profile_fail(BOOT_PHASE_DSP_RESET);
             return false;
         }
-        // Load dsp_core_register_R4_data
-        if(!(sigma_dsp_write_burst(CORE_REGISTER_R4_ADDR,
-                                   CORE_REGISTER_R4_SIZE,
-                                   (uint8_t*)dsp_core_register_R4_data) 
-                                   == SIGMA_DSP_WRITE_SUCCESS))
+        boot_profile_end(BOOT_PHASE_DSP_RESET);
+
+        boot_profile_begin(BOOT_PHASE_DSP_DOWNLOAD);
+        if(sigma_dsp_boot_write(dsp, image) != SIGMA_DSP_WRITE_SUCCESS)
         {
+            boot_profile_fail(BOOT_PHASE_DSP_DOWNLOAD);
             return false;
         }
+        boot_profile_end(BOOT_PHASE_DSP_DOWNLOAD);
     }
     return true;
 }
 
 /******************************* GLOBAL FUNCTIONS ************************/
 
-uint8_t init_sigma_dsp(uint8_t i2c_scl_gpio,
-                       uint8_t i2c_sda_gpio,
-                       uint8_t i2c_port_num,
-                       uint8_t sigma_dsp_address,
-                       gpio_num_t reset_pin)
+sigma_dsp_t* init_sigma_dsp(uint8_t i2c_scl_gpio,
+                            uint8_t i2c_sda_gpio,
+                            uint8_t i2c_port_num,
+                            uint8_t sigma_dsp_address,
+                            gpio_num_t reset_pin)
 {
-    sigma_dsp = malloc(sizeof(sigma_dsp_t));
+    sigma_dsp_t *dsp = malloc(sizeof(sigma_dsp_t));
 
-    if(sigma_dsp != NULL)
+    if(dsp != NULL)
     {
-        sigma_dsp->i2c_scl_gpio      = i2c_scl_gpio;
-        sigma_dsp->i2c_sda_gpio      = i2c_sda_gpio;
-        sigma_dsp->i2c_port_num      = i2c_port_num;
-        sigma_dsp->sigma_dsp_address = sigma_dsp_address;
-        sigma_dsp->reset_pin         = reset_pin;
+        dsp->i2c_scl_gpio        = i2c_scl_gpio;
+        dsp->i2c_sda_gpio        = i2c_sda_gpio;
+        dsp->i2c_port_num        = i2c_port_num;
+        dsp->sigma_dsp_address   = sigma_dsp_address;
+        dsp->reset_pin           = reset_pin;
+        dsp->device              = NULL;
+        dsp->next_slot           = 0;
+        dsp->async_failed        = false;
+        dsp->scrub_address       = SIGMA_DSP_PARAMETER_RAM_ADDR;
+        dsp->scrub_repairs       = 0;
+        dsp->program_shadow      = NULL;
+        dsp->image.header        = NULL;
+        dsp->staged_image.header = NULL;
+        dsp->staged_parameters   = NULL;
+
+        bool slotsCreated = true;
+        for(int i = 0; i < SIGMA_DSP_ASYNC_SLOTS; i++)
+        {
+            dsp->slots[i].busy     = false;
+            dsp->slots[i].txn.done = xSemaphoreCreateBinary();
+            if(dsp->slots[i].txn.done == NULL)
+            {
+                slotsCreated = false;
+            }
+        }
 
-        if(i2c_master_init(i2c_scl_gpio,
-                           i2c_sda_gpio,
-                           i2c_port_num,
-                           false) == ESP_OK)
+        if(slotsCreated && 
+           i2c_bus_port_init(i2c_port_num,
+                             i2c_scl_gpio,
+                             i2c_sda_gpio,
+                             false))
         {
-            if(gpio_set_direction(reset_pin, GPIO_MODE_OUTPUT) == ESP_OK)
+            dsp->device = i2c_bus_add_device(i2c_port_num,
+                                             sigma_dsp_address,
+                                             0);
+        }
+        if(dsp->device != NULL)
+        {
+            // Level first, driving the pin low for a moment would reset a
+            // DSP that is still running.
+            if(set_reset_pin(dsp, 1) &&
+               gpio_set_direction(reset_pin, GPIO_MODE_OUTPUT) == ESP_OK)
             {
-                if(set_reset_pin(1))
+                if(load_program(dsp))
                 {
-                    if(load_program())
-                    {
-                        ESP_LOGI(TAG, "Sigma DSP init success!");
-                        return SIGMA_DSP_INIT_SUCCESS;
-                    }
+                    ESP_LOGI(TAG, "Sigma DSP 0x%02X init success!", 
+                             sigma_dsp_address);
+                    return dsp;
                 }
             }
         }
     }
-    free(sigma_dsp);
-    sigma_dsp = NULL;
-    ESP_LOGW(TAG, "Sigma DSP init failed!");
-    return SIGMA_DSP_INIT_FAILED;
+    if(dsp != NULL)
+    {
+        for(int i = 0; i < SIGMA_DSP_ASYNC_SLOTS; i++)
+        {
+            if(dsp->slots[i].txn.done != NULL)
+            {
+                vSemaphoreDelete(dsp->slots[i].txn.done);
+            }
+        }
+        dsp_image_close(&dsp->image);
+        i2c_bus_remove_device(dsp->device);
+    }
+    free(dsp);
+    ESP_LOGW(TAG, "Sigma DSP 0x%02X init failed!", sigma_dsp_address);
+    return NULL;
 }
 
-uint8_t deinit_sigma_dsp()
+uint8_t deinit_sigma_dsp(sigma_dsp_t *dsp)
 {
-    if(sigma_dsp != NULL)
+    if(dsp != NULL)
     {
-        free(sigma_dsp);
-        sigma_dsp = NULL;
+        sigma_dsp_flush(dsp);
+        sigma_dsp_switch_abort(dsp);
+        for(int i = 0; i < SIGMA_DSP_ASYNC_SLOTS; i++)
+        {
+            vSemaphoreDelete(dsp->slots[i].txn.done);
+        }
+        dsp_image_close(&dsp->image);
+        i2c_bus_remove_device(dsp->device);
+        free(dsp);
         ESP_LOGI(TAG, "Sigma dsp deinit success!");
+        return SIGMA_DSP_DEINIT_SUCCESS;
     }
     ESP_LOGW(TAG, "sigma dsp deinit failed!");
     return SIGMA_DSP_DEINIT_FAILED;
 }
 
-bool set_reset_pin(uint8_t level)
+bool set_reset_pin(sigma_dsp_t *dsp, uint8_t level)
 {
-    if(sigma_dsp != NULL)
+    if(dsp != NULL)
     {
-        if(gpio_set_level(sigma_dsp->reset_pin, level) == ESP_OK)
+        if(gpio_set_level(dsp->reset_pin, level) == ESP_OK)
         {
             return true;
         }
@@ -195,46 +831,549 @@ bool set_reset_pin(uint8_t level)
     return false;
 }
 
-uint8_t sigma_dsp_write_burst(uint16_t reg_address, 
+uint8_t sigma_dsp_write_burst(sigma_dsp_t *dsp,
+                              uint16_t reg_address, 
                               uint16_t len, 
                               uint8_t *data)
 {
-    if(sigma_dsp != NULL)
+    if(dsp != NULL)
     {
-        if(ack_poll())
+        uint8_t address[2] = {reg_address >> 8, reg_address};
+
+        if(sigma_dsp_stage(dsp, reg_address, len, data))
         {
-            uint8_t address_low  = reg_address;
-            uint8_t address_high = reg_address >> 8;
+            return SIGMA_DSP_WRITE_SUCCESS;
+        }
+        sigma_dsp_shadow_update(dsp, reg_address, len, data);
 
-            i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-            i2c_master_start(cmd);
-            // Control byte -->
-            i2c_master_write_byte(cmd, 
-                                (sigma_dsp->sigma_dsp_address << 1) | WRITE_BIT, 
-                                ACK_CHECK_EN);
-            i2c_master_write_byte(cmd, address_high, ACK_CHECK_EN);
-            i2c_master_write_byte(cmd, address_low,  ACK_CHECK_EN);
+        trace_mark(TRACE_STAGE_WRITE_START);
 
-            for(int i = 0; i < len; i++)
-            {
-                i2c_master_write_byte(cmd, data[i], ACK_CHECK_EN);
-            }
-            i2c_master_stop(cmd);
+        // The bus only addresses the DSP separately when it didn't answer
+        // last time.
+        esp_err_t err = i2c_bus_write(dsp->device,
+                                      I2C_BUS_PRIO_HIGH,
+                                      address,
+                                      sizeof(address),
+                                      data,
+                                      len);
+        trace_mark(TRACE_STAGE_WRITE_END);
+        if(err == ESP_OK)
+        {
+            return SIGMA_DSP_WRITE_SUCCESS;
+        }
+    }
+    ESP_LOGW(TAG, "Burst write failed!");
+    return SIGMA_DSP_WRITE_FAILED;
+}
+
+uint8_t sigma_dsp_write_burst_async(sigma_dsp_t *dsp,
+                                    uint16_t reg_address, 
+                                    uint16_t len, 
+                                    uint8_t *data)
+{
+    if(dsp == NULL)
+    {
+        return SIGMA_DSP_WRITE_FAILED;
+    }
+    if(sigma_dsp_stage(dsp, reg_address, len, data))
+    {
+        return SIGMA_DSP_WRITE_SUCCESS;
+    }
+    if(len > SIGMA_DSP_ASYNC_MAX_LEN)
+    {
+        // Too big for a slot, but it still has to go after the queued ones.
+        return sigma_dsp_flush(dsp) & 
+               sigma_dsp_write_burst(dsp, reg_address, len, data);
+    }
+
+    // The slot we fill was used two writes ago, usually it is done by now.
+    sigma_dsp_async_slot_t *slot = &dsp->slots[dsp->next_slot];
+    sigma_dsp_slot_wait(slot);
+    dsp->next_slot = (dsp->next_slot + 1) % SIGMA_DSP_ASYNC_SLOTS;
+
+    slot->header[0] = reg_address >> 8;
+    slot->header[1] = reg_address;
+    memcpy(slot->data, data, len);
+    sigma_dsp_shadow_update(dsp, reg_address, len, data);
+
+    slot->txn.device     = dsp->device;
+    slot->txn.op         = I2C_BUS_OP_WRITE;
+    slot->txn.header     = slot->header;
+    slot->txn.header_len = sizeof(slot->header);
+    slot->txn.data       = slot->data;
+    slot->txn.len        = len;
+    slot->txn.callback   = sigma_dsp_write_done;
+    slot->txn.arg        = dsp;
+    slot->trace_id       = trace_current();
+
+    bool failed = dsp->async_failed;
+    dsp->async_failed = false;
+
+    trace_mark(TRACE_STAGE_WRITE_START);
+    if(i2c_bus_submit(&slot->txn, I2C_BUS_PRIO_HIGH) == ESP_OK)
+    {
+        slot->busy = true;
+    }
+    else
+    {
+        failed = true;
+    }
+
+    if(failed)
+    {
+        ESP_LOGW(TAG, "Async burst write failed!");
+        return SIGMA_DSP_WRITE_FAILED;
+    }
+    return SIGMA_DSP_WRITE_SUCCESS;
+}
+
+uint8_t sigma_dsp_write_list(sigma_dsp_t               *dsp,
+                             const sigma_dsp_segment_t *segments, 
+                             uint8_t                   amount)
+{
+    if(dsp == NULL || segments == NULL || amount == 0)
+    {
+        return SIGMA_DSP_WRITE_FAILED;
+    }
+
+    for(int i = 0; i < amount; i++)
+    {
+        if(!sigma_dsp_segment_valid(&segments[i]))
+        {
+            ESP_LOGW(TAG, "Invalid segment at 0x%04X!", segments[i].address);
+            return SIGMA_DSP_WRITE_FAILED;
+        }
+    }
+
+    typedef struct
+    {
+        i2c_bus_transaction_t txn;
+        uint8_t               header[2];
+    } list_entry_t;
+
+    list_entry_t *entries = malloc(amount * sizeof(list_entry_t));
+    if(entries == NULL)
+    {
+        return SIGMA_DSP_WRITE_FAILED;
+    }
+
+    sigma_dsp_list_state_t state = {
+        .remaining = amount,
+        .failed    = 0,
+        .done      = dsp->device->done,
+    };
+    bool waitDone = true;
+
+    // All segments are queued at once and run back to back. The device
+    // stays ready in between, so it is not polled again.
+    i2c_bus_lock(dsp->device, portMAX_DELAY);
+    for(int i = 0; i < amount; i++)
+    {
+        list_entry_t *entry = &entries[i];
+
+        sigma_dsp_shadow_update(dsp, segments[i].address, 
+                                segments[i].len, 
+                                segments[i].data);
+
+        entry->header[0]      = segments[i].address >> 8;
+        entry->header[1]      = segments[i].address;
+        entry->txn.device     = dsp->device;
+        entry->txn.op         = I2C_BUS_OP_WRITE;
+        entry->txn.header     = entry->header;
+        entry->txn.header_len = sizeof(entry->header);
+        entry->txn.data       = (uint8_t*)segments[i].data;
+        entry->txn.len        = segments[i].len;
+        entry->txn.callback   = sigma_dsp_list_done;
+        entry->txn.arg        = &state;
+        entry->txn.done       = NULL;
+
+        if(i2c_bus_submit(&entry->txn, I2C_BUS_PRIO_HIGH) != ESP_OK)
+        {
+            // The rest is never queued, only wait for what is.
+            taskENTER_CRITICAL(&list_lock);
+            state.failed++;
+            state.remaining -= (amount - i);
+            waitDone = (state.remaining != 0);
+            taskEXIT_CRITICAL(&list_lock);
+            break;
+        }
+    }
+    if(waitDone)
+    {
+        xSemaphoreTake(state.done, portMAX_DELAY);
+    }
+    i2c_bus_unlock(dsp->device);
+
+    free(entries);
+
+    if(state.failed > 0)
+    {
+        ESP_LOGW(TAG, "Write list failed!");
+        return SIGMA_DSP_WRITE_FAILED;
+    }
+    return SIGMA_DSP_WRITE_SUCCESS;
+}
+
+uint8_t sigma_dsp_flush(sigma_dsp_t *dsp)
+{
+    if(dsp == NULL)
+    {
+        return SIGMA_DSP_WRITE_FAILED;
+    }
+
+    for(int i = 0; i < SIGMA_DSP_ASYNC_SLOTS; i++)
+    {
+        sigma_dsp_slot_wait(&dsp->slots[i]);
+    }
+
+    bool failed = dsp->async_failed;
+    dsp->async_failed = false;
+
+    if(failed)
+    {
+        ESP_LOGW(TAG, "Async burst write failed!");
+        return SIGMA_DSP_WRITE_FAILED;
+    }
+    return SIGMA_DSP_WRITE_SUCCESS;
+}
+
+static uint8_t sigma_dsp_read(sigma_dsp_t *dsp,
+                              uint16_t reg_address, 
+                              uint16_t len, 
+                              uint8_t  *data,
+                              uint8_t  prio)
+{
+    if(dsp != NULL && len > 0)
+    {
+        uint8_t address[2] = {reg_address >> 8, reg_address};
+
+        if(i2c_bus_read(dsp->device,
+                        prio,
+                        address,
+                        sizeof(address),
+                        data,
+                        len) == ESP_OK)
+        {
+            return SIGMA_DSP_READ_SUCCESS;
+        }
+    }
+    ESP_LOGW(TAG, "Burst read failed!");
+    return SIGMA_DSP_READ_FAILED;
+}
+
+uint8_t sigma_dsp_read_burst(sigma_dsp_t *dsp,
+                             uint16_t reg_address, 
+                             uint16_t len, 
+                             uint8_t *data)
+{
+    return sigma_dsp_read(dsp, reg_address, len, data, I2C_BUS_PRIO_HIGH);
+}
+
+static esp_err_t sigma_dsp_scrub_write(sigma_dsp_t   *dsp,
+                                       uint16_t      address,
+                                       uint16_t      len,
+                                       const uint8_t *data)
+{
+    uint8_t address_bytes[2] = {address >> 8, address};
+
+    return i2c_bus_write(dsp->device,
+                         I2C_BUS_PRIO_LOW,
+                         address_bytes,
+                         sizeof(address_bytes),
+                         data,
+                         len);
+}
+
+// Program RAM is only written with the core stopped and the outputs muted,
+// like a switch. Without the core control of the image the DSP is reset 
+// and downloaded again.
+static uint8_t sigma_dsp_scrub_program(sigma_dsp_t   *dsp,
+                                       uint16_t      address,
+                                       uint16_t      len,
+                                       const uint8_t *shadow)
+{
+    const uint8_t *running = sigma_dsp_image_core_control(&dsp->image);
+    uint8_t       mute[SIGMA_DSP_CORE_CONTROL_SIZE];
+
+    if(running == NULL)
+    {
+        sigma_dsp_segment_t parameters = {
+            .address = SIGMA_DSP_PARAMETER_RAM_ADDR,
+            .len     = SIGMA_DSP_PARAMETER_SIZE,
+            .data    = dsp->parameter_shadow,
+        };
+
+        if(sigma_dsp_reset(dsp) &&
+           sigma_dsp_image_write(dsp, &dsp->image, true) == SIGMA_DSP_WRITE_SUCCESS &&
+           sigma_dsp_write_list(dsp, &parameters, 1) == SIGMA_DSP_WRITE_SUCCESS)
+        {
+            return SIGMA_DSP_READ_SUCCESS;
+        }
+        return SIGMA_DSP_WRITE_FAILED;
+    }
+
+    mute[0] = running[0];
+    mute[1] = running[1] & ~SIGMA_DSP_CORE_CONTROL_RUN;
+
+    // The core control is restored also when the repair failed.
+    uint8_t result = sigma_dsp_write_burst(dsp, SIGMA_DSP_CORE_CONTROL_ADDR,
+                                           SIGMA_DSP_CORE_CONTROL_SIZE,
+                                           mute);
+    if(result == SIGMA_DSP_WRITE_SUCCESS)
+    {
+        if(sigma_dsp_scrub_write(dsp, address, len, shadow) != ESP_OK)
+        {
+            result = SIGMA_DSP_WRITE_FAILED;
+        }
+        if(sigma_dsp_write_burst(dsp, SIGMA_DSP_CORE_CONTROL_ADDR,
+                                 SIGMA_DSP_CORE_CONTROL_SIZE,
+                                 (uint8_t*)running) != SIGMA_DSP_WRITE_SUCCESS)
+        {
+            result = SIGMA_DSP_WRITE_FAILED;
+        }
+    }
+    return result;
+}
+
+uint8_t sigma_dsp_scrub_step(sigma_dsp_t *dsp)
+{
+    if(dsp == NULL)
+    {
+        return SIGMA_DSP_READ_FAILED;
+    }
+
+    uint16_t address = dsp->scrub_address;
+    uint16_t regSize = (address < SIGMA_DSP_PROGRAM_RAM_ADDR) ? 
+                       SIGMA_DSP_PARAMETER_REGSIZE : SIGMA_DSP_PROGRAM_REGSIZE;
+    uint16_t len     = SIGMA_DSP_SCRUB_WORDS * regSize;
+    uint8_t  readback[SIGMA_DSP_SCRUB_WORDS * SIGMA_DSP_PROGRAM_REGSIZE];
+
+    const uint8_t *shadow = sigma_dsp_shadow(dsp, address, &len);
+
+    dsp->scrub_address += SIGMA_DSP_SCRUB_WORDS;
+    if(dsp->scrub_address >= SIGMA_DSP_REGISTER_ADDR)
+    {
+        dsp->scrub_address = SIGMA_DSP_PARAMETER_RAM_ADDR;
+    }
+    if(shadow == NULL)
+    {
+        // Nothing known to compare with.
+        return SIGMA_DSP_READ_SUCCESS;
+    }
 
-            esp_err_t ret = i2c_master_cmd_begin(sigma_dsp->i2c_port_num, 
-                                                cmd, 
-                                                I2C_TIMEOUT_MS / portTICK_PERIOD_MS);
+    if(!sigma_dsp_read(dsp, address, len, readback, I2C_BUS_PRIO_LOW))
+    {
+        return SIGMA_DSP_READ_FAILED;
+    }
+
+    bool match = true;
+    for(int i = 0; i < len; i++)
+    {
+        uint8_t mask = 0xFF;
+        if(regSize == SIGMA_DSP_PARAMETER_REGSIZE && 
+           (i % SIGMA_DSP_PARAMETER_REGSIZE) == 0)
+        {
+            // Only the low nibble of the first byte is stored.
+            mask = SIGMA_DSP_PARAMETER_MASK;
+        }
+        if((readback[i] & mask) != (shadow[i] & mask))
+        {
+            match = false;
+            break;
+        }
+    }
 
-            i2c_cmd_link_delete(cmd);
+    if(!match)
+    {
+        dsp->scrub_repairs++;
+        ESP_LOGW(TAG, "Repairing DSP RAM at 0x%04X, %d repairs.", 
+                 address, 
+                 (int)dsp->scrub_repairs);
 
-            if(ret == ESP_OK)
+        if(regSize == SIGMA_DSP_PROGRAM_REGSIZE)
+        {
+            return sigma_dsp_scrub_program(dsp, address, len, shadow);
+        }
+        if(sigma_dsp_scrub_write(dsp, address, len, shadow) != ESP_OK)
+        {
+            return SIGMA_DSP_WRITE_FAILED;
+        }
+    }
+    return SIGMA_DSP_READ_SUCCESS;
+}
+
+uint32_t sigma_dsp_scrub_repairs(sigma_dsp_t *dsp)
+{
+    if(dsp != NULL)
+    {
+        return dsp->scrub_repairs;
+    }
+    return 0;
+}
+
+uint8_t sigma_dsp_image_index(sigma_dsp_t *dsp)
+{
+    if(dsp == NULL || dsp->image.header == NULL)
+    {
+        return SIGMA_DSP_BOOT_IMAGE;
+    }
+    return dsp->image.index;
+}
+
+uint8_t sigma_dsp_switch_begin(sigma_dsp_t *dsp, uint8_t index)
+{
+    if(dsp == NULL || dsp->staged_parameters != NULL)
+    {
+        return SIGMA_DSP_WRITE_FAILED;
+    }
+
+    // Queued writes belong to the running image. A failed one doesn't 
+    // matter anymore, its parameter is staged again.
+    sigma_dsp_flush(dsp);
+
+    dsp->staged_parameters = malloc(SIGMA_DSP_PARAMETER_SIZE);
+    if(dsp->staged_parameters == NULL)
+    {
+        return SIGMA_DSP_WRITE_FAILED;
+    }
+    if(dsp_image_open(index, &dsp->staged_image) != DSP_IMAGE_SUCCESS)
+    {
+        free(dsp->staged_parameters);
+        dsp->staged_parameters = NULL;
+        return SIGMA_DSP_WRITE_FAILED;
+    }
+
+    // The settings go to the module addresses the firmware is built with,
+    // the boot image has them. Another layout would get them at the wrong
+    // place.
+    if(dsp->image.header != NULL &&
+       dsp->staged_image.header->layout != dsp->image.header->layout)
+    {
+        ESP_LOGE(TAG, "Image %d has another module layout.", (int)index);
+        sigma_dsp_switch_abort(dsp);
+        return SIGMA_DSP_WRITE_FAILED;
+    }
+
+    sigma_dsp_image_region(&dsp->staged_image,
+                           SIGMA_DSP_PARAMETER_RAM_ADDR,
+                           SIGMA_DSP_PARAMETER_REGSIZE,
+                           SIGMA_DSP_PARAMETER_SIZE,
+                           dsp->staged_parameters);
+    sigma_dsp_image_marker(&dsp->staged_image,
+                           dsp->staged_parameters + 
+                           SIGMA_DSP_IMAGE_MARKER_ADDR * SIGMA_DSP_PARAMETER_REGSIZE);
+    return SIGMA_DSP_WRITE_SUCCESS;
+}
+
+uint8_t sigma_dsp_switch_commit(sigma_dsp_t *dsp)
+{
+    if(dsp == NULL || dsp->staged_parameters == NULL)
+    {
+        return SIGMA_DSP_WRITE_FAILED;
+    }
+
+    dsp_image_t       *image   = &dsp->staged_image;
+    uint8_t           *staged  = dsp->staged_parameters;
+    const uint8_t     *control = sigma_dsp_image_core_control(image);
+    const uint8_t     *running = sigma_dsp_image_core_control(&dsp->image);
+    uint8_t           *program = malloc(2 * SIGMA_DSP_PROGRAM_SIZE);
+    sigma_dsp_batch_t batch    = {.dsp = dsp, .amount = 0, .failed = false};
+    uint8_t           mute[SIGMA_DSP_CORE_CONTROL_SIZE];
+    uint8_t           result   = SIGMA_DSP_WRITE_FAILED;
+
+    // From here on parameter writes go to the DSP again.
+    dsp->staged_parameters = NULL;
+
+    if(control != NULL && running != NULL && program != NULL)
+    {
+        // Outputs muted and the core stopped, a half written program is 
+        // never heard.
+        mute[0] = running[0];
+        mute[1] = running[1] & ~SIGMA_DSP_CORE_CONTROL_RUN;
+
+        if(sigma_dsp_write_burst(dsp, SIGMA_DSP_CORE_CONTROL_ADDR,
+                                 SIGMA_DSP_CORE_CONTROL_SIZE,
+                                 mute) == SIGMA_DSP_WRITE_SUCCESS)
+        {
+            uint8_t *oldProgram = program;
+            uint8_t *newProgram = program + SIGMA_DSP_PROGRAM_SIZE;
+
+            sigma_dsp_image_region(&dsp->image,
+                                   SIGMA_DSP_PROGRAM_RAM_ADDR,
+                                   SIGMA_DSP_PROGRAM_REGSIZE,
+                                   SIGMA_DSP_PROGRAM_SIZE,
+                                   oldProgram);
+            sigma_dsp_image_region(image,
+                                   SIGMA_DSP_PROGRAM_RAM_ADDR,
+                                   SIGMA_DSP_PROGRAM_REGSIZE,
+                                   SIGMA_DSP_PROGRAM_SIZE,
+                                   newProgram);
+
+            sigma_dsp_diff(&batch,
+                           SIGMA_DSP_PROGRAM_RAM_ADDR,
+                           SIGMA_DSP_PROGRAM_REGSIZE,
+                           oldProgram,
+                           newProgram,
+                           SIGMA_DSP_PROGRAM_SIZE);
+            sigma_dsp_diff(&batch,
+                           SIGMA_DSP_PARAMETER_RAM_ADDR,
+                           SIGMA_DSP_PARAMETER_REGSIZE,
+                           dsp->parameter_shadow,
+                           staged,
+                           SIGMA_DSP_PARAMETER_SIZE);
+            sigma_dsp_diff_registers(&batch, mute);
+            sigma_dsp_batch_flush(&batch);
+
+            if(!batch.failed &&
+               sigma_dsp_write_burst(dsp, SIGMA_DSP_CORE_CONTROL_ADDR,
+                                     SIGMA_DSP_CORE_CONTROL_SIZE,
+                                     (uint8_t*)control) == SIGMA_DSP_WRITE_SUCCESS)
             {
-                return SIGMA_DSP_WRITE_SUCCESS;
+                result = SIGMA_DSP_WRITE_SUCCESS;
             }
         }
     }
-    ESP_LOGW(TAG, "Burst write failed!");
-    return SIGMA_DSP_WRITE_FAILED;
+    free(program);
+
+    if(result != SIGMA_DSP_WRITE_SUCCESS)
+    {
+        // The DSP is somewhere in between, start over from a reset.
+        sigma_dsp_segment_t parameters = {
+            .address = SIGMA_DSP_PARAMETER_RAM_ADDR,
+            .len     = SIGMA_DSP_PARAMETER_SIZE,
+            .data    = staged,
+        };
+
+        ESP_LOGW(TAG, "Image switch failed, downloading image %d.", image->index);
+        if(sigma_dsp_reset(dsp) &&
+           sigma_dsp_image_write(dsp, image, true) == SIGMA_DSP_WRITE_SUCCESS &&
+           sigma_dsp_write_list(dsp, &parameters, 1) == SIGMA_DSP_WRITE_SUCCESS)
+        {
+            result = SIGMA_DSP_WRITE_SUCCESS;
+        }
+    }
+
+    // The new image is the shadow from now on, the scrubber repairs what 
+    // a failed download left behind.
+    dsp_image_close(&dsp->image);
+    dsp->image          = *image;
+    image->header             = NULL;
+    dsp->program_shadow = sigma_dsp_image_program(&dsp->image);
+    memcpy(dsp->parameter_shadow, staged, SIGMA_DSP_PARAMETER_SIZE);
+    free(staged);
+
+    ESP_LOGI(TAG, "Switched to DSP image %d.", dsp->image.index);
+    return result;
+}
+
+void sigma_dsp_switch_abort(sigma_dsp_t *dsp)
+{
+    if(dsp != NULL && dsp->staged_parameters != NULL)
+    {
+        dsp_image_close(&dsp->staged_image);
+        free(dsp->staged_parameters);
+        dsp->staged_parameters = NULL;
+    }
 }
 
 /******************************* THE END *********************************/
\ No newline at end of file
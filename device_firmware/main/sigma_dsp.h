@@ -6,8 +6,11 @@
  * 
  * This module is used to communicate with the ADAU1701 DSP chip. It 
  * loads the initial DSP program from the sigma studio software using
- * the exported parameters. The parameters can be found in 
- * sigma_studio_export.h.
+ * the exported parameters. The program is read from the DSP image
+ * partition, see dsp_image.h.
+ * 
+ * Every DSP is a handle returned by init_sigma_dsp(), one firmware can 
+ * drive several of them on one or both buses.
  * 
  * 
  */ 
@@ -18,31 +21,18 @@
 
 #include <stdio.h>
 #include <stdbool.h>
+#include <string.h>
 #include "esp_log.h"
-#include "driver/i2c.h"
 #include "driver/gpio.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "i2c_bus.h"
+#include "dsp_image.h"
+#include "trace.h"
+#include "boot_profile.h"
 
 /******************************* DEFINES *********************************/
 
-#define I2C_MASTER_FREQ_HZ          400000 /* I2C master clock frequency */
-#define I2C_MASTER_TX_BUF_DISABLE   0      /* Disable buffer as master   */
-#define I2C_MASTER_RX_BUF_DISABLE   0      /* Disable buffer as master   */
-#define I2C_TIMEOUT_MS              1000
-
-#define ACK_CHECK_EN                0x1    /* Check ACK from slave       */
-#define ACK_CHECK_DIS               0x0    /* Do not chekc ACK from slave*/
-#define ACK_VAL                     0x0    /* I2C ack value              */
-#define NACK_VAL                    0x1    /* I2C nack value             */
-
-#define WRITE_BIT                   0      /* I2C master write value     */
-#define READ_BIT                    1      /* I2C master read value      */
-
-#define ACK_POLL_TIMEOUT            1000
-#define ACK_POLL_SUCCESS            1
-#define ACK_POLL_FAILED             0
-
-#define SIGMA_DSP_INIT_SUCCESS   1
-#define SIGMA_DSP_INIT_FAILED    0 
 #define SIGMA_DSP_DEINIT_SUCCESS 1
 #define SIGMA_DSP_DEINIT_FAILED  0 
 
@@ -51,8 +41,81 @@
 #define SIGMA_DSP_WRITE_SUCCESS  1
 #define SIGMA_DSP_WRITE_FAILED   0 
 
+// DSP memory map
+#define SIGMA_DSP_PARAMETER_RAM_ADDR 0x0000
+#define SIGMA_DSP_PARAMETER_REGSIZE  4
+#define SIGMA_DSP_PARAMETER_SIZE     4096
+#define SIGMA_DSP_PROGRAM_RAM_ADDR   0x0400
+#define SIGMA_DSP_PROGRAM_REGSIZE    5
+#define SIGMA_DSP_PROGRAM_SIZE       5120
+#define SIGMA_DSP_REGISTER_ADDR      0x0800
+#define SIGMA_DSP_REGISTER_REGSIZE   1     /* Bursts are byte streams    */
+#define SIGMA_DSP_REGISTER_END       0x0828
+#define SIGMA_DSP_CORE_CONTROL_ADDR  0x081C
+#define SIGMA_DSP_CORE_CONTROL_SIZE  2
+
+#define SIGMA_DSP_BOOT_IMAGE         0     /* Image slot loaded at init  */
+
+// After a download the hash of the image is written to the last parameter
+// word, which the SigmaStudio project must leave unused. At boot the hash,
+// the core control register and a few program words are read back, when
+// they all match the download is skipped. Images with hash 0 are always
+// downloaded.
+#define SIGMA_DSP_IMAGE_MARKER_ADDR  (SIGMA_DSP_PROGRAM_RAM_ADDR - 1)
+#define SIGMA_DSP_FINGERPRINT_WORDS  8
+
+// A full download starts with a reset, the DSP clears its RAMs while it
+// initializes. Clear sections of the image are then skipped, otherwise
+// they are written in chunks from a zero buffer in flash.
+#define SIGMA_DSP_RESET_PULSE_MS     10
+#define SIGMA_DSP_RESET_INIT_MS      20
+#define SIGMA_DSP_CLEAR_CHUNK        512
+
+// Switching images at runtime: the outputs are muted and the core is
+// stopped through the core control register, only the words that differ
+// are written, then the new image starts the core. Runs of differing 
+// words with gaps up to SIGMA_DSP_DIFF_MERGE_GAP words are one segment.
+#define SIGMA_DSP_CORE_CONTROL_RUN   0x1C  /* ADM | DAM | CR, low byte   */
+#define SIGMA_DSP_DIFF_MERGE_GAP     2
+#define SIGMA_DSP_BATCH_SIZE         32
+
+// The scrubber compares this many words of DSP RAM per step. Chunks never
+// cross from parameter to program RAM.
+#define SIGMA_DSP_SCRUB_WORDS        16
+#define SIGMA_DSP_PARAMETER_MASK     0x0F  /* Parameters are 28 bit      */
+
+// Asynchronous writes are double buffered: one block is on the wire while
+// the caller computes the next one.
+#define SIGMA_DSP_ASYNC_SLOTS    2
+#define SIGMA_DSP_ASYNC_MAX_LEN  32
+
 /******************************* TYPEDEFS ********************************/
 
+// One part of a write list. len is in bytes and has to be a whole number
+// of registers of the memory region address is in.
+typedef struct
+{
+    uint16_t      address;
+    uint16_t      len;
+    const uint8_t *data;
+} sigma_dsp_segment_t;
+
+typedef struct
+{
+    uint8_t           remaining;
+    uint8_t           failed;
+    SemaphoreHandle_t done;
+} sigma_dsp_list_state_t;
+
+typedef struct
+{
+    i2c_bus_transaction_t txn;
+    uint8_t               header[2];
+    uint8_t               data[SIGMA_DSP_ASYNC_MAX_LEN];
+    bool                  busy;
+    uint16_t              trace_id;  /* Request that queued the write */
+} sigma_dsp_async_slot_t;
+
 typedef struct
 {
     uint8_t i2c_scl_gpio;
@@ -61,34 +124,156 @@ typedef struct
 
     gpio_num_t reset_pin;
     uint8_t sigma_dsp_address;
+
+    // Descriptor on the shared bus, it also keeps the ready state.
+    i2c_bus_device_t *device;
+
+    sigma_dsp_async_slot_t slots[SIGMA_DSP_ASYNC_SLOTS];
+    uint8_t                next_slot;
+    // Set by the completion callback, reported by the next async call.
+    volatile bool          async_failed;
+
+    // Word address of the next scrub step and the repairs done so far.
+    uint16_t               scrub_address;
+    uint32_t               scrub_repairs;
+
+    // Image the DSP runs. Program RAM is compared with the image in flash,
+    // parameters change at runtime so they are kept in RAM.
+    dsp_image_t            image;
+    const uint8_t          *program_shadow;
+    uint8_t                parameter_shadow[SIGMA_DSP_PARAMETER_SIZE];
+
+    // Image of a switch in progress. Parameter writes go to the staged
+    // parameters until the switch is committed.
+    dsp_image_t            staged_image;
+    uint8_t                *staged_parameters;
 } sigma_dsp_t;
 
+// Segments collected for one write list, written when it is full.
+typedef struct
+{
+    sigma_dsp_t         *dsp;
+    sigma_dsp_segment_t segments[SIGMA_DSP_BATCH_SIZE];
+    uint8_t             amount;
+    bool                failed;
+} sigma_dsp_batch_t;
+
 /******************************* LOCAL FUNCTIONS *************************/
 
-esp_err_t i2c_master_init(uint8_t i2c_scl_gpio,
-                          uint8_t i2c_sda_gpio,
-                          uint8_t i2c_port_num,
-                          bool    internal_pullup);
+bool sigma_dsp_image_present(sigma_dsp_t *dsp, const dsp_image_t *image);
+
+bool sigma_dsp_reset(sigma_dsp_t *dsp);
+
+uint8_t sigma_dsp_image_write(sigma_dsp_t       *dsp,
+                              const dsp_image_t *image,
+                              bool              cleared);
+
+bool load_program(sigma_dsp_t *dsp);
+
+void sigma_dsp_image_region(const dsp_image_t *image,
+                            uint16_t          region_address,
+                            uint8_t           regsize,
+                            uint16_t          size,
+                            uint8_t           *buffer);
+
+bool sigma_dsp_stage(sigma_dsp_t   *dsp,
+                     uint16_t      reg_address,
+                     uint16_t      len,
+                     const uint8_t *data);
+
+void sigma_dsp_batch_add(sigma_dsp_batch_t *batch,
+                         uint16_t          address,
+                         uint16_t          len,
+                         const uint8_t     *data);
+
+void sigma_dsp_batch_flush(sigma_dsp_batch_t *batch);
+
+void sigma_dsp_diff(sigma_dsp_batch_t *batch,
+                    uint16_t          address,
+                    uint8_t           regsize,
+                    const uint8_t     *old,
+                    const uint8_t     *new,
+                    uint16_t          len);
+
+void sigma_dsp_diff_registers(sigma_dsp_batch_t *batch,
+                              const uint8_t     mute[SIGMA_DSP_CORE_CONTROL_SIZE]);
 
-uint8_t ack_poll(void);
+void sigma_dsp_write_done(i2c_bus_transaction_t *txn);
 
-bool load_program(void);
+bool sigma_dsp_segment_valid(const sigma_dsp_segment_t *segment);
+
+const uint8_t* sigma_dsp_shadow(sigma_dsp_t *dsp,
+                                uint16_t    reg_address,
+                                uint16_t    *len);
+
+void sigma_dsp_shadow_update(sigma_dsp_t   *dsp,
+                             uint16_t      reg_address, 
+                             uint16_t      len, 
+                             const uint8_t *data);
 
 /******************************* GLOBAL FUNCTIONS ************************/
 
-uint8_t init_sigma_dsp(uint8_t i2c_scl_gpio,
-                       uint8_t i2c_sda_gpio,
-                       uint8_t i2c_port_num,
-                       uint8_t sigma_dsp_address,
-                       gpio_num_t reset_pin);
+// Adds a DSP on a bus and loads its program. Every DSP is its own handle,
+// several of them can share a bus at different addresses. Returns NULL 
+// when the DSP can't be used.
+sigma_dsp_t* init_sigma_dsp(uint8_t i2c_scl_gpio,
+                            uint8_t i2c_sda_gpio,
+                            uint8_t i2c_port_num,
+                            uint8_t sigma_dsp_address,
+                            gpio_num_t reset_pin);
 
-uint8_t deinit_sigma_dsp();
+uint8_t deinit_sigma_dsp(sigma_dsp_t *dsp);
 
-bool set_reset_pin(uint8_t level);
+bool set_reset_pin(sigma_dsp_t *dsp, uint8_t level);
 
-uint8_t sigma_dsp_write_burst(uint16_t reg_address, 
+uint8_t sigma_dsp_write_burst(sigma_dsp_t *dsp,
+                              uint16_t reg_address, 
                               uint16_t len, 
                               uint8_t *data);
+
+// Copies data and returns as soon as the write is queued. A failure of an
+// earlier asynchronous write is reported by the next call or the flush.
+uint8_t sigma_dsp_write_burst_async(sigma_dsp_t *dsp,
+                                    uint16_t reg_address, 
+                                    uint16_t len, 
+                                    uint8_t *data);
+
+// Writes all segments back to back in one bus session. Nothing is written
+// when one of the segments is invalid.
+uint8_t sigma_dsp_write_list(sigma_dsp_t               *dsp,
+                             const sigma_dsp_segment_t *segments, 
+                             uint8_t                   amount);
+
+// Waits until all asynchronous writes are done.
+uint8_t sigma_dsp_flush(sigma_dsp_t *dsp);
+
+// Reads parameter or program RAM, len is in bytes.
+uint8_t sigma_dsp_read_burst(sigma_dsp_t *dsp,
+                             uint16_t reg_address, 
+                             uint16_t len, 
+                             uint8_t *data);
+
+// Compares one chunk of DSP RAM with the shadow image and rewrites it when
+// it differs. Uses low priority bus transactions, except for the core 
+// control writes that stop the core around a program RAM repair.
+uint8_t sigma_dsp_scrub_step(sigma_dsp_t *dsp);
+
+uint32_t sigma_dsp_scrub_repairs(sigma_dsp_t *dsp);
+
+// Slot of the image the DSP runs.
+uint8_t sigma_dsp_image_index(sigma_dsp_t *dsp);
+
+// Starts a switch to the image in a slot. Until the commit, parameter 
+// writes only build the parameters of the new image, so settings can be
+// applied to it first. Images with another module layout than the
+// running one are rejected.
+uint8_t sigma_dsp_switch_begin(sigma_dsp_t *dsp, uint8_t index);
+
+// Mutes, writes the differences with the running image and starts the
+// new image. Falls back to a full download when a diff write fails.
+uint8_t sigma_dsp_switch_commit(sigma_dsp_t *dsp);
+
+void sigma_dsp_switch_abort(sigma_dsp_t *dsp);
 /******************************* THE END *********************************/
 
 #endif /* SIGMA_DSP_H_ */
\ No newline at end of file
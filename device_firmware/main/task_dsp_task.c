@@ -10,15 +10,27 @@
 
 static const char *TAG = "DSP task";
 
+// Between events the DSP memory is scrubbed one chunk per interval.
+#define DSP_TASK_SCRUB_INTERVAL_MS    100
+#define DSP_TASK_SCRUB_INTERVAL_TICKS (DSP_TASK_SCRUB_INTERVAL_MS / portTICK_PERIOD_MS)
+
 /* Function: dsp_task 
  *
  * This function runs as a freeRTOS task. It handles everything related
  * to the DSP module. It initialises the DSP module and loads the program
  * onto the Analog Devices chip. The EQ's and Muxes can be changed by 
- * sending an event to the task using a given communication type.
+ * sending an event to the task using a given communication type. A preset
+ * event switches the DSP to another stored program, the current settings
+ * are applied to it.
  *
  * Events are described in "event.h".
  *
+ * Writes to the DSP are asynchronous, the writes of one event go out back
+ * to back. The event is answered once they are done, so a failure goes to
+ * the client that caused it and not to whoever sends the next event. The
+ * settings at boot and after a preset switch are one event, a single
+ * flush for all EQs.
+ *
  */
 void dsp_task(void* pvParameters)
 {
@@ -32,8 +44,11 @@ void dsp_task(void* pvParameters)
     {
         event_response.response_event_type = EVENT_RESPONSE_ERROR;
 
-        if(await_event(communication, &event, EVENT_STD_TIMEOUT_TICKS))
+        if(await_event(communication, &event, DSP_TASK_SCRUB_INTERVAL_TICKS))
         { 
+            trace_set_current(event.trace_id);
+            trace_mark(TRACE_STAGE_DSP_TASK);
+
             if(event.event_type == DSP_SET_EQ)
             {
                 if(dsp_control_eq_secondorder(&event.eq))
@@ -45,6 +60,28 @@ void dsp_task(void* pvParameters)
                     event_response.response_event_type = EVENT_RESPONSE_DSP_ERROR;
                 }
             }
+            else if(event.event_type == DSP_SET_PRESET)
+            {
+                if(dsp_control_switch_program(event.preset))
+                {
+                    event_response.response_event_type = EVENT_RESPONSE_OK;
+                }
+                else
+                {
+                    event_response.response_event_type = EVENT_RESPONSE_DSP_ERROR;
+                }
+            }
+            else if(event.event_type == DSP_SET_ALL)
+            {
+                if(dsp_control_apply_settings())
+                {
+                    event_response.response_event_type = EVENT_RESPONSE_OK;
+                }
+                else
+                {
+                    event_response.response_event_type = EVENT_RESPONSE_DSP_ERROR;
+                }
+            }
             else if(event.event_type == DSP_SET_MUX)
             {
                 if(dsp_control_mux(&event.mux))
@@ -56,13 +93,32 @@ void dsp_task(void* pvParameters)
                     event_response.response_event_type = EVENT_RESPONSE_DSP_ERROR;
                 }
             }
-            
+
+            // Waits for the writes of this event, also when it failed.
+            if(!dsp_control_flush() &&
+               event_response.response_event_type == EVENT_RESPONSE_OK)
+            {
+                event_response.response_event_type = EVENT_RESPONSE_DSP_ERROR;
+            }
+
             if(!send_event_response(communication, 
                                     &event_response, 
                                     EVENT_STD_TIMEOUT_TICKS))
             {
                 ESP_LOGE(TAG, "Unable to put event response in response queue!");
             }
+            trace_set_current(0);
+        }
+        else
+        {
+            if(!dsp_control_flush())
+            {
+                // Nothing left to report it with.
+                ESP_LOGE(TAG, "DSP write failed!");
+            }
+            // Idle, check a piece of the DSP memory. The scrubber only uses
+            // low priority bus transactions.
+            dsp_control_scrub();
         }
     }
     vTaskDelete(NULL);
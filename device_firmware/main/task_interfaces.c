@@ -16,14 +16,14 @@ static const char *TAG = "Interfaces task";
 
 void task_interfaces(void* pvParameters)
 {
-    communication_t* toSettings = (communication_t*)pvParameters;
+    communication_t** toSettings = (communication_t**)pvParameters;
     uint8_t device_name[] = "easydsp";
 
     // Initialize the BLE, it will run as a task on its own.
     // The buffer is used for the serial ble options, not currently
     // operational.
 
-    init_ble(device_name, toSettings);
+    init_ble(device_name, toSettings, SETTINGS_INTERFACE_AMOUNT);
     
     dsp_event_t          event;
     dsp_event_response_t event_response;
@@ -45,6 +45,9 @@ void task_interfaces(void* pvParameters)
         //         ESP_LOGI(TAG, "Response received from settings!");
         //     }
         // }
+        // Keeps the status in the advertising data up to date. Limits
+        // the updates to the controller to one per loop.
+        ble_refresh_status();
         vTaskDelay(100 / portTICK_PERIOD_MS);
     }
     vTaskDelete(NULL);
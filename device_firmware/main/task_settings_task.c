@@ -7,6 +7,7 @@
 #include "freertos/task.h"
 #include "esp_log.h"
 #include "event.h"
+#include "capture.h"
 
 static const char *TAG = "Settings task";
 
@@ -15,84 +16,92 @@ static const char *TAG = "Settings task";
  * This function is run as a thread by FreeRTOS. This task handles the 
  * initialization of the settings of the EasyDSP. After loading the 
  * settings, it sends all settings to a given queue to other tasks.
+ * Changed settings are stored in NV storage once no event came in for
+ * EVENT_STD_TIMEOUT_MS, a dragged slider costs one store.
  *
  */
 void settings_task(void* pvParameters)
 {
+    boot_profile_begin(BOOT_PHASE_SETTINGS);
     init_device_settings();
-    //device_settings_load_nv();
-
-    device_settings_load_factory();
+    // The settings of the last session, so an MCU reset that left the DSP
+    // running doesn't turn its EQs back to the factory settings. Factory
+    // settings on a new unit.
+    bool nvCurrent = (device_settings_load_nv() == NV_RW_SUCCESS);
+    if(!nvCurrent)
+    {
+        device_settings_load_factory();
+    }
+    uint32_t nvVersion = device_settings_get_version();
+    boot_profile_end(BOOT_PHASE_SETTINGS);
 
     device_settings_t * settings = get_device_settings_address();
 
     dsp_event_t          event;
     dsp_event_response_t event_response;
     event_response.response_event_type = EVENT_RESPONSE_ERROR;
+    event.trace_id = 0;
 
     settings_task_communications_t* queues = (settings_task_communications_t*)pvParameters;
 
     communication_t* communicationDsp        = queues->settings_dsp;
-    communication_t* communicationInterfaces = queues->settings_interfaces;
-
-    // After initializing the settings, let send all the settings to the
-    // DSP task using our communication
-    for(int i = 0; i < DEVICE_SETTINGS_INPUT_AMOUNT; i++)
+    communication_t* communicationInterfaces = NULL;
+
+    // Every interface client has its own pipeline, we wait on all of them
+    // and answer on the one the event came from.
+    communication_set_t* interfacesSet = 
+        dsp_communication_set_create(queues->settings_interfaces,
+                                     SETTINGS_INTERFACE_AMOUNT);
+
+    // After initializing the settings, let the DSP task apply all of them.
+    // One event, the DSP task reads the settings itself and queues all
+    // writes before it waits for them.
+    boot_profile_begin(BOOT_PHASE_SETTINGS_PUSH);
+    event.event_type = DSP_SET_ALL;
+    if(send_event(communicationDsp, 
+                  &event, 
+                  &event_response, 
+                  EVENT_STD_TIMEOUT_TICKS))
     {
-        for(int j = 0; j < DEVICE_SETTINGS_INPUT_EQ_AMOUNT; j++)
+        if(event_response.response_event_type != EVENT_RESPONSE_OK)
         {
-            event.event_type = DSP_SET_EQ;
-            event.eq = settings->inputs[i].eq[j];
-
-            if(send_event(communicationDsp, 
-                          &event, 
-                          &event_response, 
-                          EVENT_STD_TIMEOUT_TICKS))
-            {
-                if(event_response.response_event_type != EVENT_RESPONSE_OK)
-                {
-                    ESP_LOGW(TAG, "Response to event is not OK");
-                }
-            }
+            ESP_LOGW(TAG, "Response to event is not OK");
         }
     }
-    for(int i = 0; i < DEVICE_SETTINGS_OUTPUT_AMOUNT; i++)
+    boot_profile_end(BOOT_PHASE_SETTINGS_PUSH);
+
+    // Infinite loop, waits for event from command interface.
+    for(;;)
     {
-        event.event_type = DSP_SET_MUX;
-        event.mux = settings->outputs[i].mux;
-        if(send_event(communicationDsp, 
-                      &event, 
-                      &event_response, 
-                      EVENT_STD_TIMEOUT_TICKS))
+        communicationInterfaces = await_event_set(interfacesSet, 
+                                                  &event, 
+                                                  EVENT_STD_TIMEOUT_TICKS);
+        if(communicationInterfaces == NULL)
         {
-            if(event_response.response_event_type != EVENT_RESPONSE_OK)
+            // Idle, store what changed since the last store. A failed 
+            // store is tried again on the next timeout.
+            uint32_t version = device_settings_get_version();
+            if((!nvCurrent || version != nvVersion) &&
+               device_settings_store_nv() == NV_RW_SUCCESS)
             {
-                ESP_LOGW(TAG, "Response to event is not OK");
+                nvCurrent = true;
+                nvVersion = version;
             }
         }
-        for(int j = 0; j < DEVICE_SETTINGS_OUTPUT_EQ_AMOUNT; j++)
+        else
         {
-            event.event_type = DSP_SET_EQ;
-            event.eq = settings->outputs[i].eq[j];
-            if(send_event(communicationDsp, 
-                      &event, 
-                      &event_response, 
-                      EVENT_STD_TIMEOUT_TICKS))
+            trace_set_current(event.trace_id);
+            trace_mark(TRACE_STAGE_SETTINGS);
+
+            // Record the command as it came in, before it is handled.
+            for(uint8_t i = 0; i < SETTINGS_INTERFACE_AMOUNT; i++)
             {
-                if(event_response.response_event_type != EVENT_RESPONSE_OK)
+                if(queues->settings_interfaces[i] == communicationInterfaces)
                 {
-                    ESP_LOGW(TAG, "Response to event is not OK");
+                    capture_event(&event, i);
                 }
             }
-        }
-    }  
-
 
-    // Infinite loop, waits for event from command interface.
-    for(;;)
-    {
-        if(await_event(communicationInterfaces, &event, EVENT_STD_TIMEOUT_TICKS))
-        {
             ESP_LOGI(TAG, "Received event!!");
             event_response.response_event_type = EVENT_RESPONSE_ERROR;
 
@@ -149,9 +158,12 @@ void settings_task(void* pvParameters)
                     if(channelNum < DEVICE_SETTINGS_OUTPUT_AMOUNT)
                     {
                         uint16_t old_address = settings->outputs[channelNum].eq[eqNum].sigma_dsp_address;
+                        uint8_t  old_dsp     = settings->outputs[channelNum].eq[eqNum].dsp_index;
                         event.eq.sigma_dsp_address = old_address;
+                        event.eq.dsp_index         = old_dsp;
+                        device_settings_write_begin();
                         settings->outputs[channelNum].eq[eqNum] = event.eq;
-                        settings->outputs[channelNum].eq[eqNum].sigma_dsp_address = old_address;
+                        device_settings_write_end();
                         settingsUpdated = true;
                     }
                 }
@@ -160,9 +172,12 @@ void settings_task(void* pvParameters)
                     if(channelNum < DEVICE_SETTINGS_INPUT_AMOUNT)
                     {
                         uint16_t old_address = settings->inputs[channelNum].eq[eqNum].sigma_dsp_address;
+                        uint8_t  old_dsp     = settings->inputs[channelNum].eq[eqNum].dsp_index;
                         event.eq.sigma_dsp_address = old_address;
+                        event.eq.dsp_index         = old_dsp;
+                        device_settings_write_begin();
                         settings->inputs[channelNum].eq[eqNum] = event.eq;
-                        settings->inputs[channelNum].eq[eqNum].sigma_dsp_address = old_address;
+                        device_settings_write_end();
                         settingsUpdated = true;
                     }
                 }
@@ -190,9 +205,12 @@ void settings_task(void* pvParameters)
                 if(output && channelNum < DEVICE_SETTINGS_OUTPUT_AMOUNT)
                 {
                     uint16_t old_address = settings->outputs[channelNum].mux.sigma_dsp_address;
+                    uint8_t  old_dsp     = settings->outputs[channelNum].mux.dsp_index;
                     event.mux.sigma_dsp_address = old_address;
+                    event.mux.dsp_index         = old_dsp;
+                    device_settings_write_begin();
                     settings->outputs[channelNum].mux = event.mux;
-                    settings->outputs[channelNum].mux.sigma_dsp_address = old_address;
+                    device_settings_write_end();
                 }
                 event.event_type = DSP_SET_MUX;
                 if(send_event(communicationDsp, 
@@ -204,9 +222,31 @@ void settings_task(void* pvParameters)
                 }
             }
 
+            /* BLE SWITCHING PRESET */
+            if(event.event_type == DSP_SET_PRESET)
+            {
+                // The DSP task applies the settings to the new program,
+                // it reads them itself.
+                if(send_event(communicationDsp, 
+                              &event, 
+                              &event_response, 
+                              EVENT_STD_TIMEOUT_TICKS))
+                {
+                    if(event_response.response_event_type == EVENT_RESPONSE_OK)
+                    {
+                        ESP_LOGI(TAG, "Switched to preset %d.", event.preset);
+                    }
+                }
+                else
+                {
+                    event_response.response_event_type = EVENT_RESPONSE_ERROR;
+                }
+            }
+
             send_event_response(communicationInterfaces, 
                                 &event_response, 
                                 EVENT_STD_TIMEOUT_TICKS);
+            trace_set_current(0);
         }
     }
     vTaskDelete(NULL);
@@ -0,0 +1,266 @@
+/*
+ * telemetry.c
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Runtime health of the firmware, see telemetry.h. Needs the FreeRTOS
+ * trace facility and run time stats, both are on in sdkconfig.
+ *
+ */
+/******************************* INCLUDES ********************************/
+
+#include "telemetry.h"
+
+/******************************* GLOBAL VARIABLES ************************/
+
+static const char *TAG = "Telemetry";
+
+static SemaphoreHandle_t lock = NULL;
+static telemetry_t       last;
+
+// Only used by the telemetry task.
+static TaskStatus_t        statuses[TELEMETRY_TASK_MAX];
+static telemetry_counter_t counters[TELEMETRY_TASK_MAX];
+static uint8_t             counterAmount = 0;
+static uint32_t            lastTotal     = 0;
+
+/******************************* LOCAL FUNCTIONS *************************/
+
+static uint8_t* put_u16(uint8_t *buf, uint16_t value)
+{
+    *buf++ = value;
+    *buf++ = value >> 8;
+    return buf;
+}
+
+static uint8_t* put_u32(uint8_t *buf, uint32_t value)
+{
+    *buf++ = value;
+    *buf++ = value >> 8;
+    *buf++ = value >> 16;
+    *buf++ = value >> 24;
+    return buf;
+}
+
+// Run time of a task at the previous sample, 0 for a new task.
+static uint32_t telemetry_previous(UBaseType_t number)
+{
+    for(int i = 0; i < counterAmount; i++)
+    {
+        if(counters[i].number == number)
+        {
+            return counters[i].counter;
+        }
+    }
+    return 0;
+}
+
+void telemetry_sample(void)
+{
+    static telemetry_t sample;
+    uint32_t           total = 0;
+    UBaseType_t        amount;
+
+    memset(&sample, 0, sizeof(sample));
+
+    // Fails when there are more tasks than statuses.
+    amount = uxTaskGetSystemState(statuses, TELEMETRY_TASK_MAX, &total);
+    if(amount == 0)
+    {
+        ESP_LOGW(TAG, "More than %d tasks, not sampled!", TELEMETRY_TASK_MAX);
+    }
+
+    uint32_t elapsed = total - lastTotal;
+
+    for(int i = 0; i < amount; i++)
+    {
+        telemetry_task_t *task  = &sample.tasks[i];
+        uint32_t         delta  = statuses[i].ulRunTimeCounter - 
+                                  telemetry_previous(statuses[i].xTaskNumber);
+
+        strncpy(task->name, statuses[i].pcTaskName, TELEMETRY_NAME_LEN);
+        task->cpu        = elapsed ? (uint64_t)delta * 1000 / elapsed : 0;
+        task->stack_free = statuses[i].usStackHighWaterMark;
+    }
+    sample.task_amount = amount;
+
+    for(int i = 0; i < amount; i++)
+    {
+        counters[i].number  = statuses[i].xTaskNumber;
+        counters[i].counter = statuses[i].ulRunTimeCounter;
+    }
+    counterAmount = amount;
+    lastTotal     = total;
+
+    sample.uptime         = esp_timer_get_time() / 1000000;
+    sample.heap_free      = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    sample.heap_minimum   = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+    sample.heap_largest   = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+    sample.eeprom_commits = eeprom_commits();
+    sample.scrub_repairs  = dsp_control_scrub_repairs();
+
+    for(int i = 0; i < I2C_BUS_PORT_AMOUNT; i++)
+    {
+        i2c_bus_stats(i, &sample.buses[i]);
+    }
+
+    sample.queue_amount = dsp_communication_amount();
+    for(int i = 0; i < sample.queue_amount && i < EVENT_COMMUNICATION_MAX; i++)
+    {
+        communication_t *communication = dsp_communication_get(i);
+
+        sample.queues[i][0] = uxQueueMessagesWaiting(communication->event_queue);
+        sample.queues[i][1] = 
+            uxQueueMessagesWaiting(communication->event_response_queue);
+    }
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    last = sample;
+    xSemaphoreGive(lock);
+}
+
+/*
+ * Function: telemetry_task
+ * ----------------------------
+ *
+ * Samples once per period. The CPU use of a task is its share of the
+ * time since the previous sample.
+ *
+ */
+void telemetry_task(void *pvParameters)
+{
+    TickType_t wake = xTaskGetTickCount();
+
+    for(;;)
+    {
+        telemetry_sample();
+        vTaskDelayUntil(&wake, TELEMETRY_PERIOD_MS / portTICK_PERIOD_MS);
+    }
+    vTaskDelete(NULL);
+}
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+uint8_t init_telemetry(void)
+{
+    if(lock == NULL)
+    {
+        lock = xSemaphoreCreateMutex();
+    }
+    if(lock != NULL && 
+       xTaskCreatePinnedToCore(telemetry_task, 
+                               "Telemetry", 
+                               TELEMETRY_STACK_SIZE, 
+                               NULL, 
+                               TELEMETRY_PRIORITY, 
+                               NULL, 
+                               tskNO_AFFINITY) == pdPASS)
+    {
+        return TELEMETRY_INIT_SUCCESS;
+    }
+    ESP_LOGE(TAG, "Unable to start telemetry!");
+    return TELEMETRY_INIT_FAILED;
+}
+
+uint16_t telemetry_serialize(uint8_t *buf, uint16_t len)
+{
+    static telemetry_t sample;
+
+    if(lock == NULL || buf == NULL || len < TELEMETRY_RECORD_MAX)
+    {
+        return 0;
+    }
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    sample = last;
+    xSemaphoreGive(lock);
+
+    uint8_t *p = buf;
+    *p++ = TELEMETRY_RECORD_FORMAT;
+    *p++ = sample.task_amount;
+    *p++ = I2C_BUS_PORT_AMOUNT;
+    *p++ = sample.queue_amount;
+    p = put_u32(p, sample.uptime);
+    p = put_u32(p, sample.heap_free);
+    p = put_u32(p, sample.heap_minimum);
+    p = put_u32(p, sample.heap_largest);
+    p = put_u32(p, sample.eeprom_commits);
+    p = put_u32(p, sample.scrub_repairs);
+
+    for(int i = 0; i < sample.task_amount; i++)
+    {
+        // Names are zero padded.
+        strncpy((char*)p, sample.tasks[i].name, TELEMETRY_NAME_LEN);
+        p += TELEMETRY_NAME_LEN;
+        p = put_u16(p, sample.tasks[i].cpu);
+        p = put_u16(p, sample.tasks[i].stack_free);
+    }
+
+    for(int i = 0; i < I2C_BUS_PORT_AMOUNT; i++)
+    {
+        p = put_u32(p, sample.buses[i].transactions);
+        p = put_u32(p, sample.buses[i].bytes);
+        p = put_u32(p, sample.buses[i].errors);
+    }
+
+    for(int i = 0; i < sample.queue_amount; i++)
+    {
+        *p++ = sample.queues[i][0];
+        *p++ = sample.queues[i][1];
+    }
+    return (uint16_t)(p - buf);
+}
+
+void telemetry_print(void)
+{
+    static telemetry_t sample;
+
+    if(lock == NULL)
+    {
+        printf("Telemetry not running\n");
+        return;
+    }
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    sample = last;
+    xSemaphoreGive(lock);
+
+    printf("uptime %lu s\n", (unsigned long)sample.uptime);
+    printf("heap free %lu, minimum %lu, largest block %lu\n",
+           (unsigned long)sample.heap_free,
+           (unsigned long)sample.heap_minimum,
+           (unsigned long)sample.heap_largest);
+    printf("eeprom commits %lu, scrub repairs %lu\n",
+           (unsigned long)sample.eeprom_commits,
+           (unsigned long)sample.scrub_repairs);
+
+    printf("%-9s %7s %11s\n", "task", "cpu %", "stack free");
+    for(int i = 0; i < sample.task_amount; i++)
+    {
+        printf("%-9s %5u.%u %11u\n",
+               sample.tasks[i].name,
+               sample.tasks[i].cpu / 10,
+               sample.tasks[i].cpu % 10,
+               sample.tasks[i].stack_free);
+    }
+
+    for(int i = 0; i < I2C_BUS_PORT_AMOUNT; i++)
+    {
+        printf("i2c %d: %lu transactions, %lu bytes, %lu errors\n",
+               i,
+               (unsigned long)sample.buses[i].transactions,
+               (unsigned long)sample.buses[i].bytes,
+               (unsigned long)sample.buses[i].errors);
+    }
+
+    for(int i = 0; i < sample.queue_amount; i++)
+    {
+        printf("queue %d: %u events, %u responses\n",
+               i,
+               sample.queues[i][0],
+               sample.queues[i][1]);
+    }
+}
+
+/******************************* THE END *********************************/
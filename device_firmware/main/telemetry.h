@@ -0,0 +1,117 @@
+/*
+ * telemetry.h
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Runtime health of the firmware. A low priority task samples CPU use and
+ * stack headroom of every task, the heap, the depths of the event queues
+ * and the I2C, EEPROM and scrubber counters. The last sample is read over
+ * BLE as a binary record or printed on the console.
+ *
+ * Sampling suspends the scheduler once per period for a walk over the
+ * tasks, everything else reads counters that are kept anyway.
+ *
+ */
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+/******************************* INCLUDES ********************************/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "event.h"
+#include "i2c_bus.h"
+#include "eeprom.h"
+#include "dsp_control.h"
+
+/******************************* DEFINES *********************************/
+
+#define TELEMETRY_PERIOD_MS     10000
+#define TELEMETRY_STACK_SIZE    3072
+#define TELEMETRY_PRIORITY      1
+#define TELEMETRY_TASK_MAX      32   /* Tasks sampled, IDF ones included */
+#define TELEMETRY_NAME_LEN      8    /* Task name in the record          */
+
+// Telemetry record, little endian:
+//   u8 format, u8 task amount, u8 bus amount, u8 queue amount,
+//   u32 uptime s, u32 heap free, u32 heap minimum, u32 heap largest block,
+//   u32 EEPROM commits, u32 scrub repairs,
+//   per task:  char name[8], u16 CPU in per mille of one core,
+//              u16 stack never used in bytes
+//   per bus:   u32 transactions, u32 bytes, u32 errors
+//   per queue: u8 events waiting, u8 responses waiting
+#define TELEMETRY_RECORD_FORMAT 1
+#define TELEMETRY_RECORD_HEADER 28
+#define TELEMETRY_RECORD_TASK   (TELEMETRY_NAME_LEN + 4)
+#define TELEMETRY_RECORD_BUS    12
+#define TELEMETRY_RECORD_QUEUE  2
+#define TELEMETRY_RECORD_MAX    (TELEMETRY_RECORD_HEADER + \
+                                 TELEMETRY_TASK_MAX * TELEMETRY_RECORD_TASK + \
+                                 I2C_BUS_PORT_AMOUNT * TELEMETRY_RECORD_BUS + \
+                                 EVENT_COMMUNICATION_MAX * TELEMETRY_RECORD_QUEUE)
+
+#define TELEMETRY_INIT_SUCCESS  1
+#define TELEMETRY_INIT_FAILED   0
+
+/******************************* TYPEDEFS ********************************/
+
+typedef struct
+{
+    char     name[TELEMETRY_NAME_LEN + 1];
+    uint16_t cpu;
+    uint16_t stack_free;
+} telemetry_task_t;
+
+typedef struct
+{
+    uint32_t uptime;
+    uint32_t heap_free;
+    uint32_t heap_minimum;
+    uint32_t heap_largest;
+    uint32_t eeprom_commits;
+    uint32_t scrub_repairs;
+
+    uint8_t          task_amount;
+    telemetry_task_t tasks[TELEMETRY_TASK_MAX];
+
+    i2c_bus_stats_t  buses[I2C_BUS_PORT_AMOUNT];
+
+    uint8_t          queue_amount;
+    uint8_t          queues[EVENT_COMMUNICATION_MAX][2];
+} telemetry_t;
+
+// Run time counter of a task at the previous sample.
+typedef struct
+{
+    UBaseType_t number;
+    uint32_t    counter;
+} telemetry_counter_t;
+
+/******************************* LOCAL FUNCTIONS *************************/
+
+void telemetry_task(void *pvParameters);
+
+void telemetry_sample(void);
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+uint8_t init_telemetry(void);
+
+// Writes the record of the last sample, returns its length or 0.
+uint16_t telemetry_serialize(uint8_t *buf, uint16_t len);
+
+void telemetry_print(void);
+
+/******************************* THE END *********************************/
+
+#endif /* TELEMETRY_H_ */
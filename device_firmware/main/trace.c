@@ -0,0 +1,275 @@
+/*
+ * trace.c
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Latency tracing of client requests, see trace.h. Marking is a timer
+ * read and a few table lookups in a critical section, cheap enough to
+ * leave on.
+ *
+ */
+/******************************* INCLUDES ********************************/
+
+#include "trace.h"
+
+/******************************* GLOBAL VARIABLES ************************/
+
+static portMUX_TYPE trace_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static trace_entry_t    ring[TRACE_RING_SIZE];
+static uint16_t         ring_head  = 0;
+static bool             ring_full  = false;
+static trace_task_t     tasks[TRACE_TASK_SLOTS];
+static trace_inflight_t inflight[TRACE_INFLIGHT];
+static uint8_t          inflight_next = 0;
+static uint16_t         next_id = 1;
+static uint32_t         histograms[TRACE_STAGE_AMOUNT][TRACE_BUCKET_AMOUNT];
+
+static const char *stage_names[TRACE_STAGE_AMOUNT] = {
+    "gatt_write",
+    "event_send",
+    "settings",
+    "dsp_task",
+    "compute",
+    "write_start",
+    "write_end",
+    "response",
+};
+
+/******************************* LOCAL FUNCTIONS *************************/
+
+uint8_t trace_bucket(uint32_t latency)
+{
+    uint8_t bucket = 0;
+
+    latency >>= TRACE_BUCKET_SHIFT + 1;
+    while(latency != 0 && bucket < TRACE_BUCKET_AMOUNT - 1)
+    {
+        latency >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+// Only called with the lock taken.
+static void trace_record(uint16_t id, uint8_t stage, uint32_t now)
+{
+    trace_inflight_t *request = NULL;
+
+    ring[ring_head].time     = now;
+    ring[ring_head].id       = id;
+    ring[ring_head].stage    = stage;
+    ring[ring_head].reserved = 0;
+    ring_head = (ring_head + 1) % TRACE_RING_SIZE;
+    if(ring_head == 0)
+    {
+        ring_full = true;
+    }
+
+    for(int i = 0; i < TRACE_INFLIGHT; i++)
+    {
+        if(inflight[i].id == id)
+        {
+            request = &inflight[i];
+        }
+    }
+    if(request == NULL)
+    {
+        // The oldest request makes room, it is done long ago.
+        request       = &inflight[inflight_next];
+        inflight_next = (inflight_next + 1) % TRACE_INFLIGHT;
+        request->id   = id;
+    }
+    else
+    {
+        histograms[stage][trace_bucket(now - request->last)]++;
+    }
+    request->last = now;
+}
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+uint16_t trace_begin(void)
+{
+    uint16_t id;
+
+    taskENTER_CRITICAL(&trace_lock);
+    id = next_id++;
+    if(next_id == 0)
+    {
+        next_id = 1;
+    }
+    taskEXIT_CRITICAL(&trace_lock);
+
+    trace_set_current(id);
+    trace_mark(TRACE_STAGE_GATT_WRITE);
+    return id;
+}
+
+void trace_set_current(uint16_t id)
+{
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    trace_task_t *free = NULL;
+
+    taskENTER_CRITICAL(&trace_lock);
+    for(int i = 0; i < TRACE_TASK_SLOTS; i++)
+    {
+        if(tasks[i].task == task)
+        {
+            tasks[i].id = id;
+            free        = NULL;
+            break;
+        }
+        if(tasks[i].task == NULL && free == NULL)
+        {
+            free = &tasks[i];
+        }
+    }
+    if(free != NULL)
+    {
+        free->task = task;
+        free->id   = id;
+    }
+    taskEXIT_CRITICAL(&trace_lock);
+}
+
+uint16_t trace_current(void)
+{
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    uint16_t     id   = 0;
+
+    taskENTER_CRITICAL(&trace_lock);
+    for(int i = 0; i < TRACE_TASK_SLOTS; i++)
+    {
+        if(tasks[i].task == task)
+        {
+            id = tasks[i].id;
+        }
+    }
+    taskEXIT_CRITICAL(&trace_lock);
+    return id;
+}
+
+void trace_mark(uint8_t stage)
+{
+    trace_mark_id(trace_current(), stage);
+}
+
+void trace_mark_id(uint16_t id, uint8_t stage)
+{
+    if(id == 0 || stage >= TRACE_STAGE_AMOUNT)
+    {
+        return;
+    }
+
+    uint32_t now = (uint32_t)esp_timer_get_time();
+
+    taskENTER_CRITICAL(&trace_lock);
+    trace_record(id, stage, now);
+    taskEXIT_CRITICAL(&trace_lock);
+}
+
+uint16_t trace_serialize(uint8_t *buf, uint16_t len)
+{
+    if(buf == NULL || len < TRACE_RECORD_LEN)
+    {
+        return 0;
+    }
+
+    uint8_t *p = buf;
+    *p++ = TRACE_RECORD_FORMAT;
+    *p++ = TRACE_STAGE_AMOUNT;
+    *p++ = TRACE_BUCKET_AMOUNT;
+    *p++ = TRACE_BUCKET_SHIFT;
+
+    taskENTER_CRITICAL(&trace_lock);
+    for(int i = 0; i < TRACE_STAGE_AMOUNT; i++)
+    {
+        for(int j = 0; j < TRACE_BUCKET_AMOUNT; j++)
+        {
+            uint32_t count = histograms[i][j];
+
+            *p++ = count;
+            *p++ = count >> 8;
+            *p++ = count >> 16;
+            *p++ = count >> 24;
+        }
+    }
+    taskEXIT_CRITICAL(&trace_lock);
+    return (uint16_t)(p - buf);
+}
+
+void trace_print_histograms(void)
+{
+    uint32_t copy[TRACE_STAGE_AMOUNT][TRACE_BUCKET_AMOUNT];
+
+    taskENTER_CRITICAL(&trace_lock);
+    memcpy(copy, histograms, sizeof(copy));
+    taskEXIT_CRITICAL(&trace_lock);
+
+    printf("%-12s", "stage/us <");
+    for(int j = 0; j < TRACE_BUCKET_AMOUNT - 1; j++)
+    {
+        printf("%8lu", (unsigned long)(1 << (TRACE_BUCKET_SHIFT + j + 1)));
+    }
+    printf("%8s\n", "more");
+
+    // The first stage starts a request, there is nothing before it.
+    for(int i = TRACE_STAGE_GATT_WRITE + 1; i < TRACE_STAGE_AMOUNT; i++)
+    {
+        printf("%-12s", stage_names[i]);
+        for(int j = 0; j < TRACE_BUCKET_AMOUNT; j++)
+        {
+            printf("%8lu", (unsigned long)copy[i][j]);
+        }
+        printf("\n");
+    }
+}
+
+void trace_print_ring(void)
+{
+    trace_entry_t entry;
+    uint16_t      amount;
+    uint16_t      start;
+
+    taskENTER_CRITICAL(&trace_lock);
+    amount = ring_full ? TRACE_RING_SIZE : ring_head;
+    start  = ring_full ? ring_head : 0;
+    taskEXIT_CRITICAL(&trace_lock);
+
+    // One line per mark, easy to load in a spreadsheet. Marks made while
+    // printing may overwrite the oldest lines.
+    printf("time_us,id,stage\n");
+    for(int i = 0; i < amount; i++)
+    {
+        taskENTER_CRITICAL(&trace_lock);
+        entry = ring[(start + i) % TRACE_RING_SIZE];
+        taskEXIT_CRITICAL(&trace_lock);
+
+        printf("%lu,%u,%s\n",
+               (unsigned long)entry.time,
+               entry.id,
+               trace_stage_name(entry.stage));
+    }
+}
+
+void trace_clear(void)
+{
+    taskENTER_CRITICAL(&trace_lock);
+    memset(histograms, 0, sizeof(histograms));
+    ring_head = 0;
+    ring_full = false;
+    taskEXIT_CRITICAL(&trace_lock);
+}
+
+const char* trace_stage_name(uint8_t stage)
+{
+    if(stage < TRACE_STAGE_AMOUNT)
+    {
+        return stage_names[stage];
+    }
+    return "?";
+}
+
+/******************************* THE END *********************************/
@@ -0,0 +1,115 @@
+/*
+ * trace.h
+ *
+ * Created: 19-10-2026
+ * Author: Perry Petiet
+ *
+ * Latency tracing of client requests. A request gets an id when the GATT
+ * write comes in, every task it passes marks the stages with that id.
+ * Marks go into a ring of esp_timer timestamps and into a histogram per
+ * stage of the time since the previous mark of the same request.
+ *
+ * A task handles one request at a time, so the id travels in dsp_event_t
+ * between tasks and is the "current" id of a task while it handles it.
+ * Marks with id 0 are not traced.
+ *
+ */
+#ifndef TRACE_H_
+#define TRACE_H_
+
+/******************************* INCLUDES ********************************/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/******************************* DEFINES *********************************/
+
+// Stages in the order a request passes them.
+#define TRACE_STAGE_GATT_WRITE   0  /* Client write, starts the request */
+#define TRACE_STAGE_EVENT_SEND   1  /* send_event() called             */
+#define TRACE_STAGE_SETTINGS     2  /* Settings task received it       */
+#define TRACE_STAGE_DSP_TASK     3  /* DSP task received it            */
+#define TRACE_STAGE_COMPUTE      4  /* Coefficients computed           */
+#define TRACE_STAGE_WRITE_START  5  /* DSP write handed to the bus     */
+#define TRACE_STAGE_WRITE_END    6  /* I2C transaction done            */
+#define TRACE_STAGE_RESPONSE     7  /* send_event() got its response   */
+#define TRACE_STAGE_AMOUNT       8
+
+#define TRACE_RING_SIZE          256
+#define TRACE_TASK_SLOTS         8   /* Tasks that handle requests      */
+#define TRACE_INFLIGHT           8   /* Requests followed at once       */
+
+// Histogram bucket b counts latencies below 16 << (b + 1) us, the last
+// one everything above.
+#define TRACE_BUCKET_AMOUNT      12
+#define TRACE_BUCKET_SHIFT       4
+
+// Histogram record, little endian:
+//   u8 format, u8 stage amount, u8 bucket amount, u8 bucket shift,
+//   u32 count[stage][bucket]
+#define TRACE_RECORD_FORMAT      1
+#define TRACE_RECORD_LEN         (4 + TRACE_STAGE_AMOUNT * \
+                                  TRACE_BUCKET_AMOUNT * 4)
+
+/******************************* TYPEDEFS ********************************/
+
+typedef struct __attribute__((packed))
+{
+    uint32_t time;     /* esp_timer time, lower 32 bits of us */
+    uint16_t id;
+    uint8_t  stage;
+    uint8_t  reserved;
+} trace_entry_t;
+
+typedef struct
+{
+    TaskHandle_t task;
+    uint16_t     id;
+} trace_task_t;
+
+typedef struct
+{
+    uint16_t id;
+    uint32_t last;
+} trace_inflight_t;
+
+/******************************* LOCAL FUNCTIONS *************************/
+
+uint8_t trace_bucket(uint32_t latency);
+
+/******************************* GLOBAL FUNCTIONS ************************/
+
+// Starts a request in the calling task and returns its id.
+uint16_t trace_begin(void);
+
+// Makes id the request the calling task works on, 0 for none.
+void trace_set_current(uint16_t id);
+
+uint16_t trace_current(void);
+
+// Marks a stage of the current request of the calling task.
+void trace_mark(uint8_t stage);
+
+// Marks a stage of a request from outside its task, like a completion
+// callback.
+void trace_mark_id(uint16_t id, uint8_t stage);
+
+// Writes the histogram record, returns its length or 0.
+uint16_t trace_serialize(uint8_t *buf, uint16_t len);
+
+// Prints the histograms or the ring, oldest first.
+void trace_print_histograms(void);
+void trace_print_ring(void);
+
+void trace_clear(void);
+
+const char* trace_stage_name(uint8_t stage);
+
+/******************************* THE END *********************************/
+
+#endif /* TRACE_H_ */